@@ -113,6 +113,30 @@ namespace BlockParams {
    };
 }
 
+/*! A namespace for storing indices into an array which contains the
+ * velocity moments of a particle species, accumulated by the Vlasov solvers
+ * while they write the propagated distribution function (if
+ * vlasovsolver.fuse_moments is enabled). The moments are not weighted
+ * by particle mass. First and second moments are taken about a reference 
+ * velocity u close to the bulk velocity, so that central moments can be 
+ * obtained from them without cancellation in cold, fast drifting plasma.*/
+namespace FusedMoments {
+   enum {
+      M0,     /*!< Sum of f*dV, i.e., number density.*/
+      M1X,    /*!< Sum of f*(vx-ux)*dV.*/
+      M1Y,    /*!< Sum of f*(vy-uy)*dV.*/
+      M1Z,    /*!< Sum of f*(vz-uz)*dV.*/
+      M2X,    /*!< Sum of f*(vx-ux)^2*dV.*/
+      M2Y,    /*!< Sum of f*(vy-uy)^2*dV.*/
+      M2Z,    /*!< Sum of f*(vz-uz)^2*dV.*/
+      N_FUSED_SUMS,
+      UX = N_FUSED_SUMS, /*!< Reference velocity ux, not a sum.*/
+      UY,     /*!< Reference velocity uy, not a sum.*/
+      UZ,     /*!< Reference velocity uz, not a sum.*/
+      N_FUSED_MOMENTS
+   };
+}
+
 /*! A namespace for storing indices into an array which contains the 
  * physical parameters of each spatial cell. Do not change the order 
  * of variables unless you know what you are doing - MPI transfers in 
@@ -225,6 +249,7 @@ namespace CellParams {
                            * this is the max allowed timestep over all particle species.*/
       MAXFDT,             /*!< maximum timestep allowed in ordinary space by fieldsolver for this cell**/
       LBWEIGHTCOUNTER,    /*!< Counter for storing compute time weights needed by the load balancing**/
+      LBWEIGHTPREDICTED,  /*!< Compute time of the cell predicted by the cost model at the last rebalance**/
       ACCSUBCYCLES,        /*!< number of subcyles for each cell*/
       ISCELLSAVINGF,      /*!< Value telling whether a cell is saving its distribution function when partial f data is written out. */
       PHI,        /*!< Electrostatic potential.*/
@@ -352,7 +377,11 @@ RK_ORDER2_STEP1,   /*!< Two-step second order method, first step */
 RK_ORDER2_STEP2    /*!< Two-step second order method, second step */
 };
 
-const uint WID = 4;         /*!< Number of cells per coordinate in a velocity block. Only a value of 4 supported by vectorized Leveque solver */
+#ifndef VELOCITY_BLOCK_WIDTH
+   #define VELOCITY_BLOCK_WIDTH 4
+#endif
+const uint WID = VELOCITY_BLOCK_WIDTH; /*!< Number of cells per coordinate in a velocity block, set with -DVELOCITY_BLOCK_WIDTH (default 4). 
+                                        * The vector length VECL has to divide WID*WID.*/
 const uint WID2 = WID*WID;  /*!< Number of cells per 2D slab in a velocity block. */
 const uint WID3 = WID2*WID; /*!< Number of cells in a velocity block. */
 
@@ -122,6 +122,11 @@ void initializeDataReducers(DataReducer * outputReducer, DataReducer * diagnosti
          outputReducer->addOperator(new DRO::DataReductionOperatorCellParams("LB_weight",CellParams::LBWEIGHTCOUNTER,1));
          continue;
       }
+      if(*it == "LBweightPredicted") {
+         // Compute time predicted by the load balance cost model, compare to LB_weight
+         outputReducer->addOperator(new DRO::DataReductionOperatorCellParams("LB_weight_predicted",CellParams::LBWEIGHTPREDICTED,1));
+         continue;
+      }
       if(*it == "MaxVdt") {
          outputReducer->addOperator(new DRO::DataReductionOperatorCellParams("max_v_dt",CellParams::MAXVDT,1));
          continue;
@@ -371,6 +376,11 @@ void initializeDataReducers(DataReducer * outputReducer, DataReducer * diagnosti
          diagnosticReducer->addOperator(new DRO::DataReductionOperatorCellParams("LB_weight",CellParams::LBWEIGHTCOUNTER,1));
          continue;
       }
+      if(*it == "LBweightPredicted") {
+         // Compute time predicted by the load balance cost model, compare to LB_weight
+         diagnosticReducer->addOperator(new DRO::DataReductionOperatorCellParams("LB_weight_predicted",CellParams::LBWEIGHTPREDICTED,1));
+         continue;
+      }
       if(*it == "MaxVdt") {
          diagnosticReducer->addOperator(new DRO::DataReductionOperatorCellParams("max_v_dt",CellParams::MAXVDT,1));
          continue;
@@ -471,6 +481,16 @@ bool DataReducer::handlesWriting(const unsigned int& operatorID) const {
    return operators[operatorID]->handlesWriting();
 }
 
+/** Ask if a DataReductionOperator is computed from velocity space sums, i.e., if it 
+ * shares the pass over the velocity blocks with other such operators when reduced 
+ * in the same batch.
+ * @param operatorID ID number of the DataReductionOperator.
+ * @return If true, the operator is computed from velocity space sums.*/
+bool DataReducer::usesVelocitySpaceSums(const unsigned int& operatorID) const {
+   if (operatorID >= operators.size()) return false;
+   return operators[operatorID]->getVelocitySpaceSums() != 0;
+}
+
 /** Request a DataReductionOperator to calculate its output data and to write it to the given buffer.
  * @param cell Pointer to spatial cell whose data is to be reduced.
  * @param operatorID ID number of the applied DataReductionOperator.
@@ -501,6 +521,105 @@ bool DataReducer::reduceData(const SpatialCell* cell,const unsigned int& operato
    return true;
 }
 
+/** Request several DataReductionOperators to calculate their output data for many spatial cells.
+ * Operators computed from velocity space sums (see DRO::DataReductionOperator::getVelocitySpaceSums) 
+ * share one pass over the velocity blocks of each cell, and cells are reduced in parallel. Other 
+ * operators keep per-cell state and are applied to the cells serially.
+ * @param cells Spatial cells whose data is to be reduced.
+ * @param operatorIDs ID numbers of the applied DataReductionOperators.
+ * @param buffers Output buffer of each operator. Data of cells[i] is written at offset 
+ * i*vectorSize*dataSize, as given by getDataVectorInfo.
+ * @return If true, all DataReductionOperators calculated and wrote data successfully.
+ */
+bool DataReducer::reduceData(const std::vector<const SpatialCell*>& cells,const std::vector<unsigned int>& operatorIDs,
+                             const std::vector<char*>& buffers) {
+   if (operatorIDs.size() != buffers.size()) return false;
+   bool success = true;
+   vector<unsigned int> fusedIDs;
+   vector<char*> fusedBuffers;
+   vector<size_t> fusedStrides;
+   for (size_t op=0; op<operatorIDs.size(); ++op) {
+      string dataType;
+      unsigned int dataSize,vectorSize;
+      if (getDataVectorInfo(operatorIDs[op],dataType,dataSize,vectorSize) == false) return false;
+      const size_t stride = dataSize*vectorSize;
+      
+      if (operators[operatorIDs[op]]->getVelocitySpaceSums() != 0) {
+         fusedIDs.push_back(operatorIDs[op]);
+         fusedBuffers.push_back(buffers[op]);
+         fusedStrides.push_back(stride);
+         continue;
+      }
+      for (size_t c=0; c<cells.size(); ++c) {
+         if (reduceData(cells[c],operatorIDs[op],buffers[op] + c*stride) == false) success = false;
+      }
+   }
+   if (reduceVelocityMoments(cells,fusedIDs,fusedBuffers,fusedStrides) == false) success = false;
+   return success;
+}
+
+/** Request several DataReductionOperators to calculate their output data for many spatial cells, 
+ * writing one Real value per cell. Intended for diagnostic operators, which return scalars.
+ * @param cells Spatial cells whose data is to be reduced.
+ * @param operatorIDs ID numbers of the applied DataReductionOperators.
+ * @param results Output array of each operator, the value of cells[i] is written to results[op][i].
+ * @return If true, all DataReductionOperators calculated and wrote data successfully.
+ * @see DataReducer::reduceData(const std::vector<const SpatialCell*>&,const std::vector<unsigned int>&,const std::vector<char*>&).
+ */
+bool DataReducer::reduceData(const std::vector<const SpatialCell*>& cells,const std::vector<unsigned int>& operatorIDs,
+                             const std::vector<Real*>& results) {
+   if (operatorIDs.size() != results.size()) return false;
+   bool success = true;
+   vector<unsigned int> fusedIDs;
+   vector<char*> fusedBuffers;
+   vector<size_t> fusedStrides;
+   for (size_t op=0; op<operatorIDs.size(); ++op) {
+      string dataType;
+      unsigned int dataSize,vectorSize;
+      if (getDataVectorInfo(operatorIDs[op],dataType,dataSize,vectorSize) == false) return false;
+      
+      if (operators[operatorIDs[op]]->getVelocitySpaceSums() != 0 && dataSize*vectorSize == sizeof(Real)) {
+         fusedIDs.push_back(operatorIDs[op]);
+         fusedBuffers.push_back(reinterpret_cast<char*>(results[op]));
+         fusedStrides.push_back(sizeof(Real));
+         continue;
+      }
+      for (size_t c=0; c<cells.size(); ++c) {
+         if (reduceData(cells[c],operatorIDs[op],results[op] + c) == false) success = false;
+      }
+   }
+   if (reduceVelocityMoments(cells,fusedIDs,fusedBuffers,fusedStrides) == false) success = false;
+   return success;
+}
+
+/** Apply DataReductionOperators computed from velocity space sums to many spatial cells. 
+ * The sums needed by all operators are computed once per cell, cells are distributed 
+ * dynamically over threads since their block counts differ.
+ * @param cells Spatial cells whose data is to be reduced.
+ * @param operatorIDs ID numbers of the applied DataReductionOperators.
+ * @param buffers Output buffer of each operator.
+ * @param strides Byte size of the data of one cell in each buffer.
+ * @return If true, all DataReductionOperators calculated and wrote data successfully.
+ */
+bool DataReducer::reduceVelocityMoments(const std::vector<const SpatialCell*>& cells,const std::vector<unsigned int>& operatorIDs,
+                                        const std::vector<char*>& buffers,const std::vector<size_t>& strides) {
+   if (operatorIDs.size() == 0) return true;
+   
+   uint sums = 0;
+   for (size_t op=0; op<operatorIDs.size(); ++op) sums |= operators[operatorIDs[op]]->getVelocitySpaceSums();
+   
+   int failures = 0;
+   #pragma omp parallel for schedule(dynamic) reduction(+:failures)
+   for (size_t c=0; c<cells.size(); ++c) {
+      DRO::VelocityMoments moments;
+      DRO::calculateVelocityMoments(cells[c],sums,moments);
+      for (size_t op=0; op<operatorIDs.size(); ++op) {
+         if (operators[operatorIDs[op]]->reduceMoments(cells[c],moments,buffers[op] + c*strides[op]) == false) ++failures;
+      }
+   }
+   return failures == 0;
+}
+
 /** Get the number of DataReductionOperators stored in DataReducer.
  * @return Number of DataReductionOperators stored in DataReducer.
  */
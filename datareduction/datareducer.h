@@ -47,7 +47,12 @@ class DataReducer {
    bool handlesWriting(const unsigned int& operatorID) const;
    bool reduceData(const SpatialCell* cell,const unsigned int& operatorID,char* buffer);
    bool reduceData(const SpatialCell* cell,const unsigned int& operatorID,Real * result);
+   bool reduceData(const std::vector<const SpatialCell*>& cells,const std::vector<unsigned int>& operatorIDs,
+                   const std::vector<char*>& buffers);
+   bool reduceData(const std::vector<const SpatialCell*>& cells,const std::vector<unsigned int>& operatorIDs,
+                   const std::vector<Real*>& results);
    unsigned int size() const;
+   bool usesVelocitySpaceSums(const unsigned int& operatorID) const;
    bool writeData(const unsigned int& operatorID,
                   const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                   const std::vector<CellID>& cells,const std::string& meshName,
@@ -57,6 +62,8 @@ class DataReducer {
    /** Private copy-constructor to prevent copying the class.
     */
    DataReducer(const DataReducer& dr);
+   bool reduceVelocityMoments(const std::vector<const SpatialCell*>& cells,const std::vector<unsigned int>& operatorIDs,
+                              const std::vector<char*>& buffers,const std::vector<size_t>& strides);
    
    std::vector<DRO::DataReductionOperator*> operators;
    /**< A container for all DRO::DataReductionOperators stored in DataReducer.*/
@@ -131,6 +131,173 @@ namespace DRO {
    
    
    
+   /** Get the velocity space sums this DataReductionOperator is computed from.
+    * @return Bitwise or of DRO::velocitysums flags. The base class function returns zero, 
+    * i.e. the operator is not computed from DRO::VelocityMoments.
+    * @see DataReductionOperator::reduceMoments.*/
+   uint DataReductionOperator::getVelocitySpaceSums() const {return 0;}
+   
+   /** Reduce the data of a spatial cell from precomputed velocity space sums and write the data 
+    * vector to the given buffer. This function must not modify the operator, so that it can be 
+    * called for many cells in parallel. It is only called if getVelocitySpaceSums returned nonzero.
+    * @param cell The SpatialCell whose data is reduced.
+    * @param moments Velocity space sums of the cell, computed with the flags given by getVelocitySpaceSums.
+    * @param buffer Buffer in which the reduced data is written.
+    * @return If true, DataReductionOperator reduced data successfully.*/
+   bool DataReductionOperator::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      cerr << "ERROR: DataReductionOperator::reduceMoments called instead of derived class function!" << endl;
+      return false;
+   }
+   
+   /** Copy reduced values into an output buffer.*/
+   static void copyToBuffer(const Real* values,const uint& count,char* buffer) {
+      const char* ptr = reinterpret_cast<const char*>(values);
+      for (uint i = 0; i < count*sizeof(Real); ++i) buffer[i] = ptr[i];
+   }
+   
+   /** Compute the requested velocity space sums of a spatial cell. All requested sums are 
+    * accumulated in one pass over the velocity blocks of each population, the pressure tensors 
+    * need a second pass since they are central moments. The computation is serial, callers 
+    * reducing many cells parallelize over the cells.
+    * @param cell The SpatialCell whose velocity space is summed.
+    * @param sums Bitwise or of DRO::velocitysums flags.
+    * @param moments Computed sums. Sums that were not requested are zero.*/
+   void calculateVelocityMoments(const SpatialCell* cell,const uint& sums,VelocityMoments& moments) {
+      const Real HALF = 0.5;
+      const bool densities = (sums & (velocitysums::DENSITY | velocitysums::PRESSURE)) != 0;
+      const bool pressures = (sums & velocitysums::PRESSURE) != 0;
+      const bool extrema   = (sums & velocitysums::EXTREMA) != 0;
+      const Real backstreamRadius2 = P::backstreamradius*P::backstreamradius;
+      
+      for (int p=0; p<VelocityMoments::N_PARTS; ++p) {
+         moments.n[p] = 0.0;
+         for (int i=0; i<3; ++i) moments.nV[p][i] = 0.0;
+         for (int i=0; i<6; ++i) moments.P[p][i] = 0.0;
+      }
+      moments.minF = std::numeric_limits<Real>::max();
+      moments.maxF = std::numeric_limits<Real>::min();
+      
+      // First pass: extrema, and densities and fluxes of the backstream and non-backstream parts
+      for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+         const Realf* block_data = cell->get_data(popID);
+         
+         for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
+            const Real* blockParams = cell->get_block_parameters(n,popID,paramsScratch);
+            const Realf* avgs = block_data + n*SIZE_VELBLOCK;
+            
+            if (extrema) for (uint i=0; i<SIZE_VELBLOCK; ++i) {
+               moments.minF = min((Real)avgs[i],moments.minF);
+               moments.maxF = max((Real)avgs[i],moments.maxF);
+            }
+            if (densities == false) continue;
+            
+            const Real DV3 = blockParams[BlockParams::DVX]*blockParams[BlockParams::DVY]*blockParams[BlockParams::DVZ];
+            for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
+               const Real VX = blockParams[BlockParams::VXCRD] + (i + HALF)*blockParams[BlockParams::DVX];
+               const Real VY = blockParams[BlockParams::VYCRD] + (j + HALF)*blockParams[BlockParams::DVY];
+               const Real VZ = blockParams[BlockParams::VZCRD] + (k + HALF)*blockParams[BlockParams::DVZ];
+               const int part = ( (P::backstreamvx - VX) * (P::backstreamvx - VX)
+                                + (P::backstreamvy - VY) * (P::backstreamvy - VY)
+                                + (P::backstreamvz - VZ) * (P::backstreamvz - VZ) ) > backstreamRadius2
+                              ? VelocityMoments::BACKSTREAM : VelocityMoments::NONBACKSTREAM;
+               const Real fDV3 = avgs[cellIndex(i,j,k)]*DV3;
+               moments.n[part]     += fDV3;
+               moments.nV[part][0] += fDV3*VX;
+               moments.nV[part][1] += fDV3*VY;
+               moments.nV[part][2] += fDV3*VZ;
+            }
+         }
+      }
+      moments.n[VelocityMoments::TOTAL] = moments.n[VelocityMoments::BACKSTREAM] + moments.n[VelocityMoments::NONBACKSTREAM];
+      for (int i=0; i<3; ++i) {
+         moments.nV[VelocityMoments::TOTAL][i] = moments.nV[VelocityMoments::BACKSTREAM][i] + moments.nV[VelocityMoments::NONBACKSTREAM][i];
+      }
+      if (pressures == false) return;
+      
+      // Bulk velocities the pressure tensors are centered on. The whole distribution uses the 
+      // bulk velocity of the cell, the parts use their own. Empty cells have zero pressure. 
+      // A part without density has an undefined bulk velocity, so its pressure is NaN 
+      // if the part covers any velocity cells of the mesh.
+      Real averageV[VelocityMoments::N_PARTS][3];
+      for (int i=0; i<3; ++i) {
+         averageV[VelocityMoments::TOTAL][i] = 0.0;
+         averageV[VelocityMoments::BACKSTREAM][i] = 0.0;
+         averageV[VelocityMoments::NONBACKSTREAM][i] = 0.0;
+      }
+      if (cell->parameters[CellParams::RHO] != 0.0) {
+         averageV[VelocityMoments::TOTAL][0] = cell->parameters[CellParams::RHOVX] / cell->parameters[CellParams::RHO];
+         averageV[VelocityMoments::TOTAL][1] = cell->parameters[CellParams::RHOVY] / cell->parameters[CellParams::RHO];
+         averageV[VelocityMoments::TOTAL][2] = cell->parameters[CellParams::RHOVZ] / cell->parameters[CellParams::RHO];
+         for (int part=VelocityMoments::BACKSTREAM; part<VelocityMoments::N_PARTS; ++part) {
+            for (int i=0; i<3; ++i) averageV[part][i] = moments.nV[part][i] / moments.n[part];
+         }
+      }
+      
+      // Second pass: pressure tensors, mass weighted per population
+      for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+         const Realf* block_data = cell->get_data(popID);
+         
+         Real pop_P[VelocityMoments::N_PARTS][6];
+         for (int p=0; p<VelocityMoments::N_PARTS; ++p) for (int i=0; i<6; ++i) pop_P[p][i] = 0.0;
+         
+         for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
+            const Real* blockParams = cell->get_block_parameters(n,popID,paramsScratch);
+            const Realf* avgs = block_data + n*SIZE_VELBLOCK;
+            const Real DV3 = blockParams[BlockParams::DVX]*blockParams[BlockParams::DVY]*blockParams[BlockParams::DVZ];
+            
+            for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
+               const Real VX = blockParams[BlockParams::VXCRD] + (i + HALF)*blockParams[BlockParams::DVX];
+               const Real VY = blockParams[BlockParams::VYCRD] + (j + HALF)*blockParams[BlockParams::DVY];
+               const Real VZ = blockParams[BlockParams::VZCRD] + (k + HALF)*blockParams[BlockParams::DVZ];
+               const int part = ( (P::backstreamvx - VX) * (P::backstreamvx - VX)
+                                + (P::backstreamvy - VY) * (P::backstreamvy - VY)
+                                + (P::backstreamvz - VZ) * (P::backstreamvz - VZ) ) > backstreamRadius2
+                              ? VelocityMoments::BACKSTREAM : VelocityMoments::NONBACKSTREAM;
+               const Real fDV3 = avgs[cellIndex(i,j,k)]*DV3;
+               
+               const int accumulate[2] = {VelocityMoments::TOTAL,part};
+               for (int a=0; a<2; ++a) {
+                  const int p = accumulate[a];
+                  const Real dVX = VX - averageV[p][0];
+                  const Real dVY = VY - averageV[p][1];
+                  const Real dVZ = VZ - averageV[p][2];
+                  pop_P[p][0] += fDV3*dVX*dVX;
+                  pop_P[p][1] += fDV3*dVY*dVY;
+                  pop_P[p][2] += fDV3*dVZ*dVZ;
+                  pop_P[p][3] += fDV3*dVY*dVZ;
+                  pop_P[p][4] += fDV3*dVZ*dVX;
+                  pop_P[p][5] += fDV3*dVX*dVY;
+               }
+            }
+         }
+         const Real mass = getObjectWrapper().particleSpecies[popID].mass;
+         for (int p=0; p<VelocityMoments::N_PARTS; ++p) for (int i=0; i<6; ++i) moments.P[p][i] += mass*pop_P[p][i];
+      }
+   }
+   
+   // ************************************************************
+   // ***** DEFINITIONS FOR VELOCITY MOMENT OPERATOR BASE CLASS ***
+   // ************************************************************
+   
+   DataReductionOperatorVelocityMoments::DataReductionOperatorVelocityMoments(): DataReductionOperator() { }
+   DataReductionOperatorVelocityMoments::~DataReductionOperatorVelocityMoments() { }
+   
+   /** Reduce the data of a single cell. The velocity space sums are computed for this operator 
+    * only, DataReducer::reduceData shares them between all operators reduced together.*/
+   bool DataReductionOperatorVelocityMoments::reduceData(const SpatialCell* cell,char* buffer) {
+      VelocityMoments moments;
+      calculateVelocityMoments(cell,getVelocitySpaceSums(),moments);
+      return reduceMoments(cell,moments,buffer);
+   }
+   
+   bool DataReductionOperatorVelocityMoments::reduceData(const SpatialCell* cell,Real* result) {
+      return reduceData(cell,reinterpret_cast<char*>(result));
+   }
+   
+   bool DataReductionOperatorVelocityMoments::setSpatialCell(const SpatialCell* cell) {return true;}
+   
    DataReductionOperatorCellParams::DataReductionOperatorCellParams(const std::string& name,const unsigned int parameterIndex,const unsigned int vectorSize):
    DataReductionOperator() {
       _vectorSize=vectorSize;
@@ -398,7 +565,8 @@ namespace DRO {
    }
 
    // Scalar pressure 
-   VariablePressure::VariablePressure(): DataReductionOperator() { }
+   // p = m/3 * integral((v - <V>)^2 * f(r,v) dV), doing the sum of the x, y and z components.
+   VariablePressure::VariablePressure(): DataReductionOperatorVelocityMoments() { }
    VariablePressure::~VariablePressure() { }
    
    std::string VariablePressure::getName() const {return "Pressure";}
@@ -410,81 +578,15 @@ namespace DRO {
       return true;
    }
    
-   // Adding pressure calculations to Vlasiator.
-   // p = m/3 * integral((v - <V>)^2 * f(r,v) dV), doing the sum of the x, y and z components.
-   bool VariablePressure::reduceData(const SpatialCell* cell,char* buffer) {
-      const Real HALF = 0.5;
+   uint VariablePressure::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
+   
+   bool VariablePressure::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
       const Real THIRD = 1.0/3.0;
-      
-      Real thread_nvx2_sum = 0.0;
-      Real thread_nvy2_sum = 0.0;
-      Real thread_nvz2_sum = 0.0;
-
-      # pragma omp parallel reduction(+:thread_nvx2_sum,thread_nvy2_sum,thread_nvz2_sum)
-      {
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            // Get velocity block parameters and distribution function of active population
-            const Real*  parameters = cell->get_block_parameters(popID);
-            const Realf* block_data = cell->get_data(popID);
-
-            Real pop_nvx2_sum = 0.0;
-            Real pop_nvy2_sum = 0.0;
-            Real pop_nvz2_sum = 0.0;
-            
-            #pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); n++) {
-               for (uint k = 0; k < WID; ++k)
-                  for (uint j = 0; j < WID; ++j)
-                     for (uint i = 0; i < WID; ++i) {
-                        const Real VX 
-                           =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] 
-                           + (i + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-                        const Real VY 
-                           =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] 
-                           + (j + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-                        const Real VZ 
-                           =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] 
-                           + (k + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                        const Real DV3 
-                           = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-                           * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY] 
-                           * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                        pop_nvx2_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VX - averageVX) * (VX - averageVX) * DV3;
-                        pop_nvy2_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VY - averageVY) * (VY - averageVY) * DV3;
-                        pop_nvz2_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VZ - averageVZ) * (VZ - averageVZ) * DV3;
-               }
-            }
-            const Real mass = getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvx2_sum += mass*pop_nvx2_sum;
-            thread_nvy2_sum += mass*pop_nvy2_sum;
-            thread_nvz2_sum += mass*pop_nvz2_sum;
-         }
-      }
-      Pressure = THIRD*(thread_nvx2_sum + thread_nvy2_sum + thread_nvz2_sum);
-      const char* ptr = reinterpret_cast<const char*>(&Pressure);
-      for (uint i = 0; i < sizeof(Real); ++i) buffer[i] = ptr[i];
+      const Real pressure = THIRD*(moments.P[VelocityMoments::TOTAL][0] + moments.P[VelocityMoments::TOTAL][1] + moments.P[VelocityMoments::TOTAL][2]);
+      copyToBuffer(&pressure,1,buffer);
       return true;
    }
 
-  bool VariablePressure::reduceData(const SpatialCell* cell,Real* buffer) {
-    reduceData(cell,(char*)buffer);
-    return true;
-  }
-   
-   bool VariablePressure::setSpatialCell(const SpatialCell* cell) {
-      if(cell-> parameters[CellParams::RHO] != 0.0) {
-         averageVX = cell-> parameters[CellParams::RHOVX] / cell-> parameters[CellParams::RHO];
-         averageVY = cell-> parameters[CellParams::RHOVY] / cell-> parameters[CellParams::RHO];
-         averageVZ = cell-> parameters[CellParams::RHOVZ] / cell-> parameters[CellParams::RHO];
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      Pressure = 0.0;
-      return true;
-   }
-   
    // Scalar pressure from the solvers
    VariablePressureSolver::VariablePressureSolver(): DataReductionOperator() { }
    VariablePressureSolver::~VariablePressureSolver() { }
@@ -516,7 +618,7 @@ namespace DRO {
    // Pressure tensor 6 components (11, 22, 33, 23, 13, 12) added by YK
    // Split into VariablePTensorDiagonal (11, 22, 33)
    // and VariablePTensorOffDiagonal (23, 13, 12)
-   VariablePTensorDiagonal::VariablePTensorDiagonal(): DataReductionOperator() { }
+   VariablePTensorDiagonal::VariablePTensorDiagonal(): DataReductionOperatorVelocityMoments() { }
    VariablePTensorDiagonal::~VariablePTensorDiagonal() { }
    
    std::string VariablePTensorDiagonal::getName() const {return "PTensorDiagonal";}
@@ -528,81 +630,14 @@ namespace DRO {
       return true;
    }
    
-   bool VariablePTensorDiagonal::reduceData(const SpatialCell* cell,char* buffer) {
-      const Real HALF = 0.5;
-      # pragma omp parallel
-      {
-         Real thread_nvxvx_sum = 0.0;
-         Real thread_nvyvy_sum = 0.0;
-         Real thread_nvzvz_sum = 0.0;
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Real* parameters  = cell->get_block_parameters(popID);
-            const Realf* block_data = cell->get_data(popID);
-            
-            Real pop_nvxvx_sum = 0;
-            Real pop_nvyvy_sum = 0;
-            Real pop_nvzvz_sum = 0;
-            
-            # pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); n++) {
-               for (uint k = 0; k < WID; ++k)
-                  for (uint j = 0; j < WID; ++j)
-                     for (uint i = 0; i < WID; ++i) {
-                        const Real VX 
-                        =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] 
-                        + (i + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-                        const Real VY 
-                        =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] 
-                        + (j + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-                        const Real VZ 
-                        =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] 
-                        + (k + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                        const Real DV3 
-                        = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-                        * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY] 
-                        * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                        
-                        pop_nvxvx_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VX - averageVX) * (VX - averageVX) * DV3;
-                        pop_nvyvy_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VY - averageVY) * (VY - averageVY) * DV3;
-                        pop_nvzvz_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VZ - averageVZ) * (VZ - averageVZ) * DV3;
-               }
-            }
-            thread_nvxvx_sum += pop_nvxvx_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvyvy_sum += pop_nvyvy_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvzvz_sum += pop_nvzvz_sum * getObjectWrapper().particleSpecies[popID].mass;
-         }
-
-         // Accumulate contributions coming from this velocity block to the 
-         // spatial cell velocity moments. If multithreading / OpenMP is used, 
-         // these updates need to be atomic:
-         # pragma omp critical
-         {
-            PTensor[0] += thread_nvxvx_sum;
-            PTensor[1] += thread_nvyvy_sum;
-            PTensor[2] += thread_nvzvz_sum;
-         }
-      }
-      const char* ptr = reinterpret_cast<const char*>(&PTensor);
-      for (uint i = 0; i < 3*sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
+   uint VariablePTensorDiagonal::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
    
-   bool VariablePTensorDiagonal::setSpatialCell(const SpatialCell* cell) {
-      if (cell-> parameters[CellParams::RHO] != 0.0) {
-         averageVX = cell-> parameters[CellParams::RHOVX] / cell-> parameters[CellParams::RHO];
-         averageVY = cell-> parameters[CellParams::RHOVY] / cell-> parameters[CellParams::RHO];
-         averageVZ = cell-> parameters[CellParams::RHOVZ] / cell-> parameters[CellParams::RHO];
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      for(int i = 0; i < 3; i++) PTensor[i] = 0.0;
+   bool VariablePTensorDiagonal::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.P[VelocityMoments::TOTAL][0],3,buffer);
       return true;
    }
    
-   VariablePTensorOffDiagonal::VariablePTensorOffDiagonal(): DataReductionOperator() { }
+   VariablePTensorOffDiagonal::VariablePTensorOffDiagonal(): DataReductionOperatorVelocityMoments() { }
    VariablePTensorOffDiagonal::~VariablePTensorOffDiagonal() { }
    
    std::string VariablePTensorOffDiagonal::getName() const {return "PTensorOffDiagonal";}
@@ -614,80 +649,14 @@ namespace DRO {
       return true;
    }
    
-   bool VariablePTensorOffDiagonal::reduceData(const SpatialCell* cell,char* buffer) {
-      const Real HALF = 0.5;
-      # pragma omp parallel
-      {
-         Real thread_nvxvy_sum = 0.0;
-         Real thread_nvzvx_sum = 0.0;
-         Real thread_nvyvz_sum = 0.0;
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Real* parameters = cell->get_block_parameters(popID);
-            const Realf* block_data = cell->get_data(popID);
-            
-            Real pop_nvxvy_sum = 0.0;
-            Real pop_nvzvx_sum = 0.0;
-            Real pop_nvyvz_sum = 0.0;
-            
-            # pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); n++) {               
-               for (uint k = 0; k < WID; ++k)
-                  for (uint j = 0; j < WID; ++j)
-                     for (uint i = 0; i < WID; ++i) {
-                        const Real VX 
-                        =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] 
-                        + (i + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-                        const Real VY 
-                        =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] 
-                        + (j + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-                        const Real VZ 
-                        =          parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] 
-                        + (k + HALF)*parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                        const Real DV3 
-                        = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-                        * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY] 
-                        * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                        
-                        pop_nvxvy_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VX - averageVX) * (VY - averageVY) * DV3;
-                        pop_nvzvx_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VZ - averageVZ) * (VX - averageVX) * DV3;
-                        pop_nvyvz_sum += block_data[n * SIZE_VELBLOCK+cellIndex(i,j,k)] * (VY - averageVY) * (VZ - averageVZ) * DV3;
-               }
-            }
-            thread_nvxvy_sum += pop_nvxvy_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvzvx_sum += pop_nvzvx_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvyvz_sum += pop_nvyvz_sum * getObjectWrapper().particleSpecies[popID].mass;
-         }
-         
-         // Accumulate contributions coming from this velocity block to the 
-         // spatial cell velocity moments. If multithreading / OpenMP is used, 
-         // these updates need to be atomic:
-         # pragma omp critical
-         {
-            PTensor[0] += thread_nvyvz_sum;
-            PTensor[1] += thread_nvzvx_sum;
-            PTensor[2] += thread_nvxvy_sum;
-         }
-      }
-      const char* ptr = reinterpret_cast<const char*>(&PTensor);
-      for (uint i = 0; i < 3*sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
+   uint VariablePTensorOffDiagonal::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
    
-   bool VariablePTensorOffDiagonal::setSpatialCell(const SpatialCell* cell) {
-      if(cell-> parameters[CellParams::RHO] != 0.0) {
-         averageVX = cell-> parameters[CellParams::RHOVX] / cell-> parameters[CellParams::RHO];
-         averageVY = cell-> parameters[CellParams::RHOVY] / cell-> parameters[CellParams::RHO];
-         averageVZ = cell-> parameters[CellParams::RHOVZ] / cell-> parameters[CellParams::RHO];
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      for(int i = 0; i < 3; i++) PTensor[i] = 0.0;
+   bool VariablePTensorOffDiagonal::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.P[VelocityMoments::TOTAL][3],3,buffer);
       return true;
    }
-   
+
+
    // Integrated divergence of magnetic field
    // Integral of div B over the simulation volume =
    // Integral of flux of B on simulation volume surface
@@ -789,7 +758,7 @@ namespace DRO {
    bool DiagnosticFluxE::setSpatialCell(const SpatialCell* cell) {return true;}
    
    // YK maximum value of the distribution function
-   MaxDistributionFunction::MaxDistributionFunction(): DataReductionOperator() { }
+   MaxDistributionFunction::MaxDistributionFunction(): DataReductionOperatorVelocityMoments() { }
    MaxDistributionFunction::~MaxDistributionFunction() { }
    
    std::string MaxDistributionFunction::getName() const {return "MaximumDistributionFunctionValue";}
@@ -801,53 +770,15 @@ namespace DRO {
       return true;
    }
    
+   uint MaxDistributionFunction::getVelocitySpaceSums() const {return velocitysums::EXTREMA;}
    
-   bool MaxDistributionFunction::reduceData(const SpatialCell* cell,Real* buffer) {
-      const Real HALF = 0.5;
-      
-      #pragma omp parallel 
-      {
-         Real threadMax = std::numeric_limits<Real>::min();
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Realf* block_data = cell->get_data(popID);
-            
-            #pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
-               for (uint k = 0; k < WID; ++k)
-                  for (uint j = 0; j < WID; ++j)
-                     for (uint i = 0; i < WID; ++i) {
-                        const int celli=k*WID*WID+j*WID+i;
-                        threadMax = max((Real)(block_data[n * SIZE_VELBLOCK+celli]), threadMax);
-               }
-            }
-         }
-
-         #pragma omp critical
-         {
-            maxF = max(threadMax, maxF);
-         }
-      }
-      
-      *buffer = maxF;
-      return true;
-   }
-   
-   bool MaxDistributionFunction::reduceData(const SpatialCell* cell,char* buffer) {
-      Real dummy;
-      reduceData(cell,&dummy);
-      const char* ptr = reinterpret_cast<const char*>(&dummy);
-      for (uint i = 0; i < sizeof(Real); ++i) buffer[i] = ptr[i];
+   bool MaxDistributionFunction::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.maxF,1,buffer);
       return true;
    }
    
-   bool MaxDistributionFunction::setSpatialCell(const SpatialCell* cell) {
-      return true;
-   }
-   
-   
    // YK minimum value of the distribution function
-   MinDistributionFunction::MinDistributionFunction(): DataReductionOperator() { }
+   MinDistributionFunction::MinDistributionFunction(): DataReductionOperatorVelocityMoments() { }
    MinDistributionFunction::~MinDistributionFunction() { }
    
    std::string MinDistributionFunction::getName() const {return "MinimumDistributionFunctionValue";}
@@ -859,436 +790,13 @@ namespace DRO {
       return true;
    }
    
+   uint MinDistributionFunction::getVelocitySpaceSums() const {return velocitysums::EXTREMA;}
    
-   bool MinDistributionFunction::reduceData(const SpatialCell* cell,Real* buffer) {
-      const Real HALF = 0.5;
-      
-      #pragma omp parallel 
-      {
-         Real threadMin = std::numeric_limits<Real>::max();
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Realf* block_data = cell->get_data(popID);
-
-            #pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {               
-               for (uint k = 0; k < WID; ++k)
-                  for (uint j = 0; j < WID; ++j)
-                     for (uint i = 0; i < WID; ++i) {
-                        const int celli=k*WID*WID+j*WID+i;
-                        threadMin = min((Real)(block_data[n * SIZE_VELBLOCK+celli]), threadMin);
-               }
-            }
-         
-         }
-         #pragma omp critical
-         {
-            minF = min(threadMin, minF);
-         }
-      }
-      
-      *buffer = minF;
-      return true;
-   }
-   
-   bool MinDistributionFunction::reduceData(const SpatialCell* cell,char* buffer) {
-      Real dummy;
-      reduceData(cell,&dummy);
-      const char* ptr = reinterpret_cast<const char*>(&dummy);
-      for (uint i = 0; i < sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
-   
-   bool MinDistributionFunction::setSpatialCell(const SpatialCell* cell) {
+   bool MinDistributionFunction::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.minF,1,buffer);
       return true;
    }
 
-   //Helper function for getting the velocity cell ids that are a part of the backstream population:
-   static void getBackstreamVelocityCells(const Real* block_parameters, vector<uint64_t> & vCellIds ) {
-      const Real HALF = 0.5;
-      // Go through every velocity cell (i, j, k are indices)
-      for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
-         // Get the vx, vy, vz coordinates of the velocity cell
-         const Real VX = block_parameters[BlockParams::VXCRD] + (i + HALF) * block_parameters[BlockParams::DVX];
-         const Real VY = block_parameters[BlockParams::VYCRD] + (j + HALF) * block_parameters[BlockParams::DVY];
-         const Real VZ = block_parameters[BlockParams::VZCRD] + (k + HALF) * block_parameters[BlockParams::DVZ];
-         // Compare the distance of the velocity cell from the center of the maxwellian distribution to the radius of the maxwellian distribution
-         if( ( (P::backstreamvx - VX) * (P::backstreamvx - VX)
-             + (P::backstreamvy - VY) * (P::backstreamvy - VY)
-             + (P::backstreamvz - VZ) * (P::backstreamvz - VZ) )
-             >
-             P::backstreamradius*P::backstreamradius ) {
-             //The velocity cell is a part of the backstream population:
-             vCellIds.push_back(cellIndex(i,j,k));
-          }
-      }
-   }
-   //Helper function for getting the velocity cell ids that are a part of the backstream population:
-   static void getNonBackstreamVelocityCells(const Real* block_parameters, vector<uint64_t> & vCellIds ) {
-      const Real HALF = 0.5;
-      for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
-         const Real VX = block_parameters[BlockParams::VXCRD] + (i + HALF) * block_parameters[BlockParams::DVX];
-         const Real VY = block_parameters[BlockParams::VYCRD] + (j + HALF) * block_parameters[BlockParams::DVY];
-         const Real VZ = block_parameters[BlockParams::VZCRD] + (k + HALF) * block_parameters[BlockParams::DVZ];
-         if( ( (P::backstreamvx - VX) * (P::backstreamvx - VX)
-             + (P::backstreamvy - VY) * (P::backstreamvy - VY)
-             + (P::backstreamvz - VZ) * (P::backstreamvz - VZ) )
-             <=
-             P::backstreamradius*P::backstreamradius ) {
-             //The velocity cell is a part of the backstream population:
-             vCellIds.push_back(cellIndex(i,j,k));
-          }
-      }
-   }
-   //Helper function for getting the velocity cell indices that are a part of the backstream population:
-   static void getBackstreamVelocityCellIndices(
-      const Real* block_parameters,
-      vector<array<uint, 3>> & vCellIndices
-   ) {
-      const Real HALF = 0.5;
-      // Go through a block's every velocity cell
-      for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
-         // Get the coordinates of the velocity cell (e.g. VX = block_vx_min_coordinates + (velocity_cell_indice_x+0.5)*length_of_velocity_cell_in_x_direction
-         const Real VX = block_parameters[BlockParams::VXCRD] + (i + HALF) * block_parameters[BlockParams::DVX];
-         const Real VY = block_parameters[BlockParams::VYCRD] + (j + HALF) * block_parameters[BlockParams::DVY];
-         const Real VZ = block_parameters[BlockParams::VZCRD] + (k + HALF) * block_parameters[BlockParams::DVZ];
-         // Calculate the distance of the velocity cell from the center of the maxwellian distribution and compare it to the approximate radius of the maxwellian distribution
-         if( ( (P::backstreamvx - VX) * (P::backstreamvx - VX)
-             + (P::backstreamvy - VY) * (P::backstreamvy - VY)
-             + (P::backstreamvz - VZ) * (P::backstreamvz - VZ) )
-             >
-             P::backstreamradius*P::backstreamradius ) {
-             //The velocity cell is a part of the backstream population because it is not within the radius:
-             const array<uint, 3> indices{{i, j, k}};
-             vCellIndices.push_back( indices );
-          }
-      }
-   }
-   //Helper function for getting the velocity cell indices that are not a part of the backstream population:
-   static void getNonBackstreamVelocityCellIndices(const Real* block_parameters,
-                                                 vector<array<uint, 3>> & vCellIndices ) {
-      const Real HALF = 0.5;
-      // Go through a block's every velocity cell
-      for (uint k = 0; k < WID; ++k) for (uint j = 0; j < WID; ++j) for (uint i = 0; i < WID; ++i) {
-         // Get the coordinates of the velocity cell (e.g. VX = block_vx_min_coordinates + (velocity_cell_indice_x+0.5)*length_of_velocity_cell_in_x_direction
-         const Real VX = block_parameters[BlockParams::VXCRD] + (i + HALF) * block_parameters[BlockParams::DVX];
-         const Real VY = block_parameters[BlockParams::VYCRD] + (j + HALF) * block_parameters[BlockParams::DVY];
-         const Real VZ = block_parameters[BlockParams::VZCRD] + (k + HALF) * block_parameters[BlockParams::DVZ];
-         // Calculate the distance of the velocity cell from the center of the maxwellian distribution and compare it to the approximate radius of the maxwellian distribution
-         if( ( (P::backstreamvx - VX) * (P::backstreamvx - VX)
-             + (P::backstreamvy - VY) * (P::backstreamvy - VY)
-             + (P::backstreamvz - VZ) * (P::backstreamvz - VZ) )
-             <=
-             P::backstreamradius*P::backstreamradius ) {
-             //The velocity cell is a part of the backstream population because it is within the radius:
-             const array<uint, 3> indices{{i, j, k}};
-             vCellIndices.push_back( indices );
-          }
-      }
-   }
-
-   //Calculates rho backstream or rho non backstream
-   static void rhoBackstreamCalculation( const SpatialCell * cell, const bool calculateBackstream, Real & rho ) {
-      const Real HALF = 0.5;
-      # pragma omp parallel
-      {
-         Real thread_n_sum = 0.0;
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Real* parameters = cell->get_block_parameters(popID);
-            const Realf* block_data = cell->get_data(popID);
-            
-            # pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
-               const Real DV3
-               = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-               vector< uint64_t > vCells; //Velocity cell ids
-               vCells.clear();
-               if ( calculateBackstream == true ) {
-                  getBackstreamVelocityCells(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCells);
-               } else {
-                  getNonBackstreamVelocityCells(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCells);
-               }
-               for( vector< uint64_t >::const_iterator it = vCells.begin(); it != vCells.end(); ++it ) {
-                  //velocity cell id = *it
-                  thread_n_sum += block_data[n * SIZE_VELBLOCK + (*it)] * DV3;
-               }
-            }
-         }
-
-         // Accumulate contributions coming from this velocity block
-         // If multithreading / OpenMP is used, 
-         // these updates need to be atomic:
-         // todo: use omp reduction
-         # pragma omp critical
-         {
-            rho += thread_n_sum;
-         }
-      }
-      return;
-   }
-
-   static void rhoVBackstreamCalculation( const SpatialCell * cell, const bool calculateBackstream, Real * rhoV ) {
-      const Real HALF = 0.5;
-      // Make sure the rhoV is initialized
-      rhoV[0] = 0;
-      rhoV[1] = 0;
-      rhoV[2] = 0;
-      # pragma omp parallel
-      {
-         Real thread_nvx_sum = 0.0;
-         Real thread_nvy_sum = 0.0;
-         Real thread_nvz_sum = 0.0;
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Real* parameters = cell->get_block_parameters(popID);
-            const Realf* block_data = cell->get_data(popID);
-            
-            # pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
-               // Get the volume of a velocity cell
-               const Real DV3
-               = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-               // Get the velocity cell indices of the cells that are a part of the backstream population
-               vector< array<uint, 3> > vCellIndices;
-               vCellIndices.clear();
-               // Save indices to the std::vector
-               if( calculateBackstream == true ) {
-                  getBackstreamVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices);
-               } else {
-                  getNonBackstreamVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices);
-               }
-               // We have now fethced all of the needed velocity cell indices, so now go through them:
-               for( vector< array<uint, 3> >::const_iterator it = vCellIndices.begin(); it != vCellIndices.end(); ++it ) {
-                  // Get the indices of the current iterated velocity cell
-                  const array<uint, 3> indices = *it;
-                  const uint i = indices[0];
-                  const uint j = indices[1];
-                  const uint k = indices[2];
-                  // Get the coordinates of the velocity cell (e.g. VX = block_vx_min_coordinates + (velocity_cell_indice_x+0.5)*length_of_velocity_cell_in_x_direction)
-                  const Real VX = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] + (i + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-                  const Real VY = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] + (j + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-                  const Real VZ = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] + (k + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                  // Add the value of the coordinates and multiply by the AVGS value of the velocity cell and the volume of the velocity cell
-                  thread_nvx_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)]*VX*DV3;
-                  thread_nvy_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)]*VY*DV3;
-                  thread_nvz_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)]*VZ*DV3;
-               }
-            } // for-loop over velocity blocks
-         } // for-loop over populations
-
-         // Accumulate contributions coming from this velocity block
-         // If multithreading / OpenMP is used, 
-         // these updates need to be atomic:
-         # pragma omp critical
-         {
-            rhoV[0] += thread_nvx_sum;
-            rhoV[1] += thread_nvy_sum;
-            rhoV[2] += thread_nvz_sum;
-         }
-      }
-      return;
-   }
-
-   static void pressureBackstreamCalculations( const SpatialCell * cell, 
-                                               const bool calculateBackstream, 
-                                               const Real averageVX,
-                                               const Real averageVY,
-                                               const Real averageVZ,
-                                               Real & Pressure ) {
-      const Real HALF = 0.5;
-      const Real THIRD = 1.0/3.0;
-      Pressure = 0;
-      # pragma omp parallel
-      {
-         Real thread_nvx2_sum = 0.0;
-         Real thread_nvy2_sum = 0.0;
-         Real thread_nvz2_sum = 0.0;
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Real* parameters = cell->get_block_parameters(popID);
-            const Realf* block_data = cell->get_data(popID);
-
-            Real pop_nvx2_sum = 0.0;
-            Real pop_nvy2_sum = 0.0;
-            Real pop_nvz2_sum = 0.0;
-
-            # pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
-               const Real DV3
-               = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-               vector< array<uint, 3> > vCellIndices;
-               vCellIndices.clear();
-               //Note: Could use function pointers
-               if( calculateBackstream == true ) {
-                  getBackstreamVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices);
-               } else {
-                  getNonBackstreamVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices);
-               }
-               for( vector< array<uint, 3> >::const_iterator it = vCellIndices.begin(); it != vCellIndices.end(); ++it ) {
-                  //Go through every velocity cell:
-                  const array<uint, 3> indices = *it;
-                  const uint i = indices[0];
-                  const uint j = indices[1];
-                  const uint k = indices[2];
-                  const Real VX = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] + (i + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-                  const Real VY = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] + (j + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-                  const Real VZ = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] + (k + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                  pop_nvx2_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VX - averageVX) * (VX - averageVX) * DV3;
-                  pop_nvy2_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VY - averageVY) * (VY - averageVY) * DV3;
-                  pop_nvz2_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VZ - averageVZ) * (VZ - averageVZ) * DV3;
-               }
-            }
-            thread_nvx2_sum += pop_nvx2_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvy2_sum += pop_nvy2_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvz2_sum += pop_nvz2_sum * getObjectWrapper().particleSpecies[popID].mass;
-         }
-
-         // Accumulate contributions coming from this velocity block to the 
-         // spatial cell velocity moments. If multithreading / OpenMP is used, 
-         // these updates need to be atomic:
-         # pragma omp critical
-         {
-            Pressure += THIRD * (thread_nvx2_sum + thread_nvy2_sum + thread_nvz2_sum);
-         }
-      }
-   }
-
-   static void PTensorDiagonalBackstreamCalculations( const SpatialCell * cell,
-                                                      const bool calculateBackstream,
-                                                      const Real averageVX,
-                                                      const Real averageVY,
-                                                      const Real averageVZ,
-                                                      Real * PTensor ) {
-      const Real HALF = 0.5;
-      # pragma omp parallel
-      {
-         Real thread_nvxvx_sum = 0.0;
-         Real thread_nvyvy_sum = 0.0;
-         Real thread_nvzvz_sum = 0.0;
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Real* parameters = cell->get_block_parameters(popID);
-            const Realf* block_data = cell->get_data(popID);
-         
-            Real pop_nvxvx_sum = 0.0;
-            Real pop_nvyvy_sum = 0.0;
-            Real pop_nvzvz_sum = 0.0;
-            
-            # pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
-               const Real DV3
-               = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-               vector< array<uint, 3> > vCellIndices;
-               vCellIndices.clear();
-               if( calculateBackstream == true ) {
-                  getBackstreamVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices);
-               } else {
-                  getNonBackstreamVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices);
-               }
-               for( vector< array<uint, 3> >::const_iterator it = vCellIndices.begin(); it != vCellIndices.end(); ++it ) {
-                  //Go through every velocity cell:
-                  const array<uint, 3> indices = *it;
-                  const uint i = indices[0];
-                  const uint j = indices[1];
-                  const uint k = indices[2];
-                  const Real VX = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] + (i + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-                  const Real VY = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] + (j + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-                  const Real VZ = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] + (k + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                  pop_nvxvx_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VX - averageVX) * (VX - averageVX) * DV3;
-                  pop_nvyvy_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VY - averageVY) * (VY - averageVY) * DV3;
-                  pop_nvzvz_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VZ - averageVZ) * (VZ - averageVZ) * DV3;
-               }
-            }
-            thread_nvxvx_sum += pop_nvxvx_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvyvy_sum += pop_nvyvy_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvzvz_sum += pop_nvzvz_sum * getObjectWrapper().particleSpecies[popID].mass;
-         }
-
-         // Accumulate contributions coming from this velocity block to the 
-         // spatial cell velocity moments. If multithreading / OpenMP is used, 
-         // these updates need to be atomic:
-         # pragma omp critical
-         {
-            PTensor[0] += thread_nvxvx_sum;
-            PTensor[1] += thread_nvyvy_sum;
-            PTensor[2] += thread_nvzvz_sum;
-         }
-      }
-      return;
-   }
-
-   static void PTensorOffDiagonalBackstreamCalculations( const SpatialCell * cell,
-                                                         const bool calculateBackstream,
-                                                         const Real averageVX,
-                                                         const Real averageVY,
-                                                         const Real averageVZ,
-                                                         Real * PTensor ) {
-      const Real HALF = 0.5;
-      # pragma omp parallel
-      {
-         Real thread_nvxvy_sum = 0.0;
-         Real thread_nvzvx_sum = 0.0;
-         Real thread_nvyvz_sum = 0.0;
-         
-         for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
-            const Real* parameters = cell->get_block_parameters(popID);
-            const Realf* block_data = cell->get_data(popID);
-         
-            Real pop_nvxvy_sum = 0.0;
-            Real pop_nvzvx_sum = 0.0;
-            Real pop_nvyvz_sum = 0.0;
-            
-            # pragma omp for
-            for (vmesh::LocalID n=0; n<cell->get_number_of_velocity_blocks(popID); ++n) {
-               const Real DV3
-               = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY]
-               * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-               vector< array<uint, 3> > vCellIndices;
-               if( calculateBackstream == true ) {
-                  getBackstreamVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices);
-               } else {
-                  getNonBackstreamVelocityCellIndices(&parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS], vCellIndices);
-               }
-               for( vector< array<uint, 3> >::const_iterator it = vCellIndices.begin(); it != vCellIndices.end(); ++it ) {
-                  //Go through every velocity cell:
-                  const array<uint, 3> indices = *it;
-                  const uint i = indices[0];
-                  const uint j = indices[1];
-                  const uint k = indices[2];
-                  const Real VX = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD] + (i + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-                  const Real VY = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD] + (j + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-                  const Real VZ = parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD] + (k + HALF) * parameters[n * BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
-                  pop_nvxvy_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VX - averageVX) * (VY - averageVY) * DV3;
-                  pop_nvzvx_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VZ - averageVZ) * (VX - averageVX) * DV3;
-                  pop_nvyvz_sum += block_data[n * SIZE_VELBLOCK + cellIndex(i,j,k)] * (VY - averageVY) * (VZ - averageVZ) * DV3;
-               }
-            }
-            thread_nvxvy_sum += pop_nvxvy_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvzvx_sum += pop_nvzvx_sum * getObjectWrapper().particleSpecies[popID].mass;
-            thread_nvyvz_sum += pop_nvyvz_sum * getObjectWrapper().particleSpecies[popID].mass;
-         }
-         
-         // Accumulate contributions coming from this velocity block to the 
-         // spatial cell velocity moments. If multithreading / OpenMP is used, 
-         // these updates need to be atomic:
-         # pragma omp critical
-         {
-            PTensor[0] += thread_nvyvz_sum;
-            PTensor[1] += thread_nvzvx_sum;
-            PTensor[2] += thread_nvxvy_sum;
-         }
-      }
-   }
 
    VariableMeshData::VariableMeshData(): DataReductionOperator() { }
    VariableMeshData::~VariableMeshData() { }
@@ -1334,7 +842,7 @@ namespace DRO {
    }
    
    // Rho backstream:
-   VariableRhoBackstream::VariableRhoBackstream(): DataReductionOperator() { }
+   VariableRhoBackstream::VariableRhoBackstream(): DataReductionOperatorVelocityMoments() { }
    VariableRhoBackstream::~VariableRhoBackstream() { }
    
    std::string VariableRhoBackstream::getName() const {return "RhoBackstream";}
@@ -1346,23 +854,15 @@ namespace DRO {
       return true;
    }
    
-   // Adding rho backstream calculations to Vlasiator.
-   bool VariableRhoBackstream::reduceData(const SpatialCell* cell,char* buffer) {
-      const bool calculateBackstream = true;
-      rhoBackstreamCalculation( cell, calculateBackstream, RhoBackstream );
-      const char* ptr = reinterpret_cast<const char*>(&RhoBackstream);
-      for (uint i = 0; i < sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
+   uint VariableRhoBackstream::getVelocitySpaceSums() const {return velocitysums::DENSITY;}
    
-   bool VariableRhoBackstream::setSpatialCell(const SpatialCell* cell) {
-      RhoBackstream = 0.0;
+   bool VariableRhoBackstream::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.n[VelocityMoments::BACKSTREAM],1,buffer);
       return true;
    }
 
-
    // Rho non backstream:
-   VariableRhoNonBackstream::VariableRhoNonBackstream(): DataReductionOperator() { }
+   VariableRhoNonBackstream::VariableRhoNonBackstream(): DataReductionOperatorVelocityMoments() { }
    VariableRhoNonBackstream::~VariableRhoNonBackstream() { }
    
    std::string VariableRhoNonBackstream::getName() const {return "RhoNonBackstream";}
@@ -1374,22 +874,15 @@ namespace DRO {
       return true;
    }
    
-   // Adding rho non backstream calculations to Vlasiator.
-   bool VariableRhoNonBackstream::reduceData(const SpatialCell* cell,char* buffer) {
-      const bool calculateBackstream = false; //We don't want backstream
-      rhoBackstreamCalculation( cell, calculateBackstream, Rho );
-      const char* ptr = reinterpret_cast<const char*>(&Rho);
-      for (uint i = 0; i < sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
+   uint VariableRhoNonBackstream::getVelocitySpaceSums() const {return velocitysums::DENSITY;}
    
-   bool VariableRhoNonBackstream::setSpatialCell(const SpatialCell* cell) {
-      Rho = 0.0;
+   bool VariableRhoNonBackstream::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.n[VelocityMoments::NONBACKSTREAM],1,buffer);
       return true;
    }
 
    //Rho v backstream:
-   VariableRhoVBackstream::VariableRhoVBackstream(): DataReductionOperator() { }
+   VariableRhoVBackstream::VariableRhoVBackstream(): DataReductionOperatorVelocityMoments() { }
    VariableRhoVBackstream::~VariableRhoVBackstream() { }
    
    std::string VariableRhoVBackstream::getName() const {return "RhoVBackstream";}
@@ -1400,30 +893,16 @@ namespace DRO {
       vectorSize = 3;
       return true;
    }
-
-
-
-   // Adding rho v backstream calculations to Vlasiator.
-   bool VariableRhoVBackstream::reduceData(const SpatialCell* cell,char* buffer) {
-      const bool calculateBackstream = true;
-      //Calculate rho v backstream
-      rhoVBackstreamCalculation( cell, calculateBackstream, RhoVBackstream );
-      const uint RhoVBackstreamSize = 3;
-      const char* ptr = reinterpret_cast<const char*>(&RhoVBackstream);
-      for (uint i = 0; i < RhoVBackstreamSize*sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
    
-   bool VariableRhoVBackstream::setSpatialCell(const SpatialCell* cell) {
-      // Initialize values
-      for( uint i = 0; i < 3; ++i ) {
-         RhoVBackstream[i] = 0.0;
-      }
+   uint VariableRhoVBackstream::getVelocitySpaceSums() const {return velocitysums::DENSITY;}
+   
+   bool VariableRhoVBackstream::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(moments.nV[VelocityMoments::BACKSTREAM],3,buffer);
       return true;
    }
 
    //Rho v non backstream:
-   VariableRhoVNonBackstream::VariableRhoVNonBackstream(): DataReductionOperator() { }
+   VariableRhoVNonBackstream::VariableRhoVNonBackstream(): DataReductionOperatorVelocityMoments() { }
    VariableRhoVNonBackstream::~VariableRhoVNonBackstream() { }
    
    std::string VariableRhoVNonBackstream::getName() const {return "RhoVNonBackstream";}
@@ -1434,29 +913,17 @@ namespace DRO {
       vectorSize = 3;
       return true;
    }
-
-   // Adding rho v non backstream calculations to Vlasiator.
-   bool VariableRhoVNonBackstream::reduceData(const SpatialCell* cell,char* buffer) {
-      const bool calculateBackstream = false;
-      //Calculate rho v backstream
-      rhoVBackstreamCalculation( cell, calculateBackstream, RhoV );
-      const uint vectorSize = 3;
-      const char* ptr = reinterpret_cast<const char*>(&RhoV);
-      for (uint i = 0; i < vectorSize*sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
    
-   bool VariableRhoVNonBackstream::setSpatialCell(const SpatialCell* cell) {
-      // Initialize values
-      for( uint i = 0; i < 3; ++i ) {
-         RhoV[i] = 0.0;
-      }
+   uint VariableRhoVNonBackstream::getVelocitySpaceSums() const {return velocitysums::DENSITY;}
+   
+   bool VariableRhoVNonBackstream::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(moments.nV[VelocityMoments::NONBACKSTREAM],3,buffer);
       return true;
    }
 
-
    // Scalar pressure of backstream
-   VariablePressureBackstream::VariablePressureBackstream(): DataReductionOperator() { }
+   // p = m/3 * integral((v - <V>)^2 * f(r,v) dV), where <V> is the bulk velocity of the backstream.
+   VariablePressureBackstream::VariablePressureBackstream(): DataReductionOperatorVelocityMoments() { }
    VariablePressureBackstream::~VariablePressureBackstream() { }
    
    std::string VariablePressureBackstream::getName() const {return "PressureBackstream";}
@@ -1468,39 +935,17 @@ namespace DRO {
       return true;
    }
    
-   // Adding pressure backstream calculations to Vlasiator.
-   // p = m/3 * integral((v - <V>)^2 * f(r,v) dV), doing the sum of the x, y and z components.
-   bool VariablePressureBackstream::reduceData(const SpatialCell* cell,char* buffer) {
-      const bool calculateBackstream = true;
-      pressureBackstreamCalculations( cell, calculateBackstream, averageVX, averageVY, averageVZ, Pressure );
-      const char* ptr = reinterpret_cast<const char*>(&Pressure);
-      for (uint i = 0; i < sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
+   uint VariablePressureBackstream::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
    
-   bool VariablePressureBackstream::setSpatialCell(const SpatialCell* cell) {
-      if(cell-> parameters[CellParams::RHO] != 0.0) {
-         //Get rho and rho v of the backstream:
-         Real rho = 0;
-         Real rhoV[3] = {0};
-         const bool calculateBackstream = true;
-         rhoBackstreamCalculation( cell, calculateBackstream, rho );
-         rhoVBackstreamCalculation( cell, calculateBackstream, rhoV );
-         //Set the average velocities:
-         averageVX = rhoV[0] / rho;
-         averageVY = rhoV[1] / rho;
-         averageVZ = rhoV[2] / rho;
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      Pressure = 0.0;
+   bool VariablePressureBackstream::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      const Real THIRD = 1.0/3.0;
+      const Real pressure = THIRD*(moments.P[VelocityMoments::BACKSTREAM][0] + moments.P[VelocityMoments::BACKSTREAM][1] + moments.P[VelocityMoments::BACKSTREAM][2]);
+      copyToBuffer(&pressure,1,buffer);
       return true;
    }
 
    // Scalar pressure of non backstream
-   VariablePressureNonBackstream::VariablePressureNonBackstream(): DataReductionOperator() { }
+   VariablePressureNonBackstream::VariablePressureNonBackstream(): DataReductionOperatorVelocityMoments() { }
    VariablePressureNonBackstream::~VariablePressureNonBackstream() { }
    
    std::string VariablePressureNonBackstream::getName() const {return "PressureNonBackstream";}
@@ -1512,45 +957,18 @@ namespace DRO {
       return true;
    }
    
-   // Adding pressure backstream calculations to Vlasiator.
-   // p = m/3 * integral((v - <V>)^2 * f(r,v) dV), doing the sum of the x, y and z components.
-   bool VariablePressureNonBackstream::reduceData(const SpatialCell* cell,char* buffer) {
-      const bool calculateBackstream = false;
-      pressureBackstreamCalculations( cell, calculateBackstream, averageVX, averageVY, averageVZ, Pressure );
-      const char* ptr = reinterpret_cast<const char*>(&Pressure);
-      for (uint i = 0; i < sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
+   uint VariablePressureNonBackstream::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
    
-   bool VariablePressureNonBackstream::setSpatialCell(const SpatialCell* cell) {
-      if(cell-> parameters[CellParams::RHO] != 0.0) {
-         //Get rho and rho v of the backstream:
-         Real rho = 0;
-         Real rhoV[3] = {0};
-         const bool calculateBackstream = false;
-         rhoBackstreamCalculation( cell, calculateBackstream, rho );
-         rhoVBackstreamCalculation( cell, calculateBackstream, rhoV );
-         //Set the average velocities:
-         averageVX = rhoV[0] / rho;
-         averageVY = rhoV[1] / rho;
-         averageVZ = rhoV[2] / rho;
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      Pressure = 0.0;
+   bool VariablePressureNonBackstream::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      const Real THIRD = 1.0/3.0;
+      const Real pressure = THIRD*(moments.P[VelocityMoments::NONBACKSTREAM][0] + moments.P[VelocityMoments::NONBACKSTREAM][1] + moments.P[VelocityMoments::NONBACKSTREAM][2]);
+      copyToBuffer(&pressure,1,buffer);
       return true;
    }
 
-
-   // Adding pressure calculations for backstream population to Vlasiator.
-   // p_ij = m/3 * integral((v - <V>)_i(v - <V>)_j * f(r,v) dV)
-   
-   // Pressure tensor 6 components (11, 22, 33, 23, 13, 12) added by YK
-   // Split into VariablePTensorBackstreamDiagonal (11, 22, 33)
-   // and VariablePTensorOffDiagonal (23, 13, 12)
-   VariablePTensorBackstreamDiagonal::VariablePTensorBackstreamDiagonal(): DataReductionOperator() { }
+   // Pressure tensor of the backstream population, split into diagonal (11, 22, 33)
+   // and off-diagonal (23, 13, 12) components.
+   VariablePTensorBackstreamDiagonal::VariablePTensorBackstreamDiagonal(): DataReductionOperatorVelocityMoments() { }
    VariablePTensorBackstreamDiagonal::~VariablePTensorBackstreamDiagonal() { }
    
    std::string VariablePTensorBackstreamDiagonal::getName() const {return "PTensorBackstreamDiagonal";}
@@ -1562,46 +980,14 @@ namespace DRO {
       return true;
    }
    
-   bool VariablePTensorBackstreamDiagonal::reduceData(const SpatialCell* cell,char* buffer) {
-      const bool calculateBackstream = true;
-      //Calculate PTensor and save it in PTensorArray:
-      PTensorDiagonalBackstreamCalculations( cell, calculateBackstream, averageVX, averageVY, averageVZ, PTensor );
-      const uint vectorSize = 3;
-      //Save the data into buffer:
-      const char* ptr = reinterpret_cast<const char*>(&PTensor);
-      for (uint i = 0; i < vectorSize*sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
-   
-   bool VariablePTensorBackstreamDiagonal::setSpatialCell(const SpatialCell* cell) {
-      if(cell-> parameters[CellParams::RHO] != 0.0) {
-         //Get rho and rho v of the backstream:
-         Real rho = 0;
-         Real rhoV[3] = {0};
-         const bool calculateBackstream = true; //We are calculating backstream
-         rhoBackstreamCalculation( cell, calculateBackstream, rho );
-         rhoVBackstreamCalculation( cell, calculateBackstream, rhoV );
-         //Set the average velocities:
-         averageVX = rhoV[0] / rho;
-         averageVY = rhoV[1] / rho;
-         averageVZ = rhoV[2] / rho;
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      const uint vectorSize = 3;
-      for(uint i = 0; i < vectorSize; i++) PTensor[i] = 0.0;
+   uint VariablePTensorBackstreamDiagonal::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
+   
+   bool VariablePTensorBackstreamDiagonal::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.P[VelocityMoments::BACKSTREAM][0],3,buffer);
       return true;
    }
 
-   // Adding pressure calculations for backstream population to Vlasiator.
-   // p_ij = m/3 * integral((v - <V>)_i(v - <V>)_j * f(r,v) dV)
-   
-   // Pressure tensor 6 components (11, 22, 33, 23, 13, 12) added by YK
-   // Split into VariablePTensorNonBackstreamDiagonal (11, 22, 33)
-   // and VariablePTensorOffDiagonal (23, 13, 12)
-   VariablePTensorNonBackstreamDiagonal::VariablePTensorNonBackstreamDiagonal(): DataReductionOperator() { }
+   VariablePTensorNonBackstreamDiagonal::VariablePTensorNonBackstreamDiagonal(): DataReductionOperatorVelocityMoments() { }
    VariablePTensorNonBackstreamDiagonal::~VariablePTensorNonBackstreamDiagonal() { }
    
    std::string VariablePTensorNonBackstreamDiagonal::getName() const {return "PTensorNonBackstreamDiagonal";}
@@ -1613,40 +999,14 @@ namespace DRO {
       return true;
    }
    
-   bool VariablePTensorNonBackstreamDiagonal::reduceData(const SpatialCell* cell,char* buffer) {
-      const bool calculateBackstream = false;
-      //Calculate PTensor and save it in PTensorArray:
-      PTensorDiagonalBackstreamCalculations( cell, calculateBackstream, averageVX, averageVY, averageVZ, PTensor );
-      const uint vectorSize = 3;
-      //Save the data into buffer:
-      const char* ptr = reinterpret_cast<const char*>(&PTensor);
-      for (uint i = 0; i < vectorSize*sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
-   
-   bool VariablePTensorNonBackstreamDiagonal::setSpatialCell(const SpatialCell* cell) {
-      if(cell-> parameters[CellParams::RHO] != 0.0) {
-         //Get rho and rho v of the backstream:
-         Real rho = 0;
-         Real rhoV[3] = {0};
-         const bool calculateBackstream = false; //We are not calculating backstream
-         rhoBackstreamCalculation( cell, calculateBackstream, rho );
-         rhoVBackstreamCalculation( cell, calculateBackstream, rhoV );
-         //Set the average velocities:
-         averageVX = rhoV[0] / rho;
-         averageVY = rhoV[1] / rho;
-         averageVZ = rhoV[2] / rho;
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      const uint vectorSize = 3;
-      for(uint i = 0; i < vectorSize; i++) PTensor[i] = 0.0;
+   uint VariablePTensorNonBackstreamDiagonal::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
+   
+   bool VariablePTensorNonBackstreamDiagonal::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.P[VelocityMoments::NONBACKSTREAM][0],3,buffer);
       return true;
    }
 
-   VariablePTensorBackstreamOffDiagonal::VariablePTensorBackstreamOffDiagonal(): DataReductionOperator() { }
+   VariablePTensorBackstreamOffDiagonal::VariablePTensorBackstreamOffDiagonal(): DataReductionOperatorVelocityMoments() { }
    VariablePTensorBackstreamOffDiagonal::~VariablePTensorBackstreamOffDiagonal() { }
    
    std::string VariablePTensorBackstreamOffDiagonal::getName() const {return "PTensorBackstreamOffDiagonal";}
@@ -1658,40 +1018,14 @@ namespace DRO {
       return true;
    }
    
-   bool VariablePTensorBackstreamOffDiagonal::reduceData(const SpatialCell* cell,char* buffer) {
-      //Calculate PTensor for PTensorArray:
-      const bool calculateBackstream = true;
-      //Calculate and save:
-      PTensorOffDiagonalBackstreamCalculations( cell, calculateBackstream, averageVX, averageVY, averageVZ, PTensor );
-      const uint vectorSize = 3;
-      //Input data into buffer
-      const char* ptr = reinterpret_cast<const char*>(&PTensor);
-      for (uint i = 0; i < 3*sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
+   uint VariablePTensorBackstreamOffDiagonal::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
    
-   bool VariablePTensorBackstreamOffDiagonal::setSpatialCell(const SpatialCell* cell) {
-      if(cell-> parameters[CellParams::RHO] != 0.0) {
-         //Get rho and rho v of the backstream:
-         Real rho = 0;
-         Real rhoV[3] = {0};
-         const bool calculateBackstream = true; //We are calculating backstream
-         rhoBackstreamCalculation( cell, calculateBackstream, rho );
-         rhoVBackstreamCalculation( cell, calculateBackstream, rhoV );
-         //Set the average velocities:
-         averageVX = rhoV[0] / rho;
-         averageVY = rhoV[1] / rho;
-         averageVZ = rhoV[2] / rho;
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      for(int i = 0; i < 3; i++) PTensor[i] = 0.0;
+   bool VariablePTensorBackstreamOffDiagonal::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.P[VelocityMoments::BACKSTREAM][3],3,buffer);
       return true;
    }
 
-   VariablePTensorNonBackstreamOffDiagonal::VariablePTensorNonBackstreamOffDiagonal(): DataReductionOperator() { }
+   VariablePTensorNonBackstreamOffDiagonal::VariablePTensorNonBackstreamOffDiagonal(): DataReductionOperatorVelocityMoments() { }
    VariablePTensorNonBackstreamOffDiagonal::~VariablePTensorNonBackstreamOffDiagonal() { }
    
    std::string VariablePTensorNonBackstreamOffDiagonal::getName() const {return "PTensorNonBackstreamOffDiagonal";}
@@ -1703,39 +1037,14 @@ namespace DRO {
       return true;
    }
    
-   bool VariablePTensorNonBackstreamOffDiagonal::reduceData(const SpatialCell* cell,char* buffer) {
-      //Calculate PTensor for PTensorArray:
-      const bool calculateBackstream = false;
-      //Calculate and save:
-      PTensorOffDiagonalBackstreamCalculations( cell, calculateBackstream, averageVX, averageVY, averageVZ, PTensor );
-      const uint vectorSize = 3;
-      //Input data into buffer
-      const char* ptr = reinterpret_cast<const char*>(&PTensor);
-      for (uint i = 0; i < 3*sizeof(Real); ++i) buffer[i] = ptr[i];
-      return true;
-   }
+   uint VariablePTensorNonBackstreamOffDiagonal::getVelocitySpaceSums() const {return velocitysums::PRESSURE;}
    
-   bool VariablePTensorNonBackstreamOffDiagonal::setSpatialCell(const SpatialCell* cell) {
-      if(cell-> parameters[CellParams::RHO] != 0.0) {
-         //Get rho and rho v of the backstream:
-         Real rho = 0;
-         Real rhoV[3] = {0};
-         const bool calculateBackstream = false; //We are not calculating backstream
-         rhoBackstreamCalculation( cell, calculateBackstream, rho );
-         rhoVBackstreamCalculation( cell, calculateBackstream, rhoV );
-         //Set the average velocities:
-         averageVX = rhoV[0] / rho;
-         averageVY = rhoV[1] / rho;
-         averageVZ = rhoV[2] / rho;
-      } else {
-         averageVX = 0.0;
-         averageVY = 0.0;
-         averageVZ = 0.0;
-      }
-      for(int i = 0; i < 3; i++) PTensor[i] = 0.0;
+   bool VariablePTensorNonBackstreamOffDiagonal::reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const {
+      copyToBuffer(&moments.P[VelocityMoments::NONBACKSTREAM][3],3,buffer);
       return true;
    }
 
+
    // Adding pressure calculations for backstream population to Vlasiator.
    // p_ij = m/3 * integral((v - <V>)_i(v - <V>)_j * f(r,v) dV)
    
@@ -36,6 +36,32 @@ using namespace spatial_cell;
 
 namespace DRO {
 
+   /** Flags selecting which velocity space sums DRO::calculateVelocityMoments computes.*/
+   namespace velocitysums {
+      enum {
+         DENSITY  = 0x1, /**< Number density and flux of the whole distribution and of its backstream and non-backstream parts.*/
+         PRESSURE = 0x2, /**< Pressure tensors of the whole distribution and of its parts, implies DENSITY.*/
+         EXTREMA  = 0x4  /**< Minimum and maximum value of the distribution function.*/
+      };
+   }
+
+   /** Sums over the velocity space of one spatial cell, summed over all populations. They are computed 
+    * in one pass over the velocity blocks (two for pressures) and shared by all operators reduced together.
+    * Backstream velocity cells are those outside of the sphere given by P::backstreamradius 
+    * around (P::backstreamvx,P::backstreamvy,P::backstreamvz).
+    */
+   struct VelocityMoments {
+      enum Part {TOTAL,BACKSTREAM,NONBACKSTREAM,N_PARTS};
+      Real n[N_PARTS];     /**< Number density.*/
+      Real nV[N_PARTS][3]; /**< Number flux.*/
+      Real P[N_PARTS][6];  /**< Mass weighted integral of (v-<V>)_i(v-<V>)_j f, components 11 22 33 23 13 12. 
+                            * <V> is the bulk velocity of the cell for TOTAL and that of the part otherwise.*/
+      Real minF;
+      Real maxF;
+   };
+
+   void calculateVelocityMoments(const SpatialCell* cell,const uint& sums,VelocityMoments& moments);
+
    /** DRO::DataReductionOperator defines a base class for reducing simulation data
     * (six-dimensional distribution function) into more compact variables, e.g. 
     * scalar fields, which can be written into file(s) and visualized.
@@ -57,9 +83,11 @@ namespace DRO {
       
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
+      virtual uint getVelocitySpaceSums() const;
       virtual bool handlesWriting() const;
       virtual bool reduceData(const SpatialCell* cell,char* buffer);
       virtual bool reduceData(const SpatialCell* cell,Real * result);
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
       virtual bool setSpatialCell(const SpatialCell* cell);
       virtual bool writeData(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                              const std::vector<CellID>& cells,const std::string& meshName,
@@ -69,6 +97,22 @@ namespace DRO {
    
    };
 
+   /** Base class for operators computed from DRO::VelocityMoments. They keep no per-cell state, so 
+    * DataReducer applies them to many cells in parallel and computes the velocity space sums of a 
+    * cell once for all of them. The single cell interface computes the sums of the operator alone.
+    */
+   class DataReductionOperatorVelocityMoments: public DataReductionOperator {
+   public:
+      DataReductionOperatorVelocityMoments();
+      virtual ~DataReductionOperatorVelocityMoments();
+
+      virtual uint getVelocitySpaceSums() const = 0;
+      virtual bool reduceData(const SpatialCell* cell,char* buffer);
+      virtual bool reduceData(const SpatialCell* cell,Real * result);
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const = 0;
+      virtual bool setSpatialCell(const SpatialCell* cell);
+   };
+
    class DataReductionOperatorCellParams: public DataReductionOperator {
    public:
       DataReductionOperatorCellParams(const std::string& name,const unsigned int parameterIndex,const unsigned int vectorSize);
@@ -217,20 +261,15 @@ namespace DRO {
 
    
   // Added by YK
-   class VariablePressure: public DataReductionOperator {
+   class VariablePressure: public DataReductionOperatorVelocityMoments {
    public:
       VariablePressure();
       virtual ~VariablePressure();
-     
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool reduceData(const SpatialCell* cell,Real * result);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-     
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real Pressure;
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
    
    class VariablePressureSolver: public DataReductionOperator {
@@ -247,34 +286,26 @@ namespace DRO {
       Real Pressure;
    };
    
-   class VariablePTensorDiagonal: public DataReductionOperator {
+   class VariablePTensorDiagonal: public DataReductionOperatorVelocityMoments {
    public:
       VariablePTensorDiagonal();
       virtual ~VariablePTensorDiagonal();
       
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-      
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real PTensor[3];
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
    
-   class VariablePTensorOffDiagonal: public DataReductionOperator {
+   class VariablePTensorOffDiagonal: public DataReductionOperatorVelocityMoments {
    public:
       VariablePTensorOffDiagonal();
       virtual ~VariablePTensorOffDiagonal();
       
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-      
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real PTensor[3];
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
    
    class DiagnosticFluxB: public DataReductionOperator {
@@ -305,34 +336,26 @@ namespace DRO {
       
    };
    
-   class MaxDistributionFunction: public DataReductionOperator {
+   class MaxDistributionFunction: public DataReductionOperatorVelocityMoments {
    public:
       MaxDistributionFunction();
       virtual ~MaxDistributionFunction();
       
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool reduceData(const SpatialCell* cell,Real *buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-      
-   protected:
-      Real maxF;
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
    
-   class MinDistributionFunction: public DataReductionOperator {
+   class MinDistributionFunction: public DataReductionOperatorVelocityMoments {
    public:
       MinDistributionFunction();
       virtual ~MinDistributionFunction();
       
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool reduceData(const SpatialCell* cell,Real *buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-      
-   protected:
-      Real minF;
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
    /** This class writes all scalar and two- or three-component vector data 
@@ -354,151 +377,115 @@ namespace DRO {
       
    };
    
-   class VariableRhoBackstream: public DataReductionOperator {
+   class VariableRhoBackstream: public DataReductionOperatorVelocityMoments {
    public:
       VariableRhoBackstream();
       virtual ~VariableRhoBackstream();
-     
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-     
-   protected:
-   Real RhoBackstream;
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
-   class VariableRhoNonBackstream: public DataReductionOperator {
+   class VariableRhoNonBackstream: public DataReductionOperatorVelocityMoments {
    public:
       VariableRhoNonBackstream();
       virtual ~VariableRhoNonBackstream();
-     
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-     
-   protected:
-   Real Rho;
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
 
-   class VariableRhoVBackstream: public DataReductionOperator {
+   class VariableRhoVBackstream: public DataReductionOperatorVelocityMoments {
    public:
       VariableRhoVBackstream();
       virtual ~VariableRhoVBackstream();
-     
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-     
-   protected:
-      Real RhoVBackstream[3];
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
-   class VariableRhoVNonBackstream: public DataReductionOperator {
+   class VariableRhoVNonBackstream: public DataReductionOperatorVelocityMoments {
    public:
       VariableRhoVNonBackstream();
       virtual ~VariableRhoVNonBackstream();
-
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-
-   protected:
-      Real RhoV[3];
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
-   class VariablePressureBackstream: public DataReductionOperator {
+   class VariablePressureBackstream: public DataReductionOperatorVelocityMoments {
    public:
       VariablePressureBackstream();
       virtual ~VariablePressureBackstream();
-
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real Pressure;
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
-   class VariablePressureNonBackstream: public DataReductionOperator {
+   class VariablePressureNonBackstream: public DataReductionOperatorVelocityMoments {
    public:
       VariablePressureNonBackstream();
       virtual ~VariablePressureNonBackstream();
-
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real Pressure;
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
-   class VariablePTensorBackstreamDiagonal: public DataReductionOperator {
+   class VariablePTensorBackstreamDiagonal: public DataReductionOperatorVelocityMoments {
    public:
       VariablePTensorBackstreamDiagonal();
       virtual ~VariablePTensorBackstreamDiagonal();
       
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-      
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real PTensor[3];
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
-   class VariablePTensorNonBackstreamDiagonal: public DataReductionOperator {
+   class VariablePTensorNonBackstreamDiagonal: public DataReductionOperatorVelocityMoments {
    public:
       VariablePTensorNonBackstreamDiagonal();
       virtual ~VariablePTensorNonBackstreamDiagonal();
-
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real PTensor[3];
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
-   class VariablePTensorBackstreamOffDiagonal: public DataReductionOperator {
+   class VariablePTensorBackstreamOffDiagonal: public DataReductionOperatorVelocityMoments {
    public:
       VariablePTensorBackstreamOffDiagonal();
       virtual ~VariablePTensorBackstreamOffDiagonal();
-
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real PTensor[3];
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
 
-   class VariablePTensorNonBackstreamOffDiagonal: public DataReductionOperator {
+   class VariablePTensorNonBackstreamOffDiagonal: public DataReductionOperatorVelocityMoments {
    public:
       VariablePTensorNonBackstreamOffDiagonal();
       virtual ~VariablePTensorNonBackstreamOffDiagonal();
-
+      
       virtual bool getDataVectorInfo(std::string& dataType,unsigned int& dataSize,unsigned int& vectorSize) const;
       virtual std::string getName() const;
-      virtual bool reduceData(const SpatialCell* cell,char* buffer);
-      virtual bool setSpatialCell(const SpatialCell* cell);
-
-   protected:
-      Real averageVX, averageVY, averageVZ;
-      Real PTensor[3];
+      virtual uint getVelocitySpaceSums() const;
+      virtual bool reduceMoments(const SpatialCell* cell,const VelocityMoments& moments,char* buffer) const;
    };
    
    class VariableMinValue: public DataReductionOperator {
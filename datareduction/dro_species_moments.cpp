@@ -90,11 +90,12 @@ namespace DRO {
             spatial_cell::SpatialCell* cell = mpiGrid[cells[c]];
             vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
             const Realf* data       = blockContainer.getData();
-            const Real* blockParams = blockContainer.getParameters();
+            const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+            Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
             for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
                blockVelocityFirstMoments(data+blockLID*WID3,
-                                         blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                         spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch),
                                          1.0,array);
             } // for-loop over velocity blocks
             
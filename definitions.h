@@ -113,6 +113,9 @@ typedef Realf (*AmrVelRefinement)(const Realf* velBlock);
 #define SHIFT_M_Y_NEIGHBORHOOD_ID 18 //Shift in -y direction
 #define SHIFT_M_Z_NEIGHBORHOOD_ID 19 //Shift in -z direction
 #define POISSON_NEIGHBORHOOD_ID 20   // Nearest face neighbors 
+#define FIELD_SOLVER_E_NEIGHBORHOOD_ID 21      // Nearest neighbors read when computing edge electric fields
+#define FIELD_SOLVER_E_HALL_NEIGHBORHOOD_ID 22 // FIELD_SOLVER_E + edge neighbors read by second order Hall term derivatives
+#define FIELD_SOLVER_B_NEIGHBORHOOD_ID 23      // Nearest neighbors in positive directions, their edge E is read when propagating face B
 
 //fieldsolver stencil.
 #define FS_STENCIL_WIDTH 2
@@ -32,6 +32,7 @@ extern map<CellID,uint> existingCellsFlags; /**< Defined in fs_common.cpp */
 /*! \brief Low-level spatial derivatives calculation.
  * 
  * For the cell with ID cellID calculate the spatial derivatives or apply the derivative boundary conditions defined in project.h. Uses RHO, RHOV[XYZ] and B[XYZ] in the first-order time accuracy method and in the second step of the second-order method, and RHO_DT2, RHOV[XYZ]1 and B[XYZ]1 in the first step of the second-order method.
+ * \param fields Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param mpiGrid Grid
  * \param cellCache Field solver cell cache
  * \param sysBoundaries System boundary conditions existing
@@ -39,7 +40,9 @@ extern map<CellID,uint> existingCellsFlags; /**< Defined in fs_common.cpp */
  * 
  * \sa calculateDerivativesSimple calculateBVOLDerivativesSimple calculateBVOLDerivatives
  */
+template<typename FIELDS>
 void calculateDerivatives(
+   const FIELDS& fields,
    dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    fs_cache::CellCache& cellCache,
    SysBoundary& sysBoundaries,
@@ -60,7 +63,7 @@ void calculateDerivatives(
    }
    #endif
    
-   Real* const array = cellCache.cells[fs_cache::calculateNbrID(1,1,1)]->derivatives;
+   const typename FIELDS::Values array = fields.derivatives(cellCache,fs_cache::calculateNbrID(1,1,1));
 
    // Get boundary flag for the cell:
    cuint existingCells    = cellCache.existingCellsFlags;
@@ -69,8 +72,8 @@ void calculateDerivatives(
    cuint sysBoundaryLayer = cellCache.cells[fs_cache::calculateNbrID(1,1,1)]->sysBoundaryLayer;
    
    CellID leftNbrID,rghtNbrID;
-   creal* left = NULL;
-   creal* cent = cellCache.cells[fs_cache::calculateNbrID(1,1,1)]->parameters;
+   const typename FIELDS::ConstValues cent = fields.parameters(cellCache,fs_cache::calculateNbrID(1,1,1));
+   typename FIELDS::ConstValues left = cent;
    #ifdef DEBUG_SOLVERS
    if (cent[cp::RHO] <= 0) {
       std::cerr << __FILE__ << ":" << __LINE__
@@ -79,17 +82,17 @@ void calculateDerivatives(
       abort();
    }
    #endif
-   creal* rght = NULL;
+   typename FIELDS::ConstValues rght = cent;
    CellID botLeftNbrID, botRghtNbrID, topLeftNbrID, topRghtNbrID;
-   creal* botLeft = NULL;
-   creal* botRght = NULL;
-   creal* topLeft = NULL;
-   creal* topRght = NULL;
+   typename FIELDS::ConstValues botLeft = cent;
+   typename FIELDS::ConstValues botRght = cent;
+   typename FIELDS::ConstValues topLeft = cent;
+   typename FIELDS::ConstValues topRght = cent;
    
    // Calculate x-derivatives (is not TVD for AMR mesh):
    if (((existingCells & CALCULATE_DX) == CALCULATE_DX) &&
        ((sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) || (sysBoundaryLayer == 1))) {
-      left = cellCache.cells[fs_cache::calculateNbrID(1-1,1  ,1  )]->parameters;
+      left = fields.parameters(cellCache,fs_cache::calculateNbrID(1-1,1  ,1  ));
       #ifdef DEBUG_SOLVERS
       if (left[cp::RHO] <= 0) {
          std::cerr << __FILE__ << ":" << __LINE__
@@ -98,7 +101,7 @@ void calculateDerivatives(
          abort();
       }
       #endif
-      rght = cellCache.cells[fs_cache::calculateNbrID(1+1,1  ,1  )]->parameters;
+      rght = fields.parameters(cellCache,fs_cache::calculateNbrID(1+1,1  ,1  ));
       #ifdef DEBUG_SOLVERS
       if (rght[cp::RHO] <= 0) {
          std::cerr << __FILE__ << ":" << __LINE__
@@ -171,8 +174,8 @@ void calculateDerivatives(
    // Calculate y-derivatives (is not TVD for AMR mesh):
    if (((existingCells & CALCULATE_DY) == CALCULATE_DY) &&
        ((sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) || (sysBoundaryLayer == 1))) {
-      left = cellCache.cells[fs_cache::calculateNbrID(1  ,1-1,1  )]->parameters;
-      rght = cellCache.cells[fs_cache::calculateNbrID(1  ,1+1,1  )]->parameters;
+      left = fields.parameters(cellCache,fs_cache::calculateNbrID(1  ,1-1,1  ));
+      rght = fields.parameters(cellCache,fs_cache::calculateNbrID(1  ,1+1,1  ));
 
       if (RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
          array[fs::drhody] = limiter(left[cp::RHO],cent[cp::RHO],rght[cp::RHO]);
@@ -237,8 +240,8 @@ void calculateDerivatives(
    if (((existingCells & CALCULATE_DZ) == CALCULATE_DZ) &&
        ((sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) || (sysBoundaryLayer == 1))) {
 
-      left = cellCache.cells[fs_cache::calculateNbrID(1  ,1  ,1-1)]->parameters;
-      rght = cellCache.cells[fs_cache::calculateNbrID(1  ,1  ,1+1)]->parameters;
+      left = fields.parameters(cellCache,fs_cache::calculateNbrID(1  ,1  ,1-1));
+      rght = fields.parameters(cellCache,fs_cache::calculateNbrID(1  ,1  ,1+1));
 
       if (RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
          array[fs::drhodz] = limiter(left[cp::RHO],cent[cp::RHO],rght[cp::RHO]);
@@ -306,10 +309,10 @@ void calculateDerivatives(
       // Calculate xy mixed derivatives:
       if (((existingCells & CALCULATE_DXY) == CALCULATE_DXY) &&
           ((sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) || (sysBoundaryLayer == 1))) {
-         botLeft = cellCache.cells[fs_cache::calculateNbrID(1-1,1-1,1  )]->parameters;
-         botRght = cellCache.cells[fs_cache::calculateNbrID(1+1,1-1,1  )]->parameters;
-         topLeft = cellCache.cells[fs_cache::calculateNbrID(1-1,1+1,1  )]->parameters;
-         topRght = cellCache.cells[fs_cache::calculateNbrID(1+1,1+1,1  )]->parameters;
+         botLeft = fields.parameters(cellCache,fs_cache::calculateNbrID(1-1,1-1,1  ));
+         botRght = fields.parameters(cellCache,fs_cache::calculateNbrID(1+1,1-1,1  ));
+         topLeft = fields.parameters(cellCache,fs_cache::calculateNbrID(1-1,1+1,1  ));
+         topRght = fields.parameters(cellCache,fs_cache::calculateNbrID(1+1,1+1,1  ));
 
          if(RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
             array[fs::dPERBzdxy] = FOURTH * (botLeft[cp::PERBZ] + topRght[cp::PERBZ] - botRght[cp::PERBZ] - topLeft[cp::PERBZ]);
@@ -329,10 +332,10 @@ void calculateDerivatives(
       if (((existingCells & CALCULATE_DXZ) == CALCULATE_DXZ) &&
           ((sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) || (sysBoundaryLayer == 1))) {
 
-         botLeft = cellCache.cells[fs_cache::calculateNbrID(1-1,1  ,1-1)]->parameters;
-         botRght = cellCache.cells[fs_cache::calculateNbrID(1+1,1  ,1-1)]->parameters;
-         topLeft = cellCache.cells[fs_cache::calculateNbrID(1-1,1  ,1+1)]->parameters;
-         topRght = cellCache.cells[fs_cache::calculateNbrID(1+1,1  ,1+1)]->parameters;
+         botLeft = fields.parameters(cellCache,fs_cache::calculateNbrID(1-1,1  ,1-1));
+         botRght = fields.parameters(cellCache,fs_cache::calculateNbrID(1+1,1  ,1-1));
+         topLeft = fields.parameters(cellCache,fs_cache::calculateNbrID(1-1,1  ,1+1));
+         topRght = fields.parameters(cellCache,fs_cache::calculateNbrID(1+1,1  ,1+1));
 
          if(RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
             array[fs::dPERBydxz] = FOURTH * (botLeft[cp::PERBY] + topRght[cp::PERBY] - botRght[cp::PERBY] - topLeft[cp::PERBY]);
@@ -352,10 +355,10 @@ void calculateDerivatives(
       if (((existingCells & CALCULATE_DYZ) == CALCULATE_DYZ) &&
           ((sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) || (sysBoundaryLayer == 1))) {
 
-         botLeft = cellCache.cells[fs_cache::calculateNbrID(1  ,1-1,1-1)]->parameters;
-         botRght = cellCache.cells[fs_cache::calculateNbrID(1  ,1+1,1-1)]->parameters;
-         topLeft = cellCache.cells[fs_cache::calculateNbrID(1  ,1-1,1+1)]->parameters;
-         topRght = cellCache.cells[fs_cache::calculateNbrID(1  ,1+1,1+1)]->parameters;
+         botLeft = fields.parameters(cellCache,fs_cache::calculateNbrID(1  ,1-1,1-1));
+         botRght = fields.parameters(cellCache,fs_cache::calculateNbrID(1  ,1+1,1-1));
+         topLeft = fields.parameters(cellCache,fs_cache::calculateNbrID(1  ,1-1,1+1));
+         topRght = fields.parameters(cellCache,fs_cache::calculateNbrID(1  ,1+1,1+1));
 
          if(RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
             array[fs::dPERBxdyz] = FOURTH * (botLeft[cp::PERBX] + topRght[cp::PERBX] - botRght[cp::PERBX] - topLeft[cp::PERBX]);
@@ -374,6 +377,31 @@ void calculateDerivatives(
 }
 
 
+/*! \brief Calculate spatial derivatives on the given cells.
+ * 
+ * \param fields Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
+ * \param mpiGrid Grid
+ * \param sysBoundaries System boundary conditions existing
+ * \param cells Field solver cache local IDs of the cells to process
+ * \param RKCase Element in the enum defining the Runge-Kutta method steps
+ */
+template<typename FIELDS>
+void calculateDerivatives(
+   const FIELDS& fields,
+   dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+   SysBoundary& sysBoundaries,
+   const std::vector<uint16_t>& cells,
+   cint& RKCase
+) {
+   for (size_t c=0; c<cells.size(); ++c) {
+      const uint16_t localID = cells[c];
+      fs_cache::CellCache cache = fs_cache::getCache().localCellsCache[localID];
+
+      if (cache.sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) continue;
+      calculateDerivatives(fields,mpiGrid,cache,sysBoundaries, RKCase);
+   }
+}
+
 /*! \brief High-level derivative calculation wrapper function.
  * 
 
@@ -402,6 +430,8 @@ void calculateDerivativesSimple(
    
    phiprof::start("Calculate face derivatives");
 
+   uint64_t transferMask;
+
    switch (RKCase) {
     case RK_ORDER1:
       // Means initialising the solver as well as RK_ORDER1
@@ -409,9 +439,9 @@ void calculateDerivativesSimple(
       // The update of PERB[XYZ] is needed after the system
       // boundary update of propagateMagneticFieldSimple.
       if(communicateMoments) {
-        spatial_cell::SpatialCell::set_mpi_transfer_type(Transfer::CELL_PERB | Transfer::CELL_RHO_RHOV | Transfer::CELL_P);
+        transferMask = Transfer::CELL_PERB | Transfer::CELL_RHO_RHOV | Transfer::CELL_P;
       } else {
-        spatial_cell::SpatialCell::set_mpi_transfer_type(Transfer::CELL_PERB);
+        transferMask = Transfer::CELL_PERB;
       }
       break;
     case RK_ORDER2_STEP1:
@@ -419,9 +449,9 @@ void calculateDerivativesSimple(
       // update of PERB[XYZ]_DT2 is needed after the system
       // boundary update of propagateMagneticFieldSimple.
       if(communicateMoments) {
-        spatial_cell::SpatialCell::set_mpi_transfer_type(Transfer::CELL_PERBDT2 | Transfer::CELL_RHODT2_RHOVDT2 | Transfer::CELL_PDT2);
+        transferMask = Transfer::CELL_PERBDT2 | Transfer::CELL_RHODT2_RHOVDT2 | Transfer::CELL_PDT2;
       } else {
-        spatial_cell::SpatialCell::set_mpi_transfer_type(Transfer::CELL_PERBDT2);
+        transferMask = Transfer::CELL_PERBDT2;
       }
       break;
     case RK_ORDER2_STEP2:
@@ -429,48 +459,51 @@ void calculateDerivativesSimple(
       // is needed after the system boundary update of
       // propagateMagneticFieldSimple.
       if(communicateMoments) {
-        spatial_cell::SpatialCell::set_mpi_transfer_type(Transfer::CELL_PERB | Transfer::CELL_RHO_RHOV | Transfer::CELL_P);
+        transferMask = Transfer::CELL_PERB | Transfer::CELL_RHO_RHOV | Transfer::CELL_P;
       } else {
-        spatial_cell::SpatialCell::set_mpi_transfer_type(Transfer::CELL_PERB);
+        transferMask = Transfer::CELL_PERB;
       }
       break;
     default:
       cerr << __FILE__ << ":" << __LINE__ << " Went through switch, this should not happen." << endl;
       abort();
    }
+   spatial_cell::SpatialCell::set_mpi_transfer_type(transferMask);
+   const int neighborhood = getDerivativesNeighborhood();
 
    timer=phiprof::initializeTimer("Start comm","MPI");
    phiprof::start(timer);
-   mpiGrid.start_remote_neighbor_copy_updates(FIELD_SOLVER_NEIGHBORHOOD_ID);
-   phiprof::stop(timer);
+   mpiGrid.start_remote_neighbor_copy_updates(neighborhood);
+   phiprof::stop(timer,fs_cache::getHaloExchangeBytes(neighborhood,transferMask),"Bytes");
+
+   fs_cache::CacheContainer& cacheContainer = fs_cache::getCache();
+   fs_cache::FieldGrid& fieldGrid = cacheContainer.fieldGrid;
+   const bool useFieldGrid = fieldGrid.isActive();
 
    timer=phiprof::initializeTimer("Compute process inner cells");
    phiprof::start(timer);
 
    // Calculate derivatives on process inner cells
-   for (size_t c=0; c<fs_cache::getCache().cellsWithLocalNeighbours.size(); ++c) {
-      const uint16_t localID = fs_cache::getCache().cellsWithLocalNeighbours[c];
-      fs_cache::CellCache cache = fs_cache::getCache().localCellsCache[localID];
-
-      if (cache.sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) continue;
-      calculateDerivatives(mpiGrid,cache,sysBoundaries, RKCase);
+   if (useFieldGrid == true) {
+      calculateDerivatives(fs_cache::FieldGridFields(fieldGrid),mpiGrid,sysBoundaries,cacheContainer.fieldGridCellsWithLocalNeighbours,RKCase);
+   } else {
+      calculateDerivatives(fs_cache::SpatialCellFields(),mpiGrid,sysBoundaries,cacheContainer.cellsWithLocalNeighbours,RKCase);
    }
    phiprof::stop(timer,fs_cache::getCache().cellsWithLocalNeighbours.size(),"Spatial Cells");
 
    timer=phiprof::initializeTimer("Wait for sends","MPI","Wait");
    phiprof::start(timer);
-   mpiGrid.wait_remote_neighbor_copy_update_receives(FIELD_SOLVER_NEIGHBORHOOD_ID);
+   mpiGrid.wait_remote_neighbor_copy_update_receives(neighborhood);
+   if (useFieldGrid == true) fieldGrid.copyFromCells(cacheContainer.fieldGridRemoteCells,transferMask);
    phiprof::stop(timer);
    
    // Calculate derivatives on process boundary cells
    timer=phiprof::initializeTimer("Compute process boundary cells");
    phiprof::start(timer);
-   for (size_t c=0; c<fs_cache::getCache().cellsWithRemoteNeighbours.size(); ++c) {
-      const uint16_t localID = fs_cache::getCache().cellsWithRemoteNeighbours[c];
-      fs_cache::CellCache cache = fs_cache::getCache().localCellsCache[localID];
-
-      if (cache.sysBoundaryFlag == sysboundarytype::DO_NOT_COMPUTE) continue;
-      calculateDerivatives(mpiGrid,cache,sysBoundaries, RKCase);
+   if (useFieldGrid == true) {
+      calculateDerivatives(fs_cache::FieldGridFields(fieldGrid),mpiGrid,sysBoundaries,cacheContainer.fieldGridCellsWithRemoteNeighbours,RKCase);
+   } else {
+      calculateDerivatives(fs_cache::SpatialCellFields(),mpiGrid,sysBoundaries,cacheContainer.cellsWithRemoteNeighbours,RKCase);
    }
    phiprof::stop(timer,fs_cache::getCache().cellsWithRemoteNeighbours.size(),"Spatial Cells");
 
@@ -479,6 +512,18 @@ void calculateDerivativesSimple(
    mpiGrid.wait_remote_neighbor_copy_update_sends();
    phiprof::stop(timer);
 
+   // Cells next to system boundaries are computed in spatial cells after 
+   // all remote neighbour data has arrived
+   if (useFieldGrid == true) {
+      timer=phiprof::initializeTimer("Compute system boundary cells");
+      phiprof::start(timer);
+      fieldGrid.copyToCells(cacheContainer.fieldGridMirroredCells,Transfer::CELL_DERIVATIVES);
+      calculateDerivatives(fs_cache::SpatialCellFields(),mpiGrid,sysBoundaries,cacheContainer.spatialCellsWithLocalNeighbours,RKCase);
+      calculateDerivatives(fs_cache::SpatialCellFields(),mpiGrid,sysBoundaries,cacheContainer.spatialCellsWithRemoteNeighbours,RKCase);
+      fieldGrid.copyFromCells(cacheContainer.spatialCellLocalCells,Transfer::CELL_DERIVATIVES);
+      phiprof::stop(timer,cacheContainer.spatialCellLocalCells.size(),"Spatial Cells");
+   }
+
    const size_t N_cells = fs_cache::getCache().cellsWithLocalNeighbours.size()
      + fs_cache::getCache().cellsWithRemoteNeighbours.size();
    phiprof::stop("Calculate face derivatives",N_cells,"Spatial Cells");   
@@ -42,11 +42,225 @@ vector<uint16_t> fs_cache::CacheContainer::cellsWithLocalNeighbours;
 vector<uint16_t> fs_cache::CacheContainer::cellsWithRemoteNeighbours;
 vector<uint16_t> fs_cache::CacheContainer::local_NOT_DO_NOT_COMPUTE;
 vector<uint16_t> fs_cache::CacheContainer::local_NOT_SYSBOUND_DO_NOT_COMPUTE;
+fs_cache::FieldGrid fs_cache::CacheContainer::fieldGrid;
+vector<uint16_t> fs_cache::CacheContainer::fieldGridCellsWithLocalNeighbours;
+vector<uint16_t> fs_cache::CacheContainer::fieldGridCellsWithRemoteNeighbours;
+vector<uint16_t> fs_cache::CacheContainer::fieldGrid_NOT_SYSBOUND_DO_NOT_COMPUTE;
+vector<uint16_t> fs_cache::CacheContainer::spatialCellsWithLocalNeighbours;
+vector<uint16_t> fs_cache::CacheContainer::spatialCellsWithRemoteNeighbours;
+vector<uint16_t> fs_cache::CacheContainer::spatialCell_NOT_SYSBOUND_DO_NOT_COMPUTE;
+vector<uint32_t> fs_cache::CacheContainer::fieldGridLocalCells;
+vector<uint32_t> fs_cache::CacheContainer::fieldGridMirroredCells;
+vector<uint32_t> fs_cache::CacheContainer::spatialCellLocalCells;
+vector<uint32_t> fs_cache::CacheContainer::fieldGridRemoteCells;
+map<int,size_t> fs_cache::CacheContainer::remoteCellCounts;
 
 namespace fs_cache {
            
    CellCache::CellCache() {
       for (int i=0; i<27; ++i) cells[i] = NULL;
+      for (int i=0; i<27; ++i) fieldIndices[i] = INVALID_FIELD_INDEX;
+   }
+   
+   FieldGrid::FieldGrid(): active(false) { }
+   
+   /** Allocate storage for the given cells. Local cells must be given first, 
+    * in the same order as in CacheContainer::localCellsCache.
+    * @param cells Spatial cells stored in FieldGrid.*/
+   void FieldGrid::initialize(const std::vector<spatial_cell::SpatialCell*>& cells) {
+      this->cells = cells;
+      parameterData.resize(CellParams::N_SPATIAL_CELL_PARAMS*cells.size());
+      derivativeData.resize(fieldsolver::N_SPATIAL_CELL_DERIVATIVES*cells.size());
+      active = false;
+   }
+   
+   void FieldGrid::clear() {
+      vector<spatial_cell::SpatialCell*>().swap(cells);
+      vector<Real>().swap(parameterData);
+      vector<Real>().swap(derivativeData);
+      active = false;
+   }
+   
+   /** Get the ranges of SpatialCell::parameters that are transferred with the 
+    * given transfer mask. Only the transfers used by the field solver are supported, 
+    * derivatives (Transfer::CELL_DERIVATIVES) are not included in the ranges.
+    * @param transferMask Bitwise or of values defined in namespace Transfer.
+    * @param ranges Vector where the first parameter and the number of parameters of each range are inserted.*/
+   static void getTransferredParameters(const uint64_t& transferMask,vector<pair<int,int> >& ranges) {
+      if ((transferMask & Transfer::CELL_E) != 0) ranges.push_back(make_pair((int)CellParams::EX,3));
+      if ((transferMask & Transfer::CELL_EDT2) != 0) ranges.push_back(make_pair((int)CellParams::EX_DT2,3));
+      if ((transferMask & Transfer::CELL_PERB) != 0) ranges.push_back(make_pair((int)CellParams::PERBX,3));
+      if ((transferMask & Transfer::CELL_PERBDT2) != 0) ranges.push_back(make_pair((int)CellParams::PERBX_DT2,3));
+      if ((transferMask & Transfer::CELL_RHO_RHOV) != 0) ranges.push_back(make_pair((int)CellParams::RHO,4));
+      if ((transferMask & Transfer::CELL_RHODT2_RHOVDT2) != 0) ranges.push_back(make_pair((int)CellParams::RHO_DT2,4));
+      if ((transferMask & Transfer::CELL_P) != 0) ranges.push_back(make_pair((int)CellParams::P_11,3));
+      if ((transferMask & Transfer::CELL_PDT2) != 0) ranges.push_back(make_pair((int)CellParams::P_11_DT2,3));
+      if ((transferMask & Transfer::CELL_HALL_TERM) != 0) ranges.push_back(make_pair((int)CellParams::EXHALL_000_100,12));
+      if ((transferMask & Transfer::CELL_GRADPE_TERM) != 0) ranges.push_back(make_pair((int)CellParams::EXGRADPE,3));
+   }
+   
+   /** Copy all parameters and derivatives of all cells from spatial cells to FieldGrid.*/
+   void FieldGrid::copyAllFromCells() {
+      const size_t N = cells.size();
+      #pragma omp parallel for
+      for (size_t i=0; i<N; ++i) {
+         const Real* cp = cells[i]->parameters;
+         const Real* derivs = cells[i]->derivatives;
+         for (int p=0; p<CellParams::N_SPATIAL_CELL_PARAMS; ++p) parameterData[p*N+i] = cp[p];
+         for (int d=0; d<fieldsolver::N_SPATIAL_CELL_DERIVATIVES; ++d) derivativeData[d*N+i] = derivs[d];
+      }
+   }
+   
+   /** Copy the variables transferred with the given transfer mask from spatial cells to FieldGrid.
+    * @param indices FieldGrid indices of copied cells.
+    * @param transferMask Bitwise or of values defined in namespace Transfer.*/
+   void FieldGrid::copyFromCells(const std::vector<uint32_t>& indices,const uint64_t& transferMask) {
+      vector<pair<int,int> > ranges;
+      getTransferredParameters(transferMask,ranges);
+      for (size_t r=0; r<ranges.size(); ++r) copyParametersFromCells(indices,ranges[r].first,ranges[r].second);
+      
+      if ((transferMask & Transfer::CELL_DERIVATIVES) == 0) return;
+      const size_t N = cells.size();
+      #pragma omp parallel for
+      for (size_t i=0; i<indices.size(); ++i) {
+         const Real* derivs = cells[indices[i]]->derivatives;
+         for (int d=0; d<fieldsolver::N_SPATIAL_CELL_DERIVATIVES; ++d) derivativeData[d*N+indices[i]] = derivs[d];
+      }
+   }
+   
+   /** Copy the variables transferred with the given transfer mask from FieldGrid to spatial cells.
+    * @param indices FieldGrid indices of copied cells.
+    * @param transferMask Bitwise or of values defined in namespace Transfer.*/
+   void FieldGrid::copyToCells(const std::vector<uint32_t>& indices,const uint64_t& transferMask) {
+      vector<pair<int,int> > ranges;
+      getTransferredParameters(transferMask,ranges);
+      for (size_t r=0; r<ranges.size(); ++r) copyParametersToCells(indices,ranges[r].first,ranges[r].second);
+      
+      if ((transferMask & Transfer::CELL_DERIVATIVES) == 0) return;
+      const size_t N = cells.size();
+      #pragma omp parallel for
+      for (size_t i=0; i<indices.size(); ++i) {
+         Real* derivs = cells[indices[i]]->derivatives;
+         for (int d=0; d<fieldsolver::N_SPATIAL_CELL_DERIVATIVES; ++d) derivs[d] = derivativeData[d*N+indices[i]];
+      }
+   }
+   
+   /** Copy parameters first,...,first+count-1 from spatial cells to FieldGrid.
+    * @param indices FieldGrid indices of copied cells.
+    * @param first Index of the first copied parameter, one of the values in namespace CellParams.
+    * @param count Number of copied parameters.*/
+   void FieldGrid::copyParametersFromCells(const std::vector<uint32_t>& indices,const int& first,const int& count) {
+      const size_t N = cells.size();
+      #pragma omp parallel for
+      for (size_t i=0; i<indices.size(); ++i) {
+         const Real* cp = cells[indices[i]]->parameters;
+         for (int p=first; p<first+count; ++p) parameterData[p*N+indices[i]] = cp[p];
+      }
+   }
+   
+   /** Copy parameters first,...,first+count-1 from FieldGrid to spatial cells.
+    * @param indices FieldGrid indices of copied cells.
+    * @param first Index of the first copied parameter, one of the values in namespace CellParams.
+    * @param count Number of copied parameters.*/
+   void FieldGrid::copyParametersToCells(const std::vector<uint32_t>& indices,const int& first,const int& count) {
+      const size_t N = cells.size();
+      #pragma omp parallel for
+      for (size_t i=0; i<indices.size(); ++i) {
+         Real* cp = cells[indices[i]]->parameters;
+         for (int p=first; p<first+count; ++p) cp[p] = parameterData[p*N+indices[i]];
+      }
+   }
+   
+   /** Check if the given cell can be computed in FieldGrid. Cells next to 
+    * system boundaries and DO_NOT_COMPUTE cells are computed in spatial cells, 
+    * because system boundary conditions only work with spatial cells.*/
+   static bool isFieldGridCell(const CellCache& cache) {
+      const uint ALL_CELLS_EXIST = (1 << 27) - 1;
+      if (cache.sysBoundaryFlag != sysboundarytype::NOT_SYSBOUNDARY) return false;
+      if (cache.existingCellsFlags != ALL_CELLS_EXIST) return false;
+      for (int n=0; n<27; ++n) {
+         if (cache.cells[n] == NULL) return false;
+         if (cache.cells[n]->sysBoundaryFlag != sysboundarytype::NOT_SYSBOUNDARY) return false;
+      }
+      return true;
+   }
+   
+   /** Create FieldGrid and the cell lists needed to propagate fields in it.
+    * Local cells get the same indices as in localCellsCache, remote 
+    * neighbours are appended after them.*/
+   static void calculateFieldGrid(
+      dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+      const std::vector<CellID>& cells,
+      unordered_map<CellID,uint16_t>& globalToLocalMap
+   ) {
+      vector<spatial_cell::SpatialCell*> fieldGridCells;
+      unordered_map<const spatial_cell::SpatialCell*,uint32_t> fieldIndices;
+      for (size_t c=0; c<cells.size(); ++c) {
+         fieldGridCells.push_back(mpiGrid[cells[c]]);
+         fieldIndices[mpiGrid[cells[c]]] = c;
+      }
+      
+      vector<bool> computedInFieldGrid(cells.size());
+      for (size_t c=0; c<cells.size(); ++c) {
+         CellCache& cache = cacheContainer.localCellsCache[c];
+         for (int n=0; n<27; ++n) {
+            if (cache.cells[n] == NULL) continue;
+            unordered_map<const spatial_cell::SpatialCell*,uint32_t>::const_iterator it = fieldIndices.find(cache.cells[n]);
+            if (it == fieldIndices.end()) {
+               cache.fieldIndices[n] = fieldGridCells.size();
+               fieldIndices[cache.cells[n]] = fieldGridCells.size();
+               cacheContainer.fieldGridRemoteCells.push_back(fieldGridCells.size());
+               fieldGridCells.push_back(cache.cells[n]);
+            } else {
+               cache.fieldIndices[n] = it->second;
+            }
+         }
+         
+         computedInFieldGrid[c] = isFieldGridCell(cache);
+         if (computedInFieldGrid[c] == true) {
+            cacheContainer.fieldGridLocalCells.push_back(c);
+         } else if (cache.sysBoundaryFlag != sysboundarytype::DO_NOT_COMPUTE) {
+            cacheContainer.spatialCellLocalCells.push_back(c);
+         }
+      }
+      cacheContainer.fieldGrid.initialize(fieldGridCells);
+
+      for (size_t c=0; c<cacheContainer.cellsWithLocalNeighbours.size(); ++c) {
+         const uint16_t localID = cacheContainer.cellsWithLocalNeighbours[c];
+         if (computedInFieldGrid[localID] == true) cacheContainer.fieldGridCellsWithLocalNeighbours.push_back(localID);
+         else cacheContainer.spatialCellsWithLocalNeighbours.push_back(localID);
+      }
+      for (size_t c=0; c<cacheContainer.cellsWithRemoteNeighbours.size(); ++c) {
+         const uint16_t localID = cacheContainer.cellsWithRemoteNeighbours[c];
+         if (computedInFieldGrid[localID] == true) cacheContainer.fieldGridCellsWithRemoteNeighbours.push_back(localID);
+         else cacheContainer.spatialCellsWithRemoteNeighbours.push_back(localID);
+      }
+      for (size_t c=0; c<cacheContainer.local_NOT_SYSBOUND_DO_NOT_COMPUTE.size(); ++c) {
+         const uint16_t localID = cacheContainer.local_NOT_SYSBOUND_DO_NOT_COMPUTE[c];
+         if (computedInFieldGrid[localID] == true) cacheContainer.fieldGrid_NOT_SYSBOUND_DO_NOT_COMPUTE.push_back(localID);
+         else cacheContainer.spatialCell_NOT_SYSBOUND_DO_NOT_COMPUTE.push_back(localID);
+      }
+      
+      // Spatial cells of cells computed in FieldGrid need to be kept up to date 
+      // if they are sent to other processes, or if they are read when computing 
+      // cells next to system boundaries:
+      vector<bool> mirrored(cells.size(),false);
+      const vector<uint64_t> processBoundaryCells
+        = mpiGrid.get_local_cells_on_process_boundary(SYSBOUNDARIES_EXTENDED_NEIGHBORHOOD_ID);
+      for (size_t c=0; c<processBoundaryCells.size(); ++c) {
+         mirrored[globalToLocalMap[processBoundaryCells[c]]] = true;
+      }
+      for (size_t c=0; c<cells.size(); ++c) {
+         if (computedInFieldGrid[c] == true) continue;
+         const vector<CellID>* nbrs = mpiGrid.get_neighbors_of(cells[c],SYSBOUNDARIES_EXTENDED_NEIGHBORHOOD_ID);
+         for (size_t n=0; n<nbrs->size(); ++n) {
+            unordered_map<CellID,uint16_t>::const_iterator it = globalToLocalMap.find((*nbrs)[n]);
+            if (it != globalToLocalMap.end()) mirrored[it->second] = true;
+         }
+      }
+      for (size_t c=0; c<cells.size(); ++c) {
+         if (computedInFieldGrid[c] == true && mirrored[c] == true) cacheContainer.fieldGridMirroredCells.push_back(c);
+      }
    }
    
    void calculateCache(
@@ -133,6 +347,18 @@ namespace fs_cache {
          cacheContainer.cellsWithRemoteNeighbours.push_back(globalToLocalMap[cellsWithRemoteNeighbours[c]]);
       }
 
+      if (Parameters::fieldSolverSoaGrid == true && (Parameters::ohmHallTerm == 0 && Parameters::ohmGradPeTerm == 0)) {
+         calculateFieldGrid(mpiGrid,cells,globalToLocalMap);
+      }
+
+      // Number of cells received in field solver halo exchanges
+      const int neighborhoods[] = {FIELD_SOLVER_NEIGHBORHOOD_ID,FIELD_SOLVER_E_NEIGHBORHOOD_ID,
+                                   FIELD_SOLVER_E_HALL_NEIGHBORHOOD_ID,FIELD_SOLVER_B_NEIGHBORHOOD_ID};
+      for (int n=0; n<4; ++n) {
+         cacheContainer.remoteCellCounts[neighborhoods[n]]
+           = mpiGrid.get_remote_cells_on_process_boundary(neighborhoods[n]).size();
+      }
+
       cacheContainer.cacheCalculatedStep = Parameters::tstep;
    }
    
@@ -144,8 +370,58 @@ namespace fs_cache {
       vector<uint16_t>().swap(boundaryCellsWithRemoteNeighbours);
       vector<uint16_t>().swap(cellsWithRemoteNeighbours);
       vector<uint16_t>().swap(cellsWithLocalNeighbours);
+      fieldGrid.clear();
+      vector<uint16_t>().swap(fieldGridCellsWithLocalNeighbours);
+      vector<uint16_t>().swap(fieldGridCellsWithRemoteNeighbours);
+      vector<uint16_t>().swap(fieldGrid_NOT_SYSBOUND_DO_NOT_COMPUTE);
+      vector<uint16_t>().swap(spatialCellsWithLocalNeighbours);
+      vector<uint16_t>().swap(spatialCellsWithRemoteNeighbours);
+      vector<uint16_t>().swap(spatialCell_NOT_SYSBOUND_DO_NOT_COMPUTE);
+      vector<uint32_t>().swap(fieldGridLocalCells);
+      vector<uint32_t>().swap(fieldGridMirroredCells);
+      vector<uint32_t>().swap(spatialCellLocalCells);
+      vector<uint32_t>().swap(fieldGridRemoteCells);
+      remoteCellCounts.clear();
    }
    
    CacheContainer& getCache() {return cacheContainer;}
+   
+   /** Copy field solver variables from spatial cells to FieldGrid, after which 
+    * cells in CacheContainer::fieldGridLocalCells are propagated in FieldGrid. 
+    * Does nothing if FieldGrid is not in use. Must be called after calculateCache.*/
+   void copyToFieldGrid() {
+      if (cacheContainer.fieldGrid.size() == 0) return;
+      cacheContainer.fieldGrid.copyAllFromCells();
+      cacheContainer.fieldGrid.setActive(true);
+   }
+   
+   /** Get the number of bytes this process receives when the given variables are exchanged 
+    * over the given field solver neighborhood. Used as work units of field solver MPI timers 
+    * so that the communication volume of each stage shows up in phiprof output.
+    * @param neighborhoodID Neighborhood of the exchange.
+    * @param transferMask Bitwise or of values defined in namespace Transfer.
+    * @return Received bytes, zero if the neighborhood is not known.*/
+   double getHaloExchangeBytes(const int& neighborhoodID,const uint64_t& transferMask) {
+      map<int,size_t>::const_iterator it = cacheContainer.remoteCellCounts.find(neighborhoodID);
+      if (it == cacheContainer.remoteCellCounts.end()) return 0.0;
+      
+      vector<pair<int,int> > ranges;
+      getTransferredParameters(transferMask,ranges);
+      size_t values = 0;
+      for (size_t r=0; r<ranges.size(); ++r) values += ranges[r].second;
+      if ((transferMask & Transfer::CELL_DERIVATIVES) != 0) values += fieldsolver::N_SPATIAL_CELL_DERIVATIVES;
+      return static_cast<double>(it->second)*values*sizeof(Real);
+   }
+   
+   /** Copy propagated field solver variables from FieldGrid back to spatial cells.
+    * Does nothing if FieldGrid is not active.*/
+   void copyFromFieldGrid() {
+      if (cacheContainer.fieldGrid.isActive() == false) return;
+      const uint64_t transferMask = Transfer::CELL_PERB | Transfer::CELL_PERBDT2 
+                                  | Transfer::CELL_E | Transfer::CELL_EDT2 | Transfer::CELL_DERIVATIVES;
+      cacheContainer.fieldGrid.copyToCells(cacheContainer.fieldGridLocalCells,transferMask);
+      cacheContainer.fieldGrid.copyParametersToCells(cacheContainer.fieldGridLocalCells,CellParams::MAXFDT,1);
+      cacheContainer.fieldGrid.setActive(false);
+   }
       
 } // namespace fs_cache
@@ -23,6 +23,8 @@
 #ifndef FS_CACHE_H
 #define FS_CACHE_H
 
+#include <limits>
+#include <map>
 #include <vector>
 
 #include <dccrg.hpp>
@@ -55,6 +57,8 @@ namespace fs_cache {
    template<typename INT> INT calculateNbrID(const INT& I,const INT& J,const INT& K) {
       return K*9 + J*3 + I;
    }
+
+   const uint32_t INVALID_FIELD_INDEX = std::numeric_limits<uint32_t>::max();
     
    struct CellCache {
       CellCache();
@@ -68,6 +72,69 @@ namespace fs_cache {
       //Real* derivativesBVOL;
 
       spatial_cell::SpatialCell* cells[27];
+      uint32_t fieldIndices[27];                                      /**< Indices of the cells in FieldGrid, INVALID_FIELD_INDEX if the cell does not exist.*/
+   };
+
+   /** Values of one cell in FieldGrid. Indexed like SpatialCell::parameters or 
+    * SpatialCell::derivatives, consecutive values are stride elements apart.*/
+   template<typename REAL>
+   struct FieldView {
+      FieldView(REAL* base,const size_t& stride): base(base),stride(stride) { }
+      template<typename OTHER> FieldView(const FieldView<OTHER>& other): base(other.base),stride(other.stride) { }
+      REAL& operator[](const int& i) const {return base[i*stride];}
+      
+      REAL* base;
+      size_t stride;
+   };
+   
+   /** Structure-of-arrays copy of the field solver variables of local cells and 
+    * their remote neighbours. Each variable is stored contiguously over all cells, 
+    * local cells first in the same order as CacheContainer::localCellsCache.*/
+   class FieldGrid {
+   public:
+      FieldGrid();
+      
+      void initialize(const std::vector<spatial_cell::SpatialCell*>& cells);
+      void clear();
+      bool isActive() const {return active;}
+      void setActive(const bool& active) {this->active = active;}
+      size_t size() const {return cells.size();}
+      
+      FieldView<Real> parameters(const uint32_t& index) {return FieldView<Real>(&(parameterData[index]),cells.size());}
+      FieldView<Real> derivatives(const uint32_t& index) {return FieldView<Real>(&(derivativeData[index]),cells.size());}
+      
+      void copyAllFromCells();
+      void copyFromCells(const std::vector<uint32_t>& indices,const uint64_t& transferMask);
+      void copyToCells(const std::vector<uint32_t>& indices,const uint64_t& transferMask);
+      void copyParametersFromCells(const std::vector<uint32_t>& indices,const int& first,const int& count);
+      void copyParametersToCells(const std::vector<uint32_t>& indices,const int& first,const int& count);
+      
+   private:
+      bool active;                                                    /**< If true, values in FieldGrid are more recent than in spatial cells.*/
+      std::vector<spatial_cell::SpatialCell*> cells;
+      std::vector<Real> parameterData;
+      std::vector<Real> derivativeData;
+   };
+   
+   /** Field solver variable access through spatial cells, the default.*/
+   struct SpatialCellFields {
+      typedef Real* Values;
+      typedef const Real* ConstValues;
+      
+      Values parameters(const CellCache& cache,const int& nbr) const {return cache.cells[nbr]->parameters;}
+      Values derivatives(const CellCache& cache,const int& nbr) const {return cache.cells[nbr]->derivatives;}
+   };
+   
+   /** Field solver variable access through FieldGrid.*/
+   struct FieldGridFields {
+      typedef FieldView<Real> Values;
+      typedef FieldView<const Real> ConstValues;
+      
+      FieldGridFields(FieldGrid& grid): grid(&grid) { }
+      Values parameters(const CellCache& cache,const int& nbr) const {return grid->parameters(cache.fieldIndices[nbr]);}
+      Values derivatives(const CellCache& cache,const int& nbr) const {return grid->derivatives(cache.fieldIndices[nbr]);}
+      
+      FieldGrid* grid;
    };
    
    struct CacheContainer {
@@ -85,6 +152,20 @@ namespace fs_cache {
       static std::vector<uint16_t> local_NOT_DO_NOT_COMPUTE;          /**< Exclude DO_NOT_COMPUTE cells.*/
       static std::vector<uint16_t> local_NOT_SYSBOUND_DO_NOT_COMPUTE; /**< Exclude DO_NOT_COMPUTE and system boundary cells.*/
       
+      static FieldGrid fieldGrid;                                     /**< Used if Parameters::fieldSolverSoaGrid is true, see copyToFieldGrid.*/
+      static std::vector<uint16_t> fieldGridCellsWithLocalNeighbours;  /**< Cells in cellsWithLocalNeighbours computed in fieldGrid.*/
+      static std::vector<uint16_t> fieldGridCellsWithRemoteNeighbours; /**< Cells in cellsWithRemoteNeighbours computed in fieldGrid.*/
+      static std::vector<uint16_t> fieldGrid_NOT_SYSBOUND_DO_NOT_COMPUTE; /**< Cells in local_NOT_SYSBOUND_DO_NOT_COMPUTE computed in fieldGrid.*/
+      static std::vector<uint16_t> spatialCellsWithLocalNeighbours;    /**< Cells in cellsWithLocalNeighbours computed in spatial cells.*/
+      static std::vector<uint16_t> spatialCellsWithRemoteNeighbours;   /**< Cells in cellsWithRemoteNeighbours computed in spatial cells.*/
+      static std::vector<uint16_t> spatialCell_NOT_SYSBOUND_DO_NOT_COMPUTE; /**< Cells in local_NOT_SYSBOUND_DO_NOT_COMPUTE computed in spatial cells.*/
+      static std::vector<uint32_t> fieldGridLocalCells;                /**< All local cells computed in fieldGrid.*/
+      static std::vector<uint32_t> fieldGridMirroredCells;             /**< Local cells computed in fieldGrid whose spatial cells are 
+                                                                        * read by other processes or by system boundary conditions.*/
+      static std::vector<uint32_t> spatialCellLocalCells;              /**< All local cells computed in spatial cells.*/
+      static std::vector<uint32_t> fieldGridRemoteCells;               /**< Remote neighbours of local cells.*/
+      static std::map<int,size_t> remoteCellCounts;                    /**< Number of remote cells in each field solver neighborhood.*/
+      
       static void clear();
    };
    
@@ -94,6 +175,10 @@ namespace fs_cache {
    );
    
    CacheContainer& getCache();
+   
+   void copyToFieldGrid();
+   void copyFromFieldGrid();
+   double getHaloExchangeBytes(const int& neighborhoodID,const uint64_t& transferMask);
 
 } // namespace fs_cache
    
@@ -113,6 +113,16 @@ bool propagateFields(
    cint& subcycles
 );
 
+/*! \brief Get the neighborhood over which B and moments are exchanged before computing derivatives.
+ * 
+ * B and moments are not exchanged again before computing edge E, thus the neighborhood 
+ * covers both the face neighbours read by derivatives and the cells read by edge E.
+ */
+inline int getDerivativesNeighborhood() {
+   if (Parameters::ohmHallTerm == 2) return FIELD_SOLVER_E_HALL_NEIGHBORHOOD_ID;
+   return FIELD_SOLVER_E_NEIGHBORHOOD_ID;
+}
+
 /*! \brief Calculate the neighbour number.
  * 
  * Calculate the neighbour number. For the inspected cell the (i,j,k) are (1,1,1). Add or 
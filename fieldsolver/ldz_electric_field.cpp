@@ -73,6 +73,7 @@ Real calculateCflSpeed(
  * 
  * If fields are not propagated, returns 0.0 as there is no information propagating.
  * 
+ * \tparam FIELDS Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param cp Curent cell's parameters
  * \param derivs Curent cell's derivatives
  * \param nbr_cp Neighbor cell's parameters
@@ -92,11 +93,12 @@ Real calculateCflSpeed(
  * \param ret_vS Sound speed returned
  * \param ret_vW Whistler speed returned
  */
+template<typename FIELDS>
 void calculateWaveSpeedYZ(
-   const Real* cp,
-   const Real* derivs,
-   const Real* nbr_cp,
-   const Real* nbr_derivs,
+   typename FIELDS::ConstValues cp,
+   typename FIELDS::ConstValues derivs,
+   typename FIELDS::ConstValues nbr_cp,
+   typename FIELDS::ConstValues nbr_derivs,
    const Real& By,
    const Real& Bz,
    const Real& dBydx,
@@ -172,6 +174,7 @@ void calculateWaveSpeedYZ(
  * 
  * If fields are not propagated, returns 0.0 as there is no information propagating.
  * 
+ * \tparam FIELDS Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param cp Curent cell's parameters
  * \param derivs Curent cell's derivatives
  * \param nbr_cp Neighbor cell's parameters
@@ -191,11 +194,12 @@ void calculateWaveSpeedYZ(
  * \param ret_vS Sound speed returned
  * \param ret_vW Whistler speed returned
  */
+template<typename FIELDS>
 void calculateWaveSpeedXZ(
-   const Real* cp,
-   const Real* derivs,
-   const Real* nbr_cp,
-   const Real* nbr_derivs,
+   typename FIELDS::ConstValues cp,
+   typename FIELDS::ConstValues derivs,
+   typename FIELDS::ConstValues nbr_cp,
+   typename FIELDS::ConstValues nbr_derivs,
    const Real& Bx,
    const Real& Bz,
    const Real& dBxdy,
@@ -271,6 +275,7 @@ void calculateWaveSpeedXZ(
  * 
  * If fields are not propagated, returns 0.0 as there is no information propagating.
  * 
+ * \tparam FIELDS Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param cp Curent cell's parameters
  * \param derivs Curent cell's derivatives
  * \param nbr_cp Neighbor cell's parameters
@@ -290,11 +295,12 @@ void calculateWaveSpeedXZ(
  * \param ret_vS Sound speed returned
  * \param ret_vW Whistler speed returned
  */
+template<typename FIELDS>
 void calculateWaveSpeedXY(
-   const Real* cp,
-   const Real* derivs,
-   const Real* nbr_cp,
-   const Real* nbr_derivs,
+   typename FIELDS::ConstValues cp,
+   typename FIELDS::ConstValues derivs,
+   typename FIELDS::ConstValues nbr_cp,
+   typename FIELDS::ConstValues nbr_derivs,
    const Real& Bx,
    const Real& By,
    const Real& dBxdy,
@@ -370,10 +376,13 @@ void calculateWaveSpeedXY(
  * 
  * Note that the background B field is excluded from the diffusive term calculations because they are equivalent to a current term and the background field is curl-free.
  * 
+ * \param fields Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param cache Field solver cell cache
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
  */
+template<typename FIELDS>
 void calculateEdgeElectricFieldX(
+   const FIELDS& fields,
    fs_cache::CellCache& cache,
    cint& RKCase
 ) {
@@ -399,14 +408,14 @@ void calculateEdgeElectricFieldX(
    Real c_y, c_z;                   // Wave speeds to yz-directions
 
    // Get read-only pointers to NE,NW,SE,SW states (SW is rw, result is written there):
-   Real*  const cp_SW = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1  )]->parameters;
-   creal* const cp_SE = cache.cells[fs_cache::calculateNbrID(1  ,1-1,1  )]->parameters;
-   creal* const cp_NE = cache.cells[fs_cache::calculateNbrID(1  ,1-1,1-1)]->parameters;
-   creal* const cp_NW = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1-1)]->parameters;
-   creal* const derivs_SW = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1  )]->derivatives;
-   creal* const derivs_SE = cache.cells[fs_cache::calculateNbrID(1  ,1-1,1  )]->derivatives;
-   creal* const derivs_NE = cache.cells[fs_cache::calculateNbrID(1  ,1-1,1-1)]->derivatives;
-   creal* const derivs_NW = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1-1)]->derivatives;
+   const typename FIELDS::Values cp_SW = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1  ,1  ));
+   const typename FIELDS::ConstValues cp_SE = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1-1,1  ));
+   const typename FIELDS::ConstValues cp_NE = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1-1,1-1));
+   const typename FIELDS::ConstValues cp_NW = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1  ,1-1));
+   const typename FIELDS::ConstValues derivs_SW = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1  ,1  ));
+   const typename FIELDS::ConstValues derivs_SE = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1-1,1  ));
+   const typename FIELDS::ConstValues derivs_NE = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1-1,1-1));
+   const typename FIELDS::ConstValues derivs_NW = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1  ,1-1));
 
    Real By_S, Bz_W, Bz_E, By_N, perBy_S, perBz_W, perBz_E, perBy_N, rho_S;
    Real minRho = std::numeric_limits<Real>::max();
@@ -517,10 +526,10 @@ void calculateEdgeElectricFieldX(
       Ex_SW += -HALF*((Bz_W - HALF*dBzdy_W)*(-derivs_SW[fs::dVydy] - derivs_SW[fs::dVydz]) - dBzdy_W*Vy0 + SIXTH*dBzdx_W*derivs_SW[fs::dVydx]);
    #endif
 
-   creal* const nbr_cp_SW     = cache.cells[fs_cache::calculateNbrID(1+1,1  ,1  )]->parameters;
-   creal* const nbr_derivs_SW = cache.cells[fs_cache::calculateNbrID(1+1,1  ,1  )]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_SW     = fields.parameters(cache,fs_cache::calculateNbrID(1+1,1  ,1  ));
+   const typename FIELDS::ConstValues nbr_derivs_SW = fields.derivatives(cache,fs_cache::calculateNbrID(1+1,1  ,1  ));
    
-   calculateWaveSpeedYZ(cp_SW, derivs_SW, nbr_cp_SW, nbr_derivs_SW, By_S, Bz_W, dBydx_S, dBydz_S, dBzdx_W, dBzdy_W, MINUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedYZ<FIELDS>(cp_SW, derivs_SW, nbr_cp_SW, nbr_derivs_SW, By_S, Bz_W, dBydx_S, dBydz_S, dBzdx_W, dBzdy_W, MINUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_y = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_z = c_y;
    ay_neg   = max(ZERO,-Vy0 + c_y);
@@ -571,10 +580,10 @@ void calculateEdgeElectricFieldX(
       Ex_SE += -HALF*((Bz_E + HALF*dBzdy_E)*(+derivs_SE[fs::dVydy] - derivs_SE[fs::dVydz]) + dBzdy_E*Vy0 + SIXTH*dBzdx_E*derivs_SE[fs::dVydx]);
    #endif
 
-   creal* const nbr_cp_SE     = cache.cells[fs_cache::calculateNbrID(1+1,1-1,1  )]->parameters;
-   creal* const nbr_derivs_SE = cache.cells[fs_cache::calculateNbrID(1+1,1-1,1  )]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_SE     = fields.parameters(cache,fs_cache::calculateNbrID(1+1,1-1,1  ));
+   const typename FIELDS::ConstValues nbr_derivs_SE = fields.derivatives(cache,fs_cache::calculateNbrID(1+1,1-1,1  ));
    
-   calculateWaveSpeedYZ(cp_SE, derivs_SE, nbr_cp_SE, nbr_derivs_SE, By_S, Bz_E, dBydx_S, dBydz_S, dBzdx_E, dBzdy_E, PLUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedYZ<FIELDS>(cp_SE, derivs_SE, nbr_cp_SE, nbr_derivs_SE, By_S, Bz_E, dBydx_S, dBydz_S, dBzdx_E, dBzdy_E, PLUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_y = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_z = c_y;
    ay_neg   = max(ay_neg,-Vy0 + c_y);
@@ -625,10 +634,10 @@ void calculateEdgeElectricFieldX(
       Ex_NW += -HALF*((Bz_W - HALF*dBzdy_W)*(-derivs_NW[fs::dVydy] + derivs_NW[fs::dVydz]) - dBzdy_W*Vy0 + SIXTH*dBzdx_W*derivs_NW[fs::dVydx]);
    #endif
    
-   creal* const nbr_cp_NW     = cache.cells[fs_cache::calculateNbrID(1+1,1  ,1-1)]->parameters;
-   creal* const nbr_derivs_NW = cache.cells[fs_cache::calculateNbrID(1+1,1  ,1-1)]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_NW     = fields.parameters(cache,fs_cache::calculateNbrID(1+1,1  ,1-1));
+   const typename FIELDS::ConstValues nbr_derivs_NW = fields.derivatives(cache,fs_cache::calculateNbrID(1+1,1  ,1-1));
    
-   calculateWaveSpeedYZ(cp_NW, derivs_NW, nbr_cp_NW, nbr_derivs_NW, By_N, Bz_W, dBydx_N, dBydz_N, dBzdx_W, dBzdy_W, MINUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedYZ<FIELDS>(cp_NW, derivs_NW, nbr_cp_NW, nbr_derivs_NW, By_N, Bz_W, dBydx_N, dBydz_N, dBzdx_W, dBzdy_W, MINUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_y = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_z = c_y;
    ay_neg   = max(ay_neg,-Vy0 + c_y);
@@ -679,10 +688,10 @@ void calculateEdgeElectricFieldX(
       Ex_NE += -HALF*((Bz_E + HALF*dBzdy_E)*(+derivs_NE[fs::dVydy] + derivs_NE[fs::dVydz]) + dBzdy_E*Vy0 + SIXTH*dBzdx_E*derivs_NE[fs::dVydx]);
    #endif
    
-   creal* const nbr_cp_NE     = cache.cells[fs_cache::calculateNbrID(1+1,1-1,1-1)]->parameters;
-   creal* const nbr_derivs_NE = cache.cells[fs_cache::calculateNbrID(1+1,1-1,1-1)]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_NE     = fields.parameters(cache,fs_cache::calculateNbrID(1+1,1-1,1-1));
+   const typename FIELDS::ConstValues nbr_derivs_NE = fields.derivatives(cache,fs_cache::calculateNbrID(1+1,1-1,1-1));
    
-   calculateWaveSpeedYZ(cp_NE, derivs_NE, nbr_cp_NE, nbr_derivs_NE, By_N, Bz_E, dBydx_N, dBydz_N, dBzdx_E, dBzdy_E, PLUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedYZ<FIELDS>(cp_NE, derivs_NE, nbr_cp_NE, nbr_derivs_NE, By_N, Bz_E, dBydx_N, dBydz_N, dBzdx_E, dBzdy_E, PLUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_y = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_z = c_y;
    ay_neg   = max(ay_neg,-Vy0 + c_y);
@@ -740,10 +749,13 @@ void calculateEdgeElectricFieldX(
  * 
  * Note that the background B field is excluded from the diffusive term calculations because they are equivalent to a current term and the background field is curl-free.
  * 
+ * \param fields Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param cache Field solver cell cache
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
  */
+template<typename FIELDS>
 void calculateEdgeElectricFieldY(
+   const FIELDS& fields,
    fs_cache::CellCache& cache,
    cint& RKCase
 ) {
@@ -769,14 +781,14 @@ void calculateEdgeElectricFieldY(
    Real c_x,c_z;                    // Wave speeds to xz-directions
 
    // Get read-only pointers to NE,NW,SE,SW states (SW is rw, result is written there):
-   Real* const  cp_SW = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1  )]->parameters;
-   creal* const cp_SE = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1-1)]->parameters;
-   creal* const cp_NW = cache.cells[fs_cache::calculateNbrID(1-1,1  ,1  )]->parameters;
-   creal* const cp_NE = cache.cells[fs_cache::calculateNbrID(1-1,1  ,1-1)]->parameters;
-   creal* const derivs_SW = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1  )]->derivatives;
-   creal* const derivs_SE = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1-1)]->derivatives;
-   creal* const derivs_NW = cache.cells[fs_cache::calculateNbrID(1-1,1  ,1  )]->derivatives;
-   creal* const derivs_NE = cache.cells[fs_cache::calculateNbrID(1-1,1  ,1-1)]->derivatives;
+   const typename FIELDS::Values cp_SW = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1  ,1  ));
+   const typename FIELDS::ConstValues cp_SE = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1  ,1-1));
+   const typename FIELDS::ConstValues cp_NW = fields.parameters(cache,fs_cache::calculateNbrID(1-1,1  ,1  ));
+   const typename FIELDS::ConstValues cp_NE = fields.parameters(cache,fs_cache::calculateNbrID(1-1,1  ,1-1));
+   const typename FIELDS::ConstValues derivs_SW = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1  ,1  ));
+   const typename FIELDS::ConstValues derivs_SE = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1  ,1-1));
+   const typename FIELDS::ConstValues derivs_NW = fields.derivatives(cache,fs_cache::calculateNbrID(1-1,1  ,1  ));
+   const typename FIELDS::ConstValues derivs_NE = fields.derivatives(cache,fs_cache::calculateNbrID(1-1,1  ,1-1));
 
    // Fetch required plasma parameters:
    Real Bz_S, Bx_W, Bx_E, Bz_N, perBz_S, perBx_W, perBx_E, perBz_N, rho_S;
@@ -888,10 +900,10 @@ void calculateEdgeElectricFieldY(
       Ey_SW += -HALF*((Bx_W - HALF*dBxdz_W)*(-derivs_SW[fs::dVzdx] - derivs_SW[fs::dVzdz]) - dBxdz_W*Vz0 + SIXTH*dBxdy_W*derivs_SW[fs::dVzdy]);
    #endif
    
-   creal* const nbr_cp_SW     = cache.cells[fs_cache::calculateNbrID(1  ,1+1,1  )]->parameters;
-   creal* const nbr_derivs_SW = cache.cells[fs_cache::calculateNbrID(1  ,1+1,1  )]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_SW     = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1+1,1  ));
+   const typename FIELDS::ConstValues nbr_derivs_SW = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1+1,1  ));
    
-   calculateWaveSpeedXZ(cp_SW, derivs_SW, nbr_cp_SW, nbr_derivs_SW, Bx_W, Bz_S, dBxdy_W, dBxdz_W, dBzdx_S, dBzdy_S, MINUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedXZ<FIELDS>(cp_SW, derivs_SW, nbr_cp_SW, nbr_derivs_SW, Bx_W, Bz_S, dBxdy_W, dBxdz_W, dBzdx_S, dBzdy_S, MINUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_z = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_x = c_z;
    az_neg   = max(ZERO,-Vz0 + c_z);
@@ -942,10 +954,10 @@ void calculateEdgeElectricFieldY(
       Ey_SE += -HALF*((Bx_E + HALF*dBxdz_E)*(-derivs_SE[fs::dVzdx] + derivs_SE[fs::dVzdz]) + dBxdz_E*Vz0 + SIXTH*dBxdy_E*derivs_SE[fs::dVzdy]);
    #endif
    
-   creal* const nbr_cp_SE     = cache.cells[fs_cache::calculateNbrID(1  ,1+1,1-1)]->parameters;
-   creal* const nbr_derivs_SE = cache.cells[fs_cache::calculateNbrID(1  ,1+1,1-1)]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_SE     = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1+1,1-1));
+   const typename FIELDS::ConstValues nbr_derivs_SE = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1+1,1-1));
    
-   calculateWaveSpeedXZ(cp_SE, derivs_SE, nbr_cp_SE, nbr_derivs_SE, Bx_E, Bz_S, dBxdy_E, dBxdz_E, dBzdx_S, dBzdy_S, MINUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedXZ<FIELDS>(cp_SE, derivs_SE, nbr_cp_SE, nbr_derivs_SE, Bx_E, Bz_S, dBxdy_E, dBxdz_E, dBzdx_S, dBzdy_S, MINUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_z = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_x = c_z;
    az_neg   = max(az_neg,-Vz0 + c_z);
@@ -996,10 +1008,10 @@ void calculateEdgeElectricFieldY(
       Ey_NW += -HALF*((Bx_W - HALF*dBxdz_W)*(+derivs_NW[fs::dVzdx] - derivs_NW[fs::dVzdz]) - dBxdz_W*Vz0 + SIXTH*dBxdy_W*derivs_NW[fs::dVzdy]);
    #endif
    
-   creal* const nbr_cp_NW     = cache.cells[fs_cache::calculateNbrID(1-1,1+1,1  )]->parameters;
-   creal* const nbr_derivs_NW = cache.cells[fs_cache::calculateNbrID(1-1,1+1,1  )]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_NW     = fields.parameters(cache,fs_cache::calculateNbrID(1-1,1+1,1  ));
+   const typename FIELDS::ConstValues nbr_derivs_NW = fields.derivatives(cache,fs_cache::calculateNbrID(1-1,1+1,1  ));
    
-   calculateWaveSpeedXZ(cp_NW, derivs_NW, nbr_cp_NW, nbr_derivs_NW, Bx_W, Bz_N, dBxdy_W, dBxdz_W, dBzdx_N, dBzdy_N, PLUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedXZ<FIELDS>(cp_NW, derivs_NW, nbr_cp_NW, nbr_derivs_NW, Bx_W, Bz_N, dBxdy_W, dBxdz_W, dBzdx_N, dBzdy_N, PLUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_z = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_x = c_z;
    az_neg   = max(az_neg,-Vz0 + c_z);
@@ -1050,10 +1062,10 @@ void calculateEdgeElectricFieldY(
       Ey_NE += -HALF*((Bx_E + HALF*dBxdz_E)*(+derivs_NE[fs::dVzdx] + derivs_NE[fs::dVzdz]) + dBxdz_E*Vz0 + SIXTH*dBxdy_E*derivs_NE[fs::dVzdy]);
    #endif
 
-   creal* const nbr_cp_NE     = cache.cells[fs_cache::calculateNbrID(1-1,1+1,1-1)]->parameters;
-   creal* const nbr_derivs_NE = cache.cells[fs_cache::calculateNbrID(1-1,1+1,1-1)]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_NE     = fields.parameters(cache,fs_cache::calculateNbrID(1-1,1+1,1-1));
+   const typename FIELDS::ConstValues nbr_derivs_NE = fields.derivatives(cache,fs_cache::calculateNbrID(1-1,1+1,1-1));
    
-   calculateWaveSpeedXZ(cp_NE, derivs_NE, nbr_cp_NE, nbr_derivs_NE, Bx_E, Bz_N, dBxdy_E, dBxdz_E, dBzdx_N, dBzdy_N, PLUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedXZ<FIELDS>(cp_NE, derivs_NE, nbr_cp_NE, nbr_derivs_NE, Bx_E, Bz_N, dBxdy_E, dBxdz_E, dBzdx_N, dBzdy_N, PLUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_z = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_x = c_z;
    az_neg   = max(az_neg,-Vz0 + c_z);
@@ -1108,10 +1120,13 @@ void calculateEdgeElectricFieldY(
  * 
  * Note that the background B field is excluded from the diffusive term calculations because they are equivalent to a current term and the background field is curl-free.
  * 
+ * \param fields Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param cache Field solver cell cache
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
  */
+template<typename FIELDS>
 void calculateEdgeElectricFieldZ(
+   const FIELDS& fields,
    fs_cache::CellCache& cache,
    cint& RKCase
 ) {
@@ -1137,15 +1152,15 @@ void calculateEdgeElectricFieldZ(
    Real c_x,c_y;                    // Characteristic speeds to xy-directions
    
    // Get read-only pointers to NE,NW,SE,SW states (SW is rw, result is written there):
-   Real* const cp_SW  = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1  )]->parameters;
-   creal* const cp_SE = cache.cells[fs_cache::calculateNbrID(1-1,1  ,1  )]->parameters;
-   creal* const cp_NE = cache.cells[fs_cache::calculateNbrID(1-1,1-1,1  )]->parameters;
-   creal* const cp_NW = cache.cells[fs_cache::calculateNbrID(1  ,1-1,1  )]->parameters;
+   const typename FIELDS::Values cp_SW = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1  ,1  ));
+   const typename FIELDS::ConstValues cp_SE = fields.parameters(cache,fs_cache::calculateNbrID(1-1,1  ,1  ));
+   const typename FIELDS::ConstValues cp_NE = fields.parameters(cache,fs_cache::calculateNbrID(1-1,1-1,1  ));
+   const typename FIELDS::ConstValues cp_NW = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1-1,1  ));
    
-   creal* const derivs_SW = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1  )]->derivatives;
-   creal* const derivs_SE = cache.cells[fs_cache::calculateNbrID(1-1,1  ,1  )]->derivatives;
-   creal* const derivs_NE = cache.cells[fs_cache::calculateNbrID(1-1,1-1,1  )]->derivatives;
-   creal* const derivs_NW = cache.cells[fs_cache::calculateNbrID(1  ,1-1,1  )]->derivatives;
+   const typename FIELDS::ConstValues derivs_SW = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1  ,1  ));
+   const typename FIELDS::ConstValues derivs_SE = fields.derivatives(cache,fs_cache::calculateNbrID(1-1,1  ,1  ));
+   const typename FIELDS::ConstValues derivs_NE = fields.derivatives(cache,fs_cache::calculateNbrID(1-1,1-1,1  ));
+   const typename FIELDS::ConstValues derivs_NW = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1-1,1  ));
 
    // Fetch needed plasma parameters/derivatives from the four cells:
    Real Bx_S, By_W, By_E, Bx_N, perBx_S, perBy_W, perBy_E, perBx_N, rho_S;
@@ -1259,10 +1274,10 @@ void calculateEdgeElectricFieldZ(
    
    // Calculate maximum wave speed (fast magnetosonic speed) on SW cell. In order 
    // to get Alfven speed we need to calculate some reconstruction coeff. for Bz:
-   creal* const nbr_cp_SW     = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1+1)]->parameters;
-   creal* const nbr_derivs_SW = cache.cells[fs_cache::calculateNbrID(1  ,1  ,1+1)]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_SW     = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1  ,1+1));
+   const typename FIELDS::ConstValues nbr_derivs_SW = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1  ,1+1));
    
-   calculateWaveSpeedXY(cp_SW, derivs_SW, nbr_cp_SW, nbr_derivs_SW, Bx_S, By_W, dBxdy_S, dBxdz_S, dBydx_W, dBydz_W, MINUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedXY<FIELDS>(cp_SW, derivs_SW, nbr_cp_SW, nbr_derivs_SW, Bx_S, By_W, dBxdy_S, dBxdz_S, dBydx_W, dBydz_W, MINUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_x = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_y = c_x;
    ax_neg   = max(ZERO,-Vx0 + c_x);
@@ -1313,10 +1328,10 @@ void calculateEdgeElectricFieldZ(
       Ez_SE  += -HALF*((By_E + HALF*dBydx_E)*(+derivs_SE[fs::dVxdx] - derivs_SE[fs::dVxdy]) + dBydx_E*Vx0 + SIXTH*dBydz_E*derivs_SE[fs::dVxdz]);
    #endif
    
-   creal* const nbr_cp_SE     = cache.cells[fs_cache::calculateNbrID(1-1,1  ,1+1)]->parameters;
-   creal* const nbr_derivs_SE = cache.cells[fs_cache::calculateNbrID(1-1,1  ,1+1)]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_SE     = fields.parameters(cache,fs_cache::calculateNbrID(1-1,1  ,1+1));
+   const typename FIELDS::ConstValues nbr_derivs_SE = fields.derivatives(cache,fs_cache::calculateNbrID(1-1,1  ,1+1));
    
-   calculateWaveSpeedXY(cp_SE, derivs_SE, nbr_cp_SE, nbr_derivs_SE, Bx_S, By_E, dBxdy_S, dBxdz_S, dBydx_E, dBydz_E, PLUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedXY<FIELDS>(cp_SE, derivs_SE, nbr_cp_SE, nbr_derivs_SE, Bx_S, By_E, dBxdy_S, dBxdz_S, dBydx_E, dBydz_E, PLUS, MINUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_x = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_y = c_x;
    ax_neg = max(ax_neg,-Vx0 + c_x);
@@ -1367,10 +1382,10 @@ void calculateEdgeElectricFieldZ(
       Ez_NW  += -HALF*((By_W - HALF*dBydx_W)*(-derivs_NW[fs::dVxdx] + derivs_NW[fs::dVxdy]) - dBydx_W*Vx0 + SIXTH*dBydz_W*derivs_NW[fs::dVxdz]);
    #endif
    
-   creal* const nbr_cp_NW     = cache.cells[fs_cache::calculateNbrID(1  ,1-1,1+1)]->parameters;
-   creal* const nbr_derivs_NW = cache.cells[fs_cache::calculateNbrID(1  ,1-1,1+1)]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_NW     = fields.parameters(cache,fs_cache::calculateNbrID(1  ,1-1,1+1));
+   const typename FIELDS::ConstValues nbr_derivs_NW = fields.derivatives(cache,fs_cache::calculateNbrID(1  ,1-1,1+1));
    
-   calculateWaveSpeedXY(cp_NW, derivs_NW, nbr_cp_NW, nbr_derivs_NW, Bx_N, By_W, dBxdy_N, dBxdz_N, dBydx_W, dBydz_W, MINUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedXY<FIELDS>(cp_NW, derivs_NW, nbr_cp_NW, nbr_derivs_NW, Bx_N, By_W, dBxdy_N, dBxdz_N, dBydx_W, dBydz_W, MINUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_x = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_y = c_x;
    ax_neg = max(ax_neg,-Vx0 + c_x); 
@@ -1421,10 +1436,10 @@ void calculateEdgeElectricFieldZ(
       Ez_NE  += -HALF*((By_E + HALF*dBydx_E)*(+derivs_NE[fs::dVxdx] + derivs_NE[fs::dVxdy]) + dBydx_E*Vx0 + SIXTH*dBydz_E*derivs_NE[fs::dVxdz]);
    #endif
    
-   creal* const nbr_cp_NE     = cache.cells[fs_cache::calculateNbrID(1-1,1-1,1+1)]->parameters;
-   creal* const nbr_derivs_NE = cache.cells[fs_cache::calculateNbrID(1-1,1-1,1+1)]->derivatives;
+   const typename FIELDS::ConstValues nbr_cp_NE     = fields.parameters(cache,fs_cache::calculateNbrID(1-1,1-1,1+1));
+   const typename FIELDS::ConstValues nbr_derivs_NE = fields.derivatives(cache,fs_cache::calculateNbrID(1-1,1-1,1+1));
    
-   calculateWaveSpeedXY(cp_NE, derivs_NE, nbr_cp_NE, nbr_derivs_NE, Bx_N, By_E, dBxdy_N, dBxdz_N, dBydx_E, dBydz_E, PLUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
+   calculateWaveSpeedXY<FIELDS>(cp_NE, derivs_NE, nbr_cp_NE, nbr_derivs_NE, Bx_N, By_E, dBxdy_N, dBxdz_N, dBydx_E, dBydz_E, PLUS, PLUS, minRho, maxRho, RKCase, vA, vS, vW);
    c_x = min(Parameters::maxWaveVelocity,sqrt(vA*vA + vS*vS) + vW);
    c_y = c_x;
    ax_neg = max(ax_neg,-Vx0 + c_x);
@@ -1476,6 +1491,7 @@ void calculateEdgeElectricFieldZ(
  * 
  * Calls the general or the system boundary electric field propagation functions.
  * 
+ * \param fields Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param mpiGrid Grid
  * \param cellCache Field solver cell cache
  * \param cells Vector of cells to process
@@ -1485,7 +1501,9 @@ void calculateEdgeElectricFieldZ(
  * \sa calculateUpwindedElectricFieldSimple calculateEdgeElectricFieldX calculateEdgeElectricFieldY calculateEdgeElectricFieldZ
  * 
  */
+template<typename FIELDS>
 void calculateElectricField(
+   const FIELDS& fields,
    dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    std::vector<fs_cache::CellCache>& cellCache,
    const std::vector<uint16_t>& cells,
@@ -1511,7 +1529,7 @@ void calculateElectricField(
             sysBoundaries.getSysBoundary(cellSysBoundaryFlag)->
               fieldSolverBoundaryCondElectricField(mpiGrid, cellID, RKCase, 0);
          } else {
-            calculateEdgeElectricFieldX(cache,RKCase);
+            calculateEdgeElectricFieldX(fields,cache,RKCase);
          }
       }
 
@@ -1522,7 +1540,7 @@ void calculateElectricField(
             sysBoundaries.getSysBoundary(cellSysBoundaryFlag)->
               fieldSolverBoundaryCondElectricField(mpiGrid, cellID, RKCase, 1);
          } else {
-            calculateEdgeElectricFieldY(cache,RKCase);
+            calculateEdgeElectricFieldY(fields,cache,RKCase);
          }
       }
 
@@ -1533,7 +1551,7 @@ void calculateElectricField(
             sysBoundaries.getSysBoundary(cellSysBoundaryFlag)->
               fieldSolverBoundaryCondElectricField(mpiGrid, cellID, RKCase, 2);
          } else {
-            calculateEdgeElectricFieldZ(cache,RKCase);
+            calculateEdgeElectricFieldZ(fields,cache,RKCase);
          }
       }
    } // for-loop over spatial cells
@@ -1573,28 +1591,51 @@ void calculateUpwindedElectricFieldSimple(
    
    timer=phiprof::initializeTimer("Start communication in calculateUpwindedElectricFieldSimple","MPI");
    phiprof::start(timer);
-   mpiGrid.start_remote_neighbor_copy_updates(FIELD_SOLVER_NEIGHBORHOOD_ID);
-   phiprof::stop(timer);
+   mpiGrid.start_remote_neighbor_copy_updates(FIELD_SOLVER_E_NEIGHBORHOOD_ID);
+   phiprof::stop(timer,fs_cache::getHaloExchangeBytes(FIELD_SOLVER_E_NEIGHBORHOOD_ID,transferMask),"Bytes");
    
+   fs_cache::CacheContainer& cacheContainer = fs_cache::getCache();
+   fs_cache::FieldGrid& fieldGrid = cacheContainer.fieldGrid;
+   const bool useFieldGrid = fieldGrid.isActive();
+
    // Calculate upwinded electric field on inner cells
    timer=phiprof::initializeTimer("Compute inner cells");
    phiprof::start(timer);
-   calculateElectricField(mpiGrid,fs_cache::getCache().localCellsCache,
-                          fs_cache::getCache().cellsWithLocalNeighbours,
-                          sysBoundaries,RKCase);
+   if (useFieldGrid == true) {
+      calculateElectricField(fs_cache::FieldGridFields(fieldGrid),mpiGrid,cacheContainer.localCellsCache,
+                             cacheContainer.fieldGridCellsWithLocalNeighbours,
+                             sysBoundaries,RKCase);
+      calculateElectricField(fs_cache::SpatialCellFields(),mpiGrid,cacheContainer.localCellsCache,
+                             cacheContainer.spatialCellsWithLocalNeighbours,
+                             sysBoundaries,RKCase);
+   } else {
+      calculateElectricField(fs_cache::SpatialCellFields(),mpiGrid,cacheContainer.localCellsCache,
+                             cacheContainer.cellsWithLocalNeighbours,
+                             sysBoundaries,RKCase);
+   }
    phiprof::stop(timer,fs_cache::getCache().cellsWithLocalNeighbours.size(),"Spatial Cells");
    
    timer=phiprof::initializeTimer("Wait for receives","MPI","Wait");
    phiprof::start(timer);
-   mpiGrid.wait_remote_neighbor_copy_update_receives(FIELD_SOLVER_NEIGHBORHOOD_ID);
+   mpiGrid.wait_remote_neighbor_copy_update_receives(FIELD_SOLVER_E_NEIGHBORHOOD_ID);
+   if (useFieldGrid == true) fieldGrid.copyFromCells(cacheContainer.fieldGridRemoteCells,transferMask);
    phiprof::stop(timer);
 
    // Calculate upwinded electric field on boundary cells:
    timer=phiprof::initializeTimer("Compute boundary cells");
    phiprof::start(timer);
-   calculateElectricField(mpiGrid,fs_cache::getCache().localCellsCache,   
-                          fs_cache::getCache().cellsWithRemoteNeighbours,
-                          sysBoundaries,RKCase);
+   if (useFieldGrid == true) {
+      calculateElectricField(fs_cache::FieldGridFields(fieldGrid),mpiGrid,cacheContainer.localCellsCache,
+                             cacheContainer.fieldGridCellsWithRemoteNeighbours,
+                             sysBoundaries,RKCase);
+      calculateElectricField(fs_cache::SpatialCellFields(),mpiGrid,cacheContainer.localCellsCache,
+                             cacheContainer.spatialCellsWithRemoteNeighbours,
+                             sysBoundaries,RKCase);
+   } else {
+      calculateElectricField(fs_cache::SpatialCellFields(),mpiGrid,cacheContainer.localCellsCache,
+                             cacheContainer.cellsWithRemoteNeighbours,
+                             sysBoundaries,RKCase);
+   }
    phiprof::stop(timer,fs_cache::getCache().cellsWithRemoteNeighbours.size(),"Spatial Cells");
 
 
@@ -1605,14 +1646,21 @@ void calculateUpwindedElectricFieldSimple(
    
    // Exchange electric field with neighbouring processes
    if (RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
-      SpatialCell::set_mpi_transfer_type(Transfer::CELL_E);
+      transferMask = Transfer::CELL_E;
    } else { // RKCase == RK_ORDER2_STEP1
-      SpatialCell::set_mpi_transfer_type(Transfer::CELL_EDT2);
+      transferMask = Transfer::CELL_EDT2;
+   }
+   SpatialCell::set_mpi_transfer_type(transferMask);
+   if (useFieldGrid == true) {
+      fieldGrid.copyToCells(cacheContainer.fieldGridMirroredCells,transferMask);
+      fieldGrid.copyFromCells(cacheContainer.spatialCellLocalCells,transferMask);
+      fieldGrid.copyParametersFromCells(cacheContainer.spatialCellLocalCells,CellParams::MAXFDT,1);
    }
    timer=phiprof::initializeTimer("Communicate electric fields","MPI","Wait");
    phiprof::start(timer);
-   mpiGrid.update_copies_of_remote_neighbors(FIELD_SOLVER_NEIGHBORHOOD_ID);
-   phiprof::stop(timer);
+   mpiGrid.update_copies_of_remote_neighbors(FIELD_SOLVER_B_NEIGHBORHOOD_ID);
+   if (useFieldGrid == true) fieldGrid.copyFromCells(cacheContainer.fieldGridRemoteCells,transferMask);
+   phiprof::stop(timer,fs_cache::getHaloExchangeBytes(FIELD_SOLVER_B_NEIGHBORHOOD_ID,transferMask),"Bytes");
 
    const size_t N_cells = fs_cache::getCache().cellsWithLocalNeighbours.size() 
      + fs_cache::getCache().cellsWithRemoteNeighbours.size();
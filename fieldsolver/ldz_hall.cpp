@@ -757,8 +757,8 @@ void calculateHallTermSimple(
 
       timer=phiprof::initializeTimer("Start communication of derivatives","MPI");
       phiprof::start(timer);
-      mpiGrid.start_remote_neighbor_copy_updates(FIELD_SOLVER_NEIGHBORHOOD_ID);
-      phiprof::stop(timer);
+      mpiGrid.start_remote_neighbor_copy_updates(FIELD_SOLVER_E_NEIGHBORHOOD_ID);
+      phiprof::stop(timer,fs_cache::getHaloExchangeBytes(FIELD_SOLVER_E_NEIGHBORHOOD_ID,Transfer::CELL_DERIVATIVES),"Bytes");
 
       // Calculate Hall term on inner cells
       timer=phiprof::initializeTimer("Compute inner cells");
@@ -768,7 +768,7 @@ void calculateHallTermSimple(
 
       timer=phiprof::initializeTimer("Wait for receives","MPI","Wait");
       phiprof::start(timer);
-      mpiGrid.wait_remote_neighbor_copy_update_receives(FIELD_SOLVER_NEIGHBORHOOD_ID);
+      mpiGrid.wait_remote_neighbor_copy_update_receives(FIELD_SOLVER_E_NEIGHBORHOOD_ID);
       phiprof::stop(timer);
       
       // Calculate Hall term on boundary cells:
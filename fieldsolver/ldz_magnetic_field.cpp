@@ -37,22 +37,25 @@ using namespace std;
  * intermediate E1 components for the first stage of the second-order
  * Runge-Kutta method and E for the other cases.
  * 
+ * \param fields Field variable accessor, fs_cache::SpatialCellFields or fs_cache::FieldGridFields
  * \param cellCache Field solver cell cache
  * \param cells Vector of cells to process
  * \param dt Length of the time step
  * \param RKCase Element in the enum defining the Runge-Kutta method steps
- * \param doX If true, compute the x component (default true).
- * \param doY If true, compute the y component (default true).
- * \param doZ If true, compute the z component (default true).
+ * \param doX If true, compute the x component.
+ * \param doY If true, compute the y component.
+ * \param doZ If true, compute the z component.
  */
+template<typename FIELDS>
 void propagateMagneticField(
+   const FIELDS& fields,
    const std::vector<fs_cache::CellCache>& cellCache,
    const std::vector<uint16_t>& cells,
    creal& dt,
    cint& RKCase,
-   const bool doX, //=true (default)
-   const bool doY, //=true (default)
-   const bool doZ  //=true (default)
+   const bool doX,
+   const bool doY,
+   const bool doZ
 ) {
 
    #pragma omp parallel for
@@ -60,14 +63,14 @@ void propagateMagneticField(
       const uint16_t localID = cells[c];
 
       cuint existingCellsFlag = cellCache[localID].existingCellsFlags;
-      Real* cp0 = cellCache[localID].cells[fs_cache::calculateNbrID(1  ,1  ,1  )]->parameters;
+      const typename FIELDS::Values cp0 = fields.parameters(cellCache[localID],fs_cache::calculateNbrID(1  ,1  ,1  ));
       creal dx = cp0[CellParams::DX];
       creal dy = cp0[CellParams::DY];
       creal dz = cp0[CellParams::DZ];
 
       if ((existingCellsFlag & PROPAGATE_BX) == PROPAGATE_BX && doX == true) {
-         const Real* cp1 = cellCache[localID].cells[fs_cache::calculateNbrID(1  ,1+1,1  )]->parameters;
-         const Real* cp2 = cellCache[localID].cells[fs_cache::calculateNbrID(1  ,1  ,1+1)]->parameters;
+         const typename FIELDS::ConstValues cp1 = fields.parameters(cellCache[localID],fs_cache::calculateNbrID(1  ,1+1,1  ));
+         const typename FIELDS::ConstValues cp2 = fields.parameters(cellCache[localID],fs_cache::calculateNbrID(1  ,1  ,1+1));
          switch (RKCase) {
           case RK_ORDER1:
             cp0[CellParams::PERBX] += dt/dz*(cp2[CellParams::EY] - cp0[CellParams::EY]) + dt/dy*(cp0[CellParams::EZ] - cp1[CellParams::EZ]);
@@ -88,8 +91,8 @@ void propagateMagneticField(
       }
 
       if ((existingCellsFlag & PROPAGATE_BY) == PROPAGATE_BY && doY == true) {
-         const Real* cp1 = cellCache[localID].cells[fs_cache::calculateNbrID(1  ,1  ,1+1)]->parameters;
-         const Real* cp2 = cellCache[localID].cells[fs_cache::calculateNbrID(1+1,1  ,1  )]->parameters;
+         const typename FIELDS::ConstValues cp1 = fields.parameters(cellCache[localID],fs_cache::calculateNbrID(1  ,1  ,1+1));
+         const typename FIELDS::ConstValues cp2 = fields.parameters(cellCache[localID],fs_cache::calculateNbrID(1+1,1  ,1  ));
 
          switch (RKCase) {
           case RK_ORDER1:
@@ -111,8 +114,8 @@ void propagateMagneticField(
       }
 
       if ((existingCellsFlag & PROPAGATE_BZ) == PROPAGATE_BZ && doZ == true) {
-         const Real* cp1 = cellCache[localID].cells[fs_cache::calculateNbrID(1+1,1  ,1  )]->parameters;
-         const Real* cp2 = cellCache[localID].cells[fs_cache::calculateNbrID(1  ,1+1,1  )]->parameters;
+         const typename FIELDS::ConstValues cp1 = fields.parameters(cellCache[localID],fs_cache::calculateNbrID(1+1,1  ,1  ));
+         const typename FIELDS::ConstValues cp2 = fields.parameters(cellCache[localID],fs_cache::calculateNbrID(1  ,1+1,1  ));
 
          switch (RKCase) {
           case RK_ORDER1:
@@ -135,6 +138,22 @@ void propagateMagneticField(
    }
 }
 
+/*! \brief Low-level magnetic field propagation function operating on spatial cells.
+ * 
+ * \sa propagateMagneticField(const FIELDS&,const std::vector<fs_cache::CellCache>&,const std::vector<uint16_t>&,creal&,cint&,const bool,const bool,const bool)
+ */
+void propagateMagneticField(
+   const std::vector<fs_cache::CellCache>& cellCache,
+   const std::vector<uint16_t>& cells,
+   creal& dt,
+   cint& RKCase,
+   const bool doX, //=true (default)
+   const bool doY, //=true (default)
+   const bool doZ  //=true (default)
+) {
+   propagateMagneticField(fs_cache::SpatialCellFields(),cellCache,cells,dt,RKCase,doX,doY,doZ);
+}
+
 /*! \brief High-level magnetic field propagation function.
  * 
  * Propagates the magnetic field and applies the field boundary conditions defined in project.h where needed.
@@ -163,7 +182,14 @@ void propagateMagneticFieldSimple(
    phiprof::start(timer);
 
    // Propagate B on all local cells:
-   propagateMagneticField(cacheContainer.localCellsCache,cacheContainer.local_NOT_SYSBOUND_DO_NOT_COMPUTE,dt,RKCase);
+   fs_cache::FieldGrid& fieldGrid = cacheContainer.fieldGrid;
+   if (fieldGrid.isActive() == true) {
+      propagateMagneticField(fs_cache::FieldGridFields(fieldGrid),cacheContainer.localCellsCache,
+                             cacheContainer.fieldGrid_NOT_SYSBOUND_DO_NOT_COMPUTE,dt,RKCase,true,true,true);
+      propagateMagneticField(cacheContainer.localCellsCache,cacheContainer.spatialCell_NOT_SYSBOUND_DO_NOT_COMPUTE,dt,RKCase);
+   } else {
+      propagateMagneticField(cacheContainer.localCellsCache,cacheContainer.local_NOT_SYSBOUND_DO_NOT_COMPUTE,dt,RKCase);
+   }
 
    //phiprof::stop("propagate not sysbound",localCells.size(),"Spatial Cells");
    phiprof::stop(timer,cacheContainer.local_NOT_SYSBOUND_DO_NOT_COMPUTE.size(),"Spatial Cells");
@@ -172,15 +198,19 @@ void propagateMagneticFieldSimple(
    //of the communication is going to be redone in calculateDerivativesSimple
    //TODO: do not transfer if there are no field boundaryconditions
    phiprof::start("MPI");
+   uint64_t transferMask;
    if (RKCase == RK_ORDER1 || RKCase == RK_ORDER2_STEP2) {
       // Exchange PERBX,PERBY,PERBZ with neighbours
-      spatial_cell::SpatialCell::set_mpi_transfer_type(Transfer::CELL_PERB,true);
+      transferMask = Transfer::CELL_PERB;
    } else { // RKCase == RK_ORDER2_STEP1
       // Exchange PERBX_DT2,PERBY_DT2,PERBZ_DT2 with neighbours
-      spatial_cell::SpatialCell::set_mpi_transfer_type(Transfer::CELL_PERBDT2,true);
+      transferMask = Transfer::CELL_PERBDT2;
    }
+   spatial_cell::SpatialCell::set_mpi_transfer_type(transferMask,true);
 
+   if (fieldGrid.isActive() == true) fieldGrid.copyToCells(cacheContainer.fieldGridMirroredCells,transferMask);
    mpiGrid.update_copies_of_remote_neighbors(SYSBOUNDARIES_EXTENDED_NEIGHBORHOOD_ID);
+   if (fieldGrid.isActive() == true) fieldGrid.copyFromCells(cacheContainer.fieldGridRemoteCells,transferMask);
    phiprof::stop("MPI");
 
    // Propagate B on system boundary/process inner cells
@@ -203,6 +233,9 @@ void propagateMagneticFieldSimple(
    }
    phiprof::stop(timer,cacheContainer.boundaryCellsWithRemoteNeighbours.size(),"Spatial Cells");
 
+   // Cells computed in spatial cells are read by cells computed in FieldGrid
+   if (fieldGrid.isActive() == true) fieldGrid.copyFromCells(cacheContainer.spatialCellLocalCells,transferMask);
+
    const size_t N_cells 
      = cacheContainer.boundaryCellsWithRemoteNeighbours.size()
      + cacheContainer.boundaryCellsWithLocalNeighbours.size()
@@ -116,6 +116,9 @@ bool initializeFieldPropagator(
    phiprof::start("Calculate Caches");
    fs_cache::calculateCache(mpiGrid,localCells);
    phiprof::stop("Calculate Caches",localCells.size(),"Spatial Cells");
+   if (P::fieldSolverSoaGrid == true && (P::ohmHallTerm > 0 || P::ohmGradPeTerm > 0)) {
+      logFile << "(FIELDSOLVER) fieldsolver.soaGrid is ignored when the Hall or electron pressure gradient term is enabled" << endl << writeVerbose;
+   }
 
    // Checking that spatial cells are cubic, otherwise field solver is incorrect (cf. derivatives in E, Hall term)
    if((abs((P::dx_ini-P::dy_ini)/P::dx_ini) > 0.001) ||
@@ -230,6 +233,7 @@ bool initializeFieldPropagator(
    // and edge-E:s between neighbouring processes and calculate 
    // face-averaged E,B fields.
    bool hallTermCommunicateDerivatives = true;
+   fs_cache::copyToFieldGrid();
    calculateDerivativesSimple(mpiGrid, sysBoundaries, localCells, RK_ORDER1, true);
    if(P::ohmGradPeTerm > 0) {
       calculateGradPeTermSimple(mpiGrid, sysBoundaries, localCells, RK_ORDER1);
@@ -239,6 +243,7 @@ bool initializeFieldPropagator(
       calculateHallTermSimple(mpiGrid, sysBoundaries, localCells, RK_ORDER1, hallTermCommunicateDerivatives);
    }
    calculateUpwindedElectricFieldSimple(mpiGrid, sysBoundaries, localCells, RK_ORDER1);
+   fs_cache::copyFromFieldGrid();
    calculateVolumeAveragedFields(mpiGrid,fs_cache::getCache().localCellsCache,fs_cache::getCache().local_NOT_DO_NOT_COMPUTE);
    calculateBVOLDerivativesSimple(mpiGrid, sysBoundaries, localCells);
    
@@ -288,7 +293,7 @@ bool propagateFields(
       const CellID cellID = localCells[cell];
       mpiGrid[cellID]->parameters[CellParams::MAXFDT]=std::numeric_limits<Real>::max();
    }
-
+   fs_cache::copyToFieldGrid();
 
    if (subcycles == 1) {
       #ifdef FS_1ST_ORDER_TIME
@@ -388,6 +393,10 @@ bool propagateFields(
          Real dtMaxGlobal;
          dtMaxLocal=std::numeric_limits<Real>::max();
 
+         fs_cache::FieldGrid& fieldGrid = fs_cache::getCache().fieldGrid;
+         if (fieldGrid.isActive() == true) {
+            fieldGrid.copyParametersToCells(fs_cache::getCache().fieldGridLocalCells,CellParams::MAXFDT,1);
+         }
          for (std::vector<uint64_t>::const_iterator cell_id = cells.begin(); cell_id != cells.end(); ++cell_id) {
             SpatialCell* cell = mpiGrid[*cell_id];
             if ( cell->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY ||
@@ -429,6 +438,7 @@ bool propagateFields(
       }
    }
    
+   fs_cache::copyFromFieldGrid();
    calculateVolumeAveragedFields(mpiGrid,fs_cache::getCache().localCellsCache,fs_cache::getCache().local_NOT_DO_NOT_COMPUTE);
    calculateBVOLDerivativesSimple(mpiGrid, sysBoundaries, localCells);
    return true;
@@ -26,11 +26,15 @@
 #include <iomanip> // for setprecision()
 #include <cmath>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <limits>
 #include <sstream>
 #include <ctime>
 #include <omp.h>
 #include "grid.h"
 #include "vlasovmover.h"
+#include "vlasovsolver/cpu_acc_semilag.hpp"
 #include "definitions.h"
 #include "mpiconversion.h"
 #include "logger.h"
@@ -113,10 +117,15 @@ void initializeGrid(
    geom_params.level_0_cell_length[1] = P::dy_ini;
    geom_params.level_0_cell_length[2] = P::dz_ini;
 
+   // The built-in Hilbert curve partitioner is used by balanceLoad, Zoltan's
+   // Hilbert curve partitioner does the initial partitioning
+   string zoltanAlgorithm = P::loadBalanceAlgorithm;
+   if (zoltanAlgorithm == "HILBERT") zoltanAlgorithm = "HSFC";
+
    mpiGrid.initialize(
       grid_length,
       comm,
-      &P::loadBalanceAlgorithm[0],
+      &zoltanAlgorithm[0],
       neighborhood_size, // neighborhood size
       0, // maximum refinement level
       sysBoundaries.isBoundaryPeriodic(0),
@@ -297,6 +306,285 @@ void initSpatialCellCoordinates(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geomet
 }
 
 
+/** Get the amount of velocity block data of a cell that is sent when the cell migrates.
+ * @param cell Spatial cell.
+ * @return Size of the packed velocity meshes of all populations in bytes.*/
+static Real getCellMigrationBytes(SpatialCell* cell) {
+   return cell->get_migration_buffer_size();
+}
+
+/** Request an incremental rebalance by pinning local cells on process boundaries to less loaded
+ * neighbor processes. Each process sends to each less loaded neighbor process a share of the load
+ * difference (first order diffusion), at most P::loadBalanceIncrementalMaxBytes of block data in total.
+ * Collective operation on MPI_COMM_WORLD.
+ * @param mpiGrid Parallel grid.
+ * @param cells Local cells.
+ * @param weights Load balance weights of the local cells.
+ * @return If false, the load is too far out of balance for incremental rebalancing and nothing was pinned.*/
+static bool pinIncrementalMigrations(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                     const vector<CellID>& cells,const vector<Real>& weights) {
+   int myRank,nProcesses;
+   MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+   MPI_Comm_size(MPI_COMM_WORLD,&nProcesses);
+
+   Real localLoad = 0.0;
+   for (size_t c=0; c<cells.size(); ++c) localLoad += weights[c];
+   vector<Real> loads(nProcesses);
+   MPI_Allgather(&localLoad,1,MPI_Type<Real>(),loads.data(),1,MPI_Type<Real>(),MPI_COMM_WORLD);
+
+   Real maxLoad = 0.0;
+   Real meanLoad = 0.0;
+   for (int p=0; p<nProcesses; ++p) {
+      maxLoad = max(maxLoad,loads[p]);
+      meanLoad += loads[p] / nProcesses;
+   }
+   if (meanLoad <= 0.0 || maxLoad / meanLoad > P::loadBalanceIncrementalMaxImbalance) return false;
+
+   // Local cells next to each neighbor process
+   map<int,vector<size_t> > boundaryCells;
+   for (size_t c=0; c<cells.size(); ++c) {
+      const vector<CellID>* neighbors = mpiGrid.get_neighbors_of(cells[c],NEAREST_NEIGHBORHOOD_ID);
+      for (size_t n=0; n<neighbors->size(); ++n) {
+         const CellID nbr = (*neighbors)[n];
+         if (nbr == INVALID_CELLID || mpiGrid.is_local(nbr) == true) continue;
+         vector<size_t>& list = boundaryCells[mpiGrid.get_process(nbr)];
+         if (list.size() == 0 || list.back() != c) list.push_back(c);
+      }
+   }
+
+   // Send a share of the load difference to each less loaded neighbor, least loaded first
+   vector<pair<Real,int> > targets;
+   for (map<int,vector<size_t> >::const_iterator it=boundaryCells.begin(); it!=boundaryCells.end(); ++it) {
+      if (loads[it->first] < localLoad) targets.push_back(make_pair(loads[it->first],it->first));
+   }
+   sort(targets.begin(),targets.end());
+   const Real diffusionCoefficient = 1.0 / (boundaryCells.size() + 1);
+   Real byteBudget = P::loadBalanceIncrementalMaxBytes;
+   vector<bool> pinned(cells.size(),false);
+   for (size_t t=0; t<targets.size(); ++t) {
+      const int process = targets[t].second;
+      const Real flow = diffusionCoefficient * (localLoad - targets[t].first);
+      Real sent = 0.0;
+      const vector<size_t>& list = boundaryCells[process];
+      for (size_t i=0; i<list.size(); ++i) {
+         const size_t c = list[i];
+         if (pinned[c] == true || sent + weights[c] > flow) continue;
+         const Real bytes = getCellMigrationBytes(mpiGrid[cells[c]]);
+         if (bytes > byteBudget) continue;
+         mpiGrid.pin(cells[c],process);
+         pinned[c] = true;
+         sent += weights[c];
+         byteBudget -= bytes;
+      }
+   }
+   return true;
+}
+
+/** Get the index of a cell along a Hilbert curve that fills the spatial grid (Skilling's algorithm).
+ * @param indices Indices of the cell in the grid.
+ * @param bits Number of bits per dimension, at least 1 and at most 21.
+ * @return Position of the cell on the curve.*/
+static uint64_t getHilbertIndex(const dccrg::Types<3>::indices_t& indices,const uint& bits) {
+   uint64_t X[3] = {indices[0],indices[1],indices[2]};
+   const uint64_t M = (uint64_t)1 << (bits-1);
+
+   // Inverse undo of the rotations
+   for (uint64_t Q=M; Q>1; Q>>=1) {
+      const uint64_t P = Q-1;
+      for (int i=0; i<3; ++i) {
+         if ((X[i] & Q) != 0) {
+            X[0] ^= P;
+         } else {
+            const uint64_t t = (X[0] ^ X[i]) & P;
+            X[0] ^= t;
+            X[i] ^= t;
+         }
+      }
+   }
+
+   // Gray encode
+   for (int i=1; i<3; ++i) X[i] ^= X[i-1];
+   uint64_t t = 0;
+   for (uint64_t Q=M; Q>1; Q>>=1) if ((X[2] & Q) != 0) t ^= Q-1;
+   for (int i=0; i<3; ++i) X[i] ^= t;
+
+   // Interleave the transposed bits, most significant first
+   uint64_t index = 0;
+   for (int b=bits-1; b>=0; --b) {
+      for (int i=0; i<3; ++i) index = (index << 1) | ((X[i] >> b) & 1);
+   }
+   return index;
+}
+
+/** Position and load balance weight of a cell on the Hilbert curve.*/
+struct HilbertCurveCell {
+   uint64_t index;
+   Real weight;
+   bool operator<(const HilbertCurveCell& other) const {return index < other.index;}
+};
+
+/** Request a new partition by pinning local cells to processes along a weighted Hilbert curve.
+ * The curve is first cut into one segment per compute node, in proportion to the number of processes
+ * on the node, and each node segment is then cut into one segment per process on the node. The
+ * partition of a node is thus a compact piece of the grid, and most halo traffic between its
+ * processes stays on the node.
+ *
+ * The cells are sorted along the curve with a parallel sample sort (regular sampling), so that each
+ * process only handles a contiguous piece of the curve. Positions of the cuts are found from an
+ * exclusive prefix sum of the weights of the pieces, and the new process of each cell is sent back
+ * to its current owner. Collective operation on MPI_COMM_WORLD.
+ * @param mpiGrid Parallel grid.
+ * @param cells Local cells.
+ * @param weights Load balance weights of the local cells.*/
+static void pinHilbertPartition(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                const vector<CellID>& cells,const vector<Real>& weights) {
+   int myRank,nProcesses;
+   MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
+   MPI_Comm_size(MPI_COMM_WORLD,&nProcesses);
+
+   // Processes ordered by compute node, a node is identified by its lowest rank
+   MPI_Comm nodeComm;
+   MPI_Comm_split_type(MPI_COMM_WORLD,MPI_COMM_TYPE_SHARED,myRank,MPI_INFO_NULL,&nodeComm);
+   int nodeID;
+   MPI_Allreduce(&myRank,&nodeID,1,MPI_INT,MPI_MIN,nodeComm);
+   MPI_Comm_free(&nodeComm);
+   vector<int> nodeIDs(nProcesses);
+   MPI_Allgather(&nodeID,1,MPI_INT,nodeIDs.data(),1,MPI_INT,MPI_COMM_WORLD);
+   vector<pair<int,int> > processOrder(nProcesses);
+   for (int p=0; p<nProcesses; ++p) processOrder[p] = make_pair(nodeIDs[p],p);
+   sort(processOrder.begin(),processOrder.end());
+
+   // Cells count equally if there are no weights
+   Real localWeight = 0.0;
+   for (size_t c=0; c<weights.size(); ++c) localWeight += weights[c];
+   Real totalWeight;
+   MPI_Allreduce(&localWeight,&totalWeight,1,MPI_Type<Real>(),MPI_SUM,MPI_COMM_WORLD);
+   const bool unitWeights = (totalWeight <= 0.0);
+   if (unitWeights == true) {
+      uint64_t localCount = cells.size();
+      uint64_t totalCount;
+      MPI_Allreduce(&localCount,&totalCount,1,MPI_UINT64_T,MPI_SUM,MPI_COMM_WORLD);
+      totalWeight = totalCount;
+   }
+
+   // Positions of local cells on the curve, in curve order
+   uint bits = 1;
+   const uint maxCells = max(P::xcells_ini,max(P::ycells_ini,P::zcells_ini));
+   while (((uint64_t)1 << bits) < maxCells) ++bits;
+   vector<pair<HilbertCurveCell,size_t> > localCurve(cells.size());
+   for (size_t c=0; c<cells.size(); ++c) {
+      localCurve[c].first.index = getHilbertIndex(mpiGrid.mapping.get_indices(cells[c]),bits);
+      localCurve[c].first.weight = (unitWeights == true) ? 1.0 : weights[c];
+      localCurve[c].second = c;
+   }
+   sort(localCurve.begin(),localCurve.end());
+
+   // Regular samples of the local curve, nProcesses-1 splitters from all samples
+   vector<uint64_t> localSamples;
+   if (localCurve.size() > 0) {
+      for (int p=1; p<nProcesses; ++p) localSamples.push_back(localCurve[(p*localCurve.size())/nProcesses].first.index);
+   }
+   int nLocalSamples = localSamples.size();
+   vector<int> sampleCounts(nProcesses);
+   vector<int> sampleOffsets(nProcesses+1,0);
+   MPI_Allgather(&nLocalSamples,1,MPI_INT,sampleCounts.data(),1,MPI_INT,MPI_COMM_WORLD);
+   for (int p=0; p<nProcesses; ++p) sampleOffsets[p+1] = sampleOffsets[p] + sampleCounts[p];
+   vector<uint64_t> samples(sampleOffsets[nProcesses]);
+   MPI_Allgatherv(localSamples.data(),nLocalSamples,MPI_UINT64_T,samples.data(),sampleCounts.data(),sampleOffsets.data(),
+                  MPI_UINT64_T,MPI_COMM_WORLD);
+   sort(samples.begin(),samples.end());
+   vector<uint64_t> splitters(nProcesses-1,numeric_limits<uint64_t>::max());
+   for (int p=1; p<nProcesses && samples.size() > 0; ++p) splitters[p-1] = samples[(p*samples.size())/nProcesses];
+
+   // Send each cell to the process sorting its piece of the curve. The local curve is sorted,
+   // so the cells sent to each process are contiguous in it.
+   vector<int> sendCounts(nProcesses,0);
+   for (size_t c=0; c<localCurve.size(); ++c) {
+      ++sendCounts[upper_bound(splitters.begin(),splitters.end(),localCurve[c].first.index) - splitters.begin()];
+   }
+   vector<int> recvCounts(nProcesses);
+   MPI_Alltoall(sendCounts.data(),1,MPI_INT,recvCounts.data(),1,MPI_INT,MPI_COMM_WORLD);
+   vector<int> sendOffsets(nProcesses+1,0);
+   vector<int> recvOffsets(nProcesses+1,0);
+   for (int p=0; p<nProcesses; ++p) {
+      sendOffsets[p+1] = sendOffsets[p] + sendCounts[p];
+      recvOffsets[p+1] = recvOffsets[p] + recvCounts[p];
+   }
+   vector<HilbertCurveCell> sendCells(localCurve.size());
+   for (size_t c=0; c<localCurve.size(); ++c) sendCells[c] = localCurve[c].first;
+   vector<HilbertCurveCell> recvCells(recvOffsets[nProcesses]);
+   {
+      vector<int> sendBytes(nProcesses),sendDispls(nProcesses),recvBytes(nProcesses),recvDispls(nProcesses);
+      for (int p=0; p<nProcesses; ++p) {
+         sendBytes[p] = sendCounts[p]*sizeof(HilbertCurveCell);
+         sendDispls[p] = sendOffsets[p]*sizeof(HilbertCurveCell);
+         recvBytes[p] = recvCounts[p]*sizeof(HilbertCurveCell);
+         recvDispls[p] = recvOffsets[p]*sizeof(HilbertCurveCell);
+      }
+      MPI_Alltoallv(sendCells.data(),sendBytes.data(),sendDispls.data(),MPI_BYTE,
+                    recvCells.data(),recvBytes.data(),recvDispls.data(),MPI_BYTE,MPI_COMM_WORLD);
+   }
+
+   // Sort the piece of the curve, its starting weight is the exclusive prefix sum of the weights of the pieces
+   vector<pair<HilbertCurveCell,size_t> > piece(recvCells.size());
+   Real pieceWeight = 0.0;
+   for (size_t c=0; c<recvCells.size(); ++c) {
+      piece[c] = make_pair(recvCells[c],c);
+      pieceWeight += recvCells[c].weight;
+   }
+   sort(piece.begin(),piece.end());
+   Real cumulativeWeight = 0.0;
+   MPI_Exscan(&pieceWeight,&cumulativeWeight,1,MPI_Type<Real>(),MPI_SUM,MPI_COMM_WORLD);
+   if (myRank == 0) cumulativeWeight = 0.0;
+
+   // Cut the curve. With processes ordered by node, the cuts of the node segments are
+   // at the cumulative process fractions of the nodes, and each node segment is cut evenly.
+   vector<int> recvProcesses(recvCells.size());
+   for (size_t c=0; c<piece.size(); ++c) {
+      const Real midpoint = cumulativeWeight + 0.5*piece[c].first.weight;
+      cumulativeWeight += piece[c].first.weight;
+      const int slot = min(nProcesses-1,(int)(midpoint / totalWeight * nProcesses));
+      recvProcesses[piece[c].second] = processOrder[slot].second;
+   }
+
+   // Return the new processes to the current owners in the order the cells were sent
+   vector<int> sendProcesses(localCurve.size());
+   MPI_Alltoallv(recvProcesses.data(),recvCounts.data(),recvOffsets.data(),MPI_INT,
+                 sendProcesses.data(),sendCounts.data(),sendOffsets.data(),MPI_INT,MPI_COMM_WORLD);
+   for (size_t c=0; c<localCurve.size(); ++c) {
+      if (sendProcesses[c] != myRank) mpiGrid.pin(cells[localCurve[c].second],sendProcesses[c]);
+   }
+}
+
+/** Write the quality of the current partition to logFile: the ratio of the largest and mean
+ * process load, and the edge-cut, i.e., the number of remote Vlasov solver neighbors of local cells.
+ * Collective operation on MPI_COMM_WORLD.
+ * @param mpiGrid Parallel grid.
+ * @param useCostModel If true, cells are weighted by the cost model, otherwise by the measured weights.*/
+static void reportPartitionQuality(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,const bool& useCostModel) {
+   const vector<CellID>& cells = getLocalCells();
+   Real localSums[2] = {0.0,0.0};
+   for (size_t c=0; c<cells.size(); ++c) {
+      if (useCostModel == true) localSums[0] += mpiGrid[cells[c]]->parameters[CellParams::LBWEIGHTPREDICTED];
+      else localSums[0] += mpiGrid[cells[c]]->parameters[CellParams::LBWEIGHTCOUNTER];
+
+      const vector<CellID>* neighbors = mpiGrid.get_neighbors_of(cells[c],VLASOV_SOLVER_NEIGHBORHOOD_ID);
+      for (size_t n=0; n<neighbors->size(); ++n) {
+         const CellID nbr = (*neighbors)[n];
+         if (nbr != INVALID_CELLID && mpiGrid.is_local(nbr) == false) ++localSums[1];
+      }
+   }
+
+   int nProcesses;
+   MPI_Comm_size(MPI_COMM_WORLD,&nProcesses);
+   Real maxLoad,sums[2];
+   MPI_Allreduce(&(localSums[0]),&maxLoad,1,MPI_Type<Real>(),MPI_MAX,MPI_COMM_WORLD);
+   MPI_Allreduce(localSums,sums,2,MPI_Type<Real>(),MPI_SUM,MPI_COMM_WORLD);
+   const Real meanLoad = sums[0] / nProcesses;
+   logFile << "(LB): Load imbalance (max/mean) " << (meanLoad > 0.0 ? maxLoad/meanLoad : 1.0);
+   logFile << ", edge-cut " << (uint64_t)sums[1] << " remote Vlasov solver neighbors" << endl << writeVerbose;
+}
+
 void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, SysBoundary& sysBoundaries){
    // Invalidate cached cell lists
    Parameters::meshRepartitioned = true;
@@ -310,21 +598,51 @@ void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, S
    deallocateRemoteCellBlocks(mpiGrid);
 
    phiprof::stop("deallocate boundary data");
+   // Weights measured in the last step (otherwise they are block counts or read from
+   // a restart) are smoothed with the calibrated cost model
+   bool useCostModel = false;
+   if (P::loadBalanceCostModel == true && P::prepareForRebalance == true) {
+      useCostModel = updateCellCostModel(mpiGrid);
+   }
+
    //set weights based on each cells LB weight counter
    vector<CellID> cells = mpiGrid.get_cells();
+   vector<Real> weights(cells.size());
    for (size_t i=0; i<cells.size(); ++i){
       //Set weight. If acceleration is enabled then we use the weight
       //counter which is updated in acceleration, otherwise we just
       //use the number of blocks.
 //      if (P::propagateVlasovAcceleration) 
-      mpiGrid.set_cell_weight(cells[i], mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER]);
+      if (useCostModel == true) {
+         weights[i] = mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTPREDICTED];
+      } else {
+         weights[i] = mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER];
+      }
+      mpiGrid.set_cell_weight(cells[i], weights[i]);
 //      else
 //         mpiGrid.set_cell_weight(cells[i], mpiGrid[cells[i]]->get_number_of_all_velocity_blocks());
       //reset counter
       //mpiGrid[cells[i]]->parameters[CellParams::LBWEIGHTCOUNTER] = 0.0;
    }
+   // Small imbalances are corrected incrementally by moving cells between neighboring
+   // processes, otherwise the grid is repartitioned from scratch with Zoltan
+   bool incremental = false;
+   if (P::loadBalanceIncremental == true && P::prepareForRebalance == true) {
+      phiprof::start("pin incremental migrations");
+      incremental = pinIncrementalMigrations(mpiGrid,cells,weights);
+      phiprof::stop("pin incremental migrations");
+   }
+
+   // The built-in Hilbert curve partitioner pins all cells, other algorithms are Zoltan's
+   if (incremental == false && P::loadBalanceAlgorithm == "HILBERT") {
+      phiprof::start("Hilbert partitioning");
+      pinHilbertPartition(mpiGrid,cells,weights);
+      phiprof::stop("Hilbert partitioning");
+   }
+   const bool useZoltan = (incremental == false && P::loadBalanceAlgorithm != "HILBERT");
+
    phiprof::start("dccrg.initialize_balance_load");
-   mpiGrid.initialize_balance_load(true);
+   mpiGrid.initialize_balance_load(useZoltan);
    phiprof::stop("dccrg.initialize_balance_load");
 
    const std::unordered_set<uint64_t>& incoming_cells = mpiGrid.get_cells_added_by_balance_load();
@@ -332,92 +650,104 @@ void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, S
 
    const std::unordered_set<uint64_t>& outgoing_cells = mpiGrid.get_cells_removed_by_balance_load();
    std::vector<uint64_t> outgoing_cells_list (outgoing_cells.begin(),outgoing_cells.end()); 
+
+   // Report the amount of migrated data
+   {
+      Real localMigration[2] = {(Real)outgoing_cells_list.size(),0.0};
+      for (size_t i=0; i<outgoing_cells_list.size(); ++i) {
+         localMigration[1] += getCellMigrationBytes(mpiGrid[outgoing_cells_list[i]]);
+      }
+      Real migration[2];
+      MPI_Allreduce(localMigration,migration,2,MPI_Type<Real>(),MPI_SUM,MPI_COMM_WORLD);
+      logFile << "(LB): " << (incremental ? string("Incremental") : P::loadBalanceAlgorithm) << " rebalance migrates " << (uint64_t)migration[0] << " cells, ";
+      logFile << migration[1]/1.0e6 << " MB of velocity block data" << endl << writeVerbose;
+   }
    
-   /*transfer cells in parts to preserve memory*/
+   /*transfer cells in rounds to preserve memory. All populations of a cell are packed into one message,
+    and each process sends at most P::loadBalanceTransferMaxBytes of it per round. The limit is per sender,
+    a process receiving from several processes may receive up to that much from each of them per round.*/
    phiprof::start("Data transfers");
-   const uint64_t num_part_transfers=5;
-   for (uint64_t transfer_part=0; transfer_part<num_part_transfers; transfer_part++) {
-      //Set transfers on/off for the incoming cells in this transfer set and prepare for receive
-      for (unsigned int i=0;i<incoming_cells_list.size();i++){
-         uint64_t cell_id=incoming_cells_list[i];
-         SpatialCell* cell = mpiGrid[cell_id];
-         if (cell_id%num_part_transfers!=transfer_part) {
-            cell->set_mpi_transfer_enabled(false);
-         } else {
-            cell->set_mpi_transfer_enabled(true);
-         }
+   uint64_t localRounds = 0;
+   Real roundBytes = 0.0;
+   for (unsigned int i=0; i<outgoing_cells_list.size(); i++) {
+      SpatialCell* cell = mpiGrid[outgoing_cells_list[i]];
+      const Real bytes = getCellMigrationBytes(cell);
+      if (roundBytes > 0.0 && roundBytes + bytes > P::loadBalanceTransferMaxBytes) {
+         ++localRounds;
+         roundBytes = 0.0;
+      }
+      cell->migrationRound = localRounds;
+      roundBytes += bytes;
+   }
+   if (outgoing_cells_list.size() > 0) ++localRounds;
+   uint64_t nRounds;
+   MPI_Allreduce(&localRounds,&nRounds,1,MPI_UINT64_T,MPI_MAX,MPI_COMM_WORLD);
+
+   // Send the sizes of the packed data and the transfer rounds, together
+   // with all data except the distribution function
+   for (unsigned int i=0; i<incoming_cells_list.size(); i++) mpiGrid[incoming_cells_list[i]]->set_mpi_transfer_enabled(true);
+   for (unsigned int i=0; i<outgoing_cells_list.size(); i++) mpiGrid[outgoing_cells_list[i]]->set_mpi_transfer_enabled(true);
+   phiprof::start("transfer_spatial_data");
+   SpatialCell::set_mpi_transfer_type(Transfer::MIGRATION_STAGE1 | Transfer::ALL_SPATIAL_DATA);
+   mpiGrid.continue_balance_load();
+   phiprof::stop("transfer_spatial_data");
+
+   for (uint64_t round=0; round<nRounds; ++round) {
+      //Set transfers on/off for the incoming and outgoing cells in this round
+      for (unsigned int i=0; i<incoming_cells_list.size(); i++) {
+         SpatialCell* cell = mpiGrid[incoming_cells_list[i]];
+         cell->set_mpi_transfer_enabled(cell->migrationRound == round);
       }
-      
-      //Set transfers on/off for the outgoing cells in this transfer set
       for (unsigned int i=0; i<outgoing_cells_list.size(); i++) {
-         uint64_t cell_id=outgoing_cells_list[i];
-         SpatialCell* cell = mpiGrid[cell_id];
-         if (cell_id%num_part_transfers!=transfer_part) {
-            cell->set_mpi_transfer_enabled(false);
-         } else {
-            cell->set_mpi_transfer_enabled(true);
-         }
+         SpatialCell* cell = mpiGrid[outgoing_cells_list[i]];
+         cell->set_mpi_transfer_enabled(cell->migrationRound == round);
       }
 
-      for (size_t p=0; p<getObjectWrapper().particleSpecies.size(); ++p) {
-         // Set active population
-         SpatialCell::setCommunicatedSpecies(p);
-
-         //Transfer velocity block list
-         SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_LIST_STAGE1);
-         mpiGrid.continue_balance_load();
-         SpatialCell::set_mpi_transfer_type(Transfer::VEL_BLOCK_LIST_STAGE2);
-         mpiGrid.continue_balance_load();
-      
-         int receives = 0;
-         for (unsigned int i=0; i<incoming_cells_list.size(); i++) {
-            uint64_t cell_id=incoming_cells_list[i];
-            SpatialCell* cell = mpiGrid[cell_id];
-            if (cell_id % num_part_transfers == transfer_part) {
-               receives++;
-               phiprof::start("Preparing receives");
-               // reserve space for velocity block data in arriving remote cells
-               cell->prepare_to_receive_blocks(p);
-               phiprof::stop("Preparing receives", 1, "Spatial cells");
-            }
-         }
-         if(receives == 0) {
-            //empty phiprof timer, to avoid unneccessary divergence in unique
-            //profiles (keep order same)
-            phiprof::start("Preparing receives");
-            phiprof::stop("Preparing receives", 0, "Spatial cells");
-         }
-         
-         //do the actual transfer of data for the set of cells to be transferred
-         phiprof::start("transfer_all_data");
-         SpatialCell::set_mpi_transfer_type(Transfer::ALL_DATA);
-         mpiGrid.continue_balance_load();
-         phiprof::stop("transfer_all_data");
-
-         // Free memory for cells that have been sent (the block data)
-         for (unsigned int i=0;i<outgoing_cells_list.size();i++){
-            uint64_t cell_id=outgoing_cells_list[i];
-            SpatialCell* cell = mpiGrid[cell_id];
-            
-            // Free memory of this cell as it has already been transferred, 
-            // it will not be used anymore. NOTE: Only clears memory allocated 
-            // to the active population.
-            if (cell_id % num_part_transfers == transfer_part) cell->clear(p);
-         }
-      } // for-loop over populations
-   } // for-loop over transfer parts
+      phiprof::start("Packing sends");
+      #pragma omp parallel for schedule(dynamic,1)
+      for (unsigned int i=0; i<outgoing_cells_list.size(); i++) {
+         SpatialCell* cell = mpiGrid[outgoing_cells_list[i]];
+         if (cell->migrationRound == round) cell->pack_migration_buffer();
+      }
+      phiprof::stop("Packing sends");
+
+      //do the actual transfer of the velocity meshes of all populations
+      phiprof::start("transfer_all_data");
+      SpatialCell::set_mpi_transfer_type(Transfer::MIGRATION_STAGE2);
+      mpiGrid.continue_balance_load();
+      phiprof::stop("transfer_all_data");
+
+      // Unpack arriving cells, and free memory for cells that have been sent. The
+      // sent cells will not be used anymore.
+      phiprof::start("Unpacking receives");
+      #pragma omp parallel for schedule(dynamic,1)
+      for (unsigned int i=0; i<incoming_cells_list.size(); i++) {
+         SpatialCell* cell = mpiGrid[incoming_cells_list[i]];
+         if (cell->migrationRound == round) cell->unpack_migration_buffer();
+      }
+      #pragma omp parallel for schedule(dynamic,1)
+      for (unsigned int i=0; i<outgoing_cells_list.size(); i++) {
+         SpatialCell* cell = mpiGrid[outgoing_cells_list[i]];
+         if (cell->migrationRound != round) continue;
+         cell->clear_migration_buffer();
+         for (size_t p=0; p<getObjectWrapper().particleSpecies.size(); ++p) cell->clear(p);
+      }
+      phiprof::stop("Unpacking receives");
+   } // for-loop over transfer rounds
    phiprof::stop("Data transfers");
 
    //finish up load balancing
    phiprof::start("dccrg.finish_balance_load");
    mpiGrid.finish_balance_load();
    phiprof::stop("dccrg.finish_balance_load");
+   if (useZoltan == false) mpiGrid.unpin_all_cells();
 
    //Make sure transfers are enabled for all cells
    recalculateLocalCellsCache();
    getObjectWrapper().meshData.reallocate();
    cells = mpiGrid.get_cells();
    for (uint i=0; i<cells.size(); ++i) mpiGrid[cells[i]]->set_mpi_transfer_enabled(true);
+   reportPartitionQuality(mpiGrid,useCostModel);
 
    // Communicate all spatial data for FULL neighborhood, which
    // includes all data with the exception of dist function data
@@ -447,6 +777,179 @@ void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, S
    phiprof::stop("Balancing load");
 }
 
+void addLoadBalanceWeight(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                          const Real& time,const bool& sysBoundaryCellsOnly) {
+   const vector<CellID>& cells = getLocalCells();
+   size_t nCells = 0;
+   for (size_t c=0; c<cells.size(); ++c) {
+      if (sysBoundaryCellsOnly == false || mpiGrid[cells[c]]->sysBoundaryFlag != sysboundarytype::NOT_SYSBOUNDARY) ++nCells;
+   }
+   if (nCells == 0) return;
+   
+   const Real cellTime = time / nCells;
+   for (size_t c=0; c<cells.size(); ++c) {
+      if (sysBoundaryCellsOnly == false || mpiGrid[cells[c]]->sysBoundaryFlag != sysboundarytype::NOT_SYSBOUNDARY) {
+         mpiGrid[cells[c]]->parameters[CellParams::LBWEIGHTCOUNTER] += cellTime;
+      }
+   }
+}
+
+namespace costmodel {
+   enum {
+      CELL,                /*!< Per-cell cost, scaled by field solver subcycles.*/
+      SYSBOUNDARY,         /*!< Extra cost of a system boundary cell.*/
+      BLOCK_TRANSLATION,   /*!< Per-block cost of translation and moments.*/
+      BLOCK_ACCELERATION,  /*!< Per-block cost of one acceleration subcycle.*/
+      N_TERMS
+   };
+}
+
+/** Get the terms of the cost model of a cell, i.e., the quantities whose costs the model fits.
+ * @param cell Spatial cell.
+ * @param terms Array of size costmodel::N_TERMS where the terms are written.*/
+static void getCellCostTerms(SpatialCell* cell,Real* terms) {
+   terms[costmodel::CELL] = max(P::fieldSolverSubcycles,1);
+   terms[costmodel::SYSBOUNDARY] = (cell->sysBoundaryFlag != sysboundarytype::NOT_SYSBOUNDARY) ? 1.0 : 0.0;
+   terms[costmodel::BLOCK_TRANSLATION] = 0.0;
+   terms[costmodel::BLOCK_ACCELERATION] = 0.0;
+   for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+      const Real nBlocks = cell->get_number_of_velocity_blocks(popID);
+      if (cell->sysBoundaryFlag != sysboundarytype::DO_NOT_COMPUTE) {
+         terms[costmodel::BLOCK_TRANSLATION] += nBlocks;
+      }
+      if (cell->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY && nBlocks > 0) {
+         terms[costmodel::BLOCK_ACCELERATION] += nBlocks * getAccelerationSubcycles(cell,P::dt,popID);
+      }
+   }
+}
+
+/** Solve the least squares normal equations of the cost model restricted to the active terms.
+ * @param ata Matrix A^T A, N_TERMS x N_TERMS in row-major order.
+ * @param atb Vector A^T b.
+ * @param active Terms included in the fit.
+ * @param coefficients Fitted coefficients, zero for inactive terms.
+ * @return If false, the system was singular.*/
+static bool solveCostModel(const Real* ata,const Real* atb,const bool* active,Real* coefficients) {
+   const int N = costmodel::N_TERMS;
+   Real a[N][N+1];
+   for (int i=0; i<N; ++i) {
+      for (int j=0; j<N; ++j) a[i][j] = (active[i] && active[j]) ? ata[i*N+j] : 0.0;
+      a[i][N] = active[i] ? atb[i] : 0.0;
+      // Inactive terms get an identity row so that their coefficient is zero
+      if (active[i] == false) a[i][i] = 1.0;
+   }
+
+   // Gaussian elimination with partial pivoting
+   Real scale = 0.0;
+   for (int i=0; i<N; ++i) scale = max(scale,fabs(a[i][i]));
+   for (int col=0; col<N; ++col) {
+      int pivot = col;
+      for (int row=col+1; row<N; ++row) if (fabs(a[row][col]) > fabs(a[pivot][col])) pivot = row;
+      if (fabs(a[pivot][col]) <= 1e-14 * scale) return false;
+      for (int j=0; j<=N; ++j) swap(a[col][j],a[pivot][j]);
+      for (int row=col+1; row<N; ++row) {
+         const Real factor = a[row][col] / a[col][col];
+         for (int j=col; j<=N; ++j) a[row][j] -= factor * a[col][j];
+      }
+   }
+   for (int row=N-1; row>=0; --row) {
+      Real sum = a[row][N];
+      for (int j=row+1; j<N; ++j) sum -= a[row][j] * coefficients[j];
+      coefficients[row] = sum / a[row][row];
+   }
+   return true;
+}
+
+bool updateCellCostModel(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
+   phiprof::start("update-cost-model");
+   const int N = costmodel::N_TERMS;
+   const vector<CellID>& cells = getLocalCells();
+
+   // Normal equations of the fit over all cells, A^T A and A^T b, and the sum of squared measured costs
+   Real localSums[N*N + N + 1] = {};
+   Real terms[N];
+   for (size_t c=0; c<cells.size(); ++c) {
+      SpatialCell* cell = mpiGrid[cells[c]];
+      getCellCostTerms(cell,terms);
+      const Real measured = cell->parameters[CellParams::LBWEIGHTCOUNTER];
+      for (int i=0; i<N; ++i) {
+         for (int j=0; j<N; ++j) localSums[i*N+j] += terms[i] * terms[j];
+         localSums[N*N+i] += terms[i] * measured;
+      }
+      localSums[N*N+N] += measured * measured;
+   }
+   Real sums[N*N + N + 1];
+   MPI_Allreduce(localSums,sums,N*N + N + 1,MPI_Type<Real>(),MPI_SUM,MPI_COMM_WORLD);
+   const Real* ata = sums;
+   const Real* atb = sums + N*N;
+
+   // Costs cannot be negative: drop the most negative term from the fit until all coefficients are non-negative
+   bool active[N];
+   Real coefficients[N];
+   for (int i=0; i<N; ++i) active[i] = (ata[i*N+i] > 0);
+   bool success = false;
+   for (int iteration=0; iteration<N; ++iteration) {
+      if (solveCostModel(ata,atb,active,coefficients) == false) break;
+      int mostNegative = -1;
+      for (int i=0; i<N; ++i) {
+         if (active[i] && coefficients[i] < 0 && (mostNegative < 0 || coefficients[i] < coefficients[mostNegative])) mostNegative = i;
+      }
+      if (mostNegative < 0) {
+         success = true;
+         break;
+      }
+      active[mostNegative] = false;
+   }
+   if (success == false) {
+      logFile << "(LB): Cost model could not be fitted, using measured cell weights" << endl << writeVerbose;
+      phiprof::stop("update-cost-model");
+      return false;
+   }
+
+   // Residual sum of squares |Ax-b|^2 = x^T A^T A x - 2 x^T A^T b + b^T b
+   Real residual = sums[N*N+N];
+   for (int i=0; i<N; ++i) {
+      residual -= 2 * coefficients[i] * atb[i];
+      for (int j=0; j<N; ++j) residual += coefficients[i] * ata[i*N+j] * coefficients[j];
+   }
+   const Real relativeError = (sums[N*N+N] > 0) ? sqrt(max(residual,0.0) / sums[N*N+N]) : 0.0;
+   logFile << "(LB): Cost model per cell " << coefficients[costmodel::CELL] << " s, sysboundary cell " << coefficients[costmodel::SYSBOUNDARY];
+   logFile << " s, block translation " << coefficients[costmodel::BLOCK_TRANSLATION] << " s, block acceleration " << coefficients[costmodel::BLOCK_ACCELERATION];
+   logFile << " s, relative rms error " << relativeError << endl << writeVerbose;
+
+   for (size_t c=0; c<cells.size(); ++c) {
+      SpatialCell* cell = mpiGrid[cells[c]];
+      getCellCostTerms(cell,terms);
+      Real predicted = 0.0;
+      for (int i=0; i<N; ++i) predicted += coefficients[i] * terms[i];
+      cell->parameters[CellParams::LBWEIGHTPREDICTED] = predicted;
+   }
+   phiprof::stop("update-cost-model");
+   return true;
+}
+
+void computeLoadImbalance(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                          Real& maxTime,Real& meanTime,Real& rebalanceTime) {
+   const vector<CellID>& cells = getLocalCells();
+   Real localTime = 0.0;
+   for (size_t c=0; c<cells.size(); ++c) {
+      localTime += mpiGrid[cells[c]]->parameters[CellParams::LBWEIGHTCOUNTER];
+   }
+   // The weights are summed over threads, convert them to wall time
+   localTime /= omp_get_max_threads();
+
+   int nProcesses;
+   MPI_Comm_size(MPI_COMM_WORLD,&nProcesses);
+   Real localMax[2] = {localTime,rebalanceTime};
+   Real globalMax[2];
+   Real globalSum;
+   MPI_Allreduce(localMax,globalMax,2,MPI_Type<Real>(),MPI_MAX,MPI_COMM_WORLD);
+   MPI_Allreduce(&localTime,&globalSum,1,MPI_Type<Real>(),MPI_SUM,MPI_COMM_WORLD);
+   maxTime = globalMax[0];
+   meanTime = globalSum / nProcesses;
+   rebalanceTime = globalMax[1];
+}
+
 /*
   Adjust sparse velocity space to make it consistent in all 6 dimensions.
 
@@ -513,6 +1016,10 @@ bool adjustVelocityBlocks(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& m
             for (size_t i=0; i<cell->get_number_of_velocity_blocks(popID)*WID3; ++i) {
                cell->get_data(popID)[i] *= density_pre_adjust/density_post_adjust;
             }
+            if (cell->has_fused_moments(popID)) {
+               Real* fusedMoments = cell->get_fused_moments(popID);
+               for (int m=0; m<FusedMoments::N_FUSED_SUMS; ++m) fusedMoments[m] *= density_pre_adjust/density_post_adjust;
+            }
          }
       }
    }
@@ -598,6 +1105,33 @@ void report_grid_memory_consumption(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
    logFile << "(MEM)   Average capacity: " << sum_mem[5]/n_procs << " local cells " << sum_mem[3]/n_procs << " remote cells " << sum_mem[4]/n_procs << endl;
    logFile << "(MEM)   Max capacity:     " << max_mem[2].val   << " on  process " << max_mem[2].rank << endl;
    logFile << "(MEM)   Min capacity:     " << min_mem[2].val   << " on  process " << min_mem[2].rank << endl;
+
+   /*report velocity block arena usage. Live memory is that of existing velocity blocks, 
+    the rest of the reserved memory is capacity slack of containers and free slab slots*/
+   const vmesh::ArenaStatistics arenaStats = vmesh::getBlockArena().getStatistics();
+   double arena_mem[4] = {0};
+   double sum_arena_mem[4];
+   double max_arena_mem[4];
+   for (unsigned int i=0; i<cells.size(); i++) {
+      for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         arena_mem[0] += mpiGrid[cells[i]]->get_velocity_blocks(popID).sizeInBytes();
+      }
+   }
+   for (unsigned int i=0; i<remote_cells.size(); i++) {
+      for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
+         arena_mem[0] += mpiGrid[remote_cells[i]]->get_velocity_blocks(popID).sizeInBytes();
+      }
+   }
+   arena_mem[1] = arenaStats.reserved;
+   arena_mem[2] = arenaStats.free;
+   arena_mem[3] = arena_mem[1] - arena_mem[0];
+   MPI_Reduce(arena_mem, sum_arena_mem, 4, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+   MPI_Reduce(arena_mem, max_arena_mem, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+   logFile << "(MEM) Block arena live: " << sum_arena_mem[0] << " reserved: " << sum_arena_mem[1]
+           << " free slots: " << sum_arena_mem[2] << " fragmented: " << sum_arena_mem[3] << endl;
+   logFile << "(MEM)   Max per process live: " << max_arena_mem[0] << " reserved: " << max_arena_mem[1]
+           << " fragmented: " << max_arena_mem[3] << endl;
    logFile << writeVerbose;
 }
 
@@ -605,6 +1139,20 @@ void report_grid_memory_consumption(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Ge
  *  memory
  * \param mpiGrid Spatial grid
  */
+void freeCellMPIDatatypes(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
+   std::vector<uint64_t> cells = mpiGrid.get_cells();
+   // Remote cells of the default and the largest user neighborhood, cells may appear twice
+   const std::vector<uint64_t> remote_cells = mpiGrid.get_remote_cells_on_process_boundary();
+   const std::vector<uint64_t> full_remote_cells = mpiGrid.get_remote_cells_on_process_boundary(FULL_NEIGHBORHOOD_ID);
+   cells.insert(cells.end(),remote_cells.begin(),remote_cells.end());
+   cells.insert(cells.end(),full_remote_cells.begin(),full_remote_cells.end());
+   for (size_t i=0; i<cells.size(); ++i) {
+      SpatialCell* cell = mpiGrid[cells[i]];
+      if (cell != NULL) cell->free_mpi_datatype_cache();
+   }
+   SpatialCell::free_fixed_layout_mpi_datatypes();
+}
+
 void deallocateRemoteCellBlocks(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid) {
    const std::vector<uint64_t> incoming_cells
       = mpiGrid.get_remote_cells_on_process_boundary(VLASOV_SOLVER_NEIGHBORHOOD_ID);
@@ -879,6 +1427,48 @@ void initializeStencils(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
    neighborhood.push_back({{ 0, 0,-1}});
    neighborhood.push_back({{ 0, 0,+1}});
    mpiGrid.add_neighborhood(POISSON_NEIGHBORHOOD_ID, neighborhood);
+
+   // Field solver stage neighborhoods. Edge Ex of a cell is computed from the 
+   // cells sharing the edge and from their +x neighbors, similarly for Ey and Ez.
+   neighborhood.clear();
+   for (int z = -1; z <= 1; z++) {
+      for (int y = -1; y <= 1; y++) {
+         for (int x = -1; x <= 1; x++) {
+            if (x == 0 && y == 0 && z == 0) {
+               continue;
+            }
+            const bool edgeX = (x >= 0 && y <= 0 && z <= 0);
+            const bool edgeY = (x <= 0 && y >= 0 && z <= 0);
+            const bool edgeZ = (x <= 0 && y <= 0 && z >= 0);
+            if (edgeX || edgeY || edgeZ) {
+               neigh_t offsets = {{x, y, z}};
+               neighborhood.push_back(offsets);
+            }
+         }
+      }
+   }
+   mpiGrid.add_neighborhood(FIELD_SOLVER_E_NEIGHBORHOOD_ID, neighborhood);
+
+   // Mixed derivatives of B for the second order Hall term also read these edge neighbors
+   neighborhood.push_back({{1, 1, 0}});
+   neighborhood.push_back({{1, 0, 1}});
+   neighborhood.push_back({{0, 1, 1}});
+   mpiGrid.add_neighborhood(FIELD_SOLVER_E_HALL_NEIGHBORHOOD_ID, neighborhood);
+
+   // Face B and volume averaged E read edge E of neighbors in positive directions
+   neighborhood.clear();
+   for (int z = 0; z <= 1; z++) {
+      for (int y = 0; y <= 1; y++) {
+         for (int x = 0; x <= 1; x++) {
+            if (x + y + z == 0 || x + y + z == 3) {
+               continue;
+            }
+            neigh_t offsets = {{x, y, z}};
+            neighborhood.push_back(offsets);
+         }
+      }
+   }
+   mpiGrid.add_neighborhood(FIELD_SOLVER_B_NEIGHBORHOOD_ID, neighborhood);
 }
 
 bool validateMesh(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,const int& popID) {
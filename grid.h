@@ -47,6 +47,39 @@ void initializeGrid(
 */
 void balanceLoad(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid, SysBoundary& sysBoundaries);
 
+/*! Add the time spent in a solver phase that is not timed per cell to the load balance
+ *  weights (LBWEIGHTCOUNTER) of the local cells, divided evenly between them.
+ * \param mpiGrid Spatial grid
+ * \param time Compute time of the phase on this process, summed over threads.
+ * \param sysBoundaryCellsOnly If true, the time is only divided between system boundary cells.
+ */
+void addLoadBalanceWeight(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                          const Real& time,const bool& sysBoundaryCellsOnly);
+
+/*! Calibrate the per-cell cost model against the measured weights (LBWEIGHTCOUNTER) and
+ *  store the predicted cost of each local cell in LBWEIGHTPREDICTED. The cost of a cell is
+ *  modelled as a non-negative combination of a per-cell cost scaled by the field solver
+ *  subcycles, a system boundary cell cost, a per-block translation cost and a per-block
+ *  acceleration cost scaled by the acceleration subcycles, summed over populations. The
+ *  coefficients are fitted with least squares over all cells. Collective operation on
+ *  MPI_COMM_WORLD.
+ * \param mpiGrid Spatial grid
+ * \return If false, the fit failed and LBWEIGHTPREDICTED was not updated.
+ */
+bool updateCellCostModel(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid);
+
+/*! Measure the load imbalance of the last time step. The compute time of a process is
+ *  the sum of the LBWEIGHTCOUNTER of its local cells, which the solvers accumulate over
+ *  threads when P::prepareForRebalance is true, divided by the number of threads. Collective operation on MPI_COMM_WORLD, all processes
+ *  get the same values.
+ * \param mpiGrid Spatial grid
+ * \param maxTime Largest compute time of a process.
+ * \param meanTime Mean compute time of the processes.
+ * \param rebalanceTime In: wall time this process spent in the last rebalance, out: largest such time of all processes.
+ */
+void computeLoadImbalance(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                          Real& maxTime,Real& meanTime,Real& rebalanceTime);
+
 /*!
 
 Updates velocity block lists between remote neighbors and
@@ -60,6 +93,12 @@ void updateRemoteVelocityBlockLists(
         const int& popID
 );
 
+/*! Frees the MPI datatypes cached by local and remote cells and shared by all cells.
+ *  Must be called before MPI is finalized.
+ * \param mpiGrid Spatial grid
+ */
+void freeCellMPIDatatypes(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid);
+
 /*! Deallocates all blocks in remote cells in order to save
  *  memory. 
  * \param mpiGrid Spatial grid
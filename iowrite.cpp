@@ -33,6 +33,10 @@
 #include <array>
 #include <algorithm>
 #include <limits>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "iowrite.h"
 #include "grid.h"
@@ -110,6 +114,64 @@ bool globalSuccess(bool success,string errorMessage,MPI_Comm comm){
    }
 }
 
+/** Writes the bounding box and node coordinates of the velocity mesh of the given population.
+ @param popID ID of the particle population.
+ @param vlsvWriter Some vlsv writer with a file open.
+ @param isMaster If true, this process writes the arrays, other processes write empty arrays.
+ @return Returns true if operation was successful.*/
+bool writeVelocityMeshBoundingBox(const int& popID,Writer& vlsvWriter,const bool& isMaster) {
+   bool success = true;
+   map<string,string> attribs;
+   uint64_t bbox[6];
+   const size_t meshID = getObjectWrapper().particleSpecies[popID].velocityMesh;
+   bbox[0] = getObjectWrapper().velocityMeshes[meshID].gridLength[0];
+   bbox[1] = getObjectWrapper().velocityMeshes[meshID].gridLength[1];
+   bbox[2] = getObjectWrapper().velocityMeshes[meshID].gridLength[2];
+   bbox[3] = getObjectWrapper().velocityMeshes[meshID].blockLength[0];
+   bbox[4] = getObjectWrapper().velocityMeshes[meshID].blockLength[1];
+   bbox[5] = getObjectWrapper().velocityMeshes[meshID].blockLength[2];
+
+   attribs["mesh"] = getObjectWrapper().particleSpecies[popID].name;
+   attribs["type"] = vlsv::mesh::STRING_UCD_AMR;
+
+   // stringstream is necessary here to correctly convert refLevelMaxAllowed into a string 
+   stringstream ss;
+   ss << static_cast<unsigned int>(getObjectWrapper().velocityMeshes[meshID].refLevelMaxAllowed);
+   attribs["max_velocity_ref_level"] = ss.str();
+   
+   if (isMaster == true) {
+      if (vlsvWriter.writeArray("MESH_BBOX",attribs,6,1,bbox) == false) success = false;
+
+      for (int crd=0; crd<3; ++crd) {
+         const size_t N_nodes = bbox[crd]*bbox[crd+3]+1;
+         Real* crds = new Real[N_nodes];
+         const Real dV = getObjectWrapper().velocityMeshes[meshID].cellSize[crd];
+
+         for (size_t i=0; i<N_nodes; ++i) {
+            crds[i] = getObjectWrapper().velocityMeshes[meshID].meshMinLimits[crd] + i*dV;
+         }
+
+         if (crd == 0) {
+            if (vlsvWriter.writeArray("MESH_NODE_CRDS_X",attribs,N_nodes,1,crds) == false) success = false;
+         }
+         if (crd == 1) {
+            if (vlsvWriter.writeArray("MESH_NODE_CRDS_Y",attribs,N_nodes,1,crds) == false) success = false;
+         }
+         if (crd == 2) {
+            if (vlsvWriter.writeArray("MESH_NODE_CRDS_Z",attribs,N_nodes,1,crds) == false) success = false;
+         }
+         delete [] crds; crds = NULL;
+      }
+   } else {
+      if (vlsvWriter.writeArray("MESH_BBOX",attribs,0,1,bbox) == false) success = false;
+      Real* crds = NULL;
+      if (vlsvWriter.writeArray("MESH_NODE_CRDS_X",attribs,0,1,crds) == false) success = false;
+      if (vlsvWriter.writeArray("MESH_NODE_CRDS_Y",attribs,0,1,crds) == false) success = false;
+      if (vlsvWriter.writeArray("MESH_NODE_CRDS_Z",attribs,0,1,crds) == false) success = false;
+   }
+   return success;
+}
+
 /** Writes the velocity distribution into the file.
  @param vlsvWriter Some vlsv writer with a file open.
  @param mpiGrid Vlasiator's grid.
@@ -164,54 +226,7 @@ bool writeVelocityDistributionData(const int& popID,Writer& vlsvWriter,
    if (success == false) logFile << "(MAIN) writeGrid: ERROR failed to write CELLSWITHBLOCKS to file!" << endl << writeVerbose;
 
    // Write (partial) velocity mesh data
-   uint64_t bbox[6];
-   const size_t meshID = getObjectWrapper().particleSpecies[popID].velocityMesh;
-   bbox[0] = getObjectWrapper().velocityMeshes[meshID].gridLength[0];
-   bbox[1] = getObjectWrapper().velocityMeshes[meshID].gridLength[1];
-   bbox[2] = getObjectWrapper().velocityMeshes[meshID].gridLength[2];
-   bbox[3] = getObjectWrapper().velocityMeshes[meshID].blockLength[0];
-   bbox[4] = getObjectWrapper().velocityMeshes[meshID].blockLength[1];
-   bbox[5] = getObjectWrapper().velocityMeshes[meshID].blockLength[2];
-
-   attribs.clear();
-   attribs["mesh"] = getObjectWrapper().particleSpecies[popID].name;
-   attribs["type"] = vlsv::mesh::STRING_UCD_AMR;
-
-   // stringstream is necessary here to correctly convert refLevelMaxAllowed into a string 
-   stringstream ss;
-   ss << static_cast<unsigned int>(getObjectWrapper().velocityMeshes[meshID].refLevelMaxAllowed);
-   attribs["max_velocity_ref_level"] = ss.str();
-   
-   if (mpiGrid.get_rank() == MASTER_RANK) {
-      if (vlsvWriter.writeArray("MESH_BBOX",attribs,6,1,bbox) == false) success = false;
-
-      for (int crd=0; crd<3; ++crd) {
-         const size_t N_nodes = bbox[crd]*bbox[crd+3]+1;
-         Real* crds = new Real[N_nodes];
-         const Real dV = getObjectWrapper().velocityMeshes[meshID].cellSize[crd];
-
-         for (size_t i=0; i<N_nodes; ++i) {
-            crds[i] = getObjectWrapper().velocityMeshes[meshID].meshMinLimits[crd] + i*dV;
-         }
-
-         if (crd == 0) {
-            if (vlsvWriter.writeArray("MESH_NODE_CRDS_X",attribs,N_nodes,1,crds) == false) success = false;
-         }
-         if (crd == 1) {
-            if (vlsvWriter.writeArray("MESH_NODE_CRDS_Y",attribs,N_nodes,1,crds) == false) success = false;
-         }
-         if (crd == 2) {
-            if (vlsvWriter.writeArray("MESH_NODE_CRDS_Z",attribs,N_nodes,1,crds) == false) success = false;
-         }
-         delete [] crds; crds = NULL;
-      }
-   } else {
-      if (vlsvWriter.writeArray("MESH_BBOX",attribs,0,1,bbox) == false) success = false;
-      Real* crds = NULL;
-      if (vlsvWriter.writeArray("MESH_NODE_CRDS_X",attribs,0,1,crds) == false) success = false;
-      if (vlsvWriter.writeArray("MESH_NODE_CRDS_Y",attribs,0,1,crds) == false) success = false;
-      if (vlsvWriter.writeArray("MESH_NODE_CRDS_Z",attribs,0,1,crds) == false) success = false;
-   }
+   if (writeVelocityMeshBoundingBox(popID,vlsvWriter,mpiGrid.get_rank() == MASTER_RANK) == false) success = false;
 
    // Write velocity block IDs
    vector<vmesh::GlobalID> velocityBlockIds;
@@ -251,7 +266,7 @@ bool writeVelocityDistributionData(const int& popID,Writer& vlsvWriter,
    attribs["name"] = popName;      // Name of the velocity space distribution is written avgs
    const string datatype_avgs = "float";
    const uint64_t arraySize_avgs = totalBlocks;
-   const uint64_t vectorSize_avgs = WID3; // There are 64 elements in every velocity block
+   const uint64_t vectorSize_avgs = WID3; // There are WID3 elements in every velocity block
 
    // Get the data size needed for writing in data
    uint64_t dataSize_avgs = sizeof(Realf);
@@ -269,7 +284,7 @@ bool writeVelocityDistributionData(const int& popID,Writer& vlsvWriter,
       char* arrayToWrite = reinterpret_cast<char*>(SC->get_data(popID));
 
       // Add a subarray to write
-      vlsvWriter.addMultiwriteUnit(arrayToWrite, arrayElements); // Note: We told beforehands that the vectorsize = WID3 = 64
+      vlsvWriter.addMultiwriteUnit(arrayToWrite, arrayElements); // Note: We told beforehands that the vectorsize = WID3
    }
    if (cells.size() == 0) {
       vlsvWriter.addMultiwriteUnit(NULL, 0); //Dummy write to avoid hang in end multiwrite
@@ -289,131 +304,248 @@ bool writeVelocityDistributionData(const int& popID,Writer& vlsvWriter,
    return success;
 }
 
-/*! Writes info received from data reducer. This function writes out the variable arrays into the file
+/*! Reduced data of one data reduction operator, as it is written into the VARIABLE array of the file.
+ \sa reduceDataReducers writeReducedVariable
+ */
+struct ReducedVariable {
+   map<string,string> attribs;
+   string dataType;
+   uint64_t arraySize;
+   uint32_t vectorSize;
+   uint32_t dataSize;
+   vector<char> data;
+};
+
+/*! Computes the reduced data of the given data reduction operators of a data reducer for the given cells, converting 
+ * it to floats if requested. The operators are applied to all cells in one batch, so that operators computed from the 
+ * velocity space share one threaded pass over the velocity blocks.
  \param mpiGrid The Vlasiator's grid
  \param cells List of local cells (no ghost cells included)
- \param writeAsFloat If true, the data reducer writes variable arrays as float instead of double
+ \param writeAsFloat If true, double precision variables are converted to float
  \param dataReducer The data reducer which contains the necessary functions for calculating variables
- \param dataReducerIndex Index in the data reducer (determines which variable to read) Note: size of the data reducer can be retrieved with dataReducer.size()
- \param vlsvWriter Some vlsv writer with a file open
+ \param meshName Name of the mesh the variables are written on
+ \param reducedIDs IDs of the reduced operators, none of them may handle its own writing
+ \param variables The reduced data and array description of each operator, in data reducer order. Only the entries 
+ of the reduced operators are written.
  \return Returns true if operation was successful
  */
-bool writeDataReducer(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-                      const std::vector<CellID>& cells,
-                      const bool writeAsFloat,
-                      DataReducer& dataReducer,
-                      int dataReducerIndex,
-                      Writer& vlsvWriter){
-   map<string,string> attribs;
-   string variableName,dataType;
-   bool success=true;
-
-   const string meshName = "SpatialGrid";
-
-   // If the DataReducer can write its data directly to the output file, do it here.
-   // Otherwise the output data is buffered and written below.
-   if (dataReducer.handlesWriting(dataReducerIndex) == true) {
-      return dataReducer.writeData(dataReducerIndex,mpiGrid,cells,meshName,vlsvWriter);
-   }
-
-   //Get basic data on a variable:
-   uint dataSize,vectorSize;
-   attribs["mesh"] = meshName;
-   variableName = dataReducer.getName(dataReducerIndex);
-   attribs["name"] = variableName;
-   if (dataReducer.getDataVectorInfo(dataReducerIndex,dataType,dataSize,vectorSize) == false) {
-      cerr << "ERROR when requesting info from DRO " << dataReducerIndex << endl;
-      return false;
+bool reduceDataReducers(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                        const std::vector<CellID>& cells,
+                        const bool writeAsFloat,
+                        DataReducer& dataReducer,
+                        const string& meshName,
+                        const vector<unsigned int>& reducedIDs,
+                        vector<ReducedVariable>& variables) {
+   variables.resize(dataReducer.size());
+   
+   vector<unsigned int> operatorIDs;
+   vector<char*> buffers;
+   vector<vector<char> > varBuffers(dataReducer.size());
+   for (size_t r=0; r<reducedIDs.size(); ++r) {
+      const uint i = reducedIDs[r];
+      
+      //Get basic data on a variable:
+      uint dataSize,vectorSize;
+      string dataType;
+      ReducedVariable& variable = variables[i];
+      variable.attribs["mesh"] = meshName;
+      variable.attribs["name"] = dataReducer.getName(i);
+      if (dataReducer.getDataVectorInfo(i,dataType,dataSize,vectorSize) == false) {
+         cerr << "ERROR when requesting info from DRO " << i << endl;
+         return false;
+      }
+      variable.dataType = dataType;
+      variable.arraySize = cells.size();
+      variable.vectorSize = vectorSize;
+      variable.dataSize = dataSize;
+      
+      try {
+         varBuffers[i].resize(cells.size()*vectorSize*dataSize);
+      } catch( bad_alloc& ) {
+         cerr << "ERROR, FAILED TO ALLOCATE MEMORY AT: " << __FILE__ << " " << __LINE__ << endl;
+         logFile << "(MAIN) writeGrid: ERROR FAILED TO ALLOCATE MEMORY AT: " << __FILE__ << " " << __LINE__ << endl << writeVerbose;
+         return false;
+      }
+      operatorIDs.push_back(i);
+      buffers.push_back(varBuffers[i].data());
    }
 
-   const uint64_t varBufferArraySize = cells.size()*vectorSize*dataSize;
-   
-   //Request DataReductionOperator to calculate the reduced data for all local cells:
-   char* varBuffer = NULL;
-   try {
-      varBuffer = new char[varBufferArraySize];
-   } catch( bad_alloc& ) {
-      cerr << "ERROR, FAILED TO ALLOCATE MEMORY AT: " << __FILE__ << " " << __LINE__ << endl;
-      logFile << "(MAIN) writeGrid: ERROR FAILED TO ALLOCATE MEMORY AT: " << __FILE__ << " " << __LINE__ << endl << writeVerbose;
+   //Request the DataReductionOperators to calculate the reduced data for all local cells:
+   vector<const SpatialCell*> cellPointers(cells.size());
+   for (size_t cell=0; cell<cells.size(); ++cell) cellPointers[cell] = mpiGrid[cells[cell]];
+   if (dataReducer.reduceData(cellPointers,operatorIDs,buffers) == false) {
+      logFile << "(MAIN) writeGrid: ERROR a datareductionoperator returned false!" << endl << writeVerbose;
       return false;
    }
 
-   for (size_t cell=0; cell<cells.size(); ++cell) {
-      //Reduce data ( return false if the operation fails )
-      if (dataReducer.reduceData(mpiGrid[cells[cell]],dataReducerIndex,varBuffer + cell*vectorSize*dataSize) == false){
-         success = false;
-         logFile << "(MAIN) writeGrid: ERROR datareductionoperator '" << dataReducer.getName(dataReducerIndex) <<
-            "' returned false!" << endl << writeVerbose;
-      }
-   }
-   if( success ) {
-      if( (writeAsFloat == true && dataType.compare("float") == 0) && dataSize == sizeof(double) ) {
-         double * varBuffer_double = reinterpret_cast<double*>(varBuffer);
+   for (size_t op=0; op<operatorIDs.size(); ++op) {
+      ReducedVariable& variable = variables[operatorIDs[op]];
+      vector<char>& varBuffer = varBuffers[operatorIDs[op]];
+      if( (writeAsFloat == true && variable.dataType.compare("float") == 0) && variable.dataSize == sizeof(double) ) {
+         const double * varBuffer_double = reinterpret_cast<const double*>(varBuffer.data());
          //Declare smaller varbuffer:
-         const uint64_t arraySize_smaller = cells.size();
-         const uint32_t vectorSize_smaller = vectorSize;
-         const uint32_t dataSize_smaller = sizeof(float);
-         const string dataType_smaller = dataType;
-         float * varBuffer_smaller = NULL;
+         variable.dataSize = sizeof(float);
          try {
-            varBuffer_smaller = new float[arraySize_smaller * vectorSize_smaller];
+            variable.data.resize(cells.size() * variable.vectorSize * sizeof(float));
          } catch( bad_alloc& ) {
             cerr << "ERROR, FAILED TO ALLOCATE MEMORY AT: " << __FILE__ << " " << __LINE__ << endl;
             logFile << "(MAIN) writeGrid: ERROR FAILED TO ALLOCATE MEMORY AT: " << __FILE__ << " " << __LINE__ << endl << writeVerbose;
-            delete[] varBuffer;
-            varBuffer = NULL;
             return false;
          }
          //Input varBuffer_double into varBuffer_smaller:
-         for( uint64_t i = 0; i < arraySize_smaller * vectorSize_smaller; ++i ) {
-            const double value = varBuffer_double[i];
-            varBuffer_smaller[i] = (float)(value);
+         float * varBuffer_smaller = reinterpret_cast<float*>(variable.data.data());
+         for( uint64_t i = 0; i < cells.size() * variable.vectorSize; ++i ) {
+            varBuffer_smaller[i] = (float)(varBuffer_double[i]);
          }
-         //Cast the varBuffer to char:
-         char * varBuffer_smaller_char = reinterpret_cast<char*>(varBuffer_smaller);
-         //Write the array:
-         if (vlsvWriter.writeArray("VARIABLE", attribs, dataType_smaller, arraySize_smaller, vectorSize_smaller, dataSize_smaller, varBuffer_smaller_char) == false) {
-            success = false;
-            logFile << "(MAIN) writeGrid: ERROR failed to write datareductionoperator data to file!" << endl << writeVerbose;
-         }
-         delete[] varBuffer_smaller;
-         varBuffer_smaller = NULL;
+         vector<char>().swap(varBuffer);
       } else {
-         // Write  reduced data to file if DROP was successful:
-         if (vlsvWriter.writeArray("VARIABLE",attribs, dataType, cells.size(), vectorSize, dataSize, varBuffer) == false) {
-            success = false;
-            logFile << "(MAIN) writeGrid: ERROR failed to write datareductionoperator data to file!" << endl << writeVerbose;
-         }
+         variable.data.swap(varBuffer);
       }
    }
+   return true;
+}
+
+/*! Computes the reduced data of all data reduction operators of a data reducer for the given cells.
+ \sa reduceDataReducers
+ \param variables The reduced data and array description of each operator, in data reducer order. Entries of operators 
+ that handle their own writing are left empty.
+ */
+bool reduceDataReducers(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                        const std::vector<CellID>& cells,
+                        const bool writeAsFloat,
+                        DataReducer& dataReducer,
+                        const string& meshName,
+                        vector<ReducedVariable>& variables) {
+   variables.clear();
+   vector<unsigned int> reducedIDs;
+   for (uint i=0; i<dataReducer.size(); ++i) {
+      if (dataReducer.handlesWriting(i) == false) reducedIDs.push_back(i);
+   }
+   return reduceDataReducers(mpiGrid,cells,writeAsFloat,dataReducer,meshName,reducedIDs,variables);
+}
+
+/*! Writes reduced data into the file
+ \param variable The reduced data of one data reduction operator
+ \param vlsvWriter Some vlsv writer with a file open
+ \return Returns true if operation was successful
+ \sa reduceDataReducers
+ */
+bool writeReducedVariable(ReducedVariable& variable,Writer& vlsvWriter) {
+   if (vlsvWriter.writeArray("VARIABLE",variable.attribs,variable.dataType,variable.arraySize,variable.vectorSize,variable.dataSize,variable.data.data()) == false) {
+      logFile << "(MAIN) writeGrid: ERROR failed to write datareductionoperator data to file!" << endl << writeVerbose;
+      return false;
+   }
+   return true;
+}
 
-   delete[] varBuffer;
-   varBuffer = NULL;
+/*! Largest amount of reduced data per cell held in memory by writeDataReducers. The batch boundaries only 
+ * depend on the operators, so all processes write the variables in the same order.*/
+static const uint64_t MAX_REDUCED_BATCH_BYTES_PER_CELL = 32*sizeof(double);
+
+/*! Reduces a batch of data reduction operators, writes their variables into the file and frees the reduced data.
+ \param batch IDs of the operators in the batch, the batch is emptied
+ \param variables Reduced data of the operators, indexed by operator ID
+ \sa reduceDataReducers writeReducedVariable
+ */
+static bool writeReducedBatch(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                              const std::vector<CellID>& cells,
+                              const bool writeAsFloat,
+                              DataReducer& dataReducer,
+                              const string& meshName,
+                              vector<unsigned int>& batch,
+                              vector<ReducedVariable>& variables,
+                              Writer& vlsvWriter) {
+   if (batch.size() == 0) return true;
+   if (reduceDataReducers(mpiGrid,cells,writeAsFloat,dataReducer,meshName,batch,variables) == false) return false;
+
+   bool success = true;
+   for (size_t b=0; b<batch.size(); ++b) {
+      if (writeReducedVariable(variables[batch[b]],vlsvWriter) == false) success = false;
+      vector<char>().swap(variables[batch[b]].data);
+   }
+   batch.clear();
    return success;
 }
 
+/*! Writes info received from data reducer. This function writes out the variable arrays of all data reduction operators 
+ * into the file. Each variable is written as soon as it has been reduced, except that operators computed from velocity 
+ * space sums are reduced in batches of at most MAX_REDUCED_BATCH_BYTES_PER_CELL per cell, so that they share one pass 
+ * over the velocity blocks.
+ \param mpiGrid The Vlasiator's grid
+ \param cells List of local cells (no ghost cells included)
+ \param writeAsFloat If true, the data reducer writes variable arrays as float instead of double
+ \param dataReducer The data reducer which contains the necessary functions for calculating variables
+ \param vlsvWriter Some vlsv writer with a file open
+ \return Returns true if operation was successful
+ */
+bool writeDataReducers(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                       const std::vector<CellID>& cells,
+                       const bool writeAsFloat,
+                       DataReducer& dataReducer,
+                       Writer& vlsvWriter){
+   const string meshName = "SpatialGrid";
+
+   bool success = true;
+   vector<ReducedVariable> variables(dataReducer.size());
+   vector<unsigned int> batch;
+   vector<unsigned int> velocityBatch;
+   uint64_t velocityBatchBytes = 0;
+   for (uint i=0; i<dataReducer.size(); ++i) {
+      // If the DataReducer can write its data directly to the output file, do it here.
+      if (dataReducer.handlesWriting(i) == true) {
+         if (dataReducer.writeData(i,mpiGrid,cells,meshName,vlsvWriter) == false) success = false;
+         continue;
+      }
+
+      if (dataReducer.usesVelocitySpaceSums(i) == false) {
+         batch.push_back(i);
+         if (writeReducedBatch(mpiGrid,cells,writeAsFloat,dataReducer,meshName,batch,variables,vlsvWriter) == false) return false;
+         continue;
+      }
+
+      string dataType;
+      uint dataSize,vectorSize;
+      if (dataReducer.getDataVectorInfo(i,dataType,dataSize,vectorSize) == false) {
+         cerr << "ERROR when requesting info from DRO " << i << endl;
+         return false;
+      }
+      if (velocityBatch.size() > 0 && velocityBatchBytes + dataSize*vectorSize > MAX_REDUCED_BATCH_BYTES_PER_CELL) {
+         if (writeReducedBatch(mpiGrid,cells,writeAsFloat,dataReducer,meshName,velocityBatch,variables,vlsvWriter) == false) return false;
+         velocityBatchBytes = 0;
+      }
+      velocityBatch.push_back(i);
+      velocityBatchBytes += dataSize*vectorSize;
+   }
+   if (writeReducedBatch(mpiGrid,cells,writeAsFloat,dataReducer,meshName,velocityBatch,variables,vlsvWriter) == false) return false;
+   return success;
+}
 
 
 
+
+/*! Simulation state written as parameters into an output file. Taken from Parameters when the output is started,
+ * so that files staged for the background writer record the time step they were produced at.
+ */
+struct OutputParameters {
+   Real t;
+   Real dt;
+   uint tstep;
+   int fieldSolverSubcycles;
+   uint fileIndex;
+};
+
 /*! Writes common grid data such as parameters (time steps, x_min, ..) as well as local cell ids as variables
  \param vlsvWriter Some vlsv writer with a file open
- \param mpiGrid Vlasiator's grid
  \param local_cells The local cell ids in this process
- \param fileIndex File index, file will be called "name.index.vlsv"
- \param comm The MPI comm
+ \param parameters Simulation state to write, fileIndex is the index of the file "name.index.vlsv"
  \return Returns true if operation was successful
  */
 bool writeCommonGridData(
    Writer& vlsvWriter,
-   dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    const vector<uint64_t>& local_cells,
-   const uint& fileIndex,
-   MPI_Comm comm
+   OutputParameters parameters
 ) {
    // Writes parameters and cell ids into the VLSV file
-   int myRank;
-   MPI_Comm_rank(comm, &myRank);
-   const int masterProcessId = 0;
    //Write local cells into array as a variable:
    //Note: This needs to be done separately from the array MESH
    const short unsigned int vectorSize = 1;
@@ -426,11 +558,11 @@ bool writeCommonGridData(
    }
 
    //Write parameters:
-   if( vlsvWriter.writeParameter("time", &P::t) == false ) { return false; }
-   if( vlsvWriter.writeParameter("dt", &P::dt) == false ) { return false; }
-   if( vlsvWriter.writeParameter("timestep", &P::tstep) == false ) { return false; }
-   if( vlsvWriter.writeParameter("fieldSolverSubcycles", &P::fieldSolverSubcycles) == false ) { return false; }
-   if( vlsvWriter.writeParameter("fileIndex", &fileIndex) == false ) { return false; }
+   if( vlsvWriter.writeParameter("time", &parameters.t) == false ) { return false; }
+   if( vlsvWriter.writeParameter("dt", &parameters.dt) == false ) { return false; }
+   if( vlsvWriter.writeParameter("timestep", &parameters.tstep) == false ) { return false; }
+   if( vlsvWriter.writeParameter("fieldSolverSubcycles", &parameters.fieldSolverSubcycles) == false ) { return false; }
+   if( vlsvWriter.writeParameter("fileIndex", &parameters.fileIndex) == false ) { return false; }
    if( vlsvWriter.writeParameter("xmin", &P::xmin) == false ) { return false; }
    if( vlsvWriter.writeParameter("xmax", &P::xmax) == false ) { return false; }
    if( vlsvWriter.writeParameter("ymin", &P::ymin) == false ) { return false; }
@@ -459,22 +591,39 @@ bool writeCommonGridData(
    return true; 
 }
 
-/*! Writes ghost cell ids into the file
- \param mpiGrid Vlasiator's grid
+/*! Writes common grid data such as parameters (time steps, x_min, ..) as well as local cell ids as variables
  \param vlsvWriter Some vlsv writer with a file open
- \param meshName Name of the mesh (If unsure, put SpatialGrid)
- \param ghost_cells List of cell ids on the process boundary (Ghost cells)
+ \param mpiGrid Vlasiator's grid
+ \param local_cells The local cell ids in this process
+ \param fileIndex File index, file will be called "name.index.vlsv"
+ \param comm The MPI comm
  \return Returns true if operation was successful
+ */
+bool writeCommonGridData(
+   Writer& vlsvWriter,
+   dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+   const vector<uint64_t>& local_cells,
+   const uint& fileIndex,
+   MPI_Comm comm
+) {
+   const OutputParameters parameters = {P::t,P::dt,P::tstep,P::fieldSolverSubcycles,fileIndex};
+   return writeCommonGridData(vlsvWriter,local_cells,parameters);
+}
+
+/*! Collects the owning ranks and the local ids in the owning ranks of ghost cells
+ \param mpiGrid Vlasiator's grid
+ \param ghost_cells List of cell ids on the process boundary (Ghost cells)
+ \param ghostDomainIds Ranks owning the ghost cells
+ \param ghostLocalIds Local ids of the ghost cells in their owning processes
  \sa updateLocalIds
  */
-bool writeGhostZoneDomainAndLocalIdNumbers( dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-                                              Writer & vlsvWriter,
-                                              const string & meshName,
-                                              const vector<uint64_t> & ghost_cells ) {
-   //Declare vectors for storing data
-   vector<uint64_t> ghostDomainIds;
+void getGhostZoneDomainAndLocalIdNumbers( dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                          const vector<uint64_t> & ghost_cells,
+                                          vector<uint64_t> & ghostDomainIds,
+                                          vector<uint64_t> & ghostLocalIds ) {
+   ghostDomainIds.clear();
    ghostDomainIds.reserve( ghost_cells.size() );
-   vector<uint64_t> ghostLocalIds;
+   ghostLocalIds.clear();
    ghostLocalIds.reserve( ghost_cells.size() );
 
    //Iterate through all ghost zones:
@@ -499,9 +648,22 @@ bool writeGhostZoneDomainAndLocalIdNumbers( dccrg::Dccrg<SpatialCell,dccrg::Cart
       ghostDomainIds.push_back( mpiGrid.get_process( *it ) );
       ghostLocalIds.push_back( mpiGrid[(*it)]->ioLocalCellId );
    }
+}
 
+/*! Writes ghost cell domain and local ids into the file
+ \param vlsvWriter Some vlsv writer with a file open
+ \param meshName Name of the mesh (If unsure, put SpatialGrid)
+ \param ghostDomainIds Ranks owning the ghost cells
+ \param ghostLocalIds Local ids of the ghost cells in their owning processes
+ \return Returns true if operation was successful
+ \sa getGhostZoneDomainAndLocalIdNumbers
+ */
+bool writeGhostZoneDomainAndLocalIdNumbers( Writer & vlsvWriter,
+                                            const string & meshName,
+                                            const vector<uint64_t> & ghostDomainIds,
+                                            const vector<uint64_t> & ghostLocalIds ) {
    //We need the number of ghost zones for vlsvWriter:
-   uint64_t numberOfGhosts = ghost_cells.size();
+   uint64_t numberOfGhosts = ghostDomainIds.size();
 
    //Write:
    map<string, string> xmlAttributes; //Used for writing in info
@@ -524,6 +686,24 @@ bool writeGhostZoneDomainAndLocalIdNumbers( dccrg::Dccrg<SpatialCell,dccrg::Cart
    return true;
 }
 
+/*! Writes ghost cell ids into the file
+ \param mpiGrid Vlasiator's grid
+ \param vlsvWriter Some vlsv writer with a file open
+ \param meshName Name of the mesh (If unsure, put SpatialGrid)
+ \param ghost_cells List of cell ids on the process boundary (Ghost cells)
+ \return Returns true if operation was successful
+ \sa updateLocalIds
+ */
+bool writeGhostZoneDomainAndLocalIdNumbers( dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                            Writer & vlsvWriter,
+                                            const string & meshName,
+                                            const vector<uint64_t> & ghost_cells ) {
+   vector<uint64_t> ghostDomainIds;
+   vector<uint64_t> ghostLocalIds;
+   getGhostZoneDomainAndLocalIdNumbers( mpiGrid, ghost_cells, ghostDomainIds, ghostLocalIds );
+   return writeGhostZoneDomainAndLocalIdNumbers( vlsvWriter, meshName, ghostDomainIds, ghostLocalIds );
+}
+
 
 /*! Writes domain sizes into the vlsv file, so the number of ghost and local cell ids in this process
  \param vlsvWriter Some vlsv writer with a file open
@@ -559,19 +739,21 @@ bool writeDomainSizes( Writer & vlsvWriter,
 
 
 
-/*! Writes the zone global id numbers into the file. The vlsv file needs to know in which order the local cells + ghost cells are written. Local cells are first appended to a vector called global ids, after which the ghost cells are appended. The global ids vector will then be saved into a vlsv file
+/*! Computes the zone global id numbers and the attributes of the mesh. The vlsv file needs to know in which order the local cells + ghost cells are written. Local cells are first appended to a vector called global ids, after which the ghost cells are appended.
  \param mpiGrid Vlasiator's MPI grid
- \param vlsvWriter Some vlsv writer with a file open
  \param meshName Name of the mesh ("SpatialGrid" used in the writeGrid function and it should be the default)
  \param local_cells Vector containing the local cells of this process
  \param ghost_cells Vector containing the ghost cells of this process ( The cells on process boundary )
+ \param globalIds Global ids of local cells followed by those of ghost cells
+ \param xmlAttributes Attributes of the mesh
  \return Returns true if the operation was successful
  */
-bool writeZoneGlobalIdNumbers( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-                                 Writer & vlsvWriter,
-                                 const string & meshName,
-                                 const vector<uint64_t> & local_cells,
-                                 const vector<uint64_t> & ghost_cells ) {
+bool getZoneGlobalIdNumbers( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                             const string & meshName,
+                             const vector<uint64_t> & local_cells,
+                             const vector<uint64_t> & ghost_cells,
+                             vector<uint64_t> & globalIds,
+                             map<string, string> & xmlAttributes ) {
    if( local_cells.empty() ) {
       if( !ghost_cells.empty() ) {
          //Something very wrong -- local zones should always have members when ghost zones has members
@@ -585,7 +767,7 @@ bool writeZoneGlobalIdNumbers( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_G
    const unsigned int yCells = P::ycells_ini;
    const unsigned int zCells = P::zcells_ini;
 
-   vector<uint64_t> globalIds;
+   globalIds.clear();
    globalIds.reserve( local_cells.size() + ghost_cells.size() );
 
    //Iterate through local_cells and store the values into globalIDs
@@ -610,11 +792,8 @@ bool writeZoneGlobalIdNumbers( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_G
       globalIds.push_back( (*it) - 1 );
    }
 
-   //Get the total number of zones:
-   const uint64_t numberOfZones = globalIds.size();
-
-   //Write the array:
-   map<string, string> xmlAttributes;
+   //Mesh attributes:
+   xmlAttributes.clear();
    //The name of the mesh (user input -- should be "SpatialGrid")
    xmlAttributes["name"] = meshName;
    //A mandatory 'type' -- just something visit hopefully understands, because I dont (some of us do!) :)
@@ -624,6 +803,22 @@ bool writeZoneGlobalIdNumbers( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_G
    if( mpiGrid.topology.is_periodic( 0 ) ) { xmlAttributes["xperiodic"] = "yes"; } else { xmlAttributes["xperiodic"] = "no"; }
    if( mpiGrid.topology.is_periodic( 1 ) ) { xmlAttributes["yperiodic"] = "yes"; } else { xmlAttributes["yperiodic"] = "no"; }
    if( mpiGrid.topology.is_periodic( 2 ) ) { xmlAttributes["zperiodic"] = "yes"; } else { xmlAttributes["zperiodic"] = "no"; }
+   return true;
+}
+
+/*! Writes the MESH array of zone global id numbers into the file
+ \param vlsvWriter Some vlsv writer with a file open
+ \param globalIds Global ids of local cells followed by those of ghost cells
+ \param xmlAttributes Attributes of the mesh
+ \return Returns true if the operation was successful
+ \sa getZoneGlobalIdNumbers
+ */
+bool writeZoneGlobalIdNumbers( Writer & vlsvWriter,
+                               const vector<uint64_t> & globalIds,
+                               const map<string, string> & xmlAttributes ) {
+   //Get the total number of zones:
+   const uint64_t numberOfZones = globalIds.size();
+
    //Write:
    if( numberOfZones == 0 ) {
       const uint64_t dummy_data = 0;
@@ -642,6 +837,25 @@ bool writeZoneGlobalIdNumbers( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_G
    return true;
 }
 
+/*! Writes the zone global id numbers into the file. The vlsv file needs to know in which order the local cells + ghost cells are written. Local cells are first appended to a vector called global ids, after which the ghost cells are appended. The global ids vector will then be saved into a vlsv file
+ \param mpiGrid Vlasiator's MPI grid
+ \param vlsvWriter Some vlsv writer with a file open
+ \param meshName Name of the mesh ("SpatialGrid" used in the writeGrid function and it should be the default)
+ \param local_cells Vector containing the local cells of this process
+ \param ghost_cells Vector containing the ghost cells of this process ( The cells on process boundary )
+ \return Returns true if the operation was successful
+ */
+bool writeZoneGlobalIdNumbers( const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                               Writer & vlsvWriter,
+                               const string & meshName,
+                               const vector<uint64_t> & local_cells,
+                               const vector<uint64_t> & ghost_cells ) {
+   vector<uint64_t> globalIds;
+   map<string, string> xmlAttributes;
+   if( getZoneGlobalIdNumbers( mpiGrid, meshName, local_cells, ghost_cells, globalIds, xmlAttributes ) == false ) return false;
+   return writeZoneGlobalIdNumbers( vlsvWriter, globalIds, xmlAttributes );
+}
+
 /*! Writes the node coordinates. This means basically every cell's node (Corner of each cell). Note: The grid is a structured one, so writing the nodes means starting from the corner of the grid and writing coordinates per every cell length until reaching the other corner of the grid
  \param vlsvWriter Some vlsv writer with a file open
  \param meshName Name of the mesh (SpatialGrid used in writeGrid and should be the default)
@@ -778,6 +992,54 @@ bool writeMeshBoundingBox( Writer & vlsvWriter,
    return success;
 }
 
+/** Selects the local cells whose velocity space is written into the output file of the given write class,
+ * and flags them with CellParams::ISCELLSAVINGF.
+ * @param mpiGrid Vlasiator's grid.
+ * @param index Index to call the correct member of the various parameter vectors.
+ * @param cells Vector containing local cells of this process.
+ * @return Cells of this process which write out their velocity space. */
+vector<uint64_t> getVelocitySpaceCells(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                                       int index,const vector<uint64_t>& cells) {
+   //Compute which cells will write out their velocity space
+   vector<uint64_t> velSpaceCells;
+   int lineX, lineY, lineZ;
+   for (uint i = 0; i < cells.size(); i++) {
+      mpiGrid[cells[i]]->parameters[CellParams::ISCELLSAVINGF] = 0.0;
+      // CellID stride selection
+      if (P::systemWriteDistributionWriteStride[index] > 0 &&
+          cells[i] % P::systemWriteDistributionWriteStride[index] == 0) {
+         velSpaceCells.push_back(cells[i]);
+         mpiGrid[cells[i]]->parameters[CellParams::ISCELLSAVINGF] = 1.0;
+         continue; // Avoid double entries in case the cell also matches following conditions.
+      }
+      // Cell lines selection
+      // Determine cellID's 3D indices
+      lineX =  (cells[i]-1) % P::xcells_ini;
+      lineY = ((cells[i]-1) / P::xcells_ini) % P::ycells_ini;
+      lineZ = ((cells[i]-1) /(P::xcells_ini *  P::ycells_ini)) % P::zcells_ini;
+      // Check that indices are in correct intersection at least in one plane
+      if ((P::systemWriteDistributionWriteXlineStride[index] > 0 &&
+           P::systemWriteDistributionWriteYlineStride[index] > 0 &&
+           lineX % P::systemWriteDistributionWriteXlineStride[index] == 0 &&
+           lineY % P::systemWriteDistributionWriteYlineStride[index] == 0)
+          &&
+          (P::systemWriteDistributionWriteYlineStride[index] > 0 &&
+           P::systemWriteDistributionWriteZlineStride[index] > 0 &&
+           lineY % P::systemWriteDistributionWriteYlineStride[index] == 0 &&
+           lineZ % P::systemWriteDistributionWriteZlineStride[index] == 0)
+          &&
+          (P::systemWriteDistributionWriteZlineStride[index] > 0 &&
+           P::systemWriteDistributionWriteXlineStride[index] > 0 &&
+           lineZ % P::systemWriteDistributionWriteZlineStride[index] == 0 &&
+           lineX % P::systemWriteDistributionWriteXlineStride[index] == 0)
+      ) {
+         velSpaceCells.push_back(cells[i]);
+         mpiGrid[cells[i]]->parameters[CellParams::ISCELLSAVINGF] = 1.0;
+      }
+   }
+   return velSpaceCells;
+}
+
 /** This function writes the velocity space.
  * @param mpiGrid Vlasiator's grid.
  * @param vlsvWriter some vlsv writer with a file open.
@@ -787,43 +1049,7 @@ bool writeMeshBoundingBox( Writer & vlsvWriter,
  * @sa writeVelocityDistributionData. */
 bool writeVelocitySpace(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                         Writer& vlsvWriter,int index,const vector<uint64_t>& cells) {
-      //Compute which cells will write out their velocity space
-      vector<uint64_t> velSpaceCells;
-      int lineX, lineY, lineZ;
-      for (uint i = 0; i < cells.size(); i++) {
-         mpiGrid[cells[i]]->parameters[CellParams::ISCELLSAVINGF] = 0.0;
-         // CellID stride selection
-         if (P::systemWriteDistributionWriteStride[index] > 0 &&
-             cells[i] % P::systemWriteDistributionWriteStride[index] == 0) {
-            velSpaceCells.push_back(cells[i]);
-            mpiGrid[cells[i]]->parameters[CellParams::ISCELLSAVINGF] = 1.0;
-            continue; // Avoid double entries in case the cell also matches following conditions.
-         }
-         // Cell lines selection
-         // Determine cellID's 3D indices
-         lineX =  (cells[i]-1) % P::xcells_ini;
-         lineY = ((cells[i]-1) / P::xcells_ini) % P::ycells_ini;
-         lineZ = ((cells[i]-1) /(P::xcells_ini *  P::ycells_ini)) % P::zcells_ini;
-         // Check that indices are in correct intersection at least in one plane
-         if ((P::systemWriteDistributionWriteXlineStride[index] > 0 &&
-              P::systemWriteDistributionWriteYlineStride[index] > 0 &&
-              lineX % P::systemWriteDistributionWriteXlineStride[index] == 0 &&
-              lineY % P::systemWriteDistributionWriteYlineStride[index] == 0)
-             &&
-             (P::systemWriteDistributionWriteYlineStride[index] > 0 &&
-              P::systemWriteDistributionWriteZlineStride[index] > 0 &&
-              lineY % P::systemWriteDistributionWriteYlineStride[index] == 0 &&
-              lineZ % P::systemWriteDistributionWriteZlineStride[index] == 0)
-             &&
-             (P::systemWriteDistributionWriteZlineStride[index] > 0 &&
-              P::systemWriteDistributionWriteXlineStride[index] > 0 &&
-              lineZ % P::systemWriteDistributionWriteZlineStride[index] == 0 &&
-              lineX % P::systemWriteDistributionWriteXlineStride[index] == 0)
-         ) {
-            velSpaceCells.push_back(cells[i]);
-            mpiGrid[cells[i]]->parameters[CellParams::ISCELLSAVINGF] = 1.0;
-         }
-      }
+      vector<uint64_t> velSpaceCells = getVelocitySpaceCells(mpiGrid,index,cells);
 
       uint64_t numVelSpaceCells;
       uint64_t localNumVelSpaceCells;
@@ -862,6 +1088,418 @@ bool checkForSameMembers( const vector<uint64_t> local_cells, const vector<uint6
 }
 
 
+/*! Logs the amount of data written into an output file and the approximate data rate
+ \param bytesWritten Number of bytes written by the vlsv writer
+ \param writeTime Time in seconds the vlsv writer spent in writing
+ */
+void logWriteRate(const uint64_t& bytesWritten,const double& writeTime) {
+   logFile << "(writeGrid) Wrote ";
+
+   if (bytesWritten > 1.0e9) logFile << bytesWritten/1.0e9 << " GB in ";
+   else if (bytesWritten > 1e6) logFile << bytesWritten/1.0e6 << " MB in ";
+   else if (bytesWritten > 1e3) logFile << bytesWritten/1.0e3 << " kB in ";
+   else logFile << bytesWritten << " B in ";
+
+   logFile << writeTime << " seconds, approximate data rate is ";
+
+   if (bytesWritten/writeTime > 1e9) logFile << bytesWritten/writeTime/1e9 << " GB/s";
+   else if (bytesWritten/writeTime > 1e6) logFile << bytesWritten/writeTime/1e6 << " MB/s";
+   else if (bytesWritten/writeTime > 1e3) logFile << bytesWritten/writeTime/1e3 << " kB/s";
+   else logFile << bytesWritten/writeTime << " B/s";
+   logFile << endl;
+}
+
+/*! Velocity distribution of one particle population in the cells saving their velocity space,
+ * copied out of the grid for the background writer.
+ */
+struct StagedDistribution {
+   vector<uint64_t> cells;
+   vector<vmesh::LocalID> blocksPerCell;
+   vector<vmesh::GlobalID> blockIds;
+   vector<Realf> data;
+};
+
+/*! Contents of one system output file, copied out of the grid by writeGrid so that the file can be
+ * written by the background writer while the simulation advances.
+ */
+struct StagedGridOutput {
+   string fileName;
+   OutputParameters parameters;
+   vector<uint64_t> local_cells;
+   vector<uint64_t> globalIds;
+   map<string,string> meshAttributes;
+   vector<uint64_t> ghostDomainIds;
+   vector<uint64_t> ghostLocalIds;
+   vector<StagedDistribution> distributions; /*!< Indexed by popID.*/
+   vector<ReducedVariable> variables;
+};
+
+/*! Outcome of a background write, logged by the main thread. */
+struct CompletedGridOutput {
+   string fileName;
+   uint64_t bytesWritten;
+   double writeTime;
+   bool success;
+   vector<string> errors;                    /*!< Arrays that could not be written.*/
+};
+
+/*! Writes a staged system output file. Only uses the staged data, so it can run while the grid is modified.
+ * Runs on the writer thread, so failures are only recorded in result and logged later by the main thread.
+ \param output The staged file contents
+ \param comm The MPI comm, all processes have to write the same sequence of files
+ \param result Bytes written, time spent, success of the write and the arrays that failed
+ \sa stageGrid
+ */
+void writeStagedGrid(StagedGridOutput& output,MPI_Comm comm,CompletedGridOutput& result) {
+   int myRank;
+   MPI_Comm_rank(comm,&myRank);
+   const int masterProcessId = 0;
+   const string meshName = "SpatialGrid";
+   bool success = true;
+
+   Writer vlsvWriter;
+   vlsvWriter.open( output.fileName, comm, masterProcessId, MPI_INFO_NULL );
+
+   // Keep going after a failed write so that all processes make the same collective calls
+   if( writeMeshBoundingBox( vlsvWriter, meshName, masterProcessId, comm ) == false ) success = false;
+   if( writeBoundingBoxNodeCoordinates( vlsvWriter, meshName, masterProcessId, comm ) == false ) success = false;
+   if( writeCommonGridData( vlsvWriter, output.local_cells, output.parameters ) == false ) success = false;
+   if( writeZoneGlobalIdNumbers( vlsvWriter, output.globalIds, output.meshAttributes ) == false ) success = false;
+   if (success == false) result.errors.push_back("mesh");
+
+   // Same arrays as writeDomainSizes and writeGhostZoneDomainAndLocalIdNumbers write, without logging
+   map<string,string> meshAttribs;
+   meshAttribs["mesh"] = meshName;
+   uint32_t domainSize[2];
+   domainSize[0] = output.local_cells.size() + output.ghostDomainIds.size();
+   domainSize[1] = output.ghostDomainIds.size();
+   if (vlsvWriter.writeArray("MESH_DOMAIN_SIZES",meshAttribs,1,2,domainSize) == false) result.errors.push_back("MESH_DOMAIN_SIZES");
+   if (vlsvWriter.writeArray("MESH_GHOST_DOMAINS",meshAttribs,output.ghostDomainIds.size(),1,output.ghostDomainIds.data()) == false) {
+      result.errors.push_back("MESH_GHOST_DOMAINS");
+   }
+   if (vlsvWriter.writeArray("MESH_GHOST_LOCALIDS",meshAttribs,output.ghostLocalIds.size(),1,output.ghostLocalIds.data()) == false) {
+      result.errors.push_back("MESH_GHOST_LOCALIDS");
+   }
+
+   // Same arrays as in writeVelocityDistributionData, written from the staged copies
+   for (size_t popID=0; popID<output.distributions.size(); ++popID) {
+      StagedDistribution& distribution = output.distributions[popID];
+      map<string,string> attribs;
+      attribs["name"] = getObjectWrapper().particleSpecies[popID].name;
+      attribs["mesh"] = meshName;
+      bool distributionSuccess = true;
+      if (vlsvWriter.writeArray("CELLSWITHBLOCKS",attribs,distribution.cells.size(),1,distribution.cells.data()) == false) distributionSuccess = false;
+      if (vlsvWriter.writeArray("BLOCKSPERCELL",attribs,distribution.blocksPerCell.size(),1,distribution.blocksPerCell.data()) == false) distributionSuccess = false;
+      if (writeVelocityMeshBoundingBox(popID,vlsvWriter,myRank == masterProcessId) == false) distributionSuccess = false;
+      if (vlsvWriter.writeArray("BLOCKIDS",attribs,distribution.blockIds.size(),1,distribution.blockIds.data()) == false) distributionSuccess = false;
+      if (vlsvWriter.writeArray("BLOCKVARIABLE",attribs,"float",distribution.blockIds.size(),WID3,sizeof(Realf),
+                                reinterpret_cast<char*>(distribution.data.data())) == false) distributionSuccess = false;
+      if (distributionSuccess == false) result.errors.push_back("velocity distribution of " + attribs["name"]);
+   }
+
+   // Same as writeReducedVariable, without logging
+   for (size_t i=0; i<output.variables.size(); ++i) {
+      ReducedVariable& variable = output.variables[i];
+      if (vlsvWriter.writeArray("VARIABLE",variable.attribs,variable.dataType,variable.arraySize,variable.vectorSize,variable.dataSize,
+                                variable.data.data()) == false) {
+         result.errors.push_back("variable " + variable.attribs["name"]);
+      }
+   }
+
+   result.fileName = output.fileName;
+   result.bytesWritten = vlsvWriter.getBytesWritten();
+   result.writeTime = vlsvWriter.getWriteTime();
+   result.success = (result.errors.size() == 0);
+   vlsvWriter.close();
+}
+
+/*! Background writer of system output files. writeGrid stages the contents of a file in memory and hands
+ * them over, a dedicated thread then writes the staged files in order using its own duplicate of
+ * MPI_COMM_WORLD. The number of pending files is bounded, enqueue blocks until a slot is free.
+ */
+class AsyncGridWriter {
+ public:
+   AsyncGridWriter(): started(false),stopping(false),comm(MPI_COMM_NULL),outputs(0),blockedOutputs(0),blockedTime(0.0) { }
+   ~AsyncGridWriter();
+   bool enqueue(StagedGridOutput* output,const size_t& maxPending,double& waitTime);
+   void reportCompleted();
+   void finalize();
+
+ private:
+   void run();
+
+   bool started;
+   bool stopping;
+   MPI_Comm comm;                            /*!< Communicator used by the writer thread.*/
+   std::thread writerThread;
+   std::mutex queueMutex;
+   std::condition_variable queueChanged;
+   std::deque<StagedGridOutput*> pending;    /*!< Staged files, the front one is being written.*/
+   vector<CompletedGridOutput> completed;    /*!< Written files not yet reported in logFile.*/
+   uint outputs;                             /*!< Number of staged files.*/
+   uint blockedOutputs;                      /*!< Number of staged files that had to wait for a free slot.*/
+   double blockedTime;                       /*!< Total time spent waiting for a free slot.*/
+};
+
+static AsyncGridWriter asyncGridWriter;
+
+/*! Queues a staged file for writing. Starts the writer thread on first call, which duplicates MPI_COMM_WORLD and is thus collective.
+ \param output Staged file contents, ownership is passed to the writer
+ \param maxPending Maximum number of files staged or being written
+ \param waitTime Time spent waiting for a free slot
+ \return Returns true if the queue was full and the caller had to wait
+ */
+bool AsyncGridWriter::enqueue(StagedGridOutput* output,const size_t& maxPending,double& waitTime) {
+   if (started == false) {
+      MPI_Comm_dup(MPI_COMM_WORLD,&comm);
+      writerThread = std::thread(&AsyncGridWriter::run,this);
+      started = true;
+   }
+
+   const double waitStart = MPI_Wtime();
+   bool blocked;
+   {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      blocked = pending.size() >= maxPending;
+      queueChanged.wait(lock,[&]{return pending.size() < maxPending;});
+      pending.push_back(output);
+   }
+   queueChanged.notify_all();
+   waitTime = MPI_Wtime() - waitStart;
+
+   ++outputs;
+   if (blocked == true) {
+      ++blockedOutputs;
+      blockedTime += waitTime;
+   }
+   return blocked;
+}
+
+/*! Logs the files written by the writer thread since the previous call. */
+void AsyncGridWriter::reportCompleted() {
+   vector<CompletedGridOutput> done;
+   {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      done.swap(completed);
+   }
+   for (size_t i=0; i<done.size(); ++i) {
+      if (done[i].success == false) {
+         cerr << "FAILED TO WRITE GRID " << done[i].fileName << " IN BACKGROUND WRITER" << endl;
+         logFile << "(writeGrid) ERROR failed to write " << done[i].fileName << " in background writer:";
+         for (size_t e=0; e<done[i].errors.size(); ++e) logFile << " " << done[i].errors[e];
+         logFile << endl << writeVerbose;
+      }
+      logFile << "(writeGrid) Background write of " << done[i].fileName << " finished" << endl;
+      logWriteRate(done[i].bytesWritten,done[i].writeTime);
+   }
+   if (done.size() > 0) logFile << writeVerbose;
+}
+
+/*! Waits until all staged files have been written, then stops the writer thread and frees its communicator. */
+void AsyncGridWriter::finalize() {
+   if (started == false) return;
+   {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      stopping = true;
+   }
+   queueChanged.notify_all();
+   writerThread.join();
+   MPI_Comm_free(&comm);
+   started = false;
+   stopping = false;
+
+   reportCompleted();
+   logFile << "(writeGrid) Background writer wrote " << outputs << " files, " << blockedOutputs
+           << " of them waited for a free slot for a total of " << blockedTime << " s" << endl << writeVerbose;
+}
+
+/*! Stops the writer thread if finalize was not called, e.g., on an early exit. Files that have
+ * not been started are dropped and nothing is logged, as logFile may already be closed.
+ */
+AsyncGridWriter::~AsyncGridWriter() {
+   if (started == false) return;
+   {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      stopping = true;
+      while (pending.size() > 1) {
+         delete pending.back();
+         pending.pop_back();
+      }
+   }
+   queueChanged.notify_all();
+   writerThread.join();
+   int finalized;
+   MPI_Finalized(&finalized);
+   if (finalized == false) MPI_Comm_free(&comm);
+}
+
+void AsyncGridWriter::run() {
+   while (true) {
+      StagedGridOutput* output;
+      {
+         std::unique_lock<std::mutex> lock(queueMutex);
+         queueChanged.wait(lock,[this]{return stopping == true || pending.empty() == false;});
+         if (pending.empty() == true) return;
+         output = pending.front();
+      }
+
+      CompletedGridOutput result;
+      writeStagedGrid(*output,comm,result);
+      delete output;
+
+      {
+         std::lock_guard<std::mutex> lock(queueMutex);
+         pending.pop_front();
+         completed.push_back(result);
+      }
+      queueChanged.notify_all();
+   }
+}
+
+/*! Checks whether system output files can be handed over to the background writer. Gives the same answer on all processes.
+ \param dataReducer Contains datareductionoperators that are used to compute data that is added into file
+ \return Returns true if writeGrid should stage the file for the background writer
+ */
+bool useAsyncGridWriter(DataReducer* dataReducer) {
+   static bool reported = false;
+   if (P::asyncWriteQueueDepth == 0) return false;
+
+   string reason;
+   int threadSupport;
+   MPI_Query_thread(&threadSupport);
+   if (threadSupport < MPI_THREAD_MULTIPLE) reason = "MPI does not provide MPI_THREAD_MULTIPLE";
+   // Operators writing their own output need an open file, they cannot be staged
+   if (dataReducer != NULL) for (uint i=0; i<dataReducer->size(); ++i) {
+      if (dataReducer->handlesWriting(i) == true) {
+         reason = "data reducer " + dataReducer->getName(i) + " writes its own output";
+         break;
+      }
+   }
+   if (reason.size() == 0) return true;
+
+   if (reported == false) {
+      logFile << "(writeGrid) io.async_write_queue_depth ignored, " << reason << ". Writing synchronously." << endl << writeVerbose;
+      reported = true;
+   }
+   return false;
+}
+
+/*! Copies everything writeGrid writes into memory
+ \param mpiGrid     The DCCRG grid with spatial cells
+ \param dataReducer Contains datareductionoperators that are used to compute data that is added into file
+ \param index       Index to call the correct member of the various parameter vectors
+ \param writeGhosts If true, writes out ghost cells (cells that exist on the process boundary so other process' cells)
+ \param output      The staged file contents
+ \return Returns true if operation was successful
+ \sa writeStagedGrid
+ */
+bool stageGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+               DataReducer* dataReducer,
+               const uint& index,
+               const bool writeGhosts,
+               StagedGridOutput& output) {
+   const string meshName = "SpatialGrid";
+
+   stringstream fname;
+   fname << P::systemWritePath.at(index) << "/" << P::systemWriteName.at(index) << ".";
+   fname.width(7);
+   fname.fill('0');
+   fname << P::systemWrites.at(index) << ".vlsv";
+   output.fileName = fname.str();
+   const OutputParameters parameters = {P::t,P::dt,P::tstep,P::fieldSolverSubcycles,(uint)P::systemWrites[index]};
+   output.parameters = parameters;
+
+   phiprof::start("metadata");
+   output.local_cells = getLocalCells();
+   vector<CellID> ghost_cells;
+   if( writeGhosts ) {
+      ghost_cells = mpiGrid.get_remote_cells_on_process_boundary( NEAREST_NEIGHBORHOOD_ID );
+   }
+   if( getZoneGlobalIdNumbers( mpiGrid, meshName, output.local_cells, ghost_cells, output.globalIds, output.meshAttributes ) == false ) return false;
+   if( updateLocalIds( mpiGrid, output.local_cells, MPI_COMM_WORLD ) == false ) return false;
+   getGhostZoneDomainAndLocalIdNumbers( mpiGrid, ghost_cells, output.ghostDomainIds, output.ghostLocalIds );
+   phiprof::stop("metadata");
+
+   phiprof::start("velocityspace");
+   const vector<uint64_t> velSpaceCells = getVelocitySpaceCells( mpiGrid, index, output.local_cells );
+   output.distributions.resize(getObjectWrapper().particleSpecies.size());
+   for (size_t popID=0; popID<output.distributions.size(); ++popID) {
+      StagedDistribution& distribution = output.distributions[popID];
+      distribution.cells = velSpaceCells;
+      uint64_t totalBlocks = 0;
+      for (size_t cell=0; cell<velSpaceCells.size(); ++cell) {
+         const vmesh::LocalID nBlocks = mpiGrid[velSpaceCells[cell]]->get_number_of_velocity_blocks(popID);
+         distribution.blocksPerCell.push_back(nBlocks);
+         totalBlocks += nBlocks;
+      }
+      try {
+         distribution.blockIds.reserve(totalBlocks);
+         distribution.data.reserve(totalBlocks*WID3);
+      } catch( bad_alloc& ) {
+         cerr << "ERROR, FAILED TO ALLOCATE MEMORY AT: " << __FILE__ << " " << __LINE__ << endl;
+         logFile << "(MAIN) writeGrid: ERROR FAILED TO ALLOCATE MEMORY AT: " << __FILE__ << " " << __LINE__ << endl << writeVerbose;
+         return false;
+      }
+      for (size_t cell=0; cell<velSpaceCells.size(); ++cell) {
+         SpatialCell* SC = mpiGrid[velSpaceCells[cell]];
+         for (vmesh::LocalID block_i=0; block_i<SC->get_number_of_velocity_blocks(popID); ++block_i) {
+            distribution.blockIds.push_back(SC->get_velocity_block_global_id(block_i,popID));
+         }
+         const Realf* data = SC->get_data(popID);
+         distribution.data.insert(distribution.data.end(),data,data+SC->get_number_of_velocity_blocks(popID)*WID3);
+      }
+   }
+   phiprof::stop("velocityspace");
+
+   phiprof::start("reduceddata");
+   if (dataReducer != NULL) {
+      if( reduceDataReducers( mpiGrid, output.local_cells, (P::writeAsFloat==1), *dataReducer, meshName, output.variables ) == false ) return false;
+   }
+   phiprof::stop("reduceddata");
+   return true;
+}
+
+/*! Writes the system through the background writer: the file contents are staged in memory, and the call
+ * returns as soon as there is a free slot in the writer queue.
+ \param mpiGrid     The DCCRG grid with spatial cells
+ \param dataReducer Contains datareductionoperators that are used to compute data that is added into file
+ \param index       Index to call the correct member of the various parameter vectors
+ \param writeGhosts If true, writes out ghost cells (cells that exist on the process boundary so other process' cells)
+ \return Returns true if operation was successful
+ */
+bool writeGridAsync(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+                    DataReducer* dataReducer,
+                    const uint& index,
+                    const bool writeGhosts ) {
+   phiprof::start("writeGrid-stage");
+   StagedGridOutput* output = new StagedGridOutput;
+   bool success = stageGrid( mpiGrid, dataReducer, index, writeGhosts, *output );
+   phiprof::stop("writeGrid-stage");
+
+   // The writer threads make collective calls for every queued file, so either all processes queue it or none
+   if (globalSuccess(success,"(writeGrid) ERROR: Failed to stage " + output->fileName + " for the background writer",MPI_COMM_WORLD) == false) {
+      delete output;
+      return false;
+   }
+
+   phiprof::start("writeGrid-backpressure");
+   const string fileName = output->fileName;
+   double waitTime;
+   const bool blocked = asyncGridWriter.enqueue( output, P::asyncWriteQueueDepth, waitTime );
+   phiprof::stop("writeGrid-backpressure");
+   if (blocked == true) {
+      logFile << "(writeGrid) Waited " << waitTime << " s for the background writer before queuing " << fileName
+              << ", consider increasing io.async_write_queue_depth" << endl << writeVerbose;
+   }
+   return true;
+}
+
+void finalizeAsyncWrites() {
+   phiprof::start("finalizeAsyncWrites");
+   asyncGridWriter.finalize();
+   phiprof::stop("finalizeAsyncWrites");
+}
+
 /*!
 
 \brief Write out system into a vlsv file
@@ -883,6 +1521,10 @@ bool writeGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    MPI_Barrier(MPI_COMM_WORLD);
    phiprof::stop("Barrier-entering-writegrid");
 
+   asyncGridWriter.reportCompleted();
+   if (useAsyncGridWriter(dataReducer) == true) {
+      return writeGridAsync( mpiGrid, dataReducer, index, writeGhosts );
+   }
 
    MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
    phiprof::start("writeGrid-reduced");
@@ -957,8 +1599,8 @@ bool writeGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    phiprof::start("reduceddataIO");
    //Write necessary variables:
    //Determines whether we write in floats or doubles
-   if (dataReducer != NULL) for( uint i = 0; i < dataReducer->size(); ++i ) {
-      if( writeDataReducer( mpiGrid, local_cells, (P::writeAsFloat==1), *dataReducer, i, vlsvWriter ) == false ) return false;
+   if (dataReducer != NULL) {
+      if( writeDataReducers( mpiGrid, local_cells, (P::writeAsFloat==1), *dataReducer, vlsvWriter ) == false ) return false;
    }
    
    phiprof::initializeTimer("Barrier","MPI","Barrier");
@@ -968,20 +1610,7 @@ bool writeGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    
    const uint64_t bytesWritten = vlsvWriter.getBytesWritten();
    const double writeTime = vlsvWriter.getWriteTime();
-   logFile << "(writeGrid) Wrote ";
-
-   if (bytesWritten > 1.0e9) logFile << bytesWritten/1.0e9 << " GB in ";
-   else if (bytesWritten > 1e6) logFile << bytesWritten/1.0e6 << " MB in ";
-   else if (bytesWritten > 1e3) logFile << bytesWritten/1.0e3 << " kB in ";
-   else logFile << bytesWritten << " B in ";
-
-   logFile << writeTime << " seconds, approximate data rate is ";
-
-   if (bytesWritten/writeTime > 1e9) logFile << bytesWritten/writeTime/1e9 << " GB/s";
-   else if (bytesWritten/writeTime > 1e6) logFile << bytesWritten/writeTime/1e6 << " MB/s";
-   else if (bytesWritten/writeTime > 1e3) logFile << bytesWritten/writeTime/1e3 << " kB/s";
-   else logFile << bytesWritten/writeTime << " B/s";
-   logFile << endl;
+   logWriteRate(bytesWritten,writeTime);
 
    phiprof::stop("reduceddataIO");
 
@@ -1113,9 +1742,7 @@ bool writeRestart(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
    
    //Write necessary variables:
    const bool writeAsFloat = false;
-   for (uint i=0; i<restartReducer.size(); ++i) {
-      writeDataReducer(mpiGrid, local_cells, writeAsFloat, restartReducer, i, vlsvWriter);
-   }
+   writeDataReducers(mpiGrid, local_cells, writeAsFloat, restartReducer, vlsvWriter);
    phiprof::stop("reduceddataIO");   
    //write the velocity distribution data -- note: it's expecting a vector of pointers:
    // Note: restart should always write double values to ensure the accuracy of the restart runs. 
@@ -1182,8 +1809,6 @@ bool writeDiagnostic(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
    vector<Real> localMin(nOps), localMax(nOps), localSum(nOps+1), localAvg(nOps),
                globalMin(nOps),globalMax(nOps),globalSum(nOps+1),globalAvg(nOps);
    localSum[0] = 1.0 * nCells;
-   Real buffer;
-   bool success = true;
    static bool printDiagnosticHeader = true;
    
    if (printDiagnosticHeader == true && myRank == MASTER_RANK) {
@@ -1199,28 +1824,34 @@ bool writeDiagnostic(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
       printDiagnosticHeader = false;
    }
    
+   // Request the DataReductionOperators to calculate the reduced data for all local cells:
+   vector<const SpatialCell*> cellPointers(nCells);
+   for (uint64_t cell=0; cell<nCells; ++cell) cellPointers[cell] = mpiGrid[cells[cell]];
+   vector<unsigned int> operatorIDs(nOps);
+   vector<vector<Real> > cellValues(nOps,vector<Real>(nCells,0.0));
+   vector<Real*> results(nOps);
    for (uint i=0; i<nOps; ++i) {
-      
       if (dataReducer.getDataVectorInfo(i,dataType,dataSize,vectorSize) == false) {
          cerr << "ERROR when requesting info from diagnostic DRO " << dataReducer.getName(i) << endl;
       }
+      operatorIDs[i] = i;
+      results[i] = cellValues[i].data();
+   }
+   if (dataReducer.reduceData(cellPointers,operatorIDs,results) == false) {
+      logFile << "(MAIN) writeDiagnostic: ERROR a datareductionoperator returned false!" << endl << writeVerbose;
+   }
+   
+   for (uint i=0; i<nOps; ++i) {
       localMin[i] = std::numeric_limits<Real>::max();
       localMax[i] = std::numeric_limits<Real>::min();
       localSum[i+1] = 0.0;
-      buffer = 0.0;
-      
-      // Request DataReductionOperator to calculate the reduced data for all local cells:
       for (uint64_t cell=0; cell<nCells; ++cell) {
-         success = true;
-         if (dataReducer.reduceData(mpiGrid[cells[cell]], i, &buffer) == false) success = false;
-         localMin[i] = min(buffer, localMin[i]);
-         localMax[i] = max(buffer, localMax[i]);
-         localSum[i+1] += buffer;
+         const Real value = cellValues[i][cell];
+         localMin[i] = min(value, localMin[i]);
+         localMax[i] = max(value, localMax[i]);
+         localSum[i+1] += value;
       }
       localAvg[i] = localSum[i+1];
-      
-      if (success == false) logFile << "(MAIN) writeDiagnostic: ERROR datareductionoperator '" << dataReducer.getName(i) <<
-                               "' returned false!" << endl << writeVerbose;
    }
    
    MPI_Reduce(&localMin[0], &globalMin[0], nOps, MPI_Type<Real>(), MPI_MIN, 0, MPI_COMM_WORLD);
@@ -48,6 +48,14 @@ bool writeGrid(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
 
 /*!
 
+\brief Wait for the background writer to finish all staged system writes and stop it
+
+Has to be called by all processes before MPI is finalized if io.async_write_queue_depth is nonzero.
+*/
+void finalizeAsyncWrites();
+
+/*!
+
 \brief Write out a restart of the simulation into a vlsv file. All block data in remote cells will be reset.
 
 \param mpiGrid   The DCCRG grid with spatial cells
@@ -0,0 +1,147 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/* Microbenchmark comparing std::unordered_map with vmesh::OpenHashMap as the 
+ * velocity mesh global ID to local ID index. The block set is a sphere of 
+ * blocks in a velocity mesh, as in a Maxwellian distribution. The timed 
+ * operations mimic the velocity mesh: rebuild (setGrid), lookups of existing 
+ * blocks in local ID order and in random order, lookups of neighbors that 
+ * mostly do not exist (adjust_velocity_blocks), and removal of blocks by 
+ * moving the last block to the hole (remove_velocity_block).
+ * 
+ * Usage: hash_test [number of blocks] [repetitions]
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "open_hash_map.h"
+
+typedef uint32_t GID;
+typedef uint32_t LID;
+
+double wallTime() {
+   timeval t;
+   gettimeofday(&t,NULL);
+   return t.tv_sec + 1.0e-6*t.tv_usec;
+}
+
+/* Create the global IDs of all blocks inside a sphere in a cubic mesh 
+ * of meshSize^3 blocks, the sphere contains approximately nBlocks blocks.*/
+void createBlocks(const size_t& nBlocks,const GID& meshSize,std::vector<GID>& blocks) {
+   const double radius = std::cbrt(3.0*nBlocks/(4.0*M_PI));
+   const double center = 0.5*meshSize;
+   for (GID k=0; k<meshSize; ++k) for (GID j=0; j<meshSize; ++j) for (GID i=0; i<meshSize; ++i) {
+      const double x = i+0.5-center;
+      const double y = j+0.5-center;
+      const double z = k+0.5-center;
+      if (x*x+y*y+z*z > radius*radius) continue;
+      blocks.push_back(i + j*meshSize + k*meshSize*meshSize);
+   }
+}
+
+template<typename MAP>
+void benchmark(const std::string& name,const std::vector<GID>& blocks,const std::vector<GID>& randomBlocks,
+               const std::vector<GID>& neighbors,const int& repetitions) {
+   double t_build=0,t_ordered=0,t_random=0,t_neighbors=0,t_remove=0;
+   size_t checksum = 0;
+
+   MAP map;
+   for (int r=0; r<repetitions; ++r) {
+      // Rebuild the index, the map is reused as in velocity mesh setGrid
+      double t_start = wallTime();
+      map.clear();
+      map.reserve(blocks.size());
+      for (LID b=0; b<blocks.size(); ++b) map.insert(std::make_pair(blocks[b],b));
+      t_build += wallTime()-t_start;
+
+      // Lookups of existing blocks in local ID order
+      t_start = wallTime();
+      for (size_t b=0; b<blocks.size(); ++b) checksum += map.find(blocks[b])->second;
+      t_ordered += wallTime()-t_start;
+
+      // Lookups of existing blocks in random order
+      t_start = wallTime();
+      for (size_t b=0; b<randomBlocks.size(); ++b) checksum += map.find(randomBlocks[b])->second;
+      t_random += wallTime()-t_start;
+
+      // Lookups of neighbors, most of them do not exist
+      t_start = wallTime();
+      for (size_t b=0; b<neighbors.size(); ++b) checksum += map.count(neighbors[b]);
+      t_neighbors += wallTime()-t_start;
+
+      // Remove half of the blocks, last block is moved to the removed position
+      std::vector<GID> localToGlobal = blocks;
+      t_start = wallTime();
+      for (size_t b=0; b<randomBlocks.size()/2; ++b) {
+         const LID removedLID = map.find(randomBlocks[b])->second;
+         const GID lastGID = localToGlobal.back();
+         map.find(lastGID)->second = removedLID;
+         localToGlobal[removedLID] = lastGID;
+         map.erase(randomBlocks[b]);
+         localToGlobal.pop_back();
+      }
+      t_remove += wallTime()-t_start;
+      checksum += map.size();
+   }
+
+   const double nOps = 1.0e-9*repetitions;
+   std::cout << name << std::endl;
+   std::cout << "\tbuild        " << t_build/(nOps*blocks.size()) << " ns/block" << std::endl;
+   std::cout << "\tordered find " << t_ordered/(nOps*blocks.size()) << " ns/block" << std::endl;
+   std::cout << "\trandom find  " << t_random/(nOps*randomBlocks.size()) << " ns/block" << std::endl;
+   std::cout << "\tneighbors    " << t_neighbors/(nOps*neighbors.size()) << " ns/lookup" << std::endl;
+   std::cout << "\tremove       " << t_remove/(nOps*(randomBlocks.size()/2)) << " ns/block" << std::endl;
+   std::cout << "\tchecksum     " << checksum << std::endl;
+}
+
+int main(int argc,char** argv) {
+   size_t nBlocks = 50000;
+   int repetitions = 20;
+   if (argc > 1) nBlocks = atol(argv[1]);
+   if (argc > 2) repetitions = atoi(argv[2]);
+   const GID meshSize = 100;
+
+   std::vector<GID> blocks;
+   createBlocks(nBlocks,meshSize,blocks);
+   std::vector<GID> randomBlocks = blocks;
+   std::random_shuffle(randomBlocks.begin(),randomBlocks.end());
+
+   // Face neighbors of all blocks in the sphere
+   std::vector<GID> neighbors;
+   const int offsets[6] = {-1,1,-(int)meshSize,(int)meshSize,-(int)(meshSize*meshSize),(int)(meshSize*meshSize)};
+   for (size_t b=0; b<blocks.size(); ++b) {
+      for (int n=0; n<6; ++n) neighbors.push_back(blocks[b] + offsets[n]);
+   }
+
+   std::cout << "Blocks: " << blocks.size() << " repetitions: " << repetitions << std::endl;
+   benchmark<std::unordered_map<GID,LID> >("std::unordered_map",blocks,randomBlocks,neighbors,repetitions);
+   benchmark<vmesh::OpenHashMap<GID,LID> >("vmesh::OpenHashMap",blocks,randomBlocks,neighbors,repetitions);
+   return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef OPEN_HASH_MAP_H
+#define OPEN_HASH_MAP_H
+
+#include <stdint.h>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace vmesh {
+
+   /** Hash map from velocity block global IDs to local IDs. Entries are stored 
+    * in a single flat array and collisions are resolved with linear probing, 
+    * so a lookup is usually a single cache miss and no per-entry memory is 
+    * allocated. Erased entries are removed with backward shift deletion, i.e., 
+    * no tombstones are left behind. 
+    * 
+    * The interface is a subset of std::unordered_map. Differences:
+    * - The maximum key value, std::numeric_limits<KEY>::max(), marks empty 
+    *   buckets and cannot be inserted (it is the invalid global ID).
+    * - Iterators are plain pointers to buckets and are invalidated by any 
+    *   insertion or erasure. Iteration over the map is not supported.*/
+   template<typename KEY,typename VALUE>
+   class OpenHashMap {
+    public:
+      typedef std::pair<KEY,VALUE> value_type;
+      typedef value_type* iterator;
+      typedef const value_type* const_iterator;
+
+      OpenHashMap();
+
+      VALUE& at(const KEY& key);
+      const VALUE& at(const KEY& key) const;
+      size_t bucket_count() const;
+      void clear();
+      size_t count(const KEY& key) const;
+      bool empty() const;
+      iterator end();
+      const_iterator end() const;
+      size_t erase(const KEY& key);
+      void erase(iterator it);
+      iterator find(const KEY& key);
+      const_iterator find(const KEY& key) const;
+      std::pair<iterator,bool> insert(const value_type& entry);
+      void reserve(const size_t& n);
+      size_t size() const;
+      void swap(OpenHashMap& other);
+
+    private:
+      static KEY emptyKey();
+      size_t getBucket(const KEY& key) const;
+      void rehash(const uint8_t& newSizePower);
+
+      static const uint8_t minSizePower = 4;  /**< Minimum number of buckets is 2^minSizePower.*/
+
+      std::vector<value_type> buckets;        /**< Buckets, number of buckets is always a power of two.*/
+      size_t nEntries;                        /**< Number of entries in the map.*/
+      uint8_t sizePower;                      /**< Base-two logarithm of the number of buckets.*/
+   };
+
+   // ***** DEFINITIONS OF TEMPLATE MEMBER FUNCTIONS ***** //
+
+   template<typename KEY,typename VALUE> inline
+   OpenHashMap<KEY,VALUE>::OpenHashMap(): nEntries(0),sizePower(0) { }
+
+   template<typename KEY,typename VALUE> inline
+   VALUE& OpenHashMap<KEY,VALUE>::at(const KEY& key) {
+      iterator it = find(key);
+      if (it == end()) throw std::out_of_range("OpenHashMap::at");
+      return it->second;
+   }
+
+   template<typename KEY,typename VALUE> inline
+   const VALUE& OpenHashMap<KEY,VALUE>::at(const KEY& key) const {
+      const_iterator it = find(key);
+      if (it == end()) throw std::out_of_range("OpenHashMap::at");
+      return it->second;
+   }
+
+   template<typename KEY,typename VALUE> inline
+   size_t OpenHashMap<KEY,VALUE>::bucket_count() const {
+      return buckets.size();
+   }
+
+   /** Remove all entries. Allocated buckets are kept so that the map can 
+    * be refilled without rehashing.*/
+   template<typename KEY,typename VALUE> inline
+   void OpenHashMap<KEY,VALUE>::clear() {
+      if (nEntries == 0) return;
+      for (size_t b=0; b<buckets.size(); ++b) buckets[b].first = emptyKey();
+      nEntries = 0;
+   }
+
+   template<typename KEY,typename VALUE> inline
+   size_t OpenHashMap<KEY,VALUE>::count(const KEY& key) const {
+      return (find(key) == end()) ? 0 : 1;
+   }
+
+   template<typename KEY,typename VALUE> inline
+   bool OpenHashMap<KEY,VALUE>::empty() const {
+      return nEntries == 0;
+   }
+
+   template<typename KEY,typename VALUE> inline
+   KEY OpenHashMap<KEY,VALUE>::emptyKey() {
+      return std::numeric_limits<KEY>::max();
+   }
+
+   template<typename KEY,typename VALUE> inline
+   typename OpenHashMap<KEY,VALUE>::iterator OpenHashMap<KEY,VALUE>::end() {
+      return buckets.data() + buckets.size();
+   }
+
+   template<typename KEY,typename VALUE> inline
+   typename OpenHashMap<KEY,VALUE>::const_iterator OpenHashMap<KEY,VALUE>::end() const {
+      return buckets.data() + buckets.size();
+   }
+
+   template<typename KEY,typename VALUE> inline
+   size_t OpenHashMap<KEY,VALUE>::erase(const KEY& key) {
+      iterator it = find(key);
+      if (it == end()) return 0;
+      erase(it);
+      return 1;
+   }
+
+   template<typename KEY,typename VALUE> inline
+   void OpenHashMap<KEY,VALUE>::erase(iterator it) {
+      const size_t mask = buckets.size()-1;
+      size_t hole = it - buckets.data();
+
+      // Shift subsequent entries of the probe sequence backwards 
+      // so that all entries remain reachable from their home buckets
+      size_t b = hole;
+      while (true) {
+         b = (b+1) & mask;
+         if (buckets[b].first == emptyKey()) break;
+
+         const size_t home = getBucket(buckets[b].first);
+         const bool reachable = (hole < b) ? (home > hole && home <= b) : (home > hole || home <= b);
+         if (reachable == true) continue;
+
+         buckets[hole] = buckets[b];
+         hole = b;
+      }
+      buckets[hole].first = emptyKey();
+      --nEntries;
+   }
+
+   template<typename KEY,typename VALUE> inline
+   typename OpenHashMap<KEY,VALUE>::iterator OpenHashMap<KEY,VALUE>::find(const KEY& key) {
+      const_iterator it = static_cast<const OpenHashMap&>(*this).find(key);
+      return const_cast<iterator>(it);
+   }
+
+   template<typename KEY,typename VALUE> inline
+   typename OpenHashMap<KEY,VALUE>::const_iterator OpenHashMap<KEY,VALUE>::find(const KEY& key) const {
+      if (nEntries == 0 || key == emptyKey()) return end();
+
+      // Load factor is kept at or below one half, 
+      // there is always an empty bucket that ends the probing
+      const size_t mask = buckets.size()-1;
+      size_t b = getBucket(key);
+      while (true) {
+         if (buckets[b].first == key) return buckets.data() + b;
+         if (buckets[b].first == emptyKey()) return end();
+         b = (b+1) & mask;
+      }
+   }
+
+   /** Fibonacci hashing, consecutive block global IDs are spread evenly over the buckets.*/
+   template<typename KEY,typename VALUE> inline
+   size_t OpenHashMap<KEY,VALUE>::getBucket(const KEY& key) const {
+      return (static_cast<uint64_t>(key) * UINT64_C(11400714819323198485)) >> (64 - sizePower);
+   }
+
+   template<typename KEY,typename VALUE> inline
+   std::pair<typename OpenHashMap<KEY,VALUE>::iterator,bool> OpenHashMap<KEY,VALUE>::insert(const value_type& entry) {
+      if (entry.first == emptyKey()) return std::make_pair(end(),false);
+      if (2*(nEntries+1) > buckets.size()) {
+         rehash(sizePower < minSizePower ? minSizePower : sizePower+1);
+      }
+
+      const size_t mask = buckets.size()-1;
+      size_t b = getBucket(entry.first);
+      while (true) {
+         if (buckets[b].first == entry.first) return std::make_pair(buckets.data()+b,false);
+         if (buckets[b].first == emptyKey()) break;
+         b = (b+1) & mask;
+      }
+
+      buckets[b] = entry;
+      ++nEntries;
+      return std::make_pair(buckets.data()+b,true);
+   }
+
+   /** Allocate enough buckets for n entries. Existing entries are rehashed 
+    * if the number of buckets changes.*/
+   template<typename KEY,typename VALUE> inline
+   void OpenHashMap<KEY,VALUE>::reserve(const size_t& n) {
+      uint8_t newSizePower = minSizePower;
+      while ((static_cast<size_t>(1) << newSizePower) < 2*n) ++newSizePower;
+      if (newSizePower > sizePower) rehash(newSizePower);
+   }
+
+   template<typename KEY,typename VALUE> inline
+   void OpenHashMap<KEY,VALUE>::rehash(const uint8_t& newSizePower) {
+      std::vector<value_type> oldBuckets(static_cast<size_t>(1) << newSizePower,std::make_pair(emptyKey(),VALUE()));
+      oldBuckets.swap(buckets);
+      sizePower = newSizePower;
+
+      const size_t mask = buckets.size()-1;
+      for (size_t i=0; i<oldBuckets.size(); ++i) {
+         if (oldBuckets[i].first == emptyKey()) continue;
+         size_t b = getBucket(oldBuckets[i].first);
+         while (buckets[b].first != emptyKey()) b = (b+1) & mask;
+         buckets[b] = oldBuckets[i];
+      }
+   }
+
+   template<typename KEY,typename VALUE> inline
+   size_t OpenHashMap<KEY,VALUE>::size() const {
+      return nEntries;
+   }
+
+   template<typename KEY,typename VALUE> inline
+   void OpenHashMap<KEY,VALUE>::swap(OpenHashMap& other) {
+      buckets.swap(other.buckets);
+      std::swap(nEntries,other.nEntries);
+      std::swap(sizePower,other.sizePower);
+   }
+
+} // namespace vmesh
+
+#endif
@@ -74,9 +74,15 @@ uint P::tstep = 0;
 uint P::tstep_min = 0;
 uint P::tstep_max = 0;
 uint P::diagnosticInterval = numeric_limits<uint>::max();
+bool P::reportGridMemory = false;
 bool P::writeInitialState = true;
 
 bool P::meshRepartitioned = true;
+Real P::loadBalanceTransferMaxBytes = 1.0e9;
+bool P::loadBalanceIncremental = false;
+Real P::loadBalanceIncrementalMaxImbalance = 1.5;
+Real P::loadBalanceIncrementalMaxBytes = 1.0e9;
+bool P::loadBalanceCostModel = true;
 bool P::prepareForRebalance = false;
 std::vector<CellID> P::localCells;
 
@@ -93,6 +99,7 @@ Real P::saveRestartWalltimeInterval = -1.0;
 uint P::exitAfterRestarts = numeric_limits<uint>::max();
 int P::restartStripeFactor = -1;
 string P::restartWritePath = string("");
+uint P::asyncWriteQueueDepth = 0;
 
 uint P::transmit = 0;
 
@@ -107,8 +114,12 @@ bool P::dynamicTimestep = true;
 Real P::maxWaveVelocity = 0.0;
 int P::maxFieldSolverSubcycles = 0.0;
 int P::maxSlAccelerationSubcycles = 0.0;
+bool P::vlasovSolverPencils = false;
+bool P::fuseMoments = false;
+bool P::cacheAccelerationColumns = false;
 Real P::resistivity = NAN;
 bool P::fieldSolverDiffusiveEterms = true;
+bool P::fieldSolverSoaGrid = false;
 uint P::ohmHallTerm = 0;
 uint P::ohmGradPeTerm = 0;
 Real P::electronTemperature = 0.0;
@@ -134,6 +145,7 @@ int P::writeAsFloat = false;
 string P::loadBalanceAlgorithm = string("");
 string P::loadBalanceTolerance = string("");
 uint P::rebalanceInterval = numeric_limits<uint>::max();
+Real P::rebalanceImbalanceThreshold = 0.0;
 
 vector<string> P::outputVariableList;
 vector<string> P::diagnosticVariableList;
@@ -155,6 +167,7 @@ string P::amrVelRefCriterion = "";
 bool Parameters::addParameters(){
    //the other default parameters we read through the add/get interface
    Readparameters::add("io.diagnostic_write_interval", "Write diagnostic output every arg time steps",numeric_limits<uint>::max());
+   Readparameters::add("io.report_grid_memory", "If true, log the memory use of the grid and the velocity block arena (a collective operation) whenever the run speed is logged.",false);
    
 
    Readparameters::addComposing("io.system_write_t_interval", "Save the simulation every arg simulated seconds. Negative values disable writes. [Define for all groups.]");
@@ -171,6 +184,7 @@ bool Parameters::addParameters(){
    Readparameters::add("io.number_of_restarts","Exit the simulation after certain number of walltime-based restarts.",numeric_limits<uint>::max());
    Readparameters::add("io.write_restart_stripe_factor","Stripe factor for restart writing.", -1);
    Readparameters::add("io.write_as_float","If true, write in floats instead of doubles", false);
+   Readparameters::add("io.async_write_queue_depth","Number of system writes that may be staged in memory while a background thread writes them to disk. 0 writes synchronously. Requires MPI_THREAD_MULTIPLE.", 0);
    Readparameters::add("io.restart_write_path", "Path to the location where restart files should be written. Defaults to the local directory, also if the specified destination is not writeable.", string("./"));
    
    Readparameters::add("propagate_potential","Propagate electrostatic potential during the simulation",false);
@@ -204,6 +218,7 @@ bool Parameters::addParameters(){
    Readparameters::add("fieldsolver.maxSubcycles", "Maximum allowed field solver subcycles", 1);
    Readparameters::add("fieldsolver.resistivity", "Resistivity for the eta*J term in Ohm's law.", 0.0);
    Readparameters::add("fieldsolver.diffusiveEterms", "Enable diffusive terms in the computation of E",true);
+   Readparameters::add("fieldsolver.soaGrid", "Propagate fields away from system boundaries in a per-process structure-of-arrays copy of field variables. Not used if the Hall or electron pressure gradient term is enabled.",false);
    Readparameters::add("fieldsolver.ohmHallTerm", "Enable/choose spatial order of the Hall term in Ohm's law. 0: off, 1: 1st spatial order, 2: 2nd spatial order", 0);
    Readparameters::add("fieldsolver.ohmGradPeTerm", "Enable/choose spatial order of the electron pressure gradient term in Ohm's law. 0: off, 1: 1st spatial order.", 0);
    Readparameters::add("fieldsolver.electronTemperature", "Constant electron temperature to be used for the electron pressure gradient term (K).", 0.0);
@@ -215,6 +230,9 @@ bool Parameters::addParameters(){
    Readparameters::add("vlasovsolver.maxSlAccelerationSubcycles","Maximum number of subcycles for acceleration",1);
    Readparameters::add("vlasovsolver.maxCFL","The maximum CFL limit for vlasov propagation in ordinary space. Used to set timestep if dynamic_timestep is true.",0.99);
    Readparameters::add("vlasovsolver.minCFL","The minimum CFL limit for vlasov propagation in ordinary space. Used to set timestep if dynamic_timestep is true.",0.8);
+   Readparameters::add("vlasovsolver.pencils","If true, spatial translation is done for pencils (lines of local cells) at a time, loading and storing each velocity block once per pencil instead of once per stencil cell.",false);
+   Readparameters::add("vlasovsolver.fuse_moments","If true, velocity moments are accumulated while the translation and acceleration solvers store the distribution function, instead of recomputing them in a separate pass over all velocity blocks.",false);
+   Readparameters::add("vlasovsolver.cache_acceleration_columns","If true, the sorting of velocity blocks into columns is cached in each cell and reused by the acceleration until blocks are added or removed. The mapping itself usually adds or removes blocks, so the cache only pays off for cells whose velocity mesh is stable over subcycles, at the cost of three column copies per population of every cell.",false);
    
    // Grid sparsity parameters
    Readparameters::add("sparse.minValue", "Minimum value of distribution function in any cell of a velocity block for the block to be considered to have contents", 1);
@@ -230,13 +248,19 @@ bool Parameters::addParameters(){
    
 
    // Load balancing parameters
-   Readparameters::add("loadBalance.algorithm", "Load balancing algorithm to be used", string("RCB"));
+   Readparameters::add("loadBalance.algorithm", "Load balancing algorithm to be used, a Zoltan LB_METHOD (RCB, RIB, HSFC, ...) or HILBERT for the built-in node-aware Hilbert curve partitioner weighted by the cell costs", string("RCB"));
    Readparameters::add("loadBalance.tolerance", "Load imbalance tolerance", string("1.05"));
    Readparameters::add("loadBalance.rebalanceInterval", "Load rebalance interval (steps)", 10);
+   Readparameters::add("loadBalance.transferMaxBytes", "Migrating cells are sent in rounds of at most this much velocity block data (bytes) sent by each process, all particle populations of a cell are packed into one message. The limit is per sender, a process may receive this much from each process sending to it in the same round.", 1.0e9);
+   Readparameters::add("loadBalance.incremental", "If true, rebalance by moving cells on process boundaries to less loaded neighbor processes (diffusion) instead of repartitioning from scratch with Zoltan.", false);
+   Readparameters::add("loadBalance.incrementalMaxImbalance", "Repartition from scratch instead of incrementally if the ratio of the largest and mean process load exceeds this value.", 1.5);
+   Readparameters::add("loadBalance.incrementalMaxBytes", "Largest amount of velocity block data (bytes) a process sends in an incremental rebalance.", 1.0e9);
+   Readparameters::add("loadBalance.costModel", "If true, weight cells by a cost model (per-cell, sysboundary, per-block translation and per-block acceleration subcycle costs) calibrated against the measured compute times instead of using the measured times directly.", true);
+   Readparameters::add("loadBalance.imbalanceThreshold", "If larger than zero, rebalance when the ratio of the largest and mean per-process compute time of a step exceeds this value and the time lost to imbalance since the last rebalance exceeds the cost of that rebalance. The imbalance is measured every rebalanceInterval steps, which are then rebalanced only if needed.", 0.0);
    
 // Output variable parameters
-   Readparameters::addComposing("variables.output", "List of data reduction operators (DROs) to add to the grid file output. Each variable to be added has to be on a new line output = XXX. Available are (20171107) B BackgroundB PerturbedB E Rho RhoBackstream RhoV RhoVBackstream RhoVNonBackstream PressureBackstream PTensorBackstreamDiagonal PTensorNonBackstreamDiagonal PTensorBackstreamOffDiagonal PTensorNonBackstreamOffDiagonal PTensorBackstream PTensorNonBackstream MinValue RhoNonBackstream RhoLossAdjust RhoLossVelBoundary LBweight MaxVdt MaxRdt MaxFieldsdt accSubcycles MPIrank BoundaryType BoundaryLayer Blocks fSaved VolE HallE BackgroundBedge VolB BackgroundVolB PerturbedVolB Pressure PTensor derivs BVOLderivs GridCoordinates Potential BackgroundVolE ChargeDensity PotentialError SpeciesMoments MeshData");
-   Readparameters::addComposing("variables.diagnostic", "List of data reduction operators (DROs) to add to the diagnostic runtime output. Each variable to be added has to be on a new line diagnostic = XXX. Available (20171107) are FluxB FluxE Blocks Pressure Rho RhoLossAdjust RhoLossVelBoundary LBweight MaxVdt MaxRdt MaxFieldsdt MaxDistributionFunction MinDistributionFunction BoundaryType BoundaryLayer.");
+   Readparameters::addComposing("variables.output", "List of data reduction operators (DROs) to add to the grid file output. Each variable to be added has to be on a new line output = XXX. Available are (20171107) B BackgroundB PerturbedB E Rho RhoBackstream RhoV RhoVBackstream RhoVNonBackstream PressureBackstream PTensorBackstreamDiagonal PTensorNonBackstreamDiagonal PTensorBackstreamOffDiagonal PTensorNonBackstreamOffDiagonal PTensorBackstream PTensorNonBackstream MinValue RhoNonBackstream RhoLossAdjust RhoLossVelBoundary LBweight LBweightPredicted MaxVdt MaxRdt MaxFieldsdt accSubcycles MPIrank BoundaryType BoundaryLayer Blocks fSaved VolE HallE BackgroundBedge VolB BackgroundVolB PerturbedVolB Pressure PTensor derivs BVOLderivs GridCoordinates Potential BackgroundVolE ChargeDensity PotentialError SpeciesMoments MeshData");
+   Readparameters::addComposing("variables.diagnostic", "List of data reduction operators (DROs) to add to the diagnostic runtime output. Each variable to be added has to be on a new line diagnostic = XXX. Available (20171107) are FluxB FluxE Blocks Pressure Rho RhoLossAdjust RhoLossVelBoundary LBweight LBweightPredicted MaxVdt MaxRdt MaxFieldsdt MaxDistributionFunction MinDistributionFunction BoundaryType BoundaryLayer.");
    Readparameters::add("variables.dr_backstream_vx", "Center coordinate for the maxwellian distribution. Used for calculating the backstream contriution for rho.", -500000.0);
    Readparameters::add("variables.dr_backstream_vy", "Center coordinate for the maxwellian distribution. Used for calculating the backstream contriution for rho.", 0.0);
    Readparameters::add("variables.dr_backstream_vz", "Center coordinate for the maxwellian distribution. Used for calculating the backstream contriution for rho.", 0.0);
@@ -258,6 +282,7 @@ bool Parameters::addParameters(){
 bool Parameters::getParameters(){
    //get numerical values of the parameters
    Readparameters::get("io.diagnostic_write_interval", P::diagnosticInterval);
+   Readparameters::get("io.report_grid_memory", P::reportGridMemory);
    Readparameters::get("io.system_write_t_interval", P::systemWriteTimeInterval);
    Readparameters::get("io.system_write_file_name", P::systemWriteName);
    Readparameters::get("io.system_write_path", P::systemWritePath);
@@ -271,6 +296,7 @@ bool Parameters::getParameters(){
    Readparameters::get("io.write_restart_stripe_factor", P::restartStripeFactor);
    Readparameters::get("io.restart_write_path", P::restartWritePath);
    Readparameters::get("io.write_as_float", P::writeAsFloat);
+   Readparameters::get("io.async_write_queue_depth", P::asyncWriteQueueDepth);
    
    // Checks for validity of io and restart parameters
    int myRank;
@@ -412,6 +438,7 @@ bool Parameters::getParameters(){
    Readparameters::get("fieldsolver.maxSubcycles", P::maxFieldSolverSubcycles);
    Readparameters::get("fieldsolver.resistivity", P::resistivity);
    Readparameters::get("fieldsolver.diffusiveEterms", P::fieldSolverDiffusiveEterms);
+   Readparameters::get("fieldsolver.soaGrid", P::fieldSolverSoaGrid);
    Readparameters::get("fieldsolver.ohmHallTerm", P::ohmHallTerm);
    Readparameters::get("fieldsolver.ohmGradPeTerm", P::ohmGradPeTerm);
    Readparameters::get("fieldsolver.electronTemperature", P::electronTemperature);
@@ -422,6 +449,9 @@ bool Parameters::getParameters(){
    Readparameters::get("vlasovsolver.maxSlAccelerationSubcycles",P::maxSlAccelerationSubcycles);
    Readparameters::get("vlasovsolver.maxCFL",P::vlasovSolverMaxCFL);
    Readparameters::get("vlasovsolver.minCFL",P::vlasovSolverMinCFL);
+   Readparameters::get("vlasovsolver.pencils",P::vlasovSolverPencils);
+   Readparameters::get("vlasovsolver.fuse_moments",P::fuseMoments);
+   Readparameters::get("vlasovsolver.cache_acceleration_columns",P::cacheAccelerationColumns);
    
    // Get sparsity parameters
    Readparameters::get("sparse.minValue", P::sparseMinValue);
@@ -438,6 +468,12 @@ bool Parameters::getParameters(){
    Readparameters::get("loadBalance.algorithm", P::loadBalanceAlgorithm);
    Readparameters::get("loadBalance.tolerance", P::loadBalanceTolerance);
    Readparameters::get("loadBalance.rebalanceInterval", P::rebalanceInterval);
+   Readparameters::get("loadBalance.imbalanceThreshold", P::rebalanceImbalanceThreshold);
+   Readparameters::get("loadBalance.transferMaxBytes", P::loadBalanceTransferMaxBytes);
+   Readparameters::get("loadBalance.incremental", P::loadBalanceIncremental);
+   Readparameters::get("loadBalance.incrementalMaxImbalance", P::loadBalanceIncrementalMaxImbalance);
+   Readparameters::get("loadBalance.incrementalMaxBytes", P::loadBalanceIncrementalMaxBytes);
+   Readparameters::get("loadBalance.costModel", P::loadBalanceCostModel);
    
    // Get output variable parameters
    Readparameters::get("variables.output", P::outputVariableList);
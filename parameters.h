@@ -72,6 +72,7 @@ struct Parameters {
    static std::vector<CellID> localCells; /*!< Cached copy of spatial cell IDs on this process.*/
 
    static uint diagnosticInterval;
+   static bool reportGridMemory;          /*!< If true, the memory use of the grid and the velocity block arena is logged with the run speed. */
    static std::vector<std::string> systemWriteName; /*!< Names for the different classes of grid output*/
    static std::vector<std::string> systemWritePath; /*!< Save this series in this location. Default is ./ */
    static std::vector<Real> systemWriteTimeInterval;/*!< Interval in simusecond for output for each class*/
@@ -86,6 +87,7 @@ struct Parameters {
    static uint exitAfterRestarts;           /*!< Exit after this many restarts*/
    static int restartStripeFactor;          /*!< stripe_factor for restart writing*/
    static std::string restartWritePath;          /*!< Path to the location where restart files should be written. Defaults to the local directory, also if the specified destination is not writeable. */
+   static uint asyncWriteQueueDepth;        /*!< Number of staged system writes that may be pending on the background writer thread, 0 writes synchronously. */
    
    static uint transmit;
    /*!< Indicates the data that needs to be transmitted to remote nodes.
@@ -106,9 +108,13 @@ struct Parameters {
    static uint ohmGradPeTerm; /*!< Enable/choose spatial order of the electron pressure gradient term in Ohm's law. 0: off, 1: 1st spatial order. */
    static Real electronTemperature; /*!< Constant electron temperature to be used for the electron pressure gradient term (K). */
    static bool fieldSolverDiffusiveEterms; /*!< Enable resistive terms in the computation of E*/
+   static bool fieldSolverSoaGrid; /*!< If true, fields in cells away from system boundaries are propagated in fs_cache::FieldGrid.*/
    
    static Real maxSlAccelerationRotation; /*!< Maximum rotation in acceleration for semilagrangian solver*/
    static int maxSlAccelerationSubcycles; /*!< Maximum number of subcycles in acceleration*/
+   static bool vlasovSolverPencils; /*!< If true, spatial translation maps whole pencils (lines of local cells) at a time instead of one cell at a time.*/
+   static bool fuseMoments; /*!< If true, velocity moments are accumulated in the last translation and acceleration mapping instead of a separate pass over the distribution function.*/
+   static bool cacheAccelerationColumns; /*!< If true, velocity block columns of the acceleration are cached per cell until the velocity mesh changes.*/
 
    static Real hallMinimumRho;  /*!< Minimum rho value used for the Hall and electron pressure gradient terms in the Lorentz force and in the field solver.*/
    static Real sparseMinValue; /*!< (DEPRECATED) Minimum value of distribution function in any cell of a velocity 
@@ -125,6 +131,14 @@ struct Parameters {
    static std::string loadBalanceAlgorithm; /*!< Algorithm to be used for load balance.*/
    static std::string loadBalanceTolerance; /*!< Load imbalance tolerance. */ 
    static uint rebalanceInterval; /*!< Load rebalance interval (steps). */
+   static Real rebalanceImbalanceThreshold; /*!< If larger than zero, the load is rebalanced when the ratio of the largest
+                                             * and mean per-process compute time exceeds this value and the time lost to
+                                             * imbalance since the last rebalance exceeds its cost, checked every rebalanceInterval steps.*/
+   static Real loadBalanceTransferMaxBytes; /*!< Largest amount of packed velocity block data a process sends in one load balance transfer round (per sender, not per receiver).*/
+   static bool loadBalanceIncremental; /*!< If true, the load is rebalanced by moving cells on process boundaries to less loaded neighbor processes.*/
+   static Real loadBalanceIncrementalMaxImbalance; /*!< Incremental rebalancing is only used below this ratio of the largest and mean process load.*/
+   static Real loadBalanceIncrementalMaxBytes; /*!< Largest amount of velocity block data a process sends in an incremental rebalance.*/
+   static bool loadBalanceCostModel; /*!< If true, cells are weighted by a cost model calibrated against the measured compute times.*/
    static bool prepareForRebalance; /**< If true, propagators should measure their time consumption in preparation
                                      * for mesh repartitioning.*/
    
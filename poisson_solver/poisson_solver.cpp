@@ -141,17 +141,19 @@ namespace poisson {
 
          const Real charge       = getObjectWrapper().particleSpecies[popID].charge;
          const Realf* data       = blockContainer.getData();
-         const Real* blockParams = blockContainer.getParameters();
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
          // Sum charge density over all phase-space cells
          for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+            const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
             Real sum = 0.0;
             for (int i=0; i<WID3; ++i) sum += data[blockLID*WID3+i];
 
             const Real DV3 
-               = blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVX]
-               * blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVY]
-               * blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVZ];
+               = blockParams[BlockParams::DVX]
+               * blockParams[BlockParams::DVY]
+               * blockParams[BlockParams::DVZ];
             rho_q_spec += sum*DV3;
          }
          
@@ -180,18 +182,20 @@ namespace poisson {
 
             const Real charge       = getObjectWrapper().particleSpecies[popID].charge;
             const Realf* data       = blockContainer.getData();
-            const Real* blockParams = blockContainer.getParameters();
+            const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+            Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
             // Sum charge density over all phase-space cells
             #pragma omp for
             for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+               const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
                Real sum = 0.0;
                for (int i=0; i<WID3; ++i) sum += data[blockLID*WID3+i];
 
                const Real DV3 
-                  = blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVX]
-                  * blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVY]
-                  * blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVZ];
+                  = blockParams[BlockParams::DVX]
+                  * blockParams[BlockParams::DVY]
+                  * blockParams[BlockParams::DVZ];
                rho_q_spec += sum*DV3;
             }
 
@@ -79,6 +79,7 @@ struct VelocityMeshParams {
    vector<vmesh::LocalID> vy_length;
    vector<vmesh::LocalID> vz_length;
    vector<unsigned int> maxRefLevels;
+   Real denseFillFraction;
    
    void resize(const size_t& size) {
       name.resize(1);
@@ -153,6 +154,7 @@ namespace projects {
       RP::addComposing("velocitymesh.vy_length","Initial number of velocity blocks in vy-direction.");
       RP::addComposing("velocitymesh.vz_length","Initial number of velocity blocks in vz-direction.");
       RP::addComposing("velocitymesh.max_refinement_level","Maximum allowed mesh refinement level.");
+      RP::add("velocitymesh.dense_fill_fraction","Velocity meshes whose fraction of existing blocks exceeds this value use a dense block index instead of a hash map (values >= 1 disable).",0.25);
 
       // These parameters are only read if the 'velocitymesh.' parameters are not defined 
       // in order to support older configuration files.
@@ -190,6 +192,7 @@ namespace projects {
       RP::get("velocitymesh.vy_length",velMeshParams->vy_length);
       RP::get("velocitymesh.vz_length",velMeshParams->vz_length);
       RP::get("velocitymesh.max_refinement_level",velMeshParams->maxRefLevels);
+      RP::get("velocitymesh.dense_fill_fraction",velMeshParams->denseFillFraction);
    }
 
    /** Initialize the Project. Velocity mesh and particle population 
@@ -288,6 +291,7 @@ namespace projects {
          meshParams.blockLength[1] = WID;
          meshParams.blockLength[2] = WID;
          meshParams.refLevelMaxAllowed = velMeshParams->maxRefLevels[m];
+         meshParams.denseFillFraction = velMeshParams->denseFillFraction;
          owrapper.velocityMeshes.push_back(meshParams);
 	 if(meshParams.gridLength[0] > MAX_BLOCKS_PER_DIM  || meshParams.gridLength[1] > MAX_BLOCKS_PER_DIM  || meshParams.gridLength[2] > MAX_BLOCKS_PER_DIM ) {
 	   stringstream ss;
@@ -499,15 +503,16 @@ namespace projects {
       creal dy = cell->parameters[CellParams::DY];
       creal dz = cell->parameters[CellParams::DZ];
 
-      const Real* parameters = cell->get_block_parameters(popID);
+      Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+      const Real* parameters = cell->get_block_parameters(blockLID,popID,paramsScratch);
       Realf* data = cell->get_data(popID);
       
-      creal vxBlock = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VXCRD];
-      creal vyBlock = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VYCRD];
-      creal vzBlock = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::VZCRD];
-      creal dvxCell = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVX];
-      creal dvyCell = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVY];
-      creal dvzCell = parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS + BlockParams::DVZ];
+      creal vxBlock = parameters[BlockParams::VXCRD];
+      creal vyBlock = parameters[BlockParams::VYCRD];
+      creal vzBlock = parameters[BlockParams::VZCRD];
+      creal dvxCell = parameters[BlockParams::DVX];
+      creal dvyCell = parameters[BlockParams::DVY];
+      creal dvzCell = parameters[BlockParams::DVZ];
       
       // Calculate volume average of distribution function for each phase-space cell in the block.
       Real maxValue = 0.0;
@@ -630,13 +635,13 @@ namespace projects {
       // Re-scale densities
       Real sum = 0.0;
       Realf* data = cell->get_data(popID);
-      const Real* blockParams = cell->get_block_parameters(popID);
+      Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
       for (vmesh::LocalID blockLID=0; blockLID<cell->get_number_of_velocity_blocks(popID); ++blockLID) {
+         const Real* blockParams = cell->get_block_parameters(blockLID,popID,paramsScratch);
          Real tmp = 0.0;
          for (int i=0; i<WID3; ++i) tmp += data[blockLID*WID3+i];
          const Real DV3 = blockParams[BlockParams::DVX]*blockParams[BlockParams::DVY]*blockParams[BlockParams::DVZ];
          sum += tmp*DV3;
-         blockParams += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       }
       
       const Real correctSum = getCorrectNumberDensity(cell,popID);
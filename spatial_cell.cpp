@@ -20,7 +20,9 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
 #include <unordered_set>
+#include <cstring>
 #include <vectorclass.h>
 
 #include "spatial_cell.hpp"
@@ -37,6 +39,7 @@ namespace spatial_cell {
    int SpatialCell::activePopID = -1;
    uint64_t SpatialCell::mpi_transfer_type = 0;
    bool SpatialCell::mpiTransferAtSysBoundaries = false;
+   std::map<uint64_t,MPI_Datatype> SpatialCell::fixedLayoutDatatypes;
 
    SpatialCell::SpatialCell() {
       // Block list and cache always have room for all blocks
@@ -59,6 +62,9 @@ namespace spatial_cell {
       }
       //is transferred by default
       this->mpiTransferEnabled=true;
+      this->mpiDatatypeCache.datatype=MPI_DATATYPE_NULL;
+      this->migrationBufferSize=0;
+      this->migrationRound=0;
       
       // Set correct number of populations
       populations.resize(getObjectWrapper().particleSpecies.size());
@@ -68,6 +74,9 @@ namespace spatial_cell {
          const species::Species& spec = getObjectWrapper().particleSpecies[popID];
          populations[popID].vmesh.initialize(spec.velocityMesh);
          populations[popID].velocityBlockMinValue = spec.sparseMinValue;
+         populations[popID].fusedMomentsValid = false;
+         populations[popID].blockContentFlagsMinValue = 0;
+         populations[popID].blockContentFlagsMeshVersion = 0;
       }
    }
 
@@ -79,8 +88,12 @@ namespace spatial_cell {
      sysBoundaryFlag(other.sysBoundaryFlag),
      sysBoundaryLayer(other.sysBoundaryLayer),
      sysBoundaryLayerNew(other.sysBoundaryLayerNew),
+     migrationBufferSize(0),
+     migrationRound(0),
      populations(other.populations) {
 
+        mpiDatatypeCache.datatype = MPI_DATATYPE_NULL;
+
         //copy parameters
         for(unsigned int i=0;i< CellParams::N_SPATIAL_CELL_PARAMS;i++){
            parameters[i]=other.parameters[i];
@@ -98,6 +111,49 @@ namespace spatial_cell {
         for (unsigned int i=0; i<WID3; ++i) null_block_data[i] = 0.0;
    }
 
+   /** Frees the MPI datatype cached by this cell. The datatype is not copied 
+    * by the copy constructor, each cell owns its cache.*/
+   SpatialCell::~SpatialCell() {
+      int finalized;
+      MPI_Finalized(&finalized);
+      if (finalized) return;
+      free_mpi_datatype_cache();
+   }
+
+   /** Free the MPI datatype cached by this cell. Must be called before MPI is finalized.*/
+   void SpatialCell::free_mpi_datatype_cache() {
+      if (mpiDatatypeCache.datatype != MPI_DATATYPE_NULL) MPI_Type_free(&(mpiDatatypeCache.datatype));
+      mpiDatatypeCache.datatype = MPI_DATATYPE_NULL;
+      std::vector<MPI_Aint>().swap(mpiDatatypeCache.displacements);
+      std::vector<int>().swap(mpiDatatypeCache.block_lengths);
+   }
+
+   /** Free the MPI datatypes shared by all cells. Must be called before MPI is finalized.*/
+   void SpatialCell::free_fixed_layout_mpi_datatypes() {
+      for (std::map<uint64_t,MPI_Datatype>::iterator it=fixedLayoutDatatypes.begin(); it!=fixedLayoutDatatypes.end(); ++it) {
+         MPI_Type_free(&(it->second));
+      }
+      fixedLayoutDatatypes.clear();
+   }
+
+
+   #ifndef AMR
+   // Scratch arrays of adjust_velocity_blocks, reused by each thread between calls.
+   // adjustBlockMarks is a bitmap over all block global IDs of the velocity mesh,
+   // adjustMarkedBlocks lists the marked global IDs so that only they need to be cleared.
+   static thread_local std::vector<bool> adjustBlockMarks;
+   static thread_local std::vector<vmesh::GlobalID> adjustMarkedBlocks;
+
+   /** Mark the given block in adjust_velocity_blocks scratch arrays.
+    * Global IDs outside the velocity mesh (including the invalid ID) are ignored.
+    * @param blockGID Global ID of the block.*/
+   static inline void markAdjustBlock(const vmesh::GlobalID& blockGID) {
+      if (blockGID >= adjustBlockMarks.size()) return;
+      if (adjustBlockMarks[blockGID] == true) return;
+      adjustBlockMarks[blockGID] = true;
+      adjustMarkedBlocks.push_back(blockGID);
+   }
+   #endif
 
    /** Adds "important" and removes "unimportant" velocity blocks
     * to/from this cell.
@@ -132,42 +188,43 @@ namespace spatial_cell {
       }
       #endif
       
-      //  This set contains all those cellids which have neighbors in any
-      //  of the 6-dimensions Actually, we would only need to add
-      //  local blocks with no content here, as blocks with content
-      //  do not need to be created and also will not be removed as
-      //  we only check for removal for blocks with no content
-      std::unordered_set<vmesh::GlobalID> neighbors_have_content;
-
-      //add neighbor content info for velocity space neighbors to map. We loop over blocks
-      //with content and raise the neighbors_have_content for
-      //itself, and for all its neighbors
+      //  Mark all those blocks which have neighbors in any of the
+      //  6-dimensions. Actually, we would only need to mark local blocks
+      //  with no content here, as blocks with content do not need to be
+      //  created and also will not be removed as we only check for
+      //  removal for blocks with no content
+      const vmesh::LocalID* gridLength = populations[popID].vmesh.getGridLength(0);
+      const vmesh::GlobalID maxBlocks = (vmesh::GlobalID)gridLength[0]*gridLength[1]*gridLength[2];
+      if (adjustBlockMarks.size() < maxBlocks) adjustBlockMarks.resize(maxBlocks,false);
+      adjustMarkedBlocks.clear();
+
+      //add neighbor content info for velocity space neighbors. We loop over blocks
+      //with content and mark the block itself and all its neighbors
       for (vmesh::LocalID block_index=0; block_index<velocity_block_with_content_list.size(); ++block_index) {
          vmesh::GlobalID block = velocity_block_with_content_list[block_index];
 
          const uint8_t refLevel=0;
          const velocity_block_indices_t indices = SpatialCell::get_velocity_block_indices(popID,block);
-         neighbors_have_content.insert(block); //also add the cell itself
+         markAdjustBlock(block); //also add the cell itself
          
          for (int offset_vx=-P::sparseBlockAddWidthV;offset_vx<=P::sparseBlockAddWidthV;offset_vx++) {
             for (int offset_vy=-P::sparseBlockAddWidthV;offset_vy<=P::sparseBlockAddWidthV;offset_vy++) {
                for (int offset_vz=-P::sparseBlockAddWidthV;offset_vz<=P::sparseBlockAddWidthV;offset_vz++) {
                   const vmesh::GlobalID neighbor_block 
                      = get_velocity_block(popID,{{indices[0]+offset_vx,indices[1]+offset_vy,indices[2]+offset_vz}},refLevel);
-                  neighbors_have_content.insert(neighbor_block); //add all potential ngbrs of this block with content
+                  markAdjustBlock(neighbor_block); //add all potential ngbrs of this block with content
                }
             }
          }
       }
 
-      //add neighbor content info for spatial space neighbors to map. We loop over
-      //neighbor cell lists with existing blocks, and raise the
-      //flag for the local block with same block id
+      //add neighbor content info for spatial space neighbors. We loop over
+      //neighbor cell lists with existing blocks, and mark the
+      //local block with same block id
       for (std::vector<SpatialCell*>::const_iterator neighbor=spatial_neighbors.begin();
            neighbor != spatial_neighbors.end(); ++neighbor) {
          for (vmesh::LocalID block_index=0; block_index<(*neighbor)->velocity_block_with_content_list.size(); ++block_index) {
-            vmesh::GlobalID block = (*neighbor)->velocity_block_with_content_list[block_index];
-            neighbors_have_content.insert(block);
+            markAdjustBlock((*neighbor)->velocity_block_with_content_list[block_index]);
          }
       }
 
@@ -192,19 +249,20 @@ namespace spatial_cell {
             #endif
             
             bool removeBlock = false;
-            std::unordered_set<vmesh::GlobalID>::iterator it = neighbors_have_content.find(blockGID);
-            if (it == neighbors_have_content.end()) removeBlock = true;
+            if (adjustBlockMarks[blockGID] == false) removeBlock = true;
 
             if (removeBlock == true) {
                //No content, and also no neighbor have content -> remove
                //and increment rho loss counters
-               const Real* block_parameters = get_block_parameters(popID)+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+               Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+               const Real* block_parameters = get_block_parameters(blockLID,popID,paramsScratch);
                const Real DV3 = block_parameters[BlockParams::DVX]
                  * block_parameters[BlockParams::DVY]
                  * block_parameters[BlockParams::DVZ];
                Real sum=0;
                for (unsigned int i=0; i<WID3; ++i) sum += get_data(popID)[blockLID*SIZE_VELBLOCK+i];
                this->parameters[CellParams::RHOLOSSADJUST] += DV3*sum;
+               subtract_fused_block_moments(blockLID,popID);
 	       
                // and finally remove block
                this->remove_velocity_block(blockGID,popID);
@@ -212,47 +270,58 @@ namespace spatial_cell {
          }
       }
 
-      // ADD all blocks with neighbors in spatial or velocity space (if it exists then the block is unchanged)
-      for (std::unordered_set<vmesh::GlobalID>::iterator it=neighbors_have_content.begin(); it != neighbors_have_content.end(); ++it) {
-         this->add_velocity_block(*it,popID);
+      // ADD all blocks with neighbors in spatial or velocity space (if it exists then the block is unchanged),
+      // and clear the marks for the next call
+      for (size_t b=0; b<adjustMarkedBlocks.size(); ++b) {
+         this->add_velocity_block(adjustMarkedBlocks[b],popID);
+         adjustBlockMarks[adjustMarkedBlocks[b]] = false;
       }
    }
 
    #else       // AMR version
 
+   /** Sort the given list of global IDs and remove duplicates.
+    * @param blocks List of block global IDs.*/
+   static void sortUnique(std::vector<vmesh::GlobalID>& blocks) {
+      std::sort(blocks.begin(),blocks.end());
+      blocks.erase(std::unique(blocks.begin(),blocks.end()),blocks.end());
+   }
+
    void SpatialCell::adjust_velocity_blocks(const std::vector<SpatialCell*>& spatial_neighbors,
                                             const int& popID,bool doDeleteEmptyBlocks) {
-      //  This set contains all those cell ids which have neighbors in any
+      //  This sorted list contains all those cell ids which have neighbors in any
       //  of the 6-dimensions Actually, we would only need to add
       //  local blocks with no content here, as blocks with content
       //  do not need to be created and also will not be removed as
       //  we only check for removal for blocks with no content
-      std::unordered_set<vmesh::GlobalID> neighbors_have_content;
+      vector<vmesh::GlobalID> neighbors_have_content;
+      vector<vmesh::GlobalID> neighborGIDs;
 
       for (vmesh::LocalID block_index=0; block_index<velocity_block_with_content_list.size(); ++block_index) {
          vmesh::GlobalID blockGID = velocity_block_with_content_list[block_index];
-         vector<vmesh::GlobalID> neighborGIDs;
+         neighborGIDs.clear();
          populations[popID].vmesh.getNeighborsExistingAtSameLevel(blockGID,neighborGIDs);
-         neighbors_have_content.insert(neighborGIDs.begin(),neighborGIDs.end());
-         neighbors_have_content.insert(blockGID);
+         neighbors_have_content.insert(neighbors_have_content.end(),neighborGIDs.begin(),neighborGIDs.end());
+         neighbors_have_content.push_back(blockGID);
       }
+      sortUnique(neighbors_have_content);
 
       //add neighbor content info for spatial space neighbors to map. We loop over
       //neighbor cell lists with existing blocks, and raise the
       //flag for the local block with same block id
-      unordered_set<vmesh::GlobalID> spat_nbr_has_content;
+      vector<vmesh::GlobalID> spat_nbr_has_content;
       for (std::vector<SpatialCell*>::const_iterator neighbor=spatial_neighbors.begin();
            neighbor != spatial_neighbors.end(); ++neighbor) {
-         for (vmesh::LocalID block_index=0; block_index<(*neighbor)->velocity_block_with_content_list.size(); ++block_index) {
-            vmesh::GlobalID block = (*neighbor)->velocity_block_with_content_list[block_index];
-            spat_nbr_has_content.insert(block);
-         }
-      }      
+         const vector<vmesh::GlobalID>& nbrContent = (*neighbor)->velocity_block_with_content_list;
+         spat_nbr_has_content.insert(spat_nbr_has_content.end(),nbrContent.begin(),nbrContent.end());
+      }
+      sortUnique(spat_nbr_has_content);
 
       // REMOVE all blocks in this cell without content + without neighbors with content
       // better to do it in the reverse order, as then blocks at the
       // end are removed first, and we may avoid copying extra data.
       if (doDeleteEmptyBlocks) {
+         std::vector<vmesh::GlobalID> children;
          for (int block_index= this->velocity_block_with_no_content_list.size()-1; block_index>=0; --block_index) {
             const vmesh::GlobalID blockGID = this->velocity_block_with_no_content_list[block_index];
             #ifdef DEBUG_SPATIAL_CELL
@@ -272,17 +341,18 @@ namespace spatial_cell {
             bool removeBlock = false;
 
             // Check this block in the neighbor cells
-            if (neighbors_have_content.find(blockGID) != neighbors_have_content.end()) continue;
+            if (std::binary_search(neighbors_have_content.begin(),neighbors_have_content.end(),blockGID)) continue;
             
             // Check the parent of this block in the neighbor cells
-            if (neighbors_have_content.find(populations[popID].vmesh.getParent(blockGID)) != neighbors_have_content.end()) continue;
+            if (std::binary_search(neighbors_have_content.begin(),neighbors_have_content.end(),
+                                   populations[popID].vmesh.getParent(blockGID))) continue;
             
             // Check all the children of this block in the neighbor cells
-            std::vector<vmesh::GlobalID> children;
+            children.clear();
             populations[popID].vmesh.getChildren(blockGID,children);
             int counter = 0;
             for (size_t c=0; c<children.size(); ++c) {
-               if (neighbors_have_content.find(children[c]) != neighbors_have_content.end()) ++counter;
+               if (std::binary_search(neighbors_have_content.begin(),neighbors_have_content.end(),children[c])) ++counter;
             }
             if (counter > 0) continue;
             
@@ -292,13 +362,15 @@ namespace spatial_cell {
             if (removeBlock == true) {
                //No content, and also no neighbor have content -> remove
                //and increment rho loss counters
-               const Real* block_parameters = get_block_parameters(popID)+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+               Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+               const Real* block_parameters = get_block_parameters(blockLID,popID,paramsScratch);
                const Real DV3 = block_parameters[BlockParams::DVX]
                  * block_parameters[BlockParams::DVY]
                  * block_parameters[BlockParams::DVZ];
                Real sum=0;
                for (unsigned int i=0; i<WID3; ++i) sum += get_data(popID)[blockLID*SIZE_VELBLOCK+i];
                this->parameters[CellParams::RHOLOSSADJUST] += DV3*sum;
+               subtract_fused_block_moments(blockLID,popID);
 	       
                // and finally remove block
                this->remove_velocity_block(blockGID,popID);
@@ -308,12 +380,13 @@ namespace spatial_cell {
 
       // Filter the spat_nbr_has_content list so that it doesn't
       // contain overlapping blocks
-      unordered_set<vmesh::GlobalID> ghostBlockList;
+      vector<vmesh::GlobalID> ghostBlockList;
+      vector<vmesh::GlobalID> siblings;
       vector<vector<vmesh::GlobalID> > sorted(populations[popID].vmesh.getMaxAllowedRefinementLevel()+1);
 
       // First sort the list according to refinement levels. This allows
       // us to skip checking the existence of children and grandchildren below.
-      for (unordered_set<vmesh::GlobalID>::const_iterator it=spat_nbr_has_content.begin(); 
+      for (vector<vmesh::GlobalID>::const_iterator it=spat_nbr_has_content.begin(); 
            it!=spat_nbr_has_content.end(); ++it) {
          sorted[populations[popID].vmesh.getRefinementLevel(*it)].push_back(*it);         
       }
@@ -324,10 +397,11 @@ namespace spatial_cell {
          for (size_t b=0; b<sorted[r].size(); ++b) {
             // If parent exists, all siblings must exist
             if (r > 0) {
-               if (spat_nbr_has_content.find(populations[popID].vmesh.getParent(sorted[r][b])) != spat_nbr_has_content.end()) {
-                  vector<vmesh::GlobalID> siblings;
+               if (std::binary_search(spat_nbr_has_content.begin(),spat_nbr_has_content.end(),
+                                      populations[popID].vmesh.getParent(sorted[r][b]))) {
+                  siblings.clear();
                   populations[popID].vmesh.getSiblings(sorted[r][b],siblings);
-                  ghostBlockList.insert(siblings.begin(),siblings.end());
+                  ghostBlockList.insert(ghostBlockList.end(),siblings.begin(),siblings.end());
                   continue;
                }
             }
@@ -335,27 +409,29 @@ namespace spatial_cell {
             // If grandparent exists, parent octant must exist
             if (r > 1) {
                vmesh::GlobalID grandParentGID = populations[popID].vmesh.getParent(populations[popID].vmesh.getParent(sorted[r][b]));
-               if (spat_nbr_has_content.find(grandParentGID) != spat_nbr_has_content.end()) {
-                  vector<vmesh::GlobalID> siblings;
+               if (std::binary_search(spat_nbr_has_content.begin(),spat_nbr_has_content.end(),grandParentGID)) {
+                  siblings.clear();
                   populations[popID].vmesh.getSiblings(populations[popID].vmesh.getParent(sorted[r][b]),siblings);
-                  ghostBlockList.insert(siblings.begin(),siblings.end());
+                  ghostBlockList.insert(ghostBlockList.end(),siblings.begin(),siblings.end());
                   continue;
                }
             }
 
             // Parent or grandparent does not exist, add this block
-            ghostBlockList.insert(sorted[r][b]);
+            ghostBlockList.push_back(sorted[r][b]);
          }         
       }
+      sortUnique(ghostBlockList);
 
       // Add missing no-content blocks
-      for (unordered_set<vmesh::GlobalID>::const_iterator it=ghostBlockList.begin();
+      std::vector<vmesh::GlobalID> children;
+      for (vector<vmesh::GlobalID>::const_iterator it=ghostBlockList.begin();
            it != ghostBlockList.end(); ++it) {
          // Parent already exists
          if (populations[popID].vmesh.getLocalID(populations[popID].vmesh.getParent(*it)) != vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>::invalidLocalID()) continue;
 
          // If any children exist, make sure they all exist
-         std::vector<vmesh::GlobalID> children;
+         children.clear();
          populations[popID].vmesh.getChildren(*it,children);
          bool childrensExist = false;
          for (size_t c=0; c<children.size(); ++c) {
@@ -582,6 +658,56 @@ namespace spatial_cell {
       return populations[popID].max_dt[species::MAXVDT];
    }
 
+   /** Get the velocity moments of the given species accumulated by the
+    * Vlasov solvers, indexed by FusedMoments. The values are meaningful only
+    * if has_fused_moments returns true.
+    * @param popID ID of the particle species.
+    * @return Pointer to the fused moments of the species.*/
+   Real* SpatialCell::get_fused_moments(const int& popID) {
+      #ifdef DEBUG_SPATIAL_CELL
+      if (popID >= populations.size()) {
+         std::cerr << "ERROR, popID " << popID << " exceeds populations.size() " << populations.size() << " in ";
+         std::cerr << __FILE__ << ":" << __LINE__ << std::endl;             
+         exit(1);
+      }
+      #endif
+      
+      return populations[popID].fusedMoments;
+   }
+
+   /** Get the cached velocity block columns of a particle species along the given dimension.
+    * The columns are valid only if their meshVersion equals the version of the velocity mesh.
+    * @param dimension Velocity dimension, 0 for vx, 1 for vy and 2 for vz.
+    * @param popID ID of the particle species.*/
+   VelocityBlockColumns& SpatialCell::get_velocity_block_columns(const uint& dimension,const int& popID) {
+      #ifdef DEBUG_SPATIAL_CELL
+      if (popID >= populations.size()) {
+         std::cerr << "ERROR, popID " << popID << " exceeds populations.size() " << populations.size() << " in ";
+         std::cerr << __FILE__ << ":" << __LINE__ << std::endl;             
+         exit(1);
+      }
+      #endif
+      
+      return populations[popID].blockColumns[dimension];
+   }
+
+   /** Check if the fused moments of the given species are up to date, 
+    * i.e., they were accumulated when the current distribution function 
+    * was written and have not been consumed by a moment calculation yet.
+    * @param popID ID of the particle species.
+    * @return If true, fused moments can be used instead of recomputing the moments.*/
+   bool SpatialCell::has_fused_moments(const int& popID) const {
+      #ifdef DEBUG_SPATIAL_CELL
+      if (popID >= populations.size()) {
+         std::cerr << "ERROR, popID " << popID << " exceeds populations.size() " << populations.size() << " in ";
+         std::cerr << __FILE__ << ":" << __LINE__ << std::endl;             
+         exit(1);
+      }
+      #endif
+      
+      return populations[popID].fusedMomentsValid;
+   }
+
    /** Get MPI datatype for sending the cell data.
     * @param cellID Spatial cell (dccrg) ID.
     * @param sender_rank Rank of the MPI process sending data from this cell.
@@ -599,8 +725,43 @@ namespace spatial_cell {
 
       std::vector<MPI_Aint> displacements;
       std::vector<int> block_lengths;
-      vmesh::LocalID block_index = 0;
+      get_mpi_datatype_blocks(receiving,displacements,block_lengths);
+
+      void* address = this;
+      int count = 0;
+      MPI_Datatype datatype = MPI_BYTE;
+      if (displacements.size() == 0) return std::make_tuple(address,count,datatype);
+
+      // dccrg frees the returned datatype after the transfer, so a
+      // duplicate of the cached (committed) datatype is returned
+      MPI_Datatype cachedType;
+      if ((SpatialCell::mpi_transfer_type & Transfer::VARIABLE_LAYOUT) == 0) {
+         // Offsets of in-object data are the same in all cells
+         std::map<uint64_t,MPI_Datatype>::const_iterator it = fixedLayoutDatatypes.find(SpatialCell::mpi_transfer_type);
+         if (it == fixedLayoutDatatypes.end()) {
+            MPI_Type_create_hindexed(displacements.size(),&block_lengths[0],&displacements[0],MPI_BYTE,&cachedType);
+            MPI_Type_commit(&cachedType);
+            fixedLayoutDatatypes[SpatialCell::mpi_transfer_type] = cachedType;
+         } else {
+            cachedType = it->second;
+         }
+      } else {
+         cachedType = get_cached_mpi_datatype(displacements,block_lengths);
+      }
 
+      count = 1;
+      MPI_Type_dup(cachedType,&datatype);
+      return std::make_tuple(address,count,datatype);
+   }
+
+   /** Add the displacements (relative to this cell) and lengths of the data 
+    * selected by SpatialCell::mpi_transfer_type to the given vectors. The 
+    * receiving side resizes block lists here as needed.
+    * @param receiving If true, this process is receiving data.
+    * @param displacements Displacements of the transferred data.
+    * @param block_lengths Lengths of the transferred data in bytes.*/
+   void SpatialCell::get_mpi_datatype_blocks(const bool receiving,std::vector<MPI_Aint>& displacements,
+                                             std::vector<int>& block_lengths) {
       // create datatype for actual data if we are in the first two 
       // layers around a boundary, or if we send for the whole system
       if (this->mpiTransferEnabled && (SpatialCell::mpiTransferAtSysBoundaries==false || this->sysBoundaryLayer ==1 || this->sysBoundaryLayer ==2 )) {
@@ -629,6 +790,22 @@ namespace spatial_cell {
             block_lengths.push_back(sizeof(vmesh::GlobalID) * populations[activePopID].vmesh.size());
          }
 
+         if ((SpatialCell::mpi_transfer_type & Transfer::MIGRATION_STAGE1) != 0) {
+            // send size of the packed velocity meshes and the transfer round
+            if (!receiving) this->migrationBufferSize = get_migration_buffer_size();
+            displacements.push_back((uint8_t*) &(this->migrationBufferSize) - (uint8_t*) this);
+            block_lengths.push_back(sizeof(uint64_t));
+            displacements.push_back((uint8_t*) &(this->migrationRound) - (uint8_t*) this);
+            block_lengths.push_back(sizeof(uint64_t));
+         }
+
+         if ((SpatialCell::mpi_transfer_type & Transfer::MIGRATION_STAGE2) != 0) {
+            // MIGRATION_STAGE1 should have been done, and on the sending side pack_migration_buffer called
+            if (receiving) this->migrationBuffer.resize(this->migrationBufferSize);
+            displacements.push_back((uint8_t*) &(this->migrationBuffer[0]) - (uint8_t*) this);
+            block_lengths.push_back(this->migrationBufferSize);
+         }
+
          if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_WITH_CONTENT_STAGE1) !=0) {
             //Communicate size of list so that buffers can be allocated on receiving side
             if (!receiving) this->velocity_block_with_content_list_size = this->velocity_block_with_content_list.size();
@@ -781,10 +958,12 @@ namespace spatial_cell {
             block_lengths.push_back(sizeof(int));
          }
          
+         #ifndef VBC_NO_BLOCK_PARAMETERS
          if ((SpatialCell::mpi_transfer_type & Transfer::VEL_BLOCK_PARAMETERS) !=0) {
             displacements.push_back((uint8_t*) get_block_parameters(activePopID) - (uint8_t*) this);
             block_lengths.push_back(sizeof(Real) * size(activePopID) * BlockParams::N_VELOCITY_BLOCK_PARAMS);
          }
+         #endif
          // Copy particle species metadata
          if ((SpatialCell::mpi_transfer_type & Transfer::POP_METADATA) != 0) {
             for (unsigned int popID=0; popID<populations.size(); ++popID) {
@@ -800,26 +979,32 @@ namespace spatial_cell {
          //   block_lengths.push_back(sizeof(random_data));
          //}
       }
+   }
 
-      void* address = this;
-      int count;
-      MPI_Datatype datatype;
-      
-      if (displacements.size() > 0) {
-         count = 1;
-         MPI_Type_create_hindexed(
-            displacements.size(),
-            &block_lengths[0],
-            &displacements[0],
-            MPI_BYTE,
-            &datatype
-         );
-      } else {
-         count = 0;
-         datatype = MPI_BYTE;
-      }
-
-      return std::make_tuple(address,count,datatype);
+   /** Get a committed MPI datatype for the given layout. Only the datatype of the 
+    * last transfer is kept, it is reused when the same transfer repeats with an 
+    * unchanged velocity mesh, e.g., the block data transfers of the translation. 
+    * A committed datatype takes 1-4 kB, so caching more layouts per cell would 
+    * cost more memory than the 0.1-0.6 us per transfer it saves.
+    * @param displacements Displacements of the transferred data.
+    * @param block_lengths Lengths of the transferred data in bytes.
+    * @return Cached datatype, must not be freed by the caller.*/
+   MPI_Datatype SpatialCell::get_cached_mpi_datatype(const std::vector<MPI_Aint>& displacements,
+                                                     const std::vector<int>& block_lengths) {
+      MPIDatatypeCacheEntry& entry = mpiDatatypeCache;
+      if (entry.datatype != MPI_DATATYPE_NULL
+          && entry.displacements == displacements
+          && entry.block_lengths == block_lengths) {
+         return entry.datatype;
+      }
+
+      if (entry.datatype != MPI_DATATYPE_NULL) MPI_Type_free(&(entry.datatype));
+      entry.displacements = displacements;
+      entry.block_lengths = block_lengths;
+      MPI_Type_create_hindexed(displacements.size(),&(entry.block_lengths[0]),&(entry.displacements[0]),
+                               MPI_BYTE,&(entry.datatype));
+      MPI_Type_commit(&(entry.datatype));
+      return entry.datatype;
    }
    
    /** Get random number generator data buffer.
@@ -1286,6 +1471,7 @@ namespace spatial_cell {
       populations[popID].vmesh.setGrid();
       populations[popID].blockContainer.setSize(populations[popID].vmesh.size());
 
+      #ifndef VBC_NO_BLOCK_PARAMETERS
       Real* parameters = get_block_parameters(popID);
       
       // Set velocity block parameters:
@@ -1297,6 +1483,67 @@ namespace spatial_cell {
          populations[popID].vmesh.getCellSize(blockGID,&(parameters[BlockParams::DVX]));
          parameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       }
+      #endif
+   }
+
+   /** Get the size of the velocity meshes and block data of all populations 
+    * packed by pack_migration_buffer.
+    * @return Size of the packed data in bytes.*/
+   uint64_t SpatialCell::get_migration_buffer_size() const {
+      uint64_t bytes = populations.size() * sizeof(vmesh::LocalID);
+      for (size_t popID=0; popID<populations.size(); ++popID) {
+         bytes += populations[popID].blockContainer.size() * (sizeof(vmesh::GlobalID) + WID3*sizeof(Realf));
+      }
+      return bytes;
+   }
+
+   /** Pack the velocity meshes and block data of all populations into one contiguous 
+    * buffer that is sent with Transfer::MIGRATION_STAGE2 when the cell migrates to 
+    * another process. The layout is the number of blocks of each population, followed 
+    * by the block global IDs and block data of each population. Block parameters are 
+    * not sent, the receiving process recomputes them.*/
+   void SpatialCell::pack_migration_buffer() {
+      migrationBufferSize = get_migration_buffer_size();
+      migrationBuffer.resize(migrationBufferSize);
+      uint8_t* ptr = &(migrationBuffer[0]);
+      for (size_t popID=0; popID<populations.size(); ++popID) {
+         const vmesh::LocalID nBlocks = populations[popID].blockContainer.size();
+         memcpy(ptr,&nBlocks,sizeof(vmesh::LocalID));
+         ptr += sizeof(vmesh::LocalID);
+      }
+      for (size_t popID=0; popID<populations.size(); ++popID) {
+         const vmesh::LocalID nBlocks = populations[popID].blockContainer.size();
+         if (nBlocks == 0) continue;
+         memcpy(ptr,&(populations[popID].vmesh.getGrid()[0]),nBlocks*sizeof(vmesh::GlobalID));
+         ptr += nBlocks*sizeof(vmesh::GlobalID);
+         memcpy(ptr,get_data(popID),nBlocks*WID3*sizeof(Realf));
+         ptr += nBlocks*WID3*sizeof(Realf);
+      }
+   }
+
+   /** Restore the velocity meshes and block data of all populations from the buffer 
+    * received with Transfer::MIGRATION_STAGE2, and free the buffer.*/
+   void SpatialCell::unpack_migration_buffer() {
+      const uint8_t* ptr = &(migrationBuffer[0]);
+      std::vector<vmesh::LocalID> nBlocks(populations.size());
+      for (size_t popID=0; popID<populations.size(); ++popID) {
+         memcpy(&(nBlocks[popID]),ptr,sizeof(vmesh::LocalID));
+         ptr += sizeof(vmesh::LocalID);
+      }
+      for (size_t popID=0; popID<populations.size(); ++popID) {
+         populations[popID].N_blocks = nBlocks[popID];
+         populations[popID].vmesh.setNewSize(nBlocks[popID]);
+         if (nBlocks[popID] > 0) {
+            memcpy(&(populations[popID].vmesh.getGrid()[0]),ptr,nBlocks[popID]*sizeof(vmesh::GlobalID));
+            ptr += nBlocks[popID]*sizeof(vmesh::GlobalID);
+         }
+         prepare_to_receive_blocks(popID);
+         if (nBlocks[popID] > 0) {
+            memcpy(get_data(popID),ptr,nBlocks[popID]*WID3*sizeof(Realf));
+            ptr += nBlocks[popID]*WID3*sizeof(Realf);
+         }
+      }
+      clear_migration_buffer();
    }
 
    void SpatialCell::refine_block(const vmesh::GlobalID& blockGID,std::map<vmesh::GlobalID,vmesh::LocalID>& insertedBlocks,const int& popID) {
@@ -1328,9 +1575,11 @@ namespace spatial_cell {
             
             
             // Set refined block parameters
+            #ifndef VBC_NO_BLOCK_PARAMETERS
             Real* blockParams = populations[popID].blockContainer.getParameters(ins->second);
             populations[popID].vmesh.getBlockCoordinates(ins->first,blockParams);
             populations[popID].vmesh.getCellSize(ins->first,blockParams+3);
+            #endif
             
             ++ins;
          }
@@ -1338,9 +1587,11 @@ namespace spatial_cell {
       
       for (std::map<vmesh::GlobalID,vmesh::LocalID>::iterator it=newInserted.begin(); it!=newInserted.end(); ++it) {
          // Set refined block parameters
+         #ifndef VBC_NO_BLOCK_PARAMETERS
          Real* blockParams = populations[popID].blockContainer.getParameters(it->second);
          populations[popID].vmesh.getBlockCoordinates(it->first,blockParams);
          populations[popID].vmesh.getCellSize(it->first,blockParams+3);
+         #endif
          
       }
 
@@ -1396,6 +1647,83 @@ namespace spatial_cell {
       populations[popID].max_dt[species::MAXVDT] = value;
    }
 
+   /** Set fused moments of a particle species to zero and mark them invalid.
+    * This is called before a Vlasov solver starts to accumulate them. The 
+    * reference velocity of the moments is set to the current bulk velocity of the cell.
+    * @param popID ID of the particle species.*/
+   void SpatialCell::clear_fused_moments(const int& popID) {
+      Real* fused = populations[popID].fusedMoments;
+      for (int m=0; m<FusedMoments::N_FUSED_SUMS; ++m) fused[m] = 0.0;
+      const Real RHO = parameters[CellParams::RHO];
+      for (int d=0; d<3; ++d) {
+         fused[FusedMoments::UX+d] = 0.0;
+         if (RHO > 0.0) fused[FusedMoments::UX+d] = parameters[CellParams::RHOVX+d] / RHO;
+      }
+      populations[popID].fusedMomentsValid = false;
+   }
+
+   /** Mark fused moments of a particle species valid or invalid.
+    * @param popID ID of the particle species.
+    * @param valid If true, fused moments match the current distribution function.*/
+   void SpatialCell::set_fused_moments_valid(const int& popID,const bool& valid) {
+      populations[popID].fusedMomentsValid = valid;
+   }
+
+   /** Record which velocity blocks of a particle species have content. This is called by
+    * solvers that have just written the final values of all blocks, the recorded flags
+    * are used by the next call of update_velocity_block_content_lists instead of 
+    * reading through the distribution function again. Changing the velocity mesh 
+    * after this call invalidates the flags.
+    * @param blocksWithContent Global IDs of blocks that have content, all other existing blocks have no content.
+    * @param minValue Sparse min value that was used to compute content.
+    * @param popID ID of the particle species.*/
+   void SpatialCell::set_velocity_block_content_flags(const std::vector<vmesh::GlobalID>& blocksWithContent,
+                                                      const Real& minValue,const int& popID) {
+      Population& pop = populations[popID];
+      pop.blockContentFlags.assign(pop.vmesh.size(),false);
+      pop.blockContentFlagsMinValue = minValue;
+      pop.blockContentFlagsMeshVersion = pop.vmesh.getVersion();
+      for (size_t b=0; b<blocksWithContent.size(); ++b) {
+         const vmesh::LocalID blockLID = pop.vmesh.getLocalID(blocksWithContent[b]);
+         if (blockLID == invalid_local_id()) {
+            // Mesh does not match the recorded blocks, fall back to a full rescan
+            pop.blockContentFlags.clear();
+            return;
+         }
+         pop.blockContentFlags[blockLID] = true;
+      }
+   }
+
+   /** Remove the contribution of the given velocity block from the fused 
+    * moments of the species. This is called before the block is deleted 
+    * so that fused moments stay valid. Does nothing if fused moments are invalid.
+    * @param blockLID Local ID of the velocity block.
+    * @param popID ID of the particle species.*/
+   void SpatialCell::subtract_fused_block_moments(const vmesh::LocalID& blockLID,const int& popID) {
+      if (populations[popID].fusedMomentsValid == false) return;
+
+      const Real HALF = 0.5;
+      Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+      const Real* blockParams = get_block_parameters(blockLID,popID,paramsScratch);
+      const Realf* data = get_data(blockLID,popID);
+      Real* fused = populations[popID].fusedMoments;
+      const Real DV3 = blockParams[BlockParams::DVX]*blockParams[BlockParams::DVY]*blockParams[BlockParams::DVZ];
+      // Velocities are relative to the reference velocity of the fused moments
+      for (uint k=0; k<WID; ++k) for (uint j=0; j<WID; ++j) for (uint i=0; i<WID; ++i) {
+         const Real VX = blockParams[BlockParams::VXCRD] + (i+HALF)*blockParams[BlockParams::DVX] - fused[FusedMoments::UX];
+         const Real VY = blockParams[BlockParams::VYCRD] + (j+HALF)*blockParams[BlockParams::DVY] - fused[FusedMoments::UY];
+         const Real VZ = blockParams[BlockParams::VZCRD] + (k+HALF)*blockParams[BlockParams::DVZ] - fused[FusedMoments::UZ];
+         const Real value = data[cellIndex(i,j,k)]*DV3;
+         fused[FusedMoments::M0 ] -= value;
+         fused[FusedMoments::M1X] -= value*VX;
+         fused[FusedMoments::M1Y] -= value*VY;
+         fused[FusedMoments::M1Z] -= value*VZ;
+         fused[FusedMoments::M2X] -= value*VX*VX;
+         fused[FusedMoments::M2Y] -= value*VY*VY;
+         fused[FusedMoments::M2Z] -= value*VZ*VZ;
+      }
+   }
+
    /**  Purges extra capacity from block vectors. It sets size to
     * num_blocks * block_allocation_factor (if capacity greater than this), 
     * and also forces capacity to this new smaller value.
@@ -1428,6 +1756,27 @@ namespace spatial_cell {
       velocity_block_with_content_list.clear();
       velocity_block_with_no_content_list.clear();
       
+      // Use content flags recorded by the acceleration solver if they were recorded for 
+      // the current velocity mesh, they are consumed here so that a later mesh change 
+      // cannot reuse them. The mesh version changes whenever blocks are added or removed, 
+      // so equal versions mean that the flags index the same blocks.
+      Population& pop = populations[popID];
+      if (pop.blockContentFlagsMeshVersion == pop.vmesh.getVersion()
+          && pop.blockContentFlags.size() == pop.vmesh.size()
+          && pop.blockContentFlagsMinValue == getVelocityBlockMinValue(popID)) {
+         for (vmesh::LocalID block_index=0; block_index<pop.vmesh.size(); ++block_index) {
+            const vmesh::GlobalID globalID = pop.vmesh.getGlobalID(block_index);
+            if (pop.blockContentFlags[block_index] == true) {
+               velocity_block_with_content_list.push_back(globalID);
+            } else {
+               velocity_block_with_no_content_list.push_back(globalID);
+            }
+         }
+         pop.blockContentFlags.clear();
+         return;
+      }
+      pop.blockContentFlags.clear();
+      
       for (vmesh::LocalID block_index=0; block_index<populations[popID].vmesh.size(); ++block_index) {
          const vmesh::GlobalID globalID = populations[popID].vmesh.getGlobalID(block_index);
          if (compute_block_has_content(globalID,popID)){
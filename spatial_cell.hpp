@@ -118,6 +118,17 @@ namespace spatial_cell {
       const uint64_t POP_METADATA             = (1<<27);
       const uint64_t RANDOMGEN                = (1<<28);
       const uint64_t CELL_GRADPE_TERM         = (1<<29);
+      const uint64_t MIGRATION_STAGE1         = (1<<30);
+      const uint64_t MIGRATION_STAGE2         = ((uint64_t)1<<31);
+      
+      //transfers whose layout depends on heap-allocated per-cell data, 
+      //all other transfers have the same layout in every cell
+      const uint64_t VARIABLE_LAYOUT =
+      VEL_BLOCK_LIST_STAGE1 | VEL_BLOCK_LIST_STAGE2
+      | VEL_BLOCK_DATA | VEL_BLOCK_PARAMETERS
+      | VEL_BLOCK_WITH_CONTENT_STAGE1 | VEL_BLOCK_WITH_CONTENT_STAGE2
+      | NEIGHBOR_VEL_BLOCK_DATA | POP_METADATA
+      | MIGRATION_STAGE2;
       //all data
       const uint64_t ALL_DATA =
       CELL_PARAMETERS
@@ -144,6 +155,36 @@ namespace spatial_cell {
                                                                                * Note: these are the (i,j,k) indices of the block.
                                                                                * Valid values are ([0,vx_length[,[0,vy_length[,[0,vz_length[).*/
 
+   /** Velocity blocks of a mesh sorted into columns along one dimension, see 
+    * sortBlocklistByDimension. Cached by the acceleration solver and valid as long
+    * as the version of the velocity mesh equals meshVersion.*/
+   struct VelocityBlockColumns {
+      VelocityBlockColumns(): meshVersion(std::numeric_limits<uint64_t>::max()) { }
+      uint64_t meshVersion;                                          /**< Velocity mesh version the columns were computed from.*/
+      std::vector<vmesh::GlobalID> blocks;                           /**< Block global IDs sorted into columns.*/
+      std::vector<uint> columnBlockOffsets;                          /**< Offset of each column in blocks.*/
+      std::vector<uint> columnNumBlocks;                             /**< Number of blocks in each column.*/
+      std::vector<uint> setColumnOffsets;                            /**< Index of the first column of each column set.*/
+      std::vector<uint> setNumColumns;                               /**< Number of columns in each column set.*/
+
+      /** Invalidate the columns and free their memory.*/
+      void clear() {
+         meshVersion = std::numeric_limits<uint64_t>::max();
+         std::vector<vmesh::GlobalID>().swap(blocks);
+         std::vector<uint>().swap(columnBlockOffsets);
+         std::vector<uint>().swap(columnNumBlocks);
+         std::vector<uint>().swap(setColumnOffsets);
+         std::vector<uint>().swap(setNumColumns);
+      }
+
+      /** Get the memory reserved for the columns in bytes.*/
+      uint64_t capacityInBytes() const {
+         return blocks.capacity()*sizeof(vmesh::GlobalID)
+              + (columnBlockOffsets.capacity() + columnNumBlocks.capacity()
+                 + setColumnOffsets.capacity() + setNumColumns.capacity())*sizeof(uint);
+      }
+   };
+
    /** Wrapper for variables needed for each particle species.*/
    struct Population {
       Real max_dt[2];                                                /**< Element[0] is max_r_dt, element[1] max_v_dt.*/
@@ -154,12 +195,39 @@ namespace spatial_cell {
                                                                       * in this spatial cell. Cells are identified by their unique 
                                                                       * global IDs.*/
       vmesh::VelocityBlockContainer<vmesh::LocalID> blockContainer;  /**< Velocity block data.*/
+      Real fusedMoments[FusedMoments::N_FUSED_MOMENTS];              /**< Velocity moments accumulated by the Vlasov solvers, see FusedMoments.*/
+      bool fusedMomentsValid;                                        /**< If true, fusedMoments match the current distribution function.*/
+      std::vector<bool> blockContentFlags;                           /**< Content flags of velocity blocks indexed by local ID, recorded 
+                                                                      * by the acceleration solver. Valid only if recorded for the current mesh version.*/
+      Real blockContentFlagsMinValue;                                /**< velocityBlockMinValue that was used to compute blockContentFlags.*/
+      uint64_t blockContentFlagsMeshVersion;                         /**< Version of vmesh for which blockContentFlags were recorded.*/
+      VelocityBlockColumns blockColumns[3];                          /**< Block columns along vx, vy and vz cached by the acceleration solver.*/
    };
 
+   /** Get the parameters (see BlockParams) of a velocity block. By default the parameters
+    * are stored in the block container and scratch is not used. If Vlasiator was compiled
+    * with VBC_NO_BLOCK_PARAMETERS the parameters are computed from the velocity mesh into scratch.
+    * @param vmesh Velocity mesh of the population.
+    * @param blockContainer Block container of the population.
+    * @param blockLID Local ID of the velocity block.
+    * @param scratch Array of at least BlockParams::N_VELOCITY_BLOCK_PARAMS elements.
+    * @return Pointer to the block parameters, valid until scratch is reused or the container changes.*/
+   inline const Real* getBlockParameters(const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
+                                         const vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer,
+                                         const vmesh::LocalID& blockLID,Real* scratch) {
+      #ifdef VBC_NO_BLOCK_PARAMETERS
+      vmesh.getBlockInfo(vmesh.getGlobalID(blockLID),scratch);
+      return scratch;
+      #else
+      return blockContainer.getParameters(blockLID);
+      #endif
+   }
+
    class SpatialCell {
    public:
       SpatialCell();
       SpatialCell(const SpatialCell& other);
+      ~SpatialCell();
 
       // Following functions return velocity grid metadata //
       template<int PAD> void fetch_data(const vmesh::GlobalID& blockGID,const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
@@ -173,10 +241,13 @@ namespace spatial_cell {
       const Realf* get_data(const int& popID) const;
       Realf* get_data(const vmesh::LocalID& blockLID,const int& popID);
       const Realf* get_data(const vmesh::LocalID& blockLID,const int& popID) const;
+      #ifndef VBC_NO_BLOCK_PARAMETERS
       Real* get_block_parameters(const int& popID);
       const Real* get_block_parameters(const int& popID) const;
       Real* get_block_parameters(const vmesh::LocalID& blockLID,const int& popID);
       const Real* get_block_parameters(const vmesh::LocalID& blockLID,const int& popID) const;
+      #endif
+      const Real* get_block_parameters(const vmesh::LocalID& blockLID,const int& popID,Real* scratch) const;
 
       Real* get_cell_parameters();
       const Real* get_cell_parameters() const;
@@ -188,6 +259,9 @@ namespace spatial_cell {
       uint8_t get_maximum_refinement_level(const int& popID);
       const Real& get_max_r_dt(const int& popID) const;
       const Real& get_max_v_dt(const int& popID) const;
+      Real* get_fused_moments(const int& popID);
+      VelocityBlockColumns& get_velocity_block_columns(const uint& dimension,const int& popID);
+      bool has_fused_moments(const int& popID) const;
 
       const vmesh::LocalID* get_velocity_grid_length(const int& popID,const uint8_t& refLevel=0);
       const Real* get_velocity_grid_block_size(const int& popID,const uint8_t& refLevel=0);
@@ -257,6 +331,10 @@ namespace spatial_cell {
       uint64_t get_cell_memory_size();
       void merge_values(const int& popID);
       void prepare_to_receive_blocks(const int& popID);
+      uint64_t get_migration_buffer_size() const;
+      void pack_migration_buffer();
+      void unpack_migration_buffer();
+      void clear_migration_buffer();
       bool shrink_to_fit();
       size_t size(const int& popID) const;
       void remove_velocity_block(const vmesh::GlobalID& block,const int& popID);
@@ -273,6 +351,10 @@ namespace spatial_cell {
       void increment_value(const vmesh::GlobalID& block,const unsigned int cell,const Realf value,const int& popID);
       void set_max_r_dt(const int& popID,const Real& value);
       void set_max_v_dt(const int& popID,const Real& value);
+      void clear_fused_moments(const int& popID);
+      void set_fused_moments_valid(const int& popID,const bool& valid);
+      void set_velocity_block_content_flags(const std::vector<vmesh::GlobalID>& blocksWithContent,
+                                            const Real& minValue,const int& popID);
       void set_value(const Real vx, const Real vy, const Real vz, const Realf value,const int& popID);
       void set_value(const vmesh::GlobalID& block,const unsigned int cell, const Realf value,const int& popID);
       void refine_block(const vmesh::GlobalID& block,std::map<vmesh::GlobalID,vmesh::LocalID>& insertedBlocks,
@@ -285,6 +367,8 @@ namespace spatial_cell {
                                                             const bool receiving,const int neighborhood);
       static uint64_t get_mpi_transfer_type(void);
       static void set_mpi_transfer_type(const uint64_t type,bool atSysBoundaries=false);
+      void free_mpi_datatype_cache();
+      static void free_fixed_layout_mpi_datatypes();
       void set_mpi_transfer_enabled(bool transferEnabled);
       void updateSparseMinValue(const int& popID);
       Real getVelocityBlockMinValue(const int& popID) const;
@@ -317,6 +401,9 @@ namespace spatial_cell {
       std::vector<vmesh::GlobalID> velocity_block_with_no_content_list;       /**< List of existing cells with no content, only up-to-date after
                                                                                * call to update_has_content. This is also never transferred
                                                                                * over MPI, so is invalid on remote cells.*/
+      uint64_t migrationBufferSize;                                           /**< Size of migrationBuffer in bytes. Needed for MPI communication of size 
+                                                                               * before the buffer is transferred when the cell migrates.*/
+      uint64_t migrationRound;                                                /**< Load balance transfer round in which the cell migrates.*/
       static uint64_t mpi_transfer_type;                                      /**< Which data is transferred by the mpi datatype given by spatial cells.*/
       static bool mpiTransferAtSysBoundaries;                                 /**< Do we only transfer data at boundaries (true), or in the whole system (false).*/
 
@@ -324,6 +411,11 @@ namespace spatial_cell {
       SpatialCell& operator=(const SpatialCell&);
       
       bool compute_block_has_content(const vmesh::GlobalID& block,const int& popID) const;
+      void get_mpi_datatype_blocks(const bool receiving,std::vector<MPI_Aint>& displacements,
+                                   std::vector<int>& block_lengths);
+      MPI_Datatype get_cached_mpi_datatype(const std::vector<MPI_Aint>& displacements,
+                                           const std::vector<int>& block_lengths);
+      void subtract_fused_block_moments(const vmesh::LocalID& blockLID,const int& popID);
       void merge_values_recursive(const int& popID,vmesh::GlobalID parentGID,vmesh::GlobalID blockGID,uint8_t refLevel,bool recursive,const Realf* data,
 				  std::set<vmesh::GlobalID>& blockRemovalList);
 
@@ -341,7 +433,20 @@ namespace spatial_cell {
                                                                                  * NOTE: Do not call the get-functions using this mesh as object
                                                                                  * before you have set the correct meshID using setMesh function.*/
       vmesh::VelocityBlockContainer<vmesh::LocalID> blockContainerTemp;
+      std::vector<uint8_t> migrationBuffer;                                     /**< Velocity meshes and block data of all populations packed 
+                                                                                 * into one message, only allocated while the cell migrates.*/
       std::vector<spatial_cell::Population> populations;                        /**< Particle population variables.*/
+
+      /** Committed MPI datatype of one transfer, together with the layout it was created for.*/
+      struct MPIDatatypeCacheEntry {
+         std::vector<MPI_Aint> displacements;
+         std::vector<int> block_lengths;
+         MPI_Datatype datatype;
+      };
+      MPIDatatypeCacheEntry mpiDatatypeCache;                                   /**< Datatype of the last transfer with variable layout,
+                                                                                 * MPI_DATATYPE_NULL if there is none.*/
+      static std::map<uint64_t,MPI_Datatype> fixedLayoutDatatypes;              /**< Datatypes of transfers whose layout is the 
+                                                                                 * same in all cells, indexed by transfer type.*/
    };
 
    /****************************
@@ -795,6 +900,7 @@ namespace spatial_cell {
       return populations[popID].blockContainer.getData(blockLID);
    }
 
+   #ifndef VBC_NO_BLOCK_PARAMETERS
    inline Real* SpatialCell::get_block_parameters(const int& popID) {
       #ifdef DEBUG_SPATIAL_CELL
       if (popID >= populations.size()) {
@@ -848,6 +954,24 @@ namespace spatial_cell {
       #endif
       return populations[popID].blockContainer.getParameters(blockLID);
    }
+   #endif
+
+   /** Get the parameters of a velocity block, see spatial_cell::getBlockParameters.
+    * This works whether or not block parameters are stored in the block container.
+    * @param blockLID Local ID of the velocity block.
+    * @param popID ID of the particle species.
+    * @param scratch Array of at least BlockParams::N_VELOCITY_BLOCK_PARAMS elements.
+    * @return Pointer to the block parameters.*/
+   inline const Real* SpatialCell::get_block_parameters(const vmesh::LocalID& blockLID,const int& popID,Real* scratch) const {
+      #ifdef DEBUG_SPATIAL_CELL
+      if (popID >= populations.size()) {
+         std::cerr << "ERROR, popID " << popID << " exceeds populations.size() " << populations.size() << " in ";
+         std::cerr << __FILE__ << ":" << __LINE__ << std::endl;             
+         exit(1);
+      }
+      #endif
+      return getBlockParameters(populations[popID].vmesh,populations[popID].blockContainer,blockLID,scratch);
+   }
    
    inline Real* SpatialCell::get_cell_parameters() {
        return parameters;
@@ -1541,6 +1665,11 @@ namespace spatial_cell {
       return populations[popID].vmesh.check();
    }
 
+   /** Free the buffer used for migrating the velocity meshes of this cell.*/
+   inline void SpatialCell::clear_migration_buffer() {
+      std::vector<uint8_t>().swap(migrationBuffer);
+   }
+
    /*!
     Removes all velocity blocks from this spatial cell and frees memory in the cell
     */
@@ -1555,6 +1684,7 @@ namespace spatial_cell {
        
       populations[popID].vmesh.clear();
       populations[popID].blockContainer.clear();
+      for (int d=0; d<3; ++d) populations[popID].blockColumns[d].clear();
     }
 
    /*!
@@ -1562,7 +1692,7 @@ namespace spatial_cell {
     functions of the containers in spatial cell
     */
    inline uint64_t SpatialCell::get_cell_memory_size() {
-      const uint64_t VEL_BLOCK_SIZE = 2*WID3*sizeof(Realf) + BlockParams::N_VELOCITY_BLOCK_PARAMS*sizeof(Real);
+      const uint64_t VEL_BLOCK_SIZE = 2*WID3*sizeof(Realf) + vmesh::N_STORED_BLOCK_PARAMS*sizeof(Real);
       uint64_t size = 0;
       size += vmeshTemp.sizeInBytes();
       size += blockContainerTemp.sizeInBytes();
@@ -1587,7 +1717,7 @@ namespace spatial_cell {
     the size() functions of the containers in spatial cell
     */
    inline uint64_t SpatialCell::get_cell_memory_capacity() {
-      const uint64_t VEL_BLOCK_SIZE = 2*WID3*sizeof(Realf) + BlockParams::N_VELOCITY_BLOCK_PARAMS*sizeof(Real);
+      const uint64_t VEL_BLOCK_SIZE = 2*WID3*sizeof(Realf) + vmesh::N_STORED_BLOCK_PARAMS*sizeof(Real);
       uint64_t capacity = 0;
       
       capacity += vmeshTemp.capacityInBytes();
@@ -1603,6 +1733,7 @@ namespace spatial_cell {
       for (size_t p=0; p<populations.size(); ++p) {
         capacity += populations[p].vmesh.capacityInBytes();
         capacity += populations[p].blockContainer.capacityInBytes();
+        for (int d=0; d<3; ++d) capacity += populations[p].blockColumns[d].capacityInBytes();
       }
       
       return capacity;
@@ -1637,12 +1768,14 @@ namespace spatial_cell {
       for (unsigned int i=0; i<WID*WID*WID; ++i) data[i] = 0;
 
       // Set block parameters:
+      #ifndef VBC_NO_BLOCK_PARAMETERS
 //      Real* parameters = get_block_parameters(populations[popID].vmesh.getLocalID(block));
       Real* parameters = get_block_parameters(VBC_LID,popID);
       parameters[BlockParams::VXCRD] = get_velocity_block_vx_min(popID,block);
       parameters[BlockParams::VYCRD] = get_velocity_block_vy_min(popID,block);
       parameters[BlockParams::VZCRD] = get_velocity_block_vz_min(popID,block);
       populations[popID].vmesh.getCellSize(block,&(parameters[BlockParams::DVX]));
+      #endif
 
       // The following call 'should' be the fastest, but is actually 
       // much slower that the parameter setting above
@@ -1668,7 +1801,6 @@ namespace spatial_cell {
 
       // Add blocks to block container
       vmesh::LocalID startLID = populations[popID].blockContainer.push_back(blocks.size());
-      Real* parameters = populations[popID].blockContainer.getParameters(startLID);
 
       #ifdef DEBUG_SPATIAL_CELL
          if (populations[popID].vmesh.size() != populations[popID].blockContainer.size()) {
@@ -1677,6 +1809,8 @@ namespace spatial_cell {
       #endif
 
       // Set block parameters
+      #ifndef VBC_NO_BLOCK_PARAMETERS
+      Real* parameters = populations[popID].blockContainer.getParameters(startLID);
       for (size_t b=0; b<blocks.size(); ++b) {
          parameters[BlockParams::VXCRD] = get_velocity_block_vx_min(popID,blocks[b]);
          parameters[BlockParams::VYCRD] = get_velocity_block_vy_min(popID,blocks[b]);
@@ -1684,6 +1818,7 @@ namespace spatial_cell {
          populations[popID].vmesh.getCellSize(blocks[b],&(parameters[BlockParams::DVX]));
          parameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       }
+      #endif
    }
 
    inline bool SpatialCell::add_velocity_block_octant(const vmesh::GlobalID& blockGID,const int& popID) {
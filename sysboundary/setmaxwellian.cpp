@@ -239,7 +239,8 @@ namespace SBC {
          for(vmesh::GlobalID i=0; i<blocksToInitialize.size(); ++i) {
             const vmesh::GlobalID blockGID = blocksToInitialize[i];
             const vmesh::LocalID blockLID = templateCell.get_velocity_block_local_id(blockGID,popID);
-            const Real* block_parameters = templateCell.get_block_parameters(blockLID,popID);
+            Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+            const Real* block_parameters = templateCell.get_block_parameters(blockLID,popID,paramsScratch);
             creal vxBlock = block_parameters[BlockParams::VXCRD];
             creal vyBlock = block_parameters[BlockParams::VYCRD];
             creal vzBlock = block_parameters[BlockParams::VZCRD];
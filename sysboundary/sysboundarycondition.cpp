@@ -431,7 +431,8 @@ namespace SBC {
                toBlock_data[i] = 0.0; //block did not exist in from cell, fill with zeros.
             }
          } else {
-            const Real* blockParameters = to->get_block_parameters(blockLID, popID);
+            Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+            const Real* blockParameters = to->get_block_parameters(blockLID,popID,paramsScratch);
             // check where cells are
             creal vxBlock = blockParameters[BlockParams::VXCRD];
             creal vyBlock = blockParameters[BlockParams::VYCRD];
@@ -627,9 +628,10 @@ namespace SBC {
             // Do this only for the first layer, the other layers do not need this.
             if (to->sysBoundaryLayer != 1) continue;
 
-            const Real* blockParameters = incomingCell->get_block_parameters(popID);
+            Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
             const Realf* fromData = incomingCell->get_data(popID);
             for (vmesh::LocalID incBlockLID=0; incBlockLID<incomingCell->get_number_of_velocity_blocks(popID); ++incBlockLID) {
+               const Real* blockParameters = incomingCell->get_block_parameters(incBlockLID,popID,paramsScratch);
                // Check where cells are
                creal vxBlock = blockParameters[BlockParams::VXCRD];
                creal vyBlock = blockParameters[BlockParams::VYCRD];
@@ -656,7 +658,6 @@ namespace SBC {
                   toData[cellIndex(ic,jc,kc)] += factor*fromData[cellIndex(ic,jc,kc)];
                }
                fromData += SIZE_VELBLOCK;
-               blockParameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
             } // for-loop over velocity blocks
          }
       }
@@ -687,10 +688,11 @@ namespace SBC {
       
       for (size_t i=0; i<numberOfCells; i++) {
          SpatialCell* incomingCell = mpiGrid[cellList[i]];
-         const Real* blockParameters = incomingCell->get_block_parameters(popID);
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
          // add blocks
          for (vmesh::LocalID blockLID=0; blockLID<incomingCell->get_number_of_velocity_blocks(popID); ++blockLID) {
+            const Real* blockParameters = incomingCell->get_block_parameters(blockLID,popID,paramsScratch);
             // check where cells are
             creal vxBlock = blockParameters[BlockParams::VXCRD];
             creal vyBlock = blockParameters[BlockParams::VYCRD];
@@ -725,7 +727,6 @@ namespace SBC {
                }
             } // for-loop over cells in velocity block
          } // for-loop over velocity blocks
-         blockParameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       } // for-loop over spatial cells
    }
    
@@ -756,10 +757,11 @@ namespace SBC {
       
       for (size_t i=0; i<numberOfCells; i++) {
          SpatialCell* incomingCell = mpiGrid[cellList[i]];
-         const Real* blockParameters = incomingCell->get_block_parameters(popID);
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          
          // add blocks
          for (vmesh::LocalID blockLID=0; blockLID<incomingCell->get_number_of_velocity_blocks(popID); ++blockLID) {
+            const Real* blockParameters = incomingCell->get_block_parameters(blockLID,popID,paramsScratch);
             // check where cells are
             creal vxBlock = blockParameters[BlockParams::VXCRD];
             creal vyBlock = blockParameters[BlockParams::VYCRD];
@@ -796,7 +798,6 @@ namespace SBC {
                      }
             }
          } // for-loop over velocity blocks
-         blockParameters += BlockParams::N_VELOCITY_BLOCK_PARAMS;
       } // for-loop over spatial cells
    }
 
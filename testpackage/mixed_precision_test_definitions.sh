@@ -0,0 +1,14 @@
+## Define tests of the mixed precision solver (make testpackage_mixed), which
+## are compared against double precision reference runs. Source this file
+## instead of small_test_definitions.sh in the machine specific script.
+
+source small_test_definitions.sh
+
+# tests that exercise the acceleration
+run_tests=( 1 2 10 )
+
+# density checks conservation, bulk velocity the accuracy of the mapping
+variables_name=( "rho" "rho_v" "rho_v" "rho_v" "proton" )
+variables_components=( 0 0 1 2 0 )
+# largest accepted relative diff to the double precision reference, no check if empty
+variables_tolerance=( 1e-5 1e-4 1e-4 1e-4 "" )
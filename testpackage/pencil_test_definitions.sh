@@ -0,0 +1,19 @@
+## Define tests of the pencil translation (vlasovsolver.pencils), which are
+## compared against reference runs of the default cell by cell translation
+## (trans_map_1d). Source this file instead of small_test_definitions.sh in
+## the machine specific script.
+
+source small_test_definitions.sh
+
+# tests that exercise the translation, with periodic and inflow/outflow boundaries
+run_tests=( 3 8 9 )
+for run in ${run_tests[*]}
+do
+   test_options[$run]="--vlasovsolver.pencils=1"
+done
+
+# both paths compute the same values, only the order of the additions to target blocks differs
+variables_name=( "rho" "rho_v" "rho_v" "rho_v" "proton" )
+variables_components=( 0 0 1 2 0 )
+# largest accepted relative diff to the reference, no check if empty
+variables_tolerance=( 1e-6 1e-6 1e-6 1e-6 "" )
@@ -60,7 +60,8 @@ do
     export MPICH_MAX_THREAD_SAFETY=funneled
 
     $run_command $bin --version  > VERSION.txt
-    $run_command $bin --run_config=${test_name[$run]}.cfg
+    #optional extra command line options of the test, e.g., to compare a solver option against the default references
+    $run_command $bin --run_config=${test_name[$run]}.cfg ${test_options[$run]}
 
 
   ###copy new reference data to correct folder
@@ -121,7 +122,14 @@ do
                 relativeValue=$($run_command_tools vlsvdiff_DP ${result_dir}/${comparison_vlsv[$run]} ${vlsv_dir}/${comparison_vlsv[$run]} ${variables_name[$i]} ${variables_components[$i]} |grep "The relative 0-distance between both datasets" |gawk '{print $8}'  )
                 absoluteValue=$($run_command_tools vlsvdiff_DP ${result_dir}/${comparison_vlsv[$run]} ${vlsv_dir}/${comparison_vlsv[$run]} ${variables_name[$i]} ${variables_components[$i]} |grep "The absolute 0-distance between both datasets" |gawk '{print $8}'  )
 #print the results      
-                echo "${variables_name[$i]}_${variables_components[$i]}                $absoluteValue                 $relativeValue    "
+                if [ -z "${variables_tolerance[$i]}" ]
+                then
+                    echo "${variables_name[$i]}_${variables_components[$i]}                $absoluteValue                 $relativeValue    "
+                else
+                    #optional tolerance of the relative diff, e.g., for comparing to references computed with another precision
+                    verdict=$( echo $relativeValue ${variables_tolerance[$i]} |gawk '{if($1 == $1 + 0 && $1 <= $2) print "PASS"; else print "FAIL"}')
+                    echo "${variables_name[$i]}_${variables_components[$i]}                $absoluteValue                 $relativeValue     $verdict (tolerance ${variables_tolerance[$i]})"
+                fi
             fi
 
         done # loop over variables
@@ -0,0 +1,256 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef VELOCITY_BLOCK_ARENA_H
+#define VELOCITY_BLOCK_ARENA_H
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <new>
+#include <stdint.h>
+#include <vector>
+
+#include "memoryallocation.h"
+
+namespace vmesh {
+
+   class BlockArena;
+
+   /** Memory extent handed out by vmesh::BlockArena. An extent is owned
+    * by exactly one velocity block container at a time.*/
+   struct ArenaExtent {
+      ArenaExtent(): data(NULL),bytes(0),sizeClass(0),slab(0),slot(0) { }
+      char* data;                                                       /**< Start of the extent, NULL if nothing is allocated.*/
+      size_t bytes;                                                     /**< Usable size of the extent in bytes.*/
+      uint32_t sizeClass;                                               /**< Size class the extent was taken from.*/
+      uint32_t slab;                                                    /**< Slab of the size class.*/
+      uint32_t slot;                                                    /**< Slot in the slab.*/
+   };
+
+   /** Memory statistics of vmesh::BlockArena, in bytes.*/
+   struct ArenaStatistics {
+      uint64_t reserved;                                                /**< Memory obtained from the system.*/
+      uint64_t allocated;                                               /**< Memory in extents owned by containers.*/
+      uint64_t free;                                                    /**< Memory in free slots waiting to be recycled.*/
+      uint64_t slabs;                                                   /**< Number of slabs held.*/
+   };
+
+   /** Rank-wide size-class slab allocator for velocity block data. Extents are rounded
+    * up to one of a set of geometrically spaced size classes. Each size class carves
+    * its extents out of slabs of at least SLAB_BYTES, a slab of a class whose extents
+    * are larger than SLAB_BYTES holds one extent. Extents freed by one spatial cell are
+    * recycled to the next cell that needs an extent of the same class. A size class with
+    * several extents per slab keeps one empty slab for reuse, as long as all kept empty
+    * slabs together fit in MAX_EMPTY_BYTES, so blocks growing and shrinking around a class
+    * boundary do not allocate and free slabs repeatedly. All other slabs are returned to
+    * the system as soon as all of their slots are free.
+    *
+    * All member functions are thread-safe. Allocation only happens when a velocity
+    * block container changes its capacity, so a single lock is sufficient.*/
+   class BlockArena {
+    public:
+      static const size_t ALIGNMENT            = 64;                    /**< Alignment of all extents in bytes.*/
+      static const size_t SLAB_BYTES           = 4*1024*1024;           /**< Smallest size of a slab in bytes.*/
+      static const size_t MIN_CLASS_BYTES      = 512;                   /**< Size of the smallest size class in bytes.*/
+      static const uint32_t CLASSES_PER_DOUBLING = 4;                   /**< Number of size classes between powers of two.*/
+      static const size_t MAX_EMPTY_BYTES      = 4*SLAB_BYTES;          /**< Largest total size of empty slabs kept for reuse in bytes.*/
+
+      BlockArena();
+      ~BlockArena();
+
+      ArenaExtent allocate(const size_t& bytes);
+      size_t classBytes(const size_t& bytes) const;
+      void deallocate(ArenaExtent& extent);
+      ArenaStatistics getStatistics();
+
+    private:
+      BlockArena(const BlockArena& other);
+      BlockArena& operator=(const BlockArena& other);
+
+      struct Slab {
+         char* base;                                                    /**< Start of the slab.*/
+         uint32_t nSlots;                                               /**< Number of extents in the slab.*/
+         std::vector<uint32_t> freeSlots;                               /**< Slots not owned by any container.*/
+      };
+      struct SizeClass {
+         std::vector<Slab> slabs;                                       /**< Slabs of this class, base is NULL for released slabs.*/
+         std::vector<uint32_t> partialSlabs;                            /**< Indices of slabs with free slots.*/
+         uint32_t emptySlabs;                                           /**< Number of slabs without extents in use, at most one.*/
+         SizeClass(): emptySlabs(0) { }
+      };
+
+      uint32_t getSizeClass(const size_t& bytes) const;
+      size_t getSizeClassBytes(const uint32_t& sizeClass) const;
+
+      std::mutex mutex;
+      std::vector<SizeClass> sizeClasses;
+      uint64_t reservedBytes;
+      uint64_t allocatedBytes;
+      uint64_t emptyBytes;                                              /**< Total size of empty slabs kept for reuse.*/
+   };
+
+   /** Get the arena shared by all velocity block containers of this process.*/
+   inline BlockArena& getBlockArena() {
+      static BlockArena arena;
+      return arena;
+   }
+
+   inline BlockArena::BlockArena(): reservedBytes(0),allocatedBytes(0),emptyBytes(0) { }
+
+   /** Frees all slabs. Containers must not be used after the arena is destroyed.*/
+   inline BlockArena::~BlockArena() {
+      for (size_t c=0; c<sizeClasses.size(); ++c) {
+         for (size_t s=0; s<sizeClasses[c].slabs.size(); ++s) {
+            if (sizeClasses[c].slabs[s].base != NULL) aligned_free(sizeClasses[c].slabs[s].base);
+         }
+      }
+   }
+
+   /** Allocate an extent of at least the given size. The returned extent may be larger,
+    * its usable size is stored in ArenaExtent::bytes.
+    * @param bytes Requested size in bytes.
+    * @return The allocated extent, or an empty extent if bytes is zero.*/
+   inline ArenaExtent BlockArena::allocate(const size_t& bytes) {
+      ArenaExtent extent;
+      if (bytes == 0) return extent;
+
+      extent.sizeClass = getSizeClass(bytes);
+      extent.bytes = getSizeClassBytes(extent.sizeClass);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (sizeClasses.size() <= extent.sizeClass) sizeClasses.resize(extent.sizeClass+1);
+      SizeClass& sizeClass = sizeClasses[extent.sizeClass];
+
+      bool newSlab = false;
+      if (sizeClass.partialSlabs.size() == 0) {
+         // Reuse the slot of a released slab if there is one
+         uint32_t slabIndex = sizeClass.slabs.size();
+         for (uint32_t s=0; s<sizeClass.slabs.size(); ++s) {
+            if (sizeClass.slabs[s].base == NULL) {slabIndex = s; break;}
+         }
+         if (slabIndex == sizeClass.slabs.size()) sizeClass.slabs.push_back(Slab());
+
+         Slab& slab = sizeClass.slabs[slabIndex];
+         slab.nSlots = std::max((size_t)1,SLAB_BYTES / extent.bytes);
+         slab.base = reinterpret_cast<char*>(aligned_malloc(slab.nSlots*extent.bytes,ALIGNMENT));
+         if (slab.base == NULL) throw std::bad_alloc();
+         slab.freeSlots.resize(slab.nSlots);
+         for (uint32_t i=0; i<slab.nSlots; ++i) slab.freeSlots[i] = slab.nSlots-1-i;
+         sizeClass.partialSlabs.push_back(slabIndex);
+         reservedBytes += slab.nSlots*extent.bytes;
+         newSlab = true;
+      }
+
+      extent.slab = sizeClass.partialSlabs.back();
+      Slab& slab = sizeClass.slabs[extent.slab];
+      if (newSlab == false && slab.freeSlots.size() == slab.nSlots) {
+         // Take the kept empty slab into use
+         sizeClass.emptySlabs--;
+         emptyBytes -= slab.nSlots*extent.bytes;
+      }
+      extent.slot = slab.freeSlots.back();
+      slab.freeSlots.pop_back();
+      if (slab.freeSlots.size() == 0) sizeClass.partialSlabs.pop_back();
+
+      extent.data = slab.base + extent.slot*extent.bytes;
+      allocatedBytes += extent.bytes;
+      return extent;
+   }
+
+   /** Get the usable size of the extent that would be returned for a request of the given size.
+    * @param bytes Requested size in bytes.
+    * @return Size of the extent in bytes.*/
+   inline size_t BlockArena::classBytes(const size_t& bytes) const {
+      if (bytes == 0) return 0;
+      return getSizeClassBytes(getSizeClass(bytes));
+   }
+
+   /** Return an extent to the arena. The extent is reset to an empty extent.
+    * @param extent Extent obtained from BlockArena::allocate.*/
+   inline void BlockArena::deallocate(ArenaExtent& extent) {
+      if (extent.data == NULL) return;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      SizeClass& sizeClass = sizeClasses[extent.sizeClass];
+      Slab& slab = sizeClass.slabs[extent.slab];
+      if (slab.freeSlots.size() == 0) sizeClass.partialSlabs.push_back(extent.slab);
+      slab.freeSlots.push_back(extent.slot);
+      allocatedBytes -= extent.bytes;
+
+      // Keep one empty slab per size class with several extents per slab while the kept
+      // empty slabs fit in MAX_EMPTY_BYTES, release the others once they are empty
+      const size_t slabBytes = slab.nSlots*extent.bytes;
+      if (slab.freeSlots.size() == slab.nSlots && slab.nSlots > 1 && sizeClass.emptySlabs == 0
+          && emptyBytes + slabBytes <= MAX_EMPTY_BYTES) {
+         sizeClass.emptySlabs++;
+         emptyBytes += slabBytes;
+      } else if (slab.freeSlots.size() == slab.nSlots) {
+         for (size_t i=0; i<sizeClass.partialSlabs.size(); ++i) {
+            if (sizeClass.partialSlabs[i] != extent.slab) continue;
+            sizeClass.partialSlabs[i] = sizeClass.partialSlabs.back();
+            sizeClass.partialSlabs.pop_back();
+            break;
+         }
+         reservedBytes -= slabBytes;
+         aligned_free(slab.base);
+         slab.base = NULL;
+         slab.nSlots = 0;
+         std::vector<uint32_t>().swap(slab.freeSlots);
+      }
+      extent = ArenaExtent();
+   }
+
+   inline ArenaStatistics BlockArena::getStatistics() {
+      std::lock_guard<std::mutex> lock(mutex);
+      ArenaStatistics stats;
+      stats.reserved = reservedBytes;
+      stats.allocated = allocatedBytes;
+      stats.free = reservedBytes - allocatedBytes;
+      stats.slabs = 0;
+      for (size_t c=0; c<sizeClasses.size(); ++c) {
+         for (size_t s=0; s<sizeClasses[c].slabs.size(); ++s) {
+            if (sizeClasses[c].slabs[s].base != NULL) ++stats.slabs;
+         }
+      }
+      return stats;
+   }
+
+   /** Get the smallest size class whose extents hold the given number of bytes.*/
+   inline uint32_t BlockArena::getSizeClass(const size_t& bytes) const {
+      if (bytes <= MIN_CLASS_BYTES) return 0;
+      uint32_t sizeClass = std::ceil(CLASSES_PER_DOUBLING*std::log2((double)bytes/MIN_CLASS_BYTES));
+      // Guard against rounding of the logarithm
+      while (sizeClass > 0 && getSizeClassBytes(sizeClass-1) >= bytes) --sizeClass;
+      while (getSizeClassBytes(sizeClass) < bytes) ++sizeClass;
+      return sizeClass;
+   }
+
+   /** Get the size of the extents of a size class, a multiple of BlockArena::ALIGNMENT.*/
+   inline size_t BlockArena::getSizeClassBytes(const uint32_t& sizeClass) const {
+      const double bytes = MIN_CLASS_BYTES*std::pow(2.0,(double)sizeClass/CLASSES_PER_DOUBLING);
+      return ((size_t)std::ceil(bytes) + ALIGNMENT-1) / ALIGNMENT * ALIGNMENT;
+   }
+
+} // namespace vmesh
+
+#endif
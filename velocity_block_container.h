@@ -23,10 +23,12 @@
 #ifndef VELOCITY_BLOCK_CONTAINER_H
 #define VELOCITY_BLOCK_CONTAINER_H
 
+#include <algorithm>
 #include <vector>
 
 #include "common.h"
 #include "unistd.h"
+#include "velocity_block_arena.h"
 
 #ifdef DEBUG_VBC
    #include <sstream>
@@ -36,11 +38,25 @@ namespace vmesh {
 
    static const double BLOCK_ALLOCATION_FACTOR = 1.1;
 
+   #ifdef VBC_NO_BLOCK_PARAMETERS
+   static const int N_STORED_BLOCK_PARAMS = 0;                          /**< Block parameters are computed from the velocity mesh.*/
+   #else
+   static const int N_STORED_BLOCK_PARAMS = BlockParams::N_VELOCITY_BLOCK_PARAMS; /**< Number of block parameters stored per block.*/
+   #endif
+
+   /** Storage of velocity block data and parameters. Both arrays live in one 
+    * extent of the process-wide vmesh::BlockArena, data first and parameters 
+    * after it, so that extents freed by one spatial cell are reused by others.
+    * If VBC_NO_BLOCK_PARAMETERS is defined the parameters array is empty and 
+    * getParameters is not available, use spatial_cell::getBlockParameters instead.*/
    template<typename LID>
    class VelocityBlockContainer {
     public:
 
       VelocityBlockContainer();
+      VelocityBlockContainer(const VelocityBlockContainer& other);
+      ~VelocityBlockContainer();
+      VelocityBlockContainer& operator=(const VelocityBlockContainer& other);
       LID capacity() const;
       size_t capacityInBytes() const;
       void clear();
@@ -51,10 +67,12 @@ namespace vmesh {
       Realf* getData(const LID& blockLID);
       const Realf* getData(const LID& blockLID) const;
       Realf* getNullData();
+      #ifndef VBC_NO_BLOCK_PARAMETERS
       Real* getParameters();
       const Real* getParameters() const;
       Real* getParameters(const LID& blockLID);      
       const Real* getParameters(const LID& blockLID) const;
+      #endif
       void pop();
       LID push_back();
       LID push_back(const uint32_t& N_blocks);
@@ -66,25 +84,62 @@ namespace vmesh {
 
       #ifdef DEBUG_VBC
       const Realf& getData(const LID& blockLID,const unsigned int& cell) const;
+      #ifndef VBC_NO_BLOCK_PARAMETERS
       const Real& getParameters(const LID& blockLID,const unsigned int& i) const;
+      #endif
       void setData(const LID& blockLID,const unsigned int& cell,const Realf& value);
       #endif
 
     private:
       void exitInvalidLocalID(const LID& localID,const std::string& funcName) const;
+      static LID getExtentCapacity(const size_t& bytes);
+      static size_t getExtentSize(const LID& capacity);
+      static size_t getParametersOffset(const LID& capacity);
+      void reallocate(const LID& newCapacity);
       void resize();
       
-      std::vector<Realf,aligned_allocator<Realf,WID3> > block_data;
+      ArenaExtent extent;                                               /**< Arena extent holding block data and parameters.*/
+      Realf* block_data;
       Realf null_block_data[WID3];
       LID currentCapacity;
       LID numberOfBlocks;
-      std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > parameters;
+      Real* parameters;
    };
    
    template<typename LID> inline
    VelocityBlockContainer<LID>::VelocityBlockContainer() {
+      block_data = NULL;
+      parameters = NULL;
+      currentCapacity = 0;
+      numberOfBlocks = 0;
+   }
+
+   template<typename LID> inline
+   VelocityBlockContainer<LID>::VelocityBlockContainer(const VelocityBlockContainer& other) {
+      block_data = NULL;
+      parameters = NULL;
       currentCapacity = 0;
       numberOfBlocks = 0;
+      *this = other;
+   }
+
+   template<typename LID> inline
+   VelocityBlockContainer<LID>::~VelocityBlockContainer() {
+      getBlockArena().deallocate(extent);
+   }
+
+   /** Copy the existing blocks of another container. The capacity of 
+    * this container is the smallest that holds them.*/
+   template<typename LID> inline
+   VelocityBlockContainer<LID>& VelocityBlockContainer<LID>::operator=(const VelocityBlockContainer& other) {
+      if (this == &other) return *this;
+      clear();
+      if (other.numberOfBlocks == 0) return *this;
+      reallocate(other.numberOfBlocks);
+      numberOfBlocks = other.numberOfBlocks;
+      for (size_t i=0; i<numberOfBlocks*WID3; ++i) block_data[i] = other.block_data[i];
+      for (size_t i=0; i<numberOfBlocks*N_STORED_BLOCK_PARAMS; ++i) parameters[i] = other.parameters[i];
+      return *this;
    }
    
    template<typename LID> inline
@@ -94,19 +149,16 @@ namespace vmesh {
    
    template<typename LID> inline
    size_t VelocityBlockContainer<LID>::capacityInBytes() const {
-      return (block_data.capacity())*sizeof(Realf) + parameters.capacity()*sizeof(Real);
+      return extent.bytes;
    }
 
-   /** Clears VelocityBlockContainer data and deallocates all memory 
-    * reserved for velocity blocks.*/
+   /** Clears VelocityBlockContainer data and returns the memory 
+    * reserved for velocity blocks to the arena.*/
    template<typename LID> inline
    void VelocityBlockContainer<LID>::clear() {
-      std::vector<Realf,aligned_allocator<Realf,WID3> > dummy_data;
-      std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > dummy_parameters;
-      
-      block_data.swap(dummy_data);
-      parameters.swap(dummy_parameters);
-      
+      getBlockArena().deallocate(extent);
+      block_data = NULL;
+      parameters = NULL;
       currentCapacity = 0;
       numberOfBlocks = 0;
    }
@@ -121,14 +173,11 @@ namespace vmesh {
          if (target >= currentCapacity) ok = false;
          if (numberOfBlocks >= currentCapacity) ok = false;
          if (source != numberOfBlocks-1) ok = false;
-         if (source*WID3+WID3-1 >= block_data.size()) ok = false;
-         if (source*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::N_VELOCITY_BLOCK_PARAMS-1 >= parameters.size()) ok = false;
-         if (target*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::N_VELOCITY_BLOCK_PARAMS-1 >= parameters.size()) ok = false;
-         if (parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS != block_data.size()/WID3) ok = false;
+         if (getParametersOffset(currentCapacity) + currentCapacity*N_STORED_BLOCK_PARAMS*sizeof(Real) > extent.bytes) ok = false;
          if (ok == false) {
             std::stringstream ss;
             ss << "VBC ERROR: invalid source LID=" << source << " in copy, target=" << target << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
-            ss << "or sizes are wrong, data.size()=" << block_data.size() << " parameters.size()=" << parameters.size() << std::endl;
+            ss << "or sizes are wrong, extent size=" << extent.bytes << std::endl;
             std::cerr << ss.str();
             sleep(1);
             exit(1);
@@ -136,8 +185,8 @@ namespace vmesh {
       #endif
 
       for (int i=0; i<WID3; ++i) block_data[target*WID3+i] = block_data[source*WID3+i];
-      for (int i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) {
-         parameters[target*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = parameters[source*BlockParams::N_VELOCITY_BLOCK_PARAMS+i];
+      for (int i=0; i<N_STORED_BLOCK_PARAMS; ++i) {
+         parameters[target*N_STORED_BLOCK_PARAMS+i] = parameters[source*N_STORED_BLOCK_PARAMS+i];
       }
    }
 
@@ -161,30 +210,30 @@ namespace vmesh {
    
    template<typename LID> inline
    Realf* VelocityBlockContainer<LID>::getData() {
-      return block_data.data();
+      return block_data;
    }
    
    template<typename LID> inline
    const Realf* VelocityBlockContainer<LID>::getData() const {
-      return block_data.data();
+      return block_data;
    }
 
    template<typename LID> inline
    Realf* VelocityBlockContainer<LID>::getData(const LID& blockLID) {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"getData");
-         if (blockLID >= block_data.size()/WID3) exitInvalidLocalID(blockLID,"const getData const");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"const getData const");
       #endif
-      return block_data.data() + blockLID*WID3;
+      return block_data + blockLID*WID3;
    }
    
    template<typename LID> inline
    const Realf* VelocityBlockContainer<LID>::getData(const LID& blockLID) const {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"const getData const");
-         if (blockLID >= block_data.size()/WID3) exitInvalidLocalID(blockLID,"const getData const");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"const getData const");
       #endif
-      return block_data.data() + blockLID*WID3;
+      return block_data + blockLID*WID3;
    }
 
    template<typename LID> inline
@@ -192,34 +241,59 @@ namespace vmesh {
        return null_block_data;
    }
 
+   /** Get the size of the arena extent needed by the given capacity.*/
+   template<typename LID> inline
+   size_t VelocityBlockContainer<LID>::getExtentSize(const LID& capacity) {
+      return getParametersOffset(capacity) + capacity*N_STORED_BLOCK_PARAMS*sizeof(Real);
+   }
+
+   /** Get the number of blocks that fit into an arena extent of the given size.*/
+   template<typename LID> inline
+   LID VelocityBlockContainer<LID>::getExtentCapacity(const size_t& bytes) {
+      LID capacity = bytes / (WID3*sizeof(Realf) + N_STORED_BLOCK_PARAMS*sizeof(Real));
+      while (capacity > 0 && getExtentSize(capacity) > bytes) --capacity;
+      return capacity;
+   }
+
+   /** Get the byte offset of block parameters in the arena extent. Parameters 
+    * start at the first aligned address after block data.*/
+   template<typename LID> inline
+   size_t VelocityBlockContainer<LID>::getParametersOffset(const LID& capacity) {
+      const size_t dataBytes = capacity*WID3*sizeof(Realf);
+      return (dataBytes + BlockArena::ALIGNMENT-1) / BlockArena::ALIGNMENT * BlockArena::ALIGNMENT;
+   }
+
+   #ifndef VBC_NO_BLOCK_PARAMETERS
    template<typename LID> inline
    Real* VelocityBlockContainer<LID>::getParameters() {
-      return parameters.data();
+      return parameters;
    }
    
    template<typename LID> inline
    const Real* VelocityBlockContainer<LID>::getParameters() const {
-      return parameters.data();
+      return parameters;
    }
 
    template<typename LID> inline
    Real* VelocityBlockContainer<LID>::getParameters(const LID& blockLID) {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"getParameters");
-         if (blockLID >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) exitInvalidLocalID(blockLID,"getParameters");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"getParameters");
       #endif
-      return parameters.data() + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+      return parameters + blockLID*N_STORED_BLOCK_PARAMS;
    }
    
    template<typename LID> inline
    const Real* VelocityBlockContainer<LID>::getParameters(const LID& blockLID) const {
       #ifdef DEBUG_VBC
          if (blockLID >= numberOfBlocks) exitInvalidLocalID(blockLID,"const getParameters const");
-         if (blockLID >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) exitInvalidLocalID(blockLID,"getParameters");
+         if (blockLID >= currentCapacity) exitInvalidLocalID(blockLID,"getParameters");
       #endif
-      return parameters.data() + blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS;
+      return parameters + blockLID*N_STORED_BLOCK_PARAMS;
    }
    
+   #endif
+
    template<typename LID> inline
    void VelocityBlockContainer<LID>::pop() {
       if (numberOfBlocks == 0) return;
@@ -232,10 +306,10 @@ namespace vmesh {
       if (newIndex >= currentCapacity) resize();
 
       #ifdef DEBUG_VBC
-      if (newIndex >= block_data.size()/WID3 || newIndex >= parameters.size()/BlockParams::N_VELOCITY_BLOCK_PARAMS) {
+      if (newIndex >= currentCapacity) {
          std::stringstream ss;
          ss << "VBC ERROR in push_back, LID=" << newIndex << " for new block is out of bounds" << std::endl;
-         ss << "\t data.size()=" << block_data.size()  << " parameters.size()=" << parameters.size() << std::endl;
+         ss << "\t capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
@@ -244,8 +318,8 @@ namespace vmesh {
 
       // Clear velocity block data to zero values
       for (size_t i=0; i<WID3; ++i) block_data[newIndex*WID3+i] = 0.0;
-      for (size_t i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) 
-         parameters[newIndex*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = 0.0;
+      for (size_t i=0; i<N_STORED_BLOCK_PARAMS; ++i) 
+         parameters[newIndex*N_STORED_BLOCK_PARAMS+i] = 0.0;
 
       ++numberOfBlocks;
       return newIndex;
@@ -259,26 +333,47 @@ namespace vmesh {
       
       // Clear velocity block data to zero values
       for (size_t i=0; i<WID3*N_blocks; ++i) block_data[newIndex*WID3+i] = 0.0;
-      for (size_t i=0; i<BlockParams::N_VELOCITY_BLOCK_PARAMS*N_blocks; ++i)
-	parameters[newIndex*BlockParams::N_VELOCITY_BLOCK_PARAMS+i] = 0.0;
+      for (size_t i=0; i<N_STORED_BLOCK_PARAMS*N_blocks; ++i)
+	parameters[newIndex*N_STORED_BLOCK_PARAMS+i] = 0.0;
 
       return newIndex;
    }
 
+   /** Move the blocks into an arena extent that holds at least newCapacity blocks. 
+    * The capacity is rounded up to fill the extent. Blocks within the old capacity 
+    * are preserved, and nothing is moved if the extent would not change size.*/
+   template<typename LID> inline
+   void VelocityBlockContainer<LID>::reallocate(const LID& newCapacity) {
+      BlockArena& arena = getBlockArena();
+      if (newCapacity == 0) {
+         arena.deallocate(extent);
+         block_data = NULL;
+         parameters = NULL;
+         currentCapacity = 0;
+         return;
+      }
+      if (arena.classBytes(getExtentSize(newCapacity)) == extent.bytes) return;
+
+      ArenaExtent newExtent = arena.allocate(getExtentSize(newCapacity));
+      const LID capacity = getExtentCapacity(newExtent.bytes);
+      Realf* newData = reinterpret_cast<Realf*>(newExtent.data);
+      Real* newParameters = reinterpret_cast<Real*>(newExtent.data + getParametersOffset(capacity));
+
+      const LID N_copy = std::min(std::min(numberOfBlocks,currentCapacity),capacity);
+      for (size_t i=0; i<N_copy*WID3; ++i) newData[i] = block_data[i];
+      for (size_t i=0; i<N_copy*N_STORED_BLOCK_PARAMS; ++i) newParameters[i] = parameters[i];
+
+      arena.deallocate(extent);
+      extent = newExtent;
+      block_data = newData;
+      parameters = newParameters;
+      currentCapacity = capacity;
+   }
+
    template<typename LID> inline
    bool VelocityBlockContainer<LID>::recapacitate(const LID& newCapacity) {
       if (newCapacity < numberOfBlocks) return false;
-      {
-         std::vector<Realf,aligned_allocator<Realf,WID3> > dummy_data(newCapacity*WID3);
-         for (size_t i=0; i<numberOfBlocks*WID3; ++i) dummy_data[i] = block_data[i];
-         dummy_data.swap(block_data);
-      }
-      {
-         std::vector<Real,aligned_allocator<Real,BlockParams::N_VELOCITY_BLOCK_PARAMS> > dummy_parameters(newCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
-         for (size_t i=0; i<numberOfBlocks*BlockParams::N_VELOCITY_BLOCK_PARAMS; ++i) dummy_parameters[i] = parameters[i];
-         dummy_parameters.swap(parameters);
-      }
-      currentCapacity = newCapacity;
+      reallocate(newCapacity);
       return true;
    }
 
@@ -288,9 +383,7 @@ namespace vmesh {
          // Resize so that free space is block_allocation_chunk blocks, 
          // and at least two in case of having zero blocks.
          // The order of velocity blocks is unaltered.
-         currentCapacity = 2 + numberOfBlocks * BLOCK_ALLOCATION_FACTOR;
-         block_data.resize(currentCapacity*WID3);
-         parameters.resize(currentCapacity*BlockParams::N_VELOCITY_BLOCK_PARAMS);
+         reallocate(2 + numberOfBlocks * BLOCK_ALLOCATION_FACTOR);
       }
    }
 
@@ -308,15 +401,18 @@ namespace vmesh {
       return numberOfBlocks;
    }
 
+   /** Return the memory used by existing velocity blocks.
+    * @return Bytes used by block data and parameters of existing blocks.*/
    template<typename LID> inline
    size_t VelocityBlockContainer<LID>::sizeInBytes() const {
-      return block_data.size()*sizeof(Realf) + parameters.size()*sizeof(Real);
+      return numberOfBlocks*(WID3*sizeof(Realf) + N_STORED_BLOCK_PARAMS*sizeof(Real));
    }
 
    template<typename LID> inline
    void VelocityBlockContainer<LID>::swap(VelocityBlockContainer& vbc) {
-      block_data.swap(vbc.block_data);
-      parameters.swap(vbc.parameters);
+      std::swap(extent,vbc.extent);
+      std::swap(block_data,vbc.block_data);
+      std::swap(parameters,vbc.parameters);
 
       LID dummy = currentCapacity;
       currentCapacity = vbc.currentCapacity;
@@ -334,10 +430,10 @@ namespace vmesh {
       bool ok = true;
       if (cell >= WID3) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*WID3+cell >= block_data.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in getData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " data.size()=" << block_data.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in getData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
@@ -346,32 +442,35 @@ namespace vmesh {
       return block_data[blockLID*WID3+cell];
    }
 
+   #ifndef VBC_NO_BLOCK_PARAMETERS
    template<typename LID> inline
    const Real& VelocityBlockContainer<LID>::getParameters(const LID& blockLID,const unsigned int& cell) const {
       bool ok = true;
-      if (cell >= BlockParams::N_VELOCITY_BLOCK_PARAMS) ok = false;
+      if (cell >= N_STORED_BLOCK_PARAMS) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+cell >= parameters.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in getParameters, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " parameters.size()=" << parameters.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in getParameters, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
       }
       
-      return parameters[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+cell];
+      return parameters[blockLID*N_STORED_BLOCK_PARAMS+cell];
    }
    
+   #endif
+
    template<typename LID> inline
    void VelocityBlockContainer<LID>::setData(const LID& blockLID,const unsigned int& cell,const Realf& value) {
       bool ok = true;
       if (cell >= WID3) ok = false;
       if (blockLID >= numberOfBlocks) ok = false;
-      if (blockLID*WID3+cell >= block_data.size()) ok = false;
+      if (blockLID >= currentCapacity) ok = false;
       if (ok == false) {
          std::stringstream ss;
-         ss << "VBC ERROR: out of bounds in setData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " data.size()=" << block_data.size() << std::endl;
+         ss << "VBC ERROR: out of bounds in setData, LID=" << blockLID << " cell=" << cell << " #blocks=" << numberOfBlocks << " capacity=" << currentCapacity << std::endl;
          std::cerr << ss.str();
          sleep(1);
          exit(1);
@@ -27,7 +27,6 @@
 #include <stdint.h>
 #include <vector>
 #include <map>
-#include <unordered_map>
 #include <set>
 #include <cmath>
 #include <algorithm>
@@ -36,6 +35,7 @@
    #define DEBUG_AMR_MESH
 #endif
 
+#include "open_hash_map.h"
 #include "velocity_mesh_parameters.h"
 
 namespace vmesh {
@@ -114,7 +114,7 @@ namespace vmesh {
       //LID* gridLengths;
 
       std::vector<GID> localToGlobalMap;
-      std::unordered_map<GID,LID> globalToLocalMap;
+      OpenHashMap<GID,LID> globalToLocalMap;
 
       bool checkChildren(const GID& globalID) const;
       bool checkParent(const GID& globalID) const;
@@ -148,7 +148,7 @@ namespace vmesh {
       
       for (size_t b=0; b<size(); ++b) {
          const LID globalID = localToGlobalMap[b];
-         typename std::unordered_map<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
+         typename OpenHashMap<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
          const GID localID = it->second;
          if (localID != b) {
             ok = false;
@@ -213,7 +213,7 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::clear() {
       std::vector<GID>().swap(localToGlobalMap);
-      std::unordered_map<GID,LID>().swap(globalToLocalMap);
+      OpenHashMap<GID,LID>().swap(globalToLocalMap);
    }
    
    template<typename GID,typename LID> inline
@@ -545,7 +545,7 @@ namespace vmesh {
 
    template<typename GID,typename LID> inline
    LID VelocityMesh<GID,LID>::getLocalID(const GID& globalID) const {
-      typename std::unordered_map<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
+      typename OpenHashMap<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
       if (it != globalToLocalMap.end()) return it->second;
       return invalidLocalID();
    }
@@ -642,7 +642,7 @@ namespace vmesh {
       getIndices(globalID,refLevel,i,j,k);
 
       // First check if the neighbor at same refinement level exists
-      typename std::unordered_map<GID,LID>::const_iterator nbr;
+      typename OpenHashMap<GID,LID>::const_iterator nbr;
       GID nbrGlobalID = getGlobalID(refLevel,i+i_off,j+j_off,k+k_off);
       if (nbrGlobalID == invalidGlobalID()) return;
 
@@ -946,7 +946,7 @@ namespace vmesh {
          }
       #endif
 	  
-      typename std::unordered_map<GID,LID>::iterator last = globalToLocalMap.find(lastGID);
+      typename OpenHashMap<GID,LID>::iterator last = globalToLocalMap.find(lastGID);
       globalToLocalMap.erase(last);
       localToGlobalMap.pop_back();
    }
@@ -959,7 +959,7 @@ namespace vmesh {
          return false;
       }
 
-      std::pair<typename std::unordered_map<GID,LID>::iterator,bool> position
+      std::pair<typename OpenHashMap<GID,LID>::iterator,bool> position
         = globalToLocalMap.insert(std::make_pair(globalID,localToGlobalMap.size()));
 
       if (position.second == true) {	 
@@ -978,9 +978,10 @@ namespace vmesh {
 
       // Attempt to add the given blocks
       uint8_t adds=0;
+      globalToLocalMap.reserve(size()+blocks.size());
       for (size_t b=0; b<blocks.size(); ++b) {
          const GID globalID = blocks[b];
-         std::pair<typename std::unordered_map<GID,LID>::iterator,bool> position
+         std::pair<typename OpenHashMap<GID,LID>::iterator,bool> position
            = globalToLocalMap.insert(std::make_pair(globalID,localToGlobalMap.size()+b));
          if (position.second == true) {
             localToGlobalMap.push_back(globalID);
@@ -994,7 +995,7 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::refine(const GID& globalID,std::set<GID>& erasedBlocks,std::map<GID,LID>& insertedBlocks) {
       // Check that the block exists
-      typename std::unordered_map<GID,LID>::iterator it = globalToLocalMap.find(globalID);
+      typename OpenHashMap<GID,LID>::iterator it = globalToLocalMap.find(globalID);
       if (it == globalToLocalMap.end()) {
          return false;
       }
@@ -1063,6 +1064,7 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::setGrid() {
       globalToLocalMap.clear();
+      globalToLocalMap.reserve(localToGlobalMap.size());
       for (size_t i=0; i<localToGlobalMap.size(); ++i) {
          globalToLocalMap.insert(std::make_pair(localToGlobalMap[i],i));
       }
@@ -1071,6 +1073,7 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::setGrid(const std::vector<GID>& globalIDs) {
       globalToLocalMap.clear();
+      globalToLocalMap.reserve(globalIDs.size());
       for (LID i=0; i<globalIDs.size(); ++i) {
          globalToLocalMap.insert(std::make_pair(globalIDs[i],i));
       }
@@ -23,14 +23,15 @@
 #ifndef VELOCITY_MESH_OLD_H
 #define VELOCITY_MESH_OLD_H
 
+#include <atomic>
 #include <iostream>
 #include <sstream>
 #include <stdint.h>
 #include <vector>
-#include <unordered_map>
 #include <set>
 #include <cmath>
 
+#include "open_hash_map.h"
 #include "velocity_mesh_parameters.h"
 
 namespace vmesh {
@@ -67,6 +68,7 @@ namespace vmesh {
 //      void     getNeighbors(const GlobalID& globalID,std::vector<GlobalID>& neighborIDs);
       void getIndices(const GID& globalID,uint8_t& refLevel,LID& i,LID& j,LID& k) const;
       size_t getMesh() const;
+      uint64_t getVersion() const;
       LID getLocalID(const GID& globalID) const;
       uint8_t getMaxAllowedRefinementLevel() const;
       GID getMaxVelocityBlocks() const;
@@ -102,11 +104,20 @@ namespace vmesh {
       void swap(VelocityMesh& vm);
 
     private:
+      size_t getGridSize() const;
+      void rebuildIndex();
+      void updateIndexMode();
+      static uint64_t newVersion();
+
       static std::vector<vmesh::MeshParameters> meshParameters;
       size_t meshID;
 
       std::vector<GID> localToGlobalMap;
-      std::unordered_map<GID,LID> globalToLocalMap;
+      OpenHashMap<GID,LID> globalToLocalMap; /**< Global ID to local ID index of a sparse mesh.*/
+      std::vector<LID> denseMap;             /**< Global ID to local ID index of a dense mesh, indexed by 
+                                              * global ID, invalidLocalID() for non-existing blocks.*/
+      bool dense;                            /**< If true, denseMap is used as the index instead of globalToLocalMap.*/
+      uint64_t version;                      /**< Changes whenever blocks are added or removed, see getVersion().*/
    };
 
    // ***** INITIALIZERS FOR STATIC MEMBER VARIABLES ***** //
@@ -117,6 +128,8 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    VelocityMesh<GID,LID>::VelocityMesh() { 
       meshID = std::numeric_limits<size_t>::max();
+      dense = false;
+      version = newVersion();
    }
    
    template<typename GID,typename LID> inline
@@ -125,14 +138,15 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    size_t VelocityMesh<GID,LID>::capacityInBytes() const {
       return localToGlobalMap.capacity()*sizeof(GID)
-           + globalToLocalMap.bucket_count()*(sizeof(GID)+sizeof(LID));
+           + globalToLocalMap.bucket_count()*(sizeof(GID)+sizeof(LID))
+           + denseMap.capacity()*sizeof(LID);
    }
 
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::check() const {
       bool ok = true;
 
-      if (localToGlobalMap.size() != globalToLocalMap.size()) {
+      if (dense == false && localToGlobalMap.size() != globalToLocalMap.size()) {
          std::cerr << "VMO ERROR: sizes differ, " << localToGlobalMap.size() << " vs " << globalToLocalMap.size() << std::endl;
          ok = false;
          exit(1);	 
@@ -140,8 +154,7 @@ namespace vmesh {
 
       for (size_t b=0; b<size(); ++b) {
          const LID globalID = localToGlobalMap[b];
-         typename std::unordered_map<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
-         const GID localID = it->second;
+         const GID localID = getLocalID(globalID);
          if (localID != b) {
             ok = false;
             std::cerr << "VMO ERROR: localToGlobalMap[" << b << "] = " << globalID << " but ";
@@ -156,7 +169,10 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::clear() {
       std::vector<GID>().swap(localToGlobalMap);
-      std::unordered_map<GID,LID>().swap(globalToLocalMap);
+      OpenHashMap<GID,LID>().swap(globalToLocalMap);
+      std::vector<LID>().swap(denseMap);
+      dense = false;
+      version = newVersion();
    }
    
    template<typename GID,typename LID> inline
@@ -169,6 +185,14 @@ namespace vmesh {
       const GID sourceGID = localToGlobalMap[sourceLID]; // block at the end of list
       const GID targetGID = localToGlobalMap[targetLID]; // removed block
 
+      if (dense == true) {
+         denseMap[sourceGID]         = targetLID;
+         localToGlobalMap[targetLID] = sourceGID;
+         denseMap[targetGID]         = sourceLID; // These are needed to make pop() work
+         localToGlobalMap[sourceLID] = targetGID;
+         return true;
+      }
+
       // at-function will throw out_of_range exception for non-existing global ID:
       globalToLocalMap.at(sourceGID) = targetLID;
       localToGlobalMap[targetLID]    = sourceGID;
@@ -179,7 +203,7 @@ namespace vmesh {
    
    template<typename GID,typename LID> inline
    size_t VelocityMesh<GID,LID>::count(const GID& globalID) const {
-      return globalToLocalMap.count(globalID);
+      return (getLocalID(globalID) == invalidLocalID()) ? 0 : 1;
    }
    
    template<typename GID,typename LID> inline
@@ -193,7 +217,7 @@ namespace vmesh {
       GID blockGID = getGlobalID(0,i_block,j_block,k_block);
       
       // If the block exists, return it:
-      if (globalToLocalMap.find(blockGID) != globalToLocalMap.end()) {
+      if (count(blockGID) > 0) {
          return blockGID;
       } else {
          return invalidGlobalID();
@@ -376,7 +400,12 @@ namespace vmesh {
 
    template<typename GID,typename LID> inline
    LID VelocityMesh<GID,LID>::getLocalID(const GID& globalID) const {
-      typename std::unordered_map<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
+      if (dense == true) {
+         if (globalID < denseMap.size()) return denseMap[globalID];
+         return invalidLocalID();
+      }
+
+      typename OpenHashMap<GID,LID>::const_iterator it = globalToLocalMap.find(globalID);
       if (it != globalToLocalMap.end()) return it->second;
       return invalidLocalID();
    }
@@ -396,6 +425,15 @@ namespace vmesh {
       return meshID;
    }
    
+   /** Get the version of the set of blocks in this mesh. A new version number, unique
+    * within the process, is taken whenever blocks are added or removed. Copies of a mesh
+    * share the version, so equal versions mean equal sets of global IDs. Changing the 
+    * local IDs of existing blocks (copy) does not change the version.*/
+   template<typename GID,typename LID> inline
+   uint64_t VelocityMesh<GID,LID>::getVersion() const {
+      return version;
+   }
+
    template<typename GID,typename LID> inline
    const Real* VelocityMesh<GID,LID>::getMeshMaxLimits() const {
       return meshParameters[meshID].meshMaxLimits;
@@ -448,13 +486,12 @@ namespace vmesh {
       getIndices(globalID,refLevel,i,j,k);
       
       // Return the requested neighbor if it exists:
-      typename std::unordered_map<GID,LID>::const_iterator nbr;
       GID nbrGlobalID = getGlobalID(0,i+i_off,j+j_off,k+k_off);
       if (nbrGlobalID == invalidGlobalID()) return;
 
-      nbr = globalToLocalMap.find(nbrGlobalID);
-      if (nbr != globalToLocalMap.end()) {
-         neighborLocalIDs.push_back(nbr->second);
+      const LID nbrLocalID = getLocalID(nbrGlobalID);
+      if (nbrLocalID != invalidLocalID()) {
+         neighborLocalIDs.push_back(nbrLocalID);
          refLevelDifference = 0;
          return;
       }
@@ -581,22 +618,39 @@ namespace vmesh {
 
       const LID lastLID = size()-1;
       const GID lastGID = localToGlobalMap[lastLID];
-      typename std::unordered_map<GID,LID>::iterator last = globalToLocalMap.find(lastGID);
-
-      globalToLocalMap.erase(last);
+      if (dense == true) {
+         denseMap[lastGID] = invalidLocalID();
+      } else {
+         typename OpenHashMap<GID,LID>::iterator last = globalToLocalMap.find(lastGID);
+         globalToLocalMap.erase(last);
+      }
       localToGlobalMap.pop_back();
+      updateIndexMode();
+      version = newVersion();
    }
 
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::push_back(const GID& globalID) {
       if (size() >= meshParameters[meshID].max_velocity_blocks) return false;
       if (globalID == invalidGlobalID()) return false;
+      if (getGridSize() > 0 && globalID >= getGridSize()) return false;
 
-      std::pair<typename std::unordered_map<GID,LID>::iterator,bool> position
+      if (dense == true) {
+         if (globalID >= denseMap.size()) return false;
+         if (denseMap[globalID] != invalidLocalID()) return false;
+         denseMap[globalID] = localToGlobalMap.size();
+         localToGlobalMap.push_back(globalID);
+         version = newVersion();
+         return true;
+      }
+
+      std::pair<typename OpenHashMap<GID,LID>::iterator,bool> position
         = globalToLocalMap.insert(std::make_pair(globalID,localToGlobalMap.size()));
 
       if (position.second == true) {
          localToGlobalMap.push_back(globalID);
+         updateIndexMode();
+         version = newVersion();
       }
 
       return position.second;
@@ -611,11 +665,37 @@ namespace vmesh {
          return false;
       }
          
+      // Blocks are rejected like in push_back(const GID&). If any block is invalid, outside 
+      // of the grid or already exists, the blocks added so far are removed again.
+      const size_t gridSize = getGridSize();
+      const LID offset = size();
+      bool valid = true;
+      if (dense == false) globalToLocalMap.reserve(offset+blocks.size());
       for (size_t b=0; b<blocks.size(); ++b) {
-         globalToLocalMap.insert(std::make_pair(blocks[b],localToGlobalMap.size()+b));
+         const GID globalID = blocks[b];
+         if (globalID == invalidGlobalID() || (gridSize > 0 && globalID >= gridSize)) {valid = false; break;}
+         if (dense == true) {
+            if (denseMap[globalID] != invalidLocalID()) {valid = false; break;}
+            denseMap[globalID] = offset+b;
+         } else if (globalToLocalMap.insert(std::make_pair(globalID,offset+b)).second == false) {
+            valid = false;
+            break;
+         }
+         localToGlobalMap.push_back(globalID);
+      }
+
+      if (valid == false) {
+         for (size_t i=offset; i<localToGlobalMap.size(); ++i) {
+            if (dense == true) denseMap[localToGlobalMap[i]] = invalidLocalID();
+            else globalToLocalMap.erase(localToGlobalMap[i]);
+         }
+         localToGlobalMap.resize(offset);
+         std::cerr << "vmesh: invalid, out of grid or duplicate block in push_back, no blocks added" << std::endl;
+         return false;
       }
-      localToGlobalMap.insert(localToGlobalMap.end(),blocks.begin(),blocks.end());
 
+      updateIndexMode();
+      version = newVersion();
       return true;
    }
    
@@ -626,19 +706,15 @@ namespace vmesh {
 
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::setGrid() {
-      globalToLocalMap.clear();
-      for (size_t i=0; i<localToGlobalMap.size(); ++i) {
-         globalToLocalMap.insert(std::make_pair(localToGlobalMap[i],i));
-      }
+      rebuildIndex();
+      version = newVersion();
    }
 
    template<typename GID,typename LID> inline
    bool VelocityMesh<GID,LID>::setGrid(const std::vector<GID>& globalIDs) {
-      globalToLocalMap.clear();
-      for (LID i=0; i<globalIDs.size(); ++i) {
-         globalToLocalMap.insert(std::make_pair(globalIDs[i],i));
-      }
       localToGlobalMap = globalIDs;
+      rebuildIndex();
+      version = newVersion();
       return true;
    }
 
@@ -652,6 +728,7 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::setNewSize(const LID& newSize) {
       localToGlobalMap.resize(newSize);
+      version = newVersion();
    }
 
    template<typename GID,typename LID> inline
@@ -662,13 +739,74 @@ namespace vmesh {
    template<typename GID,typename LID> inline
    size_t VelocityMesh<GID,LID>::sizeInBytes() const {
       return globalToLocalMap.size()*sizeof(GID)
-           + localToGlobalMap.size()*(sizeof(GID)+sizeof(LID));
+           + localToGlobalMap.size()*(sizeof(GID)+sizeof(LID))
+           + denseMap.size()*sizeof(LID);
    }
 
    template<typename GID,typename LID> inline
    void VelocityMesh<GID,LID>::swap(VelocityMesh& vm) {
       globalToLocalMap.swap(vm.globalToLocalMap);
       localToGlobalMap.swap(vm.localToGlobalMap);
+      denseMap.swap(vm.denseMap);
+      std::swap(dense,vm.dense);
+      std::swap(version,vm.version);
+   }
+
+   /** Take a new mesh version number. Numbers are unique within the process, each thread
+    * hands out numbers from its own range so that no synchronization is needed.*/
+   template<typename GID,typename LID> inline
+   uint64_t VelocityMesh<GID,LID>::newVersion() {
+      static std::atomic<uint64_t> threadCounter(0);
+      static thread_local const uint64_t threadBase = (threadCounter++) << 40;
+      static thread_local uint64_t counter = 0;
+      return threadBase | (++counter);
+   }
+
+   /** Get the total number of blocks in the mesh grid, i.e., the size of the dense index.
+    * Returns zero if the mesh has not been set.*/
+   template<typename GID,typename LID> inline
+   size_t VelocityMesh<GID,LID>::getGridSize() const {
+      if (meshID >= meshParameters.size()) return 0;
+      return static_cast<size_t>(meshParameters[meshID].gridLength[0])
+           * meshParameters[meshID].gridLength[1]
+           * meshParameters[meshID].gridLength[2];
+   }
+
+   /** Rebuild the global ID to local ID index from localToGlobalMap. The dense 
+    * index is used if the fraction of existing blocks exceeds MeshParameters::denseFillFraction.*/
+   template<typename GID,typename LID> inline
+   void VelocityMesh<GID,LID>::rebuildIndex() {
+      const size_t gridSize = getGridSize();
+      dense = (gridSize > 0 && size() > meshParameters[meshID].denseFillFraction*gridSize);
+
+      if (dense == true) {
+         OpenHashMap<GID,LID>().swap(globalToLocalMap);
+         denseMap.assign(gridSize,invalidLocalID());
+         for (size_t i=0; i<localToGlobalMap.size(); ++i) {
+            denseMap[localToGlobalMap[i]] = i;
+         }
+      } else {
+         std::vector<LID>().swap(denseMap);
+         globalToLocalMap.clear();
+         globalToLocalMap.reserve(localToGlobalMap.size());
+         for (size_t i=0; i<localToGlobalMap.size(); ++i) {
+            globalToLocalMap.insert(std::make_pair(localToGlobalMap[i],i));
+         }
+      }
+   }
+
+   /** Switch between the sparse and dense index if the number of blocks has 
+    * crossed the threshold. The mesh becomes dense when the fill fraction exceeds 
+    * MeshParameters::denseFillFraction, and sparse again when the fill fraction 
+    * drops below half of it, so that the index is not rebuilt back and forth.*/
+   template<typename GID,typename LID> inline
+   void VelocityMesh<GID,LID>::updateIndexMode() {
+      const size_t gridSize = getGridSize();
+      if (gridSize == 0) return;
+
+      const Real fillFraction = static_cast<Real>(size())/gridSize;
+      if (dense == false && fillFraction > meshParameters[meshID].denseFillFraction) rebuildIndex();
+      else if (dense == true && fillFraction < 0.5*meshParameters[meshID].denseFillFraction) rebuildIndex();
    }
    
 } // namespace vmesh
@@ -50,6 +50,10 @@ namespace vmesh {
       vmesh::LocalID gridLength[3];             /**< Number of blocks in mesh per coordinate at base grid level.*/
       vmesh::LocalID blockLength[3];            /**< Number of phase-space cells per coordinate in block.*/
       uint8_t refLevelMaxAllowed;               /**< Maximum refinement level allowed, 0=no refinement.*/
+      Real denseFillFraction;                   /**< If the fraction of existing blocks of all blocks in the grid 
+                                                 * exceeds this value, the mesh uses a dense global ID to local ID 
+                                                 * index instead of a hash map. Values >= 1 disable the dense index.
+                                                 * Only used by the non-AMR mesh.*/
       
       // ***** DERIVED PARAMETERS, CALCULATED BY VELOCITY MESH ***** //
       bool initialized;                         /**< If true, variables in this struct contain sensible values.*/
@@ -73,6 +77,7 @@ namespace vmesh {
 
       MeshParameters() {
          initialized = false;
+         denseFillFraction = 0.25;
       }
    };
 
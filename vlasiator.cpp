@@ -118,21 +118,23 @@ bool computeNewTimeStep(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpi
       
       for (int popID=0; popID<getObjectWrapper().particleSpecies.size(); ++popID) {
          vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
-         const Real* blockParams = blockContainer.getParameters();
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
          const Real EPS = numeric_limits<Real>::min()*1000;
          for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+            const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
             for (unsigned int i=0; i<WID;i+=WID-1) {
                 const Real Vx 
-                  = blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::VXCRD] 
-                  + (i+HALF)*blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVX]
+                  = blockParams[BlockParams::VXCRD] 
+                  + (i+HALF)*blockParams[BlockParams::DVX]
                   + EPS;
                 const Real Vy 
-                  = blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::VYCRD] 
-                  + (i+HALF)*blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVY]
+                  = blockParams[BlockParams::VYCRD] 
+                  + (i+HALF)*blockParams[BlockParams::DVY]
                   + EPS;
                     const Real Vz 
-                  = blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::VZCRD]
-                  + (i+HALF)*blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVZ]
+                  = blockParams[BlockParams::VZCRD]
+                  + (i+HALF)*blockParams[BlockParams::DVZ]
                   + EPS;
 
                 const Real dt_max_cell = min(dx/fabs(Vx),min(dy/fabs(Vy),dz/fabs(Vz)));
@@ -250,9 +252,12 @@ int main(int argn,char* args[]) {
    bool dtIsChanged;
    
 // Init MPI:
+   // Full thread support is only requested for the background writer of io.async_write_queue_depth,
+   // which falls back to synchronous writes if it is not provided.
    int required=MPI_THREAD_FUNNELED;
+   int requested=MPI_THREAD_MULTIPLE;
    int provided;
-   MPI_Init_thread(&argn,&args,required,&provided);
+   MPI_Init_thread(&argn,&args,requested,&provided);
    if (required > provided){
       MPI_Comm_rank(MPI_COMM_WORLD,&myRank);
       if(myRank==MASTER_RANK)
@@ -486,6 +491,8 @@ int main(int argn,char* args[]) {
    int doNow[2]; // 0: writeRestartNow, 1: balanceLoadNow ; declared outside main loop
    int writeRestartNow; // declared outside main loop
    bool overrideRebalanceNow = false; // declared outside main loop
+   Real lastRebalanceTime = 0.0; // wall time of the last rebalance, declared outside main loop
+   Real imbalanceLoss = 0.0; // time lost to load imbalance since the last rebalance, declared outside main loop
    
    addTimedBarrier("barrier-end-initialization");
    
@@ -533,7 +540,7 @@ int main(int argn,char* args[]) {
          beforeTime = MPI_Wtime();
          beforeSimulationTime=P::t;
          beforeStep=P::tstep;
-         //report_grid_memory_consumption(mpiGrid);
+         if (P::reportGridMemory == true) report_grid_memory_consumption(mpiGrid);
          report_process_memory_consumption();
       }
       logFile << writeVerbose;
@@ -635,15 +642,36 @@ int main(int argn,char* args[]) {
       }
       
       //Re-loadbalance if needed
-      //TODO - add LB measure and do LB if it exceeds threshold
-      if((P::tstep % P::rebalanceInterval == 0 && P::tstep > P::tstep_min) || overrideRebalanceNow == true) {
+      bool rebalanceNow = (P::tstep % P::rebalanceInterval == 0 && P::tstep > P::tstep_min);
+      if (rebalanceNow == true && overrideRebalanceNow == false && P::rebalanceImbalanceThreshold > 0) {
+         // The compute time was measured in the last step. Its imbalance is taken to hold for
+         // every step of the interval, and the load is rebalanced when it is out of balance and
+         // the time lost to the imbalance since the last rebalance has exceeded the cost of that rebalance.
+         phiprof::start("compute-load-imbalance");
+         Real maxTime,meanTime;
+         computeLoadImbalance(mpiGrid,maxTime,meanTime,lastRebalanceTime);
+         imbalanceLoss += (maxTime - meanTime) * P::rebalanceInterval;
+         const Real imbalance = (meanTime > 0) ? maxTime / meanTime : 1.0;
+         rebalanceNow = (imbalance > P::rebalanceImbalanceThreshold && imbalanceLoss > lastRebalanceTime);
+         if (rebalanceNow == true) {
+            logFile << "(LB): Imbalance " << imbalance << " (max/mean compute time " << maxTime << "/" << meanTime << " s), ";
+            logFile << "lost " << imbalanceLoss << " s since last rebalance which took " << lastRebalanceTime << " s" << endl << writeVerbose;
+         } else {
+            P::prepareForRebalance = false;
+         }
+         phiprof::stop("compute-load-imbalance");
+      }
+      if (rebalanceNow == true || overrideRebalanceNow == true) {
          logFile << "(LB): Start load balance, tstep = " << P::tstep << " t = " << P::t << endl << writeVerbose;
+         const double rebalanceStart = MPI_Wtime();
          balanceLoad(mpiGrid, sysBoundaries);
          addTimedBarrier("barrier-end-load-balance");
          phiprof::start("Shrink_to_fit");
          // * shrink to fit after LB * //
          shrink_to_fit_grid_data(mpiGrid);
          phiprof::stop("Shrink_to_fit");
+         lastRebalanceTime = MPI_Wtime() - rebalanceStart;
+         imbalanceLoss = 0.0;
          logFile << "(LB): ... done!"  << endl << writeVerbose;
          P::prepareForRebalance = false;
          overrideRebalanceNow = false;
@@ -705,7 +733,9 @@ int main(int argn,char* args[]) {
       
       if (P::propagateVlasovTranslation || P::propagateVlasovAcceleration ) {
          phiprof::start("Update system boundaries (Vlasov pre-translation)");
+         const double t_boundaries = MPI_Wtime();
          sysBoundaries.applySysBoundaryVlasovConditions(mpiGrid, P::t+0.5*P::dt); 
+         if (P::prepareForRebalance == true) addLoadBalanceWeight(mpiGrid,(MPI_Wtime() - t_boundaries) * omp_get_max_threads(),true);
          phiprof::stop("Update system boundaries (Vlasov pre-translation)");
          addTimedBarrier("barrier-boundary-conditions");
       }
@@ -734,7 +764,9 @@ int main(int argn,char* args[]) {
       // Apply boundary conditions
       if (P::propagateVlasovTranslation || P::propagateVlasovAcceleration ) {
          phiprof::start("Update system boundaries (Vlasov post-translation)");
+         const double t_boundaries = MPI_Wtime();
          sysBoundaries.applySysBoundaryVlasovConditions(mpiGrid, P::t+0.5*P::dt); 
+         if (P::prepareForRebalance == true) addLoadBalanceWeight(mpiGrid,(MPI_Wtime() - t_boundaries) * omp_get_max_threads(),true);
          phiprof::stop("Update system boundaries (Vlasov post-translation)");
          addTimedBarrier("barrier-boundary-conditions");
       }
@@ -743,7 +775,10 @@ int main(int argn,char* args[]) {
       // moments for t + dt are computed (field uses t and t+0.5dt)
       if (P::propagateField) {
          phiprof::start("Propagate Fields");
+         const double t_fields = MPI_Wtime();
          propagateFields(mpiGrid, sysBoundaries, P::dt, P::fieldSolverSubcycles);
+         // The field solver is not timed per cell, its cost is the same for every cell
+         if (P::prepareForRebalance == true) addLoadBalanceWeight(mpiGrid,(MPI_Wtime() - t_fields) * omp_get_max_threads(),false);
          phiprof::stop("Propagate Fields",cells.size(),"SpatialCells");
          addTimedBarrier("barrier-after-field-solver");
       }
@@ -799,6 +834,8 @@ int main(int argn,char* args[]) {
    
    phiprof::stop("Simulation");
    phiprof::start("Finalization");
+   finalizeAsyncWrites();
+   freeCellMPIDatatypes(mpiGrid);
    if (P::propagateField ) { 
       finalizeFieldPropagator(mpiGrid);
    }
@@ -28,7 +28,7 @@
 void loadColumnBlockData(
    const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
    vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer,
-   vmesh::GlobalID* blocks,
+   const vmesh::GlobalID* blocks,
    vmesh::LocalID n_blocks,
    const int dimension,
    Vec* __restrict__ values) {
@@ -36,12 +36,14 @@ void loadColumnBlockData(
    // we store above and below the existing blocks
 
    for (uint k=0; k<WID; ++k) {
-      for (uint j = 0; j < WID; j += VECL/WID){ 
-         values[i_pcolumnv(j, k, -1, n_blocks)] = Vec(0);
-         values[i_pcolumnv(j, k, n_blocks, n_blocks)] = Vec(0);
+      for (uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++){ 
+         values[i_pcolumnv_b(planeVector, k, -1, n_blocks)] = Vec(0);
+         values[i_pcolumnv_b(planeVector, k, n_blocks, n_blocks)] = Vec(0);
       }
    }
 
+#if VELOCITY_BLOCK_WIDTH == 4 && (defined(VEC4F_AGNER) || defined(VEC4D_AGNER) || defined(VEC8F_AGNER) || defined(VEC8D_AGNER) || defined(VEC16F_AGNER))
+   // Compile time gathers generated for WID=4 blocks
    /*[[[cog
 import cog
 
@@ -243,6 +245,34 @@ for dimension in range(0, 2):
       }
    }
 //[[[end]]]
+#else
+   // Generic transpose for other block widths and the fallback vector backends
+   if (dimension == 0 || dimension == 1) {
+      // block cell index of solver indices i,j,k (i is the vectorized dimension, k is the mapped dimension)
+      const uint cell_indices_to_id[3] = {dimension == 0 ? WID2 : 1,
+                                          dimension == 0 ? WID : WID2,
+                                          dimension == 0 ? 1 : WID};
+      Realv blockValues[VECL];
+      for (vmesh::LocalID block_k=0; block_k<n_blocks; ++block_k) {
+         Realf* __restrict__ data = blockContainer.getData(vmesh.getLocalID(blocks[block_k]));
+         for (uint k=0; k<WID; ++k) {
+            for (uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++) {
+               for (uint e = 0; e < VECL; ++e) {
+                  const uint planeCell = planeVector * VECL + e;
+                  blockValues[e] = data[(planeCell % WID) * cell_indices_to_id[0] +
+                                        (planeCell / WID) * cell_indices_to_id[1] +
+                                        k                 * cell_indices_to_id[2]];
+               }
+               values[i_pcolumnv_b(planeVector, k, block_k, n_blocks)].load(blockValues);
+            }
+         }
+         //zero old output data
+         for (uint i=0; i<WID3; ++i) {
+            data[i]=0;
+         }
+      }
+   }
+#endif
 
    if (dimension == 2) {
       // copy block data for all blocks. Dimension 2 is easy, here
@@ -6,15 +6,18 @@
 #include "vec.h"
 
 
+static_assert(WID2 % VECL == 0,"The vector length VECL has to divide the number of cells in a velocity block plane");
+
 //index in the temporary and padded column data values array. Each
-//column has an empty block in ether end.
-#define i_pcolumnv(j, k, k_block, num_k_blocks) ( ((j) / ( VECL / WID)) * WID * ( num_k_blocks + 2) + (k) + ( k_block + 1 ) * WID )
+//column has an empty block in ether end. A plane of a block consists of
+//VEC_PER_PLANE vectors, vector planeVectorIndex covers cells
+//planeVectorIndex*VECL ... (planeVectorIndex+1)*VECL-1 (i + j*WID) of the plane.
 #define i_pcolumnv_b(planeVectorIndex, k, k_block, num_k_blocks) ( planeVectorIndex * WID * ( num_k_blocks + 2) + (k) + ( k_block + 1 ) * WID )
 
 void loadColumnBlockData(
    const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh,
    vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer,
-   vmesh::GlobalID* blocks,
+   const vmesh::GlobalID* blocks,
    vmesh::LocalID n_blocks,
    const int dimension,
    Vec* __restrict__ values);
@@ -32,6 +32,7 @@
 #include "cpu_1d_ppm.hpp"
 #include "cpu_1d_plm.hpp"
 #include "cpu_acc_map.hpp"
+#include "cpu_acc_workspace.hpp"
 
 using namespace std;
 using namespace spatial_cell;
@@ -68,9 +69,11 @@ vmesh::LocalID addVelocityBlock(const vmesh::GlobalID& blockGID,
     #endif
     
     // Set block parameters:
+    #ifndef VBC_NO_BLOCK_PARAMETERS
     Real* parameters = blockContainer.getParameters(newBlockLID);
     vmesh.getBlockCoordinates(blockGID,parameters+BlockParams::VXCRD);
     vmesh.getCellSize(blockGID,parameters+BlockParams::DVX);
+    #endif
     return newBlockLID;
 }
 
@@ -111,12 +114,24 @@ void inline swapBlockIndices(velocity_block_indices_t &blockIndices, const uint
    pre-creates new blocks in a separate loop first (serial operation),
    then the openmp parallization would scale well (better than over
    spatial cells), and would not need synchronization.
+
+   If fusedMoments is not NULL, its sums are overwritten with the velocity
+   moments (see FusedMoments) of the mapped distribution function, which
+   are accumulated while the mapped values are stored. The moments are
+   taken about the reference velocity already stored in fusedMoments.
+
+   If recordContent is true, the blocks that have content after the
+   mapping are recorded in the spatial cell (see
+   SpatialCell::set_velocity_block_content_flags), so that the
+   following block adjustment does not have to rescan all blocks.
    
 */
 bool map_1d(SpatialCell* spatial_cell,
             const int popID,     
             Realv intersection, Realv intersection_di, Realv intersection_dj,Realv intersection_dk,
-            const uint dimension) {
+            const uint dimension,
+            Real* fusedMoments,
+            bool recordContent) {
    no_subnormals();
 
    Realv dv,v_min;
@@ -188,28 +203,62 @@ bool map_1d(SpatialCell* spatial_cell,
    
    const Realv i_dv=1.0/dv;
 
-   // sort blocks according to dimension, and divide them into columns
-   vmesh::LocalID* blocks = new vmesh::LocalID[vmesh.size()];
-   std::vector<uint> columnBlockOffsets;
-   std::vector<uint> columnNumBlocks;
-   std::vector<uint> setColumnOffsets;
-   std::vector<uint> setNumColumns;
-   std::vector<int> columnMinBlockK;
-   std::vector<int> columnMaxBlockK;
-   
-   sortBlocklistByDimension(vmesh, dimension, blocks,
-                            columnBlockOffsets, columnNumBlocks,
-                            setColumnOffsets, setNumColumns);
-   
-   // loop over block column sets  (all columns along the dimension with the other dimensions being equal )
-      
+   // Velocity directions of the vectorized i index and the j index after the swap
+   const uint dimension_i = (dimension == 0) ? 2 : 0;
+   const uint dimension_j = (dimension == 1) ? 2 : 1;
+   // Moments are accumulated in double precision also when the mapping is done in float (see Vecd in vec.h)
+   const Real dv_k = vmesh.getCellSize(REFLEVEL)[dimension];
+   const Real dv_i = vmesh.getCellSize(REFLEVEL)[dimension_i];
+   const Real dv_j = vmesh.getCellSize(REFLEVEL)[dimension_j];
+   const Real v_min_k = vmesh.getMeshMinLimits()[dimension];
+   const Real v_min_i = vmesh.getMeshMinLimits()[dimension_i];
+   const Real v_min_j = vmesh.getMeshMinLimits()[dimension_j];
+   if (fusedMoments != NULL) {
+      for (int m=0; m<FusedMoments::N_FUSED_SUMS; ++m) fusedMoments[m] = 0.0;
+   }
+   // Moments are accumulated about the reference velocity stored in fusedMoments
+   const Real u_k = (fusedMoments != NULL) ? fusedMoments[FusedMoments::UX + dimension]   : 0.0;
+   const Real u_i = (fusedMoments != NULL) ? fusedMoments[FusedMoments::UX + dimension_i] : 0.0;
+   const Real u_j = (fusedMoments != NULL) ? fusedMoments[FusedMoments::UX + dimension_j] : 0.0;
+
+   // All scratch buffers come from the workspace of this thread, they are
+   // reused between calls so that the mapping does not allocate memory
+   AccelerationWorkspace& workspace = getAccelerationWorkspace();
 /*   
      values array used to store column data The max size is the worst
      case scenario with every second block having content, creating up
      to ( MAX_BLOCKS_PER_DIM / 2 + 1) columns with each needing three
      blocks (two for padding)
 */
-   Vec values[(3 * ( MAX_BLOCKS_PER_DIM / 2 + 1)) * WID3 / VECL];
+   workspace.prepare(vmesh.size(),(3 * ( MAX_BLOCKS_PER_DIM / 2 + 1)) * WID3 / VECL);
+   Vec* values = workspace.values.data();
+
+   // Blocks with content after this mapping, recorded only if recordContent is true
+   const Real minValue = spatial_cell->getVelocityBlockMinValue(popID);
+   std::vector<vmesh::GlobalID>& blocksWithContent = workspace.blocksWithContent;
+
+   // sort blocks according to dimension, and divide them into columns. If columns are 
+   // cached they are only sorted again if blocks have been added or removed since the
+   // last mapping along this dimension, e.g., in earlier acceleration subcycles
+   VelocityBlockColumns& columns = (Parameters::cacheAccelerationColumns == true) ?
+      spatial_cell->get_velocity_block_columns(dimension,popID) : workspace.columns;
+   if (Parameters::cacheAccelerationColumns == false || columns.meshVersion != vmesh.getVersion()) {
+      AccelerationWorkspace::prepareColumns(columns,vmesh.size());
+      sortBlocklistByDimension(vmesh, dimension, columns.blocks.data(),
+                               columns.columnBlockOffsets, columns.columnNumBlocks,
+                               columns.setColumnOffsets, columns.setNumColumns,
+                               workspace.blockPairs, workspace.blockPairsScratch);
+      columns.meshVersion = vmesh.getVersion();
+   }
+   const vmesh::GlobalID* blocks = columns.blocks.data();
+   const std::vector<uint>& columnBlockOffsets = columns.columnBlockOffsets;
+   const std::vector<uint>& columnNumBlocks = columns.columnNumBlocks;
+   const std::vector<uint>& setColumnOffsets = columns.setColumnOffsets;
+   const std::vector<uint>& setNumColumns = columns.setNumColumns;
+   std::vector<int>& columnMinBlockK = workspace.columnMinBlockK;
+   std::vector<int>& columnMaxBlockK = workspace.columnMaxBlockK;
+   
+   // loop over block column sets  (all columns along the dimension with the other dimensions being equal )
    /*pointers to target block datas*/
    Realf *blockIndexToBlockData[MAX_BLOCKS_PER_DIM];
    bool isTargetBlock[MAX_BLOCKS_PER_DIM];
@@ -228,7 +277,7 @@ bool map_1d(SpatialCell* spatial_cell,
       uint valuesColumnOffset = 0; //offset to values array for data in a column in this set
       for(uint columnIndex = setColumnOffsets[setIndex]; columnIndex < setColumnOffsets[setIndex] + setNumColumns[setIndex] ; columnIndex ++){
          const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
-         vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
+         const vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
          loadColumnBlockData(vmesh, blockContainer, cblocks, n_cblocks, dimension, values + valuesColumnOffset);
          valuesColumnOffset += (n_cblocks + 2) * (WID3/VECL); // there are WID3/VECL elements of type Vec per block
       }
@@ -280,7 +329,7 @@ bool map_1d(SpatialCell* spatial_cell,
       //now, record which blocks are target blocks
       for(uint columnIndex = setColumnOffsets[setIndex]; columnIndex < setColumnOffsets[setIndex] + setNumColumns[setIndex] ; columnIndex ++){
          const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
-         vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
+         const vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
          velocity_block_indices_t firstBlockIndices;
          velocity_block_indices_t lastBlockIndices;
          vmesh.getIndices(cblocks[0],
@@ -372,7 +421,7 @@ bool map_1d(SpatialCell* spatial_cell,
       valuesColumnOffset = 0; //offset to values array for data in a column in this set
       for(uint columnIndex = setColumnOffsets[setIndex]; columnIndex < setColumnOffsets[setIndex] + setNumColumns[setIndex] ; columnIndex ++){
          const vmesh::LocalID n_cblocks = columnNumBlocks[columnIndex];
-         vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
+         const vmesh::GlobalID* cblocks = blocks + columnBlockOffsets[columnIndex]; //column blocks
       
          // compute the common indices for this block column set
          //First block in column
@@ -389,26 +438,18 @@ bool map_1d(SpatialCell* spatial_cell,
           
              Note that the i dimension is vectorized, and thus there are no loops over i
          */
-         for (uint j = 0; j < WID; j += VECL/WID){ 
+         for (uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++){ 
             // create vectors with the i and j indices in the vector position on the plane.
-            #if VECL == 4       
-            const Veci i_indices = Veci(0, 1, 2, 3);
-            const Veci j_indices = Veci(j, j, j, j);
-            #elif VECL == 8
-            const Veci i_indices = Veci(0, 1, 2, 3,
-                                        0, 1, 2, 3);
-            const Veci j_indices = Veci(j, j, j, j,
-                                        j + 1, j + 1, j + 1, j + 1);
-            #elif VECL == 16
-            const Veci i_indices = Veci(0, 1, 2, 3,
-                                        0, 1, 2, 3,
-                                        0, 1, 2, 3,
-                                        0, 1, 2, 3);
-            const Veci j_indices = Veci(j, j, j, j,
-                                        j + 1, j + 1, j + 1, j + 1,
-                                        j + 2, j + 2, j + 2, j + 2,
-                                        j + 3, j + 3, j + 3, j + 3);
-            #endif
+            int i_indices_plane[VECL];
+            int j_indices_plane[VECL];
+            for (int e = 0; e < VECL; ++e) {
+               i_indices_plane[e] = (planeVector * VECL + e) % WID;
+               j_indices_plane[e] = (planeVector * VECL + e) / WID;
+            }
+            Veci i_indices;
+            Veci j_indices;
+            i_indices.load(i_indices_plane);
+            j_indices.load(j_indices_plane);
 
             const Veci  target_cell_index_common =
                i_indices * cell_indices_to_id[0] +
@@ -459,22 +500,27 @@ bool map_1d(SpatialCell* spatial_cell,
             }
             
             
+            // sums of stored values times 1, v and v^2 (in dimension) for fused moments
+            Vecd fused_n(0.0);
+            Vecd fused_nv(0.0);
+            Vecd fused_nv2(0.0);
+            
             // loop through all blocks in column and compute the mapping as integrals.
             for (uint k=0; k < WID * n_cblocks; ++k ){
                // Compute reconstructions 
-               // values + i_pcolumnv(n_cblocks, -1, j, 0) is the starting point of the column data for fixed j
+               // values + i_pcolumnv_b(planeVector, 0, -1, n_cblocks) is the starting point of the column data for fixed planeVector
                // k + WID is the index where we have stored k index, WID amount of padding.
                #ifdef ACC_SEMILAG_PLM
                Vec a[2];
-               compute_plm_coeff(values + valuesColumnOffset + i_pcolumnv(j, 0, -1, n_cblocks), k + WID , a);
+               compute_plm_coeff(values + valuesColumnOffset + i_pcolumnv_b(planeVector, 0, -1, n_cblocks), k + WID , a);
                #endif
                #ifdef ACC_SEMILAG_PPM
                Vec a[3];
-               compute_ppm_coeff(values + valuesColumnOffset + i_pcolumnv(j, 0, -1, n_cblocks), h4, k + WID, a);
+               compute_ppm_coeff(values + valuesColumnOffset + i_pcolumnv_b(planeVector, 0, -1, n_cblocks), h4, k + WID, a);
                #endif
                #ifdef ACC_SEMILAG_PQM
                Vec a[5];
-               compute_pqm_coeff(values + valuesColumnOffset + i_pcolumnv(j, 0, -1, n_cblocks), h8, k + WID, a);
+               compute_pqm_coeff(values + valuesColumnOffset + i_pcolumnv_b(planeVector, 0, -1, n_cblocks), h8, k + WID, a);
                #endif
                
                // set the initial value for the integrand at the boundary at v = 0 
@@ -534,7 +580,7 @@ bool map_1d(SpatialCell* spatial_cell,
                   
                   
                   if(dimension == 2) {
-                     Realf* targetDataPointer = blockIndexToBlockData[blockK] + j * cell_indices_to_id[1] + gk_mod_WID * cell_indices_to_id[2];
+                     Realf* targetDataPointer = blockIndexToBlockData[blockK] + planeVector * VECL + gk_mod_WID * cell_indices_to_id[2];
                      Vec targetData;
                      targetData.load_a(targetDataPointer);
                      targetData += target_density_r - target_density_l;                  
@@ -553,14 +599,63 @@ bool map_1d(SpatialCell* spatial_cell,
                      }  // for-loop over vector elements
                   }
                   
+                  if (fusedMoments != NULL) {
+                     const Vecd target_density = to_vecd(target_density_r - target_density_l);
+                     const Real target_v = (gk + 0.5) * dv_k + v_min_k - u_k;
+                     fused_n   += target_density;
+                     fused_nv  += target_density * target_v;
+                     fused_nv2 += target_density * (target_v * target_v);
+                  }
                } // for loop over target k-indices of current source block
             } // for-loop over source blocks
-         } //for loop over j index
+            
+            if (fusedMoments != NULL) {
+               // i and j velocities are constant along the column
+               const Vecd v_i = (block_indices_begin[0] * WID + to_vecd(to_realv(i_indices)) + 0.5) * dv_i + (v_min_i - u_i);
+               const Vecd v_j = (block_indices_begin[1] * WID + to_vecd(to_realv(j_indices)) + 0.5) * dv_j + (v_min_j - u_j);
+               const Vecd fused_nv_i = fused_n * v_i;
+               const Vecd fused_nv_j = fused_n * v_j;
+               const Vecd fused_nv2_i = fused_nv_i * v_i;
+               const Vecd fused_nv2_j = fused_nv_j * v_j;
+               for (int i=0; i<VECL; ++i) {
+                  fusedMoments[FusedMoments::M0]               += fused_n[i];
+                  fusedMoments[FusedMoments::M1X + dimension]   += fused_nv[i];
+                  fusedMoments[FusedMoments::M2X + dimension]   += fused_nv2[i];
+                  fusedMoments[FusedMoments::M1X + dimension_i] += fused_nv_i[i];
+                  fusedMoments[FusedMoments::M2X + dimension_i] += fused_nv2_i[i];
+                  fusedMoments[FusedMoments::M1X + dimension_j] += fused_nv_j[i];
+                  fusedMoments[FusedMoments::M2X + dimension_j] += fused_nv2_j[i];
+               }
+            }
+         } //for loop over plane vectors
          valuesColumnOffset += (n_cblocks + 2) * (WID3/VECL) ;// there are WID3/VECL elements of type Vec per block    
       } //for loop over columns
-      
+
+      if (recordContent) {
+         // Target blocks of this set have received all their values and are still in 
+         // cache, record which of them have content for the next block adjustment
+         AccelerationWorkspace::reserve(blocksWithContent,blocksWithContent.size() + MAX_BLOCKS_PER_DIM);
+         for (uint blockK = 0; blockK < MAX_BLOCKS_PER_DIM; blockK++){
+            if (isTargetBlock[blockK] == false) continue;
+            const Realf* targetData = blockIndexToBlockData[blockK];
+            for (uint i=0; i<WID3; ++i) {
+               if (targetData[i] >= minValue) {
+                  blocksWithContent.push_back(setFirstBlockIndices[0] * block_indices_to_id[0] +
+                                              setFirstBlockIndices[1] * block_indices_to_id[1] +
+                                              blockK                  * block_indices_to_id[2]);
+                  break;
+               }
+            }
+         }
+      }
+   }
+
+   if (recordContent) spatial_cell->set_velocity_block_content_flags(blocksWithContent,minValue,popID);
+
+   if (fusedMoments != NULL) {
+      const Real DV3 = vmesh.getCellSize(REFLEVEL)[0]*vmesh.getCellSize(REFLEVEL)[1]*vmesh.getCellSize(REFLEVEL)[2];
+      for (int m=0; m<FusedMoments::N_FUSED_SUMS; ++m) fusedMoments[m] *= DV3;
    }
-   delete [] blocks;
    return true;
 }
 
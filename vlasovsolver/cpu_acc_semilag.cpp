@@ -98,6 +98,14 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
    Transform<Real,3,Affine> bwd_transform= fwd_transform.inverse();
    phiprof::stop("compute-transform");
 
+   // Velocity moments are accumulated in the last mapping if moments are fused, 
+   // clearing sets their reference velocity to the bulk velocity of the cell
+   Real* fusedMoments = NULL;
+   if (Parameters::fuseMoments == true) {
+      spatial_cell->clear_fused_moments(popID);
+      fusedMoments = spatial_cell->get_fused_moments(popID);
+   }
+
    const uint8_t refLevel = 0;
    Real intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk;
    Real intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk;
@@ -116,7 +124,7 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
           phiprof::start("compute-mapping");
           map_1d(spatial_cell, popID, intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk,0); // map along x
           map_1d(spatial_cell, popID, intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk,1); // map along y
-          map_1d(spatial_cell, popID, intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk,2); // map along z
+          map_1d(spatial_cell, popID, intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk,2,fusedMoments,true); // map along z
           phiprof::stop("compute-mapping");
           break;
           
@@ -134,7 +142,7 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
           phiprof::start("compute-mapping");
           map_1d(spatial_cell, popID, intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk,1); // map along y
           map_1d(spatial_cell, popID, intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk,2); // map along z
-          map_1d(spatial_cell, popID, intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk,0); // map along x
+          map_1d(spatial_cell, popID, intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk,0,fusedMoments,true); // map along x
           phiprof::stop("compute-mapping");
           break;
 
@@ -151,11 +159,13 @@ void cpu_accelerate_cell(SpatialCell* spatial_cell,
           phiprof::start("compute-mapping");
           map_1d(spatial_cell, popID, intersection_z,intersection_z_di,intersection_z_dj,intersection_z_dk,2); // map along z
           map_1d(spatial_cell, popID, intersection_x,intersection_x_di,intersection_x_dj,intersection_x_dk,0); // map along x
-          map_1d(spatial_cell, popID, intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk,1); // map along y
+          map_1d(spatial_cell, popID, intersection_y,intersection_y_di,intersection_y_dj,intersection_y_dk,1,fusedMoments,true); // map along y
           phiprof::stop("compute-mapping");
           break;
    }
 
+   if (fusedMoments != NULL) spatial_cell->set_fused_moments_valid(popID,true);
+
    if (Parameters::prepareForRebalance == true) {
       spatial_cell->parameters[CellParams::LBWEIGHTCOUNTER] += (MPI_Wtime() - t1);
    }
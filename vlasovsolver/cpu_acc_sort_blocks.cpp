@@ -36,10 +36,55 @@ inline bool paircomparator( const std::pair<uint, uint> & l, const std::pair<uin
    return l.first < r.first;
 }
 
+// Below this number of blocks the comparison sort is faster than clearing the radix buckets
+static const vmesh::LocalID RADIX_SORT_MIN_BLOCKS = 256;
+// Number of key bits sorted in one radix pass
+static const uint RADIX_BITS = 11;
+
+/* 
+   Sort pairs by their first element with a least significant digit
+   radix sort. Keys must be smaller than maxKey. The sort is stable and
+   runs in linear time, it needs as many passes as there are RADIX_BITS
+   digits in maxKey-1 (two passes up to 2^22 blocks in the mesh).
+   
+   pairs is sorted in place, scratch is used as the second buffer.
+*/
+static void radixSortPairs(std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> >& pairs,
+                           std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> >& scratch,
+                           const uint64_t maxKey) {
+   const size_t N = pairs.size();
+   scratch.resize(N);
+   const uint nBuckets = 1 << RADIX_BITS;
+   size_t bucketOffsets[1 << RADIX_BITS];
+   
+   for (uint shift=0; shift < 64 && ((maxKey - 1) >> shift) > 0; shift += RADIX_BITS) {
+      // count keys in each bucket
+      for (uint b=0; b<nBuckets; ++b) bucketOffsets[b] = 0;
+      for (size_t i=0; i<N; ++i) ++bucketOffsets[(pairs[i].first >> shift) & (nBuckets - 1)];
+      
+      // convert counts to the offsets where each bucket starts
+      size_t offset = 0;
+      for (uint b=0; b<nBuckets; ++b) {
+         const size_t count = bucketOffsets[b];
+         bucketOffsets[b] = offset;
+         offset += count;
+      }
+      
+      // scatter pairs to their buckets, this keeps the order of the previous pass
+      for (size_t i=0; i<N; ++i) {
+         scratch[bucketOffsets[(pairs[i].first >> shift) & (nBuckets - 1)]++] = pairs[i];
+      }
+      pairs.swap(scratch);
+   }
+}
+
 /*
    This function returns a sorted list of blocks in a cell.
 
    The sorted list is sorted according to the location, along the given dimension.
+   The output vectors are appended to, and block_pairs and block_pairs_scratch
+   are used as scratch space. Blocks are sorted with a linear-time radix sort,
+   except in small meshes.
    
 */
 #warning "unfinished documentation"
@@ -50,7 +95,9 @@ void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
                                std::vector<uint> & columnBlockOffsets,
                                std::vector<uint> & columnNumBlocks,
                                std::vector<uint> & setColumnOffsets,
-                               std::vector<uint> & setNumColumns) {
+                               std::vector<uint> & setNumColumns,
+                               std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > & block_pairs,
+                               std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > & block_pairs_scratch) {
    //const uint nBlocks = spatial_cell->get_number_of_velocity_blocks(); // Number of blocks
    const vmesh::LocalID nBlocks = vmesh.size();
 
@@ -58,8 +105,7 @@ void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
    // but is needed in some vmesh::VelocityMesh function calls.
    const uint8_t REFLEVEL = 0;
    
-   // Copy block data to vector
-   std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > block_pairs;
+   // Copy block data to vector, block_pairs is scratch space reused between calls
    block_pairs.resize( nBlocks );
    for (vmesh::LocalID i = 0; i < nBlocks; ++i ) {
       //const vmesh::GlobalID block = spatial_cell->get_velocity_block_global_id(i);
@@ -118,7 +164,13 @@ void sortBlocklistByDimension( //const spatial_cell::SpatialCell* spatial_cell,
       }
    }
    // Sort the list:
-   std::sort( block_pairs.begin(), block_pairs.end(), paircomparator );
+   const vmesh::LocalID* gridLength = vmesh.getGridLength(REFLEVEL);
+   const uint64_t maxKey = (uint64_t)gridLength[0]*gridLength[1]*gridLength[2];
+   if (nBlocks < RADIX_SORT_MIN_BLOCKS) {
+      std::sort( block_pairs.begin(), block_pairs.end(), paircomparator );
+   } else {
+      radixSortPairs(block_pairs, block_pairs_scratch, maxKey);
+   }
 
    // Put in the sorted blocks, and also compute column offsets and lengths:
    columnBlockOffsets.push_back(0); //first offset
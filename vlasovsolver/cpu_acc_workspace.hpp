@@ -0,0 +1,129 @@
+/*
+ * This file is part of Vlasiator.
+ * Copyright 2010-2016 Finnish Meteorological Institute
+ *
+ * For details of usage, see the COPYING file and read the "Rules of the Road"
+ * at http://www.physics.helsinki.fi/vlasiator/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CPU_ACC_WORKSPACE_H
+#define CPU_ACC_WORKSPACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "../common.h"
+#include "../memoryallocation.h"
+#include "../definitions.h"
+#include "../spatial_cell.hpp"
+#include "vec.h"
+
+/** Per-thread scratch buffers of the semi-Lagrangian acceleration (map_1d and
+ * sortBlocklistByDimension). Buffers only grow, so once they have reached the
+ * size needed by the largest velocity mesh handled by the thread the scratch 
+ * space does not allocate heap memory. Each growth of a buffer is counted, see
+ * AccelerationWorkspace::getAllocations. If block columns are cached in the 
+ * spatial cells (vlasovsolver.cache_acceleration_columns), the growth of the 
+ * columns of each cell is counted as well, so the count does not drop to zero 
+ * while the velocity meshes grow. Blocks created by the mapping are stored in 
+ * the spatial cell and are not counted.*/
+struct AccelerationWorkspace {
+   spatial_cell::VelocityBlockColumns columns;                               /**< Block columns, used if they are not cached in the cell.*/
+   std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > blockPairs;      /**< Sort keys and block GIDs.*/
+   std::vector<std::pair<vmesh::GlobalID,vmesh::GlobalID> > blockPairsScratch; /**< Second buffer of the radix sort.*/
+   std::vector<int> columnMinBlockK;                                         /**< First target block index of each column.*/
+   std::vector<int> columnMaxBlockK;                                         /**< Last target block index of each column.*/
+   std::vector<vmesh::GlobalID> blocksWithContent;                           /**< Target blocks with content.*/
+   std::vector<Vec,aligned_allocator<Vec,64> > values;                       /**< Column data of one column set.*/
+
+   /** Prepare the buffers for mapping a velocity mesh with the given number of blocks.
+    * Column and set counts are bounded by the number of blocks, so none of the buffers
+    * reallocates while the mesh is sorted into columns.
+    * @param nBlocks Number of blocks in the velocity mesh.
+    * @param nValues Number of Vec elements needed for the column data of one set.*/
+   void prepare(const size_t& nBlocks,const size_t& nValues) {
+      reserve(blockPairs,nBlocks);
+      reserve(blockPairsScratch,nBlocks);
+      reserve(columnMinBlockK,nBlocks+1);
+      reserve(columnMaxBlockK,nBlocks+1);
+      columnMinBlockK.clear();
+      columnMaxBlockK.clear();
+      blocksWithContent.clear();
+      if (values.size() < nValues) {
+         values.resize(nValues);
+         countAllocation();
+      }
+   }
+
+   /** Prepare block columns for sorting a velocity mesh with the given number of blocks.
+    * The columns may be the ones of the workspace or the ones cached in a spatial cell.
+    * @param columns Block columns, they are emptied.
+    * @param nBlocks Number of blocks in the velocity mesh.*/
+   static void prepareColumns(spatial_cell::VelocityBlockColumns& columns,const size_t& nBlocks) {
+      reserve(columns.blocks,nBlocks);
+      reserve(columns.columnBlockOffsets,nBlocks+1);
+      reserve(columns.columnNumBlocks,nBlocks+1);
+      reserve(columns.setColumnOffsets,nBlocks+1);
+      reserve(columns.setNumColumns,nBlocks+1);
+      columns.blocks.resize(nBlocks);
+      columns.columnBlockOffsets.clear();
+      columns.columnNumBlocks.clear();
+      columns.setColumnOffsets.clear();
+      columns.setNumColumns.clear();
+   }
+
+   /** Make sure that the given vector can take extra elements without reallocating.
+    * The capacity at least doubles when it grows so that growth stops quickly.
+    * @param v Vector.
+    * @param n Number of elements that must fit in the vector.*/
+   template<typename T,typename A> static void reserve(std::vector<T,A>& v,const size_t& n) {
+      if (n <= v.capacity()) return;
+      v.reserve(std::max(n,2*v.capacity()));
+      countAllocation();
+   }
+
+   /** Get the number of times any thread's workspace has grown since the counter was reset.*/
+   static uint64_t getAllocations() {
+      return allocationCounter().load();
+   }
+
+   /** Get the number of times any thread's workspace has grown and reset the counter to zero.*/
+   static uint64_t resetAllocations() {
+      return allocationCounter().exchange(0);
+   }
+
+ private:
+   static std::atomic<uint64_t>& allocationCounter() {
+      static std::atomic<uint64_t> counter(0);
+      return counter;
+   }
+
+   static void countAllocation() {
+      ++allocationCounter();
+   }
+};
+
+/** Get the acceleration workspace of the calling thread.*/
+inline AccelerationWorkspace& getAccelerationWorkspace() {
+   static thread_local AccelerationWorkspace workspace;
+   return workspace;
+}
+
+#endif
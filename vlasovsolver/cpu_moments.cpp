@@ -67,7 +67,8 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
           if (blockContainer.size() == 0) continue;
           
           const Realf* data       = blockContainer.getData();
-          const Real* blockParams = blockContainer.getParameters();
+          const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+          Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
           
           // Temporary array for storing moments
           Real array[4];
@@ -76,8 +77,9 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
           // Calculate species' contribution to first velocity moments
           const Real massRatio = getObjectWrapper().particleSpecies[popID].mass / physicalconstants::MASS_PROTON;
           for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+             const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
              blockVelocityFirstMoments(data+blockLID*WID3,
-                                       blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                       blockParams,
                                        massRatio,array);
           }
           
@@ -98,7 +100,8 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
        if (blockContainer.size() == 0) continue;
        
        const Realf* data       = blockContainer.getData();
-       const Real* blockParams = blockContainer.getParameters();
+       const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+       Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
        
        // Temporary array for storing moments
        Real array[3];
@@ -106,8 +109,9 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
 
        // Calculate species' contribution to second velocity moments
        for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+          const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
           blockVelocitySecondMoments(data+blockLID*WID3,
-                                     blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                     blockParams,
                                      cell->parameters,
                                      CellParams::RHO,
                                      CellParams::RHOVX,
@@ -129,6 +133,8 @@ void calculateCellMoments(spatial_cell::SpatialCell* cell,
  * spatial time step so that CFL(spatial)=1. The calculated moments include 
  * contributions from all existing particle populations. The calculated moments 
  * are stored to SpatialCell::parameters in _R variables. This function is AMR safe.
+ * If a species has valid fused moments, they are used instead of a pass over 
+ * its velocity blocks. Computing the second moments consumes the fused moments.
  * @param mpiGrid Parallel grid library.
  * @param cells Vector containing the spatial cells to be calculated.
  * @param computeSecond If true, second velocity moments are calculated.*/
@@ -168,16 +174,16 @@ void calculateMoments_R_maxdt(
           vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
           if (blockContainer.size() == 0) continue;
           const Realf* data       = blockContainer.getData();
-          const Real* blockParams = blockContainer.getParameters();
+          const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+          Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
           #ifdef DEBUG_MOMENTS
           bool ok = true;
           if (data == NULL && blockContainer.size() > 0) ok = false;
-          if (blockParams == NULL && blockContainer.size() > 0) ok = false;
           if (ok == false) {
              stringstream ss;
              ss << "ERROR in moment calculation in " << __FILE__ << ":" << __LINE__ << endl;
-             ss << "\t &data = " << data << "\t &blockParams = " << blockParams << endl;
+             ss << "\t &data = " << data << endl;
              ss << "\t size = " << blockContainer.size() << endl;
              cerr << ss.str();
              exit(1);
@@ -188,24 +194,29 @@ void calculateMoments_R_maxdt(
           Real array[4];
           for (int i=0; i<4; ++i) array[i] = 0.0;
 
+          // Moments accumulated during translation are used if available
+          const bool fused = cell->has_fused_moments(popID);
+          const Real massRatio = getObjectWrapper().particleSpecies[popID].mass / physicalconstants::MASS_PROTON;
+
           // Calculate species' contribution to first velocity moments
           for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+             const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
              // compute maximum dt. Algorithm has a CFL condition, since it
              // is written only for the case where we have a stencil
              // supporting max translation of one cell
              const Real EPS = numeric_limits<Real>::min()*1000;
              for (unsigned int i=0; i<WID;i+=WID-1) {
                 const Real Vx 
-                  = blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::VXCRD] 
-                  + (i+HALF)*blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVX]
+                  = blockParams[BlockParams::VXCRD] 
+                  + (i+HALF)*blockParams[BlockParams::DVX]
                   + EPS;
                 const Real Vy 
-                  = blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::VYCRD] 
-                  + (i+HALF)*blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVY]
+                  = blockParams[BlockParams::VYCRD] 
+                  + (i+HALF)*blockParams[BlockParams::DVY]
                   + EPS;
                     const Real Vz 
-                  = blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::VZCRD]
-                  + (i+HALF)*blockParams[blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS+BlockParams::DVZ]
+                  = blockParams[BlockParams::VZCRD]
+                  + (i+HALF)*blockParams[BlockParams::DVZ]
                   + EPS;
 
                 const Real dt_max_cell = min(dx/fabs(Vx),min(dy/fabs(Vy),dz/fabs(Vz)));
@@ -213,11 +224,12 @@ void calculateMoments_R_maxdt(
                 cell->set_max_r_dt(popID,min(dt_max_cell,cell->get_max_r_dt(popID)));
              }
 
-             const Real massRatio = getObjectWrapper().particleSpecies[popID].mass / physicalconstants::MASS_PROTON;
+             if (fused == true) continue;
              blockVelocityFirstMoments(data+blockLID*WID3,
-                                       blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                       blockParams,
                                        massRatio,array);
           } // for-loop over velocity blocks
+          if (fused == true) fusedVelocityFirstMoments(cell->get_fused_moments(popID),massRatio,array);
 
           // Store species' contribution to bulk velocity moments
           cell->parameters[CellParams::RHO_R  ] += array[0];
@@ -238,20 +250,34 @@ void calculateMoments_R_maxdt(
       for (size_t c=0; c<cells.size(); ++c) {
          const CellID cellID = cells[c];
          SpatialCell* cell = mpiGrid[cells[c]];
+
+         // Fused moments are consumed here, they are not valid after this pass
+         const bool fused = cell->has_fused_moments(popID);
+         cell->set_fused_moments_valid(popID,false);
        
          vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
          if (blockContainer.size() == 0) continue;
          const Realf* data       = blockContainer.getData();
-         const Real* blockParams = blockContainer.getParameters();
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
          // Temporary array where species' contribution to 2nd moments is accumulated
          Real array[3];
          for (int i=0; i<3; ++i) array[i] = 0.0;
 
          // Calculate species' contribution to second velocity moments
-         for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+         if (fused == true) {
+            fusedVelocitySecondMoments(cell->get_fused_moments(popID),
+                                       cell->parameters,
+                                       CellParams::RHO_R,
+                                       CellParams::RHOVX_R,
+                                       CellParams::RHOVY_R,
+                                       CellParams::RHOVZ_R,
+                                       array);
+         } else for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+            const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
             blockVelocitySecondMoments(data+blockLID*WID3,
-                                       blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                       blockParams,
                                        cell->parameters,
                                        CellParams::RHO_R,
                                        CellParams::RHOVX_R,
@@ -276,6 +302,8 @@ void calculateMoments_R_maxdt(
  * spatial time step so that CFL(spatial)=1. The calculated moments include 
  * contributions from all existing particle populations. The calculated moments 
  * are stored to SpatialCell::parameters in _V variables. This function is AMR safe.
+ * If a species has valid fused moments, they are used instead of a pass over 
+ * its velocity blocks. Computing the second moments consumes the fused moments.
  * @param mpiGrid Parallel grid library.
  * @param cells Vector containing the spatial cells to be calculated.
  * @param computeSecond If true, second velocity moments are calculated.*/
@@ -307,7 +335,8 @@ void calculateMoments_V(
          vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
          if (blockContainer.size() == 0) continue;
          const Realf* data       = blockContainer.getData();
-         const Real* blockParams = blockContainer.getParameters();
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
          // Temporary array for storing moments
          Real array[4];
@@ -315,10 +344,14 @@ void calculateMoments_V(
 
          const Real massRatio = getObjectWrapper().particleSpecies[popID].mass / physicalconstants::MASS_PROTON;
 
-         // Calculate species' contribution to first velocity moments
-         for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+         // Calculate species' contribution to first velocity moments, 
+         // moments accumulated during acceleration are used if available
+         if (cell->has_fused_moments(popID)) {
+            fusedVelocityFirstMoments(cell->get_fused_moments(popID),massRatio,array);
+         } else for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+            const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
             blockVelocityFirstMoments(data+blockLID*WID3,
-                                      blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                      blockParams,
                                       massRatio,array);
          }
          
@@ -342,20 +375,34 @@ void calculateMoments_V(
          const CellID cellID = cells[c];
          SpatialCell* cell = mpiGrid[cells[c]];
 
+         // Fused moments are consumed here, they are not valid after this pass
+         const bool fused = cell->has_fused_moments(popID);
+         cell->set_fused_moments_valid(popID,false);
+
          vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = cell->get_velocity_blocks(popID);
          if (blockContainer.size() == 0) continue;
          const Realf* data       = blockContainer.getData();
-         const Real* blockParams = blockContainer.getParameters();
+         const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = cell->get_velocity_mesh(popID);
+         Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
 
          // Temporary array where moments are stored
          Real array[3];
          for (int i=0; i<3; ++i) array[i] = 0.0;
 
          // Calculate species' contribution to second velocity moments
-         for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+         if (fused == true) {
+            fusedVelocitySecondMoments(cell->get_fused_moments(popID),
+                                       cell->parameters,
+                                       CellParams::RHO_V,
+                                       CellParams::RHOVX_V,
+                                       CellParams::RHOVY_V,
+                                       CellParams::RHOVZ_V,
+                                       array);
+         } else for (vmesh::LocalID blockLID=0; blockLID<blockContainer.size(); ++blockLID) {
+            const Real* blockParams = spatial_cell::getBlockParameters(vmesh,blockContainer,blockLID,paramsScratch);
             blockVelocitySecondMoments(
                                        data+blockLID*WID3,
-                                       blockParams+blockLID*BlockParams::N_VELOCITY_BLOCK_PARAMS,
+                                       blockParams,
                                        cell->parameters,
                                        CellParams::RHO_V,
                                        CellParams::RHOVX_V,
@@ -45,6 +45,17 @@ void blockVelocitySecondMoments(const Realf* avgs,const Real* blockParams,const
                                 const int cp_rho,const int cp_rhovx,const int cp_rhovy,const int cp_rhovz,
                                 REAL* array);
 
+template<typename REAL> 
+void blockVelocityFusedMoments(const REAL marginals[3][WID],const Real* blockParams,Real* fusedMoments);
+
+template<typename REAL> 
+void fusedVelocityFirstMoments(const Real* fusedMoments,const Real& massRatio,REAL* array);
+
+template<typename REAL> 
+void fusedVelocitySecondMoments(const Real* fusedMoments,const Real* cellParams,
+                                const int cp_rho,const int cp_rhovx,const int cp_rhovy,const int cp_rhovz,
+                                REAL* array);
+
 void calculateMoments_R_maxdt(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                               const std::vector<CellID>& cells,
                               const bool& computeSecond);
@@ -146,4 +157,109 @@ void blockVelocitySecondMoments(
    array[2] += nvz2_sum * DV3;
 }
 
+/** Set the sums in 'fusedMoments' to zero and copy the reference velocity 
+ * from 'target'. Partial fused moments initialized this way are taken about 
+ * the same velocity as the target, so they can be added to it elementwise.
+ * @param fusedMoments Array of fused moments to initialize.
+ * @param target Fused moments to which the partial moments are added later. 
+ * If NULL, the reference velocity is set to zero.*/
+inline void initFusedMoments(Real* fusedMoments,const Real* target) {
+   for (int m=0; m<FusedMoments::N_FUSED_SUMS; ++m) fusedMoments[m] = 0.0;
+   for (int d=0; d<3; ++d) {
+      fusedMoments[FusedMoments::UX+d] = (target == NULL) ? 0.0 : target[FusedMoments::UX+d];
+   }
+}
+
+/** Add the velocity moments of a velocity block to 'fusedMoments', 
+ * which is indexed by FusedMoments. The moments are taken about the 
+ * reference velocity stored in 'fusedMoments'. The velocity block is given by its 
+ * marginal sums, marginals[d][i] is the sum of the distribution function 
+ * over the cells whose index in velocity direction d is i. The marginal 
+ * sums can be accumulated while the block is written by the Vlasov solvers.
+ * @param marginals Marginal sums of the distribution function in vx,vy,vz.
+ * @param blockParams Parameters for the given velocity block.
+ * @param fusedMoments Array where the calculated moments are added.*/
+template<typename REAL> inline
+void blockVelocityFusedMoments(
+        const REAL marginals[3][WID],
+        const Real* blockParams,
+        Real* fusedMoments) {
+
+   const Real HALF = 0.5;
+
+   Real n_sum = 0.0;
+   Real nv_sum[3] = {0.0,0.0,0.0};
+   Real nv2_sum[3] = {0.0,0.0,0.0};
+   for (int d=0; d<3; ++d) {
+      for (uint i=0; i<WID; ++i) {
+         const Real V = blockParams[BlockParams::VXCRD+d] + (i+HALF)*blockParams[BlockParams::DVX+d]
+                      - fusedMoments[FusedMoments::UX+d];
+         nv_sum[d]  += marginals[d][i]*V;
+         nv2_sum[d] += marginals[d][i]*V*V;
+      }
+   }
+   for (uint i=0; i<WID; ++i) n_sum += marginals[0][i];
+
+   const Real DV3 = blockParams[BlockParams::DVX]*blockParams[BlockParams::DVY]*blockParams[BlockParams::DVZ];
+   fusedMoments[FusedMoments::M0 ] += n_sum      * DV3;
+   fusedMoments[FusedMoments::M1X] += nv_sum[0]  * DV3;
+   fusedMoments[FusedMoments::M1Y] += nv_sum[1]  * DV3;
+   fusedMoments[FusedMoments::M1Z] += nv_sum[2]  * DV3;
+   fusedMoments[FusedMoments::M2X] += nv2_sum[0] * DV3;
+   fusedMoments[FusedMoments::M2Y] += nv2_sum[1] * DV3;
+   fusedMoments[FusedMoments::M2Z] += nv2_sum[2] * DV3;
+}
+
+/** Calculate the zeroth and first velocity moments of a species from its 
+ * fused moments and add results to 'array'. The contents of 'array' are 
+ * the same as in blockVelocityFirstMoments.
+ * @param fusedMoments Velocity moments of the species, indexed by FusedMoments.
+ * @param massRatio Population mass / proton mass.
+ * @param array Array of at least size four where the calculated moments are added.*/
+template<typename REAL> inline
+void fusedVelocityFirstMoments(
+        const Real* fusedMoments,
+        const Real& massRatio,
+        REAL* array) {
+   const Real M0 = fusedMoments[FusedMoments::M0];
+   array[0] += massRatio * M0;
+   array[1] += massRatio * (fusedMoments[FusedMoments::M1X] + fusedMoments[FusedMoments::UX]*M0);
+   array[2] += massRatio * (fusedMoments[FusedMoments::M1Y] + fusedMoments[FusedMoments::UY]*M0);
+   array[3] += massRatio * (fusedMoments[FusedMoments::M1Z] + fusedMoments[FusedMoments::UZ]*M0);
+}
+
+/** Calculate the second velocity moments of a species from its fused 
+ * moments and add results to 'array'. The contents of 'array' are the 
+ * same as in blockVelocitySecondMoments. The fused moments are taken about 
+ * the reference velocity u, the central moments about the bulk velocity V0 
+ * are obtained as n(V-V0)^2 = n(V-u)^2 - 2 (V0-u) n(V-u) + n (V0-u)^2. 
+ * All terms are small when u is close to V0, i.e., the shift does not 
+ * suffer from cancellation like a shift of raw moments about zero would.
+ * @param fusedMoments Velocity moments of the species, indexed by FusedMoments.
+ * @param cellParams Parameters for the spatial cell.
+ * @param rho Index into cellParams, used to read bulk number density.
+ * @param rhovx Index into cellParams, used to read bulk Vx times number density.
+ * @param rhovy Index into cellParams, used to read bulk Vy times number density.
+ * @param rhovz Index into cellParams, used to read bulk Vz times number density.
+ * @param array Array where the calculated moments are added.*/
+template<typename REAL> inline
+void fusedVelocitySecondMoments(
+        const Real* fusedMoments,
+        const Real* cellParams,
+        const int cp_rho,
+        const int cp_rhovx,
+        const int cp_rhovy,
+        const int cp_rhovz,
+        REAL* array) {
+
+   const Real RHO = std::max(cellParams[cp_rho], std::numeric_limits<REAL>::min());
+   const Real averageV[3] = {cellParams[cp_rhovx] / RHO, cellParams[cp_rhovy] / RHO, cellParams[cp_rhovz] / RHO};
+   for (int d=0; d<3; ++d) {
+      const Real shift = averageV[d] - fusedMoments[FusedMoments::UX+d];
+      array[d] += fusedMoments[FusedMoments::M2X+d]
+                - 2*shift*fusedMoments[FusedMoments::M1X+d]
+                + shift*shift*fusedMoments[FusedMoments::M0];
+   }
+}
+
 #endif
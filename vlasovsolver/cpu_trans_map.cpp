@@ -34,6 +34,7 @@
 #include "cpu_1d_plm.hpp"
 #include "cpu_1d_ppm.hpp"
 #include "cpu_1d_pqm.hpp"
+#include "cpu_moments.h"
 #include "cpu_trans_map.hpp"
 
 using namespace std;
@@ -44,7 +45,7 @@ void compute_spatial_source_neighbors(const dccrg::Dccrg<SpatialCell,dccrg::Cart
 void compute_spatial_target_neighbors(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                                       const CellID& cellID,const uint dimension,SpatialCell **neighbors);
 void copy_trans_block_data(SpatialCell** source_neighbors,const vmesh::GlobalID blockGID,
-                           Vec* values,const unsigned char* const cellid_transpose,const int& popID);
+                           Vec* values,const uint16_t* const cellid_transpose,const int& popID);
 CellID get_spatial_neighbor(const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
                             const CellID& cellID,const bool include_first_boundary_layer,
                             const int spatial_di,const int spatial_dj,const int spatial_dk);
@@ -53,7 +54,8 @@ SpatialCell* get_spatial_neighbor_pointer(const dccrg::Dccrg<SpatialCell,dccrg::
                                           const int spatial_di,const int spatial_dj,const int spatial_dk);
 void store_trans_block_data(SpatialCell** target_neighbors,const vmesh::GlobalID blockGID,
                             Vec* __restrict__ target_values,
-                            const unsigned char* const cellid_transpose,const int& popID);
+                            const uint16_t* const cellid_transpose,const int& popID,
+                            Real (*fusedMoments)[FusedMoments::N_FUSED_MOMENTS]);
 
 // indices in padded source block, which is of type Vec with VECL
 // element sin each vector. b_k is the block index in z direction in
@@ -109,6 +111,7 @@ void createTargetGrid(
       blockContainer.clear();
       blockContainer.setSize(vmesh.size());
 
+      #ifndef VBC_NO_BLOCK_PARAMETERS
       for (size_t b=0; b<vmesh.size(); ++b) {
          vmesh::GlobalID blockGID = vmesh.getGlobalID(b);
          Real* blockParams = blockContainer.getParameters(b);
@@ -117,6 +120,7 @@ void createTargetGrid(
          blockParams[BlockParams::VZCRD] = spatial_cell->get_velocity_block_vz_min(popID,blockGID);
          vmesh.getCellSize(blockGID,&(blockParams[BlockParams::DVX]));
       }
+      #endif
       
       if (Parameters::prepareForRebalance == true) 
          spatial_cell->get_cell_parameters()[CellParams::LBWEIGHTCOUNTER] += (MPI_Wtime()-t_start);
@@ -361,7 +365,7 @@ inline void copy_trans_block_data(
         SpatialCell** source_neighbors,
         const vmesh::GlobalID blockGID,
         Vec* values,
-        const unsigned char* const cellid_transpose,
+        const uint16_t* const cellid_transpose,
         const int& popID) { 
 
    /*load pointers to blocks and prefetch them to L1*/
@@ -439,17 +443,22 @@ inline void copy_trans_block_data(
  * @param target_neighbors
  * @param blockGID Global ID of the target velocity block.
  * @param cellid_transpose
- * @param popID ID of the propagated particle species.*/
+ * @param popID ID of the propagated particle species.
+ * @param fusedMoments If not NULL, moments of the stored values are added 
+ * to fusedMoments[0..2], one array for each target cell.*/
 inline void store_trans_block_data(
    SpatialCell** target_neighbors,
    const vmesh::GlobalID blockGID,
    Vec* __restrict__ target_values,
-   const unsigned char* const cellid_transpose,
-   const int& popID) {
+   const uint16_t* const cellid_transpose,
+   const int& popID,
+   Real (*fusedMoments)[FusedMoments::N_FUSED_MOMENTS]) {
 
 
    /*load pointers to blocks and prefetch them to L1*/
    Realf* blockDatas[3];
+   const Real* blockParams[3];
+   Real paramsScratch[3][BlockParams::N_VELOCITY_BLOCK_PARAMS];
    for (int b=-1; b<=1; ++b) {
       blockDatas[b + 1] = NULL;
 
@@ -469,6 +478,7 @@ inline void store_trans_block_data(
       // get block container for target cells
       vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = spatial_cell->get_velocity_blocks_temporary();
       blockDatas[b + 1] = blockContainer.getData(blockLID);
+      blockParams[b + 1] = spatial_cell::getBlockParameters(spatial_cell->get_velocity_mesh(popID),blockContainer,blockLID,paramsScratch[b + 1]);
       //prefetch storage pointers to L1
       _mm_prefetch((char *)(blockDatas[b + 1]), _MM_HINT_T0);
       _mm_prefetch((char *)(blockDatas[b + 1]) + 64, _MM_HINT_T0);
@@ -488,6 +498,8 @@ inline void store_trans_block_data(
       if( blockDatas[b + 1] != NULL) {
          Realf* block_data = blockDatas[b + 1];
          Realv blockValues[VECL];
+         // marginal sums of stored values in vx,vy,vz in double precision, only used for fused moments
+         Real marginals[3][WID] = {};
          uint cellid=0;
          for (uint k=0; k<WID; ++k) {
             for(uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++){
@@ -495,10 +507,20 @@ inline void store_trans_block_data(
                for(uint i = 0; i< VECL; i++){
                   // store data, when reading data from data we swap dimensions 
                   // using precomputed plane_index_to_id and cell_indices_to_id
-                  block_data[cellid_transpose[cellid++]] += blockValues[i];
+                  const uint cell = cellid_transpose[cellid++];
+                  block_data[cell] += blockValues[i];
+                  if (fusedMoments != NULL) {
+                     marginals[0][cell % WID]         += blockValues[i];
+                     marginals[1][(cell / WID) % WID] += blockValues[i];
+                     marginals[2][cell / WID2]        += blockValues[i];
+                  }
                }
             }
          }
+         
+         if (fusedMoments != NULL) {
+            blockVelocityFusedMoments(marginals,blockParams[b + 1],fusedMoments[b + 1]);
+         }
       }
    }
 }
@@ -511,14 +533,18 @@ inline void store_trans_block_data(
 
    This function can, and should be, safely called in a parallel
 OpenMP region (as long as it does only one dimension per parallel
-refion). It is safe as each thread only computes certain blocks (blockID%tnum_threads = thread_num */
+refion). It is safe as each thread only computes certain blocks (blockID%tnum_threads = thread_num 
+
+   If accumulateMoments is true, raw velocity moments of the mapped values are 
+   added to the fused moments of the target cells. */
 
 bool trans_map_1d(
         const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
         const CellID cellID,
         const uint dimension,
         const Realv dt,
-        const int& popID) {
+        const int& popID,
+        const bool accumulateMoments) {
     
     // values used with an stencil in 1 dimension, initialized to 0. 
     // Contains a block, and its spatial neighbours in one dimension.
@@ -526,7 +552,7 @@ bool trans_map_1d(
     SpatialCell* spatial_cell = mpiGrid[cellID];
     uint block_indices_to_id[3]; /*< used when computing id of target block */
     uint cell_indices_to_id[3]; /*< used when computing id of target cell in block*/
-    unsigned char  cellid_transpose[WID3]; /*< defines the transpose for the solver internal (transposed) id: i + j*WID + k*WID2 to actual one*/
+    uint16_t cellid_transpose[WID3]; /*< defines the transpose for the solver internal (transposed) id: i + j*WID + k*WID2 to actual one*/
     uint thread_id = 0;  //thread id. Default value for serial case
     uint num_threads = 1; //Number of threads. Default value for serial case
     #ifdef _OPENMP
@@ -622,6 +648,12 @@ bool trans_map_1d(
 
     const Realv i_dz=1.0/dz;
 
+    // Moments of the values this thread stores to the three target cells
+    Real fusedMoments[3][FusedMoments::N_FUSED_MOMENTS];
+    for (int b=0; b<3; ++b) {
+       initFusedMoments(fusedMoments[b],target_neighbors[b] == NULL ? NULL : target_neighbors[b]->get_fused_moments(popID));
+    }
+
     // Loop over blocks in spatial cell. In ordinary space the number of
     // blocks in this spatial cell does not change.
     #pragma omp for
@@ -705,12 +737,416 @@ bool trans_map_1d(
         }
       
         //store values from target_values array to the actual blocks
-        store_trans_block_data(target_neighbors,blockGID,target_values,cellid_transpose,popID);
+        store_trans_block_data(target_neighbors,blockGID,target_values,cellid_transpose,popID,
+                               accumulateMoments ? fusedMoments : NULL);
+    }
+
+    // Add this thread's contribution to fused moments of target cells
+    if (accumulateMoments == true) {
+       for (int b=0; b<3; ++b) {
+          if (target_neighbors[b] == NULL) continue;
+          Real* targetMoments = target_neighbors[b]->get_fused_moments(popID);
+          for (int m=0; m<FusedMoments::N_FUSED_SUMS; ++m) {
+             #pragma omp atomic
+             targetMoments[m] += fusedMoments[b][m];
+          }
+       }
     }
 
     return true;
 }
 
+/** Group the given translated cells into pencils, i.e., into lines of 
+ * consecutive local cells along the given spatial dimension. Cells that 
+ * are not in the list (remote cells, boundary cells that are not propagated) 
+ * break the line, so each pencil only contains cells that are translated by 
+ * this process.
+ * @param mpiGrid Parallel grid.
+ * @param cells List of local translated cells.
+ * @param dimension Spatial dimension of the pencils, 0,1,2 for x,y,z.
+ * @param pencils Pencil structure where the result is written.*/
+void compute_translation_pencils(
+        const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const vector<CellID>& cells,
+        const uint dimension,
+        TranslationPencils& pencils) {
+
+   pencils.cells.clear();
+   pencils.offsets.clear();
+   pencils.offsets.push_back(0);
+   if (cells.size() == 0) return;
+
+   // Sort cells so that cells on the same line are consecutive 
+   // and ordered by their index in the pencil dimension
+   const uint dim1 = (dimension+1) % 3;
+   const uint dim2 = (dimension+2) % 3;
+   vector<pair<dccrg::Types<3>::indices_t,CellID> > sortedCells(cells.size());
+   for (size_t c=0; c<cells.size(); ++c) {
+      const dccrg::Types<3>::indices_t indices = mpiGrid.mapping.get_indices(cells[c]);
+      sortedCells[c].first[0] = indices[dim1];
+      sortedCells[c].first[1] = indices[dim2];
+      sortedCells[c].first[2] = indices[dimension];
+      sortedCells[c].second = cells[c];
+   }
+   sort(sortedCells.begin(),sortedCells.end());
+
+   // Split lines into pencils at gaps
+   pencils.cells.push_back(sortedCells[0].second);
+   for (size_t c=1; c<sortedCells.size(); ++c) {
+      const dccrg::Types<3>::indices_t& prev = sortedCells[c-1].first;
+      const dccrg::Types<3>::indices_t& curr = sortedCells[c].first;
+      if (curr[0] != prev[0] || curr[1] != prev[1] || curr[2] != prev[2]+1) {
+         pencils.offsets.push_back(pencils.cells.size());
+      }
+      pencils.cells.push_back(sortedCells[c].second);
+   }
+   pencils.offsets.push_back(pencils.cells.size());
+}
+
+/** Compute the transpose table that converts the solver internal (transposed) 
+ * cell index i + j*WID + k*WID2 into the actual cell index in a velocity block, 
+ * so that the mapping is along k in the solver.
+ * @param dimension Spatial dimension of the translation.
+ * @param cellid_transpose Array of size WID3 where the transpose is written.*/
+static void compute_cellid_transpose(const uint dimension,uint16_t* cellid_transpose) {
+   uint cell_indices_to_id[3];
+   switch (dimension) {
+    case 0:
+      cell_indices_to_id[0]=WID2;
+      cell_indices_to_id[1]=WID;
+      cell_indices_to_id[2]=1;
+      break;
+    case 1:
+      cell_indices_to_id[0]=1;
+      cell_indices_to_id[1]=WID2;
+      cell_indices_to_id[2]=WID;
+      break;
+    case 2:
+      cell_indices_to_id[0]=1;
+      cell_indices_to_id[1]=WID;
+      cell_indices_to_id[2]=WID2;
+      break;
+    default:
+      cerr << __FILE__ << ":"<< __LINE__ << " Wrong dimension, abort"<<endl;
+      abort();
+      break;
+   }
+
+   for (uint k=0; k<WID; ++k) {
+      for (uint j=0; j<WID; ++j) {
+         for (uint i=0; i<WID; ++i) {
+            cellid_transpose[i + j * WID + k * WID2] =
+               i * cell_indices_to_id[0] +
+               j * cell_indices_to_id[1] +
+               k * cell_indices_to_id[2];
+         }
+      }
+   }
+}
+
+/** Per-thread scratch buffers of trans_map_1d_pencil. Buffers only grow, so 
+ * mapping a pencil does not allocate heap memory once they have reached the 
+ * size needed by the longest pencil and the largest velocity mesh.*/
+struct PencilWorkspace {
+   std::vector<SpatialCell*> sourceCells;                        /**< Source line, pencil plus VLASOV_STENCIL_WIDTH cells on both sides.*/
+   std::vector<SpatialCell*> targetCells;                        /**< Target line, pencil plus one cell on both sides.*/
+   std::vector<vmesh::GlobalID> blockGIDs;                       /**< Blocks of the pencil mapped by this thread.*/
+   std::vector<const Realf*> sourceDatas;                        /**< Data of the mapped block in the source line.*/
+   std::vector<char> targetTouched;                              /**< Target cells that receive data of the mapped block.*/
+   std::vector<Vec,aligned_allocator<Vec,64> > values;           /**< Source line data of the mapped block.*/
+   std::vector<Vec,aligned_allocator<Vec,64> > targetValues;     /**< Target line data of the mapped block.*/
+   std::vector<Real> fusedMoments;                               /**< This thread's contribution to fused moments of the target line.*/
+};
+
+/** Get the pencil mapping workspace of the calling thread.*/
+static PencilWorkspace& getPencilWorkspace() {
+   static thread_local PencilWorkspace workspace;
+   return workspace;
+}
+
+/* Pencil version of trans_map_1d. Maps all cells in a pencil, i.e., a 
+   line of consecutive local cells along the translated dimension, at once. 
+   Each velocity block that exists in any pencil cell is mapped once: the 
+   data of the whole source line (pencil plus VLASOV_STENCIL_WIDTH cells on 
+   both sides) is gathered into a contiguous buffer, the reconstruction is 
+   computed for all pencil cells that have the block, and the results are 
+   written back once to the target line (pencil plus one cell on both sides). 
+   Compared to trans_map_1d this avoids loading each block 
+   2*VLASOV_STENCIL_WIDTH+1 times and storing it three times.
+
+   This function must be called by all threads in an OpenMP parallel 
+   region. Blocks are divided between threads by their global ID, so a block 
+   is always mapped by the same thread. Pencils that share a target cell 
+   thus never write the same target block from two threads, and threads do 
+   not need to synchronize between pencils.
+
+   @param mpiGrid Parallel grid.
+   @param pencilCells Cells in the pencil, ordered along dimension.
+   @param pencilLength Number of cells in the pencil.
+   @param dimension Translated dimension, 0,1,2 for x,y,z.
+   @param dt Time step.
+   @param popID ID of the translated particle species.
+   @param accumulateMoments If true, raw velocity moments of the mapped values 
+   are added to the fused moments of the target cells.*/
+bool trans_map_1d_pencil(
+        const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const CellID* pencilCells,
+        const uint pencilLength,
+        const uint dimension,
+        const Realv dt,
+        const int& popID,
+        const bool accumulateMoments) {
+
+   if (pencilLength == 0) return true;
+
+   #ifdef _OPENMP
+      const vmesh::GlobalID nThreads = omp_get_num_threads();
+      const vmesh::GlobalID thread = omp_get_thread_num();
+   #else
+      const vmesh::GlobalID nThreads = 1;
+      const vmesh::GlobalID thread = 0;
+   #endif
+
+   // Source line has pencilLength + 2*VLASOV_STENCIL_WIDTH cells, source cells 
+   // outside the pencil are taken from the stencils of the first and last 
+   // cell (invalid cells have been replaced by the closest good cell).
+   // Target line has pencilLength + 2 cells, invalid targets are NULL.
+   PencilWorkspace& workspace = getPencilWorkspace();
+   const int sourceLength = pencilLength + 2*VLASOV_STENCIL_WIDTH;
+   const int targetLength = pencilLength + 2;
+   vector<SpatialCell*>& sourceCells = workspace.sourceCells;
+   vector<SpatialCell*>& targetCells = workspace.targetCells;
+   sourceCells.resize(sourceLength);
+   targetCells.resize(targetLength);
+   {
+      SpatialCell* neighbors[1 + 2 * VLASOV_STENCIL_WIDTH];
+      compute_spatial_source_neighbors(mpiGrid,pencilCells[0],dimension,neighbors);
+      for (int b=0; b<VLASOV_STENCIL_WIDTH; ++b) sourceCells[b] = neighbors[b];
+      compute_spatial_source_neighbors(mpiGrid,pencilCells[pencilLength-1],dimension,neighbors);
+      for (int b=0; b<VLASOV_STENCIL_WIDTH; ++b) {
+         sourceCells[VLASOV_STENCIL_WIDTH + pencilLength + b] = neighbors[VLASOV_STENCIL_WIDTH + 1 + b];
+      }
+      
+      compute_spatial_target_neighbors(mpiGrid,pencilCells[0],dimension,neighbors);
+      targetCells[0] = neighbors[0];
+      compute_spatial_target_neighbors(mpiGrid,pencilCells[pencilLength-1],dimension,neighbors);
+      targetCells[targetLength-1] = neighbors[2];
+   }
+   for (uint c=0; c<pencilLength; ++c) {
+      SpatialCell* SC = mpiGrid[pencilCells[c]];
+      sourceCells[VLASOV_STENCIL_WIDTH + c] = SC;
+      if (SC->sysBoundaryFlag == sysboundarytype::NOT_SYSBOUNDARY) targetCells[1 + c] = SC;
+      else targetCells[1 + c] = NULL;
+   }
+
+   // Blocks of the pencil that this thread maps, each block once
+   vector<vmesh::GlobalID>& blockGIDs = workspace.blockGIDs;
+   blockGIDs.clear();
+   for (uint c=0; c<pencilLength; ++c) {
+      const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& vmesh = sourceCells[VLASOV_STENCIL_WIDTH + c]->get_velocity_mesh(popID);
+      for (vmesh::LocalID block_i=0; block_i<vmesh.size(); ++block_i) {
+         const vmesh::GlobalID blockGID = vmesh.getGlobalID(block_i);
+         if (blockGID % nThreads == thread) blockGIDs.push_back(blockGID);
+      }
+   }
+   sort(blockGIDs.begin(),blockGIDs.end());
+   blockGIDs.erase(unique(blockGIDs.begin(),blockGIDs.end()),blockGIDs.end());
+   if (blockGIDs.size() == 0) return true;
+
+   uint16_t cellid_transpose[WID3];
+   compute_cellid_transpose(dimension,cellid_transpose);
+
+   // Velocity mesh refinement level, has no effect here but it 
+   // is needed in some vmesh::VelocityMesh function calls.
+   const uint8_t REFLEVEL=0;
+   const vmesh::VelocityMesh<vmesh::GlobalID,vmesh::LocalID>& firstMesh = sourceCells[VLASOV_STENCIL_WIDTH]->get_velocity_mesh(popID);
+   const Realv dvz = firstMesh.getCellSize(REFLEVEL)[dimension];
+   const Realv vz_min = firstMesh.getMeshMinLimits()[dimension];
+   Realv dz;
+   switch (dimension) {
+    case 0:
+      dz = P::dx_ini;
+      break;
+    case 1:
+      dz = P::dy_ini;
+      break;
+    case 2:
+      dz = P::dz_ini;
+      break;
+    default:
+      cerr << __FILE__ << ":"<< __LINE__ << " Wrong dimension, abort"<<endl;
+      abort();
+      break;
+   }
+   const Realv i_dz=1.0/dz;
+
+   // Values are stored so that the values of the same velocity 
+   // cell in consecutive spatial cells are consecutive.
+   vector<Vec,aligned_allocator<Vec,64> >& values = workspace.values;
+   vector<Vec,aligned_allocator<Vec,64> >& target_values = workspace.targetValues;
+   vector<const Realf*>& sourceDatas = workspace.sourceDatas;
+   vector<char>& targetTouched = workspace.targetTouched;
+   vector<Real>& fusedMoments = workspace.fusedMoments;
+   values.resize(sourceLength * WID3 / VECL);
+   target_values.resize(targetLength * WID3 / VECL);
+   sourceDatas.resize(sourceLength);
+   targetTouched.resize(targetLength);
+   if (accumulateMoments == true) {
+      fusedMoments.resize(targetLength * FusedMoments::N_FUSED_MOMENTS);
+      for (int b=0; b<targetLength; ++b) {
+         initFusedMoments(fusedMoments.data() + b * FusedMoments::N_FUSED_MOMENTS,
+                          targetCells[b] == NULL ? NULL : targetCells[b]->get_fused_moments(popID));
+      }
+   }
+   
+   #define i_trans_ps_pencilv(planeVectorIndex, planeIndex, cellIndex) ( (cellIndex) + VLASOV_STENCIL_WIDTH + ( (planeVectorIndex) + (planeIndex) * VEC_PER_PLANE ) * sourceLength )
+
+   for (size_t block_i=0; block_i<blockGIDs.size(); ++block_i) {
+      const vmesh::GlobalID blockGID = blockGIDs[block_i];
+
+      // Gather the block along the whole source line
+      for (int b=0; b<sourceLength; ++b) {
+         const vmesh::LocalID blockLID = sourceCells[b]->get_velocity_block_local_id(blockGID,popID);
+         if (blockLID != SpatialCell::invalid_local_id()) sourceDatas[b] = sourceCells[b]->get_data(blockLID,popID);
+         else sourceDatas[b] = NULL;
+      }
+      for (int b=-VLASOV_STENCIL_WIDTH; b<(int)pencilLength+VLASOV_STENCIL_WIDTH; ++b) {
+         const Realf* block_data = sourceDatas[b + VLASOV_STENCIL_WIDTH];
+         if (block_data != NULL) {
+            Realv blockValues[WID3];
+            for (uint i=0; i<WID3; ++i) {
+               blockValues[i] = block_data[cellid_transpose[i]];
+            }
+            uint offset = 0;
+            for (uint k=0; k<WID; ++k) {
+               for (uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++) {
+                  values[i_trans_ps_pencilv(planeVector, k, b)].load(blockValues + offset);
+                  offset += VECL;
+               }
+            }
+         } else {
+            for (uint k=0; k<WID; ++k) {
+               for (uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++) {
+                  values[i_trans_ps_pencilv(planeVector, k, b)] = Vec(0);
+               }
+            }
+         }
+      }
+
+      for (size_t i=0; i<target_values.size(); ++i) target_values[i] = Vec(0.0);
+      for (int b=0; b<targetLength; ++b) targetTouched[b] = false;
+
+      velocity_block_indices_t block_indices;
+      uint8_t refLevel;
+      firstMesh.getIndices(blockGID,refLevel,block_indices[0],block_indices[1],block_indices[2]);
+      
+      for (uint k=0; k<WID; ++k) {
+         const Realv cell_vz = (block_indices[dimension] * WID + k + 0.5) * dvz + vz_min; //cell centered velocity
+         const Realv z_translation = cell_vz * dt * i_dz; // how much it moved in time dt (reduced units)
+         const int target_scell_index = (z_translation > 0) ? 1: -1; //part of density goes here (cell index change along spatial direcion)
+         Realv z_1,z_2;
+         if ( z_translation < 0 ) {
+            z_1 = 0;
+            z_2 = -z_translation; 
+         } else {
+            z_1 = 1.0 - z_translation;
+            z_2 = 1.0;
+         }
+
+         for (uint cc=0; cc<pencilLength; ++cc) {
+            // Only cells that have the block are mapped
+            if (sourceDatas[VLASOV_STENCIL_WIDTH + cc] == NULL) continue;
+            targetTouched[cc] = true;
+            targetTouched[cc + 1] = true;
+            targetTouched[cc + 2] = true;
+
+            for (uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++) {
+               #ifdef TRANS_SEMILAG_PLM
+                  Vec a[3];
+                  compute_plm_coeff(values.data() + i_trans_ps_pencilv(planeVector, k, (int)cc - VLASOV_STENCIL_WIDTH), VLASOV_STENCIL_WIDTH, a);
+               #endif
+               #ifdef TRANS_SEMILAG_PPM
+                  Vec a[3];
+                  compute_ppm_coeff(values.data() + i_trans_ps_pencilv(planeVector, k, (int)cc - VLASOV_STENCIL_WIDTH), h4, VLASOV_STENCIL_WIDTH, a);
+               #endif
+               #ifdef TRANS_SEMILAG_PQM
+                  Vec a[5];
+                  compute_pqm_coeff(values.data() + i_trans_ps_pencilv(planeVector, k, (int)cc - VLASOV_STENCIL_WIDTH), h6, VLASOV_STENCIL_WIDTH, a);
+               #endif
+
+               #ifdef TRANS_SEMILAG_PLM
+                  const Vec ngbr_target_density =
+                     z_2 * ( a[0] + z_2 * a[1] ) -
+                     z_1 * ( a[0] + z_1 * a[1] );
+               #endif
+               #ifdef TRANS_SEMILAG_PPM
+                  const Vec ngbr_target_density =
+                     z_2 * ( a[0] + z_2 * ( a[1] + z_2 * a[2] ) ) -
+                     z_1 * ( a[0] + z_1 * ( a[1] + z_1 * a[2] ) );
+               #endif
+               #ifdef TRANS_SEMILAG_PQM
+                  const Vec ngbr_target_density =
+                     z_2 * ( a[0] + z_2 * ( a[1] + z_2 * ( a[2] + z_2 * ( a[3] + z_2 * a[4] ) ) ) ) -
+                     z_1 * ( a[0] + z_1 * ( a[1] + z_1 * ( a[2] + z_1 * ( a[3] + z_1 * a[4] ) ) ) );
+               #endif
+               target_values[i_trans_pt_blockv(planeVector, k, (int)cc + target_scell_index)] += ngbr_target_density;
+               target_values[i_trans_pt_blockv(planeVector, k, (int)cc)] += values[i_trans_ps_pencilv(planeVector, k, (int)cc)] - ngbr_target_density;
+            }
+         }
+      }
+
+      // Store values from target_values to the target line, each target block is written once
+      for (int b=0; b<targetLength; ++b) {
+         if (targetTouched[b] == false || targetCells[b] == NULL) continue;
+         SpatialCell* spatial_cell = targetCells[b];
+         const vmesh::LocalID blockLID = spatial_cell->get_velocity_block_local_id(blockGID,popID);
+         if (blockLID == SpatialCell::invalid_local_id()) continue;
+
+         Realf* block_data = spatial_cell->get_velocity_blocks_temporary().getData(blockLID);
+         Realv blockValues[VECL];
+         Real marginals[3][WID] = {};
+         uint cellid=0;
+         for (uint k=0; k<WID; ++k) {
+            for (uint planeVector = 0; planeVector < VEC_PER_PLANE; planeVector++) {
+               target_values[i_trans_pt_blockv(planeVector, k, b - 1)].store(blockValues);
+               for (uint i = 0; i< VECL; i++) {
+                  const uint cell = cellid_transpose[cellid++];
+                  block_data[cell] += blockValues[i];
+                  if (accumulateMoments == true) {
+                     marginals[0][cell % WID]         += blockValues[i];
+                     marginals[1][(cell / WID) % WID] += blockValues[i];
+                     marginals[2][cell / WID2]        += blockValues[i];
+                  }
+               }
+            }
+         }
+         if (accumulateMoments == true) {
+            Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
+            blockVelocityFusedMoments(marginals,
+                                      spatial_cell::getBlockParameters(spatial_cell->get_velocity_mesh(popID),
+                                                                       spatial_cell->get_velocity_blocks_temporary(),
+                                                                       blockLID,paramsScratch),
+                                      fusedMoments.data() + b * FusedMoments::N_FUSED_MOMENTS);
+         }
+      }
+   }
+
+   #undef i_trans_ps_pencilv
+
+   // Add this thread's contribution to fused moments of target cells
+   if (accumulateMoments == true) {
+      for (int b=0; b<targetLength; ++b) {
+         if (targetCells[b] == NULL) continue;
+         Real* targetMoments = targetCells[b]->get_fused_moments(popID);
+         for (int m=0; m<FusedMoments::N_FUSED_SUMS; ++m) {
+            #pragma omp atomic
+            targetMoments[m] += fusedMoments[b * FusedMoments::N_FUSED_MOMENTS + m];
+         }
+      }
+   }
+   return true;
+}
+
 /*!
 
   This function communicates the mapping on process boundaries, and then updates the data to their correct values.
@@ -718,12 +1154,14 @@ bool trans_map_1d(
 
   \par dimension: 0,1,2 for x,y,z
   \par direction: 1 for + dir, -1 for - dir
+  \par accumulateMoments: if true, raw moments of the received data are added to the fused moments of the receiving cells
 */
 void update_remote_mapping_contribution(
         dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
         const uint dimension,
         int direction,
-        const int& popID) {
+        const int& popID,
+        const bool accumulateMoments) {
    
     const vector<CellID> local_cells = mpiGrid.get_cells();
     const vector<CellID> remote_cells = mpiGrid.get_remote_cells_on_process_boundary(VLASOV_SOLVER_NEIGHBORHOOD_ID);
@@ -821,10 +1259,39 @@ void update_remote_mapping_contribution(
             SpatialCell* spatial_cell = mpiGrid[receive_cells[c]];
             vmesh::VelocityBlockContainer<vmesh::LocalID>& blockContainer = spatial_cell->get_velocity_blocks_temporary();
 
+            if (accumulateMoments == false) {
+               #pragma omp for nowait
+               for(unsigned int cell=0; cell<VELOCITY_BLOCK_LENGTH*spatial_cell->get_number_of_velocity_blocks(popID); ++cell) {
+                  // copy received target data to temporary array where target data is stored.
+                  blockContainer.getData()[cell] += spatial_cell->get_data(popID)[cell];
+               }
+               continue;
+            }
+
+            // Same as above, but block by block so that moments of the received data can be accumulated
+            Real fusedMoments[FusedMoments::N_FUSED_MOMENTS];
+            initFusedMoments(fusedMoments,spatial_cell->get_fused_moments(popID));
+            Real paramsScratch[BlockParams::N_VELOCITY_BLOCK_PARAMS];
             #pragma omp for nowait
-            for(unsigned int cell=0; cell<VELOCITY_BLOCK_LENGTH*spatial_cell->get_number_of_velocity_blocks(popID); ++cell) {
-               // copy received target data to temporary array where target data is stored.
-               blockContainer.getData()[cell] += spatial_cell->get_data(popID)[cell];
+            for (vmesh::LocalID blockLID=0; blockLID<spatial_cell->get_number_of_velocity_blocks(popID); ++blockLID) {
+               Realf* targetData = blockContainer.getData(blockLID);
+               const Realf* receivedData = spatial_cell->get_data(blockLID,popID);
+               Real marginals[3][WID] = {};
+               for (uint k=0; k<WID; ++k) for (uint j=0; j<WID; ++j) for (uint i=0; i<WID; ++i) {
+                  const Realf value = receivedData[cellIndex(i,j,k)];
+                  targetData[cellIndex(i,j,k)] += value;
+                  marginals[0][i] += value;
+                  marginals[1][j] += value;
+                  marginals[2][k] += value;
+               }
+               blockVelocityFusedMoments(marginals,
+                                         spatial_cell::getBlockParameters(spatial_cell->get_velocity_mesh(popID),blockContainer,blockLID,paramsScratch),
+                                         fusedMoments);
+            }
+            Real* cellMoments = spatial_cell->get_fused_moments(popID);
+            for (int m=0; m<FusedMoments::N_FUSED_SUMS; ++m) {
+               #pragma omp atomic
+               cellMoments[m] += fusedMoments[m];
             }
         }
         // send cell data is set to zero. This is to avoid double copy if
@@ -28,17 +28,35 @@
 #include "../common.h"
 #include "../spatial_cell.hpp"
 
+/** Local translated cells grouped into pencils, i.e., lines of consecutive 
+ * cells along one spatial dimension. The cells of pencil p are 
+ * cells[offsets[p]] ... cells[offsets[p+1]-1].*/
+struct TranslationPencils {
+   std::vector<CellID> cells;    /**< Cell IDs of all pencils, ordered along the pencil dimension.*/
+   std::vector<uint> offsets;    /**< Offset of each pencil in cells, the last element is cells.size().*/
+   
+   size_t size() const {return offsets.size() < 2 ? 0 : offsets.size()-1;}
+   const CellID* getCells(const size_t& p) const {return cells.data() + offsets[p];}
+   uint getLength(const size_t& p) const {return offsets[p+1] - offsets[p];}
+};
+
 void clearTargetGrid(dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
         const std::vector<CellID>& cells);
 void createTargetGrid(dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
         const std::vector<CellID>& cells,const int& popID);
+void compute_translation_pencils(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const std::vector<CellID>& cells,const uint dimension,TranslationPencils& pencils);
 bool do_translate_cell(spatial_cell::SpatialCell* SC);
 void swapTargetSourceGrid(dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
         const std::vector<CellID>& cells,const int& popID);
 bool trans_map_1d(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-        const CellID cellID,const uint dimension,const Realv dt,const int& popID);
+        const CellID cellID,const uint dimension,const Realv dt,const int& popID,
+        const bool accumulateMoments=false);
+bool trans_map_1d_pencil(const dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const CellID* pencilCells,const uint pencilLength,const uint dimension,const Realv dt,const int& popID,
+        const bool accumulateMoments=false);
 void update_remote_mapping_contribution(dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
-        const uint dimension,int direction,const int& popID);
+        const uint dimension,int direction,const int& popID,const bool accumulateMoments=false);
 void zeroTargetGrid(dccrg::Dccrg<spatial_cell::SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
         const std::vector<CellID>& cells);
 
@@ -29,10 +29,12 @@
 \brief An interface to a type with  floating point values
 
 By setting suitable compile-time defines oen can set the length,
-accuracy and implementation of the vector. The vector length has to be
-a multiple of WID, which is 4 in Vlasiator. It also cannot be larger
-than WID*WID or 16. Thus 4, 8 or 16 are now supported. Currently
-implemented vector backends are:
+accuracy and implementation of the vector. The vector length has to
+divide WID*WID, the number of cells in a plane of a velocity block
+(WID is 4 by default, see VELOCITY_BLOCK_WIDTH in common.h). With
+WID=4 vector lengths 4, 8 and 16 are supported, with WID=8 a 16
+element vector covers two rows of a plane. Currently implemented
+vector backends are:
 
 VEC4D_AGNER
  - Double precision
@@ -49,6 +51,27 @@ VEC8F_AGNER
  - Vector length of 8
  - Use Agner's vectorclass with AVX intrinisics
 
+VEC8D_AGNER
+ - Double precision
+ - Vector length of 8
+ - Use Agner's vectorclass with AVX-512 intrinisics
+
+VEC16F_AGNER
+ - Single precision
+ - Vector length of 16
+ - Use Agner's vectorclass with AVX-512 intrinisics
+
+VEC4D_FALLBACK, VEC4F_FALLBACK, VEC8D_FALLBACK, VEC8F_FALLBACK
+ - Portable implementation without intrinsics
+
+Each backend also defines Vecd, a double precision vector with VECL
+elements, and to_vecd(v) that converts a Vec to it. With the single
+precision backends (and SPF distribution functions) this gives a mixed
+precision semi-Lagrangian solver: reconstructions are computed in float
+lanes, twice as many per register as with double precision, while the
+velocity moments of the mapped distribution are accumulated in
+double. With double precision backends Vecd is Vec. VEC16F_AGNER has no
+16 element double vector, its moments are accumulated in float.
  
 */
 
@@ -65,8 +88,8 @@ typedef double Realv;
 #define to_realv(v) to_double(v)
 #define VECL 4
 #define VPREC 8
-#define VEC_PER_PLANE 4 //vectors per plane in block
-#define VEC_PER_BLOCK 16
+typedef Vec Vecd;
+#define to_vecd(v) (v)
 #endif
 
 #ifdef VEC8D_AGNER
@@ -79,8 +102,8 @@ typedef double Realv;
 #define to_realv(v) to_double(v)
 #define VECL 8
 #define VPREC 8
-#define VEC_PER_PLANE 2 //vectors per plane in block
-#define VEC_PER_BLOCK 8
+typedef Vec Vecd;
+#define to_vecd(v) (v)
 #endif
 
 #ifdef VEC4F_AGNER
@@ -93,8 +116,8 @@ typedef float Realv;
 #define to_realv(v) to_float(v)
 #define VECL 4
 #define VPREC 4
-#define VEC_PER_PLANE 4 //vectors per plane in block
-#define VEC_PER_BLOCK 16
+typedef Vec4d Vecd;
+static inline Vecd to_vecd(Vec const & v) { return Vecd(extend_low(v), extend_high(v)); }
 #endif
 
 #ifdef VEC8F_AGNER
@@ -107,8 +130,8 @@ typedef float Realv;
 #define to_realv(v) to_float(v)
 #define VECL 8
 #define VPREC 4
-#define VEC_PER_PLANE 2 //vectors per plane in block
-#define VEC_PER_BLOCK 8
+typedef Vec8d Vecd;
+static inline Vecd to_vecd(Vec const & v) { return Vecd(extend_low(v), extend_high(v)); }
 #endif
 
 
@@ -122,8 +145,8 @@ typedef float Realv;
 #define to_realv(v) to_float(v)
 #define VECL 16
 #define VPREC 4
-#define VEC_PER_PLANE 1 //vectors per plane in block
-#define VEC_PER_BLOCK 4
+typedef Vec Vecd; //no 16 element double vector
+#define to_vecd(v) (v)
 #endif
 
 
@@ -138,8 +161,8 @@ typedef double Realv;
 #define to_realv(v) to_double(v)
 #define VECL 4
 #define VPREC 8
-#define VEC_PER_PLANE 4 //vectors per plane in block
-#define VEC_PER_BLOCK 16
+typedef Vec Vecd;
+#define to_vecd(v) (v)
 #endif
 
 #ifdef VEC4F_FALLBACK
@@ -152,8 +175,8 @@ typedef float Realv;
 #define to_realv(v) to_float(v)
 #define VECL 4
 #define VPREC 4
-#define VEC_PER_PLANE 4 //vectors per plane in block
-#define VEC_PER_BLOCK 16
+typedef Vec4Simple<double> Vecd;
+#define to_vecd(v) to_double(v)
 #endif
 
 #ifdef VEC8D_FALLBACK
@@ -166,8 +189,8 @@ typedef double Realv;
 #define to_realv(v) to_double(v)
 #define VECL 8
 #define VPREC 8
-#define VEC_PER_PLANE 2 //vectors per plane in block
-#define VEC_PER_BLOCK 8
+typedef Vec Vecd;
+#define to_vecd(v) (v)
 #endif
 
 
@@ -181,11 +204,14 @@ typedef float Realv;
 #define to_realv(v) to_float(v)
 #define VECL 8
 #define VPREC 4
-#define VEC_PER_PLANE 2 //vectors per plane in block
-#define VEC_PER_BLOCK 8
+typedef Vec8Simple<double> Vecd;
+#define to_vecd(v) to_double(v)
 #endif
 
 
+#define VEC_PER_PLANE (WID2/VECL) //vectors per plane in block
+#define VEC_PER_BLOCK (WID3/VECL) //vectors per block
+
 const Vec one(1.0);
 const Vec minus_one(-1.0);
 const Vec two(2.0);
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <vector>
 #include <stdint.h>
+#include <unordered_set>
 
 #ifdef _OPENMP
    #include <omp.h>
@@ -41,6 +42,7 @@
 
 #include "cpu_moments.h"
 #include "cpu_acc_semilag.hpp"
+#include "cpu_acc_workspace.hpp"
 #include "cpu_trans_map.hpp"
 
 using namespace std;
@@ -54,6 +56,102 @@ creal ONE     = 1.0;
 creal TWO     = 2.0;
 creal EPSILON = 1.0e-25;
 
+/** Map the distribution function of the given cells along one dimension. 
+ * If pencils are in use the cells are mapped pencil by pencil, otherwise 
+ * one cell at a time. This function must be called by all threads in an 
+ * OpenMP parallel region.
+ * @param mpiGrid Parallel grid.
+ * @param cells Local cells that are translated.
+ * @param pencils The same cells grouped into pencils along dimension.
+ * @param dimension Translated dimension, 0,1,2 for x,y,z.
+ * @param dt Time step.
+ * @param popID ID of the translated particle species.
+ * @param accumulateMoments If true, fused moments of the target cells are accumulated.*/
+static void translateCells(
+        const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const vector<CellID>& cells,
+        const TranslationPencils& pencils,
+        const uint dimension,
+        creal dt,
+        const int& popID,
+        const bool accumulateMoments) {
+   // Every thread maps a part of the blocks of each cell, so each thread adds the
+   // time it spent on a cell to its weight. The sum over threads is the compute
+   // time of the cell, comparable to the acceleration time of one thread per cell.
+   if (P::vlasovSolverPencils == false) {
+      for (size_t c=0; c<cells.size(); ++c) {
+         Real t_start = 0;
+         if (Parameters::prepareForRebalance == true) t_start = MPI_Wtime();
+
+         trans_map_1d(mpiGrid,cells[c],dimension,dt,popID,accumulateMoments);
+
+         if (Parameters::prepareForRebalance == true) {
+            const Real t_cell = MPI_Wtime()-t_start;
+            Real& weight = mpiGrid[cells[c]]->get_cell_parameters()[CellParams::LBWEIGHTCOUNTER];
+            #pragma omp atomic
+            weight += t_cell;
+         }
+      }
+      return;
+   }
+
+   for (size_t p=0; p<pencils.size(); ++p) {
+      Real t_start = 0;
+      if (Parameters::prepareForRebalance == true) t_start = MPI_Wtime();
+
+      trans_map_1d_pencil(mpiGrid,pencils.getCells(p),pencils.getLength(p),dimension,dt,popID,accumulateMoments);
+
+      // Pencil time is divided evenly between its cells
+      if (Parameters::prepareForRebalance == true) {
+         const Real t_cell = (MPI_Wtime()-t_start) / pencils.getLength(p);
+         for (uint c=0; c<pencils.getLength(p); ++c) {
+            Real& weight = mpiGrid[pencils.getCells(p)[c]]->get_cell_parameters()[CellParams::LBWEIGHTCOUNTER];
+            #pragma omp atomic
+            weight += t_cell;
+         }
+      }
+   }
+}
+
+/** Split the given local cells into process inner cells, i.e., cells whose 
+ * neighbors in the given neighborhood are all local, and process boundary cells. 
+ * The relative order of the cells is preserved.
+ * @param mpiGrid Parallel grid.
+ * @param cells Local cells to split.
+ * @param neighborhood ID of the neighborhood used in the check.
+ * @param innerCells Cells that do not have remote neighbors.
+ * @param boundaryCells Cells that have at least one remote neighbor.*/
+static void splitProcessBoundaryCells(
+        const dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const vector<CellID>& cells,
+        const int neighborhood,
+        vector<CellID>& innerCells,
+        vector<CellID>& boundaryCells) {
+   const vector<CellID> cellsOnProcessBoundary = mpiGrid.get_local_cells_on_process_boundary(neighborhood);
+   const unordered_set<CellID> processBoundary(cellsOnProcessBoundary.begin(),cellsOnProcessBoundary.end());
+
+   innerCells.clear();
+   boundaryCells.clear();
+   for (size_t c=0; c<cells.size(); ++c) {
+      if (processBoundary.count(cells[c]) > 0) boundaryCells.push_back(cells[c]);
+      else innerCells.push_back(cells[c]);
+   }
+}
+
+/** Clear fused moments of the given species in the given cells.
+ * @param mpiGrid Parallel grid.
+ * @param cells Spatial cells whose fused moments are cleared.
+ * @param popID ID of the particle species.*/
+static void clearFusedMoments(
+        dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
+        const vector<CellID>& cells,
+        const int& popID) {
+   #pragma omp parallel for
+   for (size_t c=0; c<cells.size(); ++c) {
+      mpiGrid[cells[c]]->clear_fused_moments(popID);
+   }
+}
+
 /** Propagates the distribution function in spatial space. 
     
     Based on SLICE-3D algorithm: Zerroukat, M., and T. Allen. "A
@@ -65,17 +163,29 @@ creal EPSILON = 1.0e-25;
 void calculateSpatialTranslation(
         dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>& mpiGrid,
         const vector<CellID>& localCells,
-        const vector<CellID>& local_propagated_cells,
+        const vector<CellID> innerCells[3],
+        const vector<CellID> boundaryCells[3],
         const vector<CellID>& local_target_cells,
         const vector<CellID>& remoteTargetCellsx,
         const vector<CellID>& remoteTargetCellsy,
         const vector<CellID>& remoteTargetCellsz,
+        const TranslationPencils innerPencils[3],
+        const TranslationPencils boundaryPencils[3],
         creal dt,
         const int& popID) {
 
     int trans_timer;
     bool localTargetGridGenerated = false;
 
+    // If moments are fused, they are accumulated in the last translated 
+    // dimension, otherwise fusedDimension is not a valid dimension.
+    uint fusedDimension = 3;
+    if (P::fuseMoments == true) {
+       if (P::ycells_ini > 1) fusedDimension = 1;
+       else if (P::xcells_ini > 1) fusedDimension = 0;
+       else if (P::zcells_ini > 1) fusedDimension = 2;
+    }
+
     // ------------- SLICE - map dist function in Z --------------- //
    if(P::zcells_ini > 1 ){
       trans_timer=phiprof::initializeTimer("transfer-stencil-data-z","MPI");
@@ -93,28 +203,31 @@ void calculateSpatialTranslation(
          localTargetGridGenerated=true;
       }
 
+      if (fusedDimension == 2) {
+         clearFusedMoments(mpiGrid,local_target_cells,popID);
+         clearFusedMoments(mpiGrid,remoteTargetCellsz,popID);
+      }
+
+      // Map cells whose stencil is local while the stencil data is in flight
+      phiprof::start("compute-mapping-inner-z");
+      #pragma omp parallel
+      {
+         no_subnormals();
+         translateCells(mpiGrid,innerCells[2],innerPencils[2],2,dt,popID,fusedDimension==2); // map along z//
+      }
+      phiprof::stop("compute-mapping-inner-z",innerCells[2].size(),"Spatial Cells");
+
       phiprof::start(trans_timer);
       mpiGrid.wait_remote_neighbor_copy_update_receives(VLASOV_SOLVER_Z_NEIGHBORHOOD_ID);
       phiprof::stop(trans_timer);
-      
-      phiprof::start("compute-mapping-z");
+
+      phiprof::start("compute-mapping-boundary-z");
       #pragma omp parallel
       {
-         const int tid = omp_get_thread_num();
          no_subnormals();
-         for (size_t c=0; c<local_propagated_cells.size(); ++c) {
-            Real t_start = 0;
-            if (tid == 0) if (Parameters::prepareForRebalance == true) t_start = MPI_Wtime();
-
-            trans_map_1d(mpiGrid,local_propagated_cells[c], 2, dt,popID); // map along z//
-
-            if (tid == 0) if (Parameters::prepareForRebalance == true) {
-               mpiGrid[local_propagated_cells[c]]->get_cell_parameters()[CellParams::LBWEIGHTCOUNTER] 
-                       += (MPI_Wtime()-t_start);
-            }
-         }
+         translateCells(mpiGrid,boundaryCells[2],boundaryPencils[2],2,dt,popID,fusedDimension==2); // map along z//
       }
-      phiprof::stop("compute-mapping-z");
+      phiprof::stop("compute-mapping-boundary-z",boundaryCells[2].size(),"Spatial Cells");
 
       phiprof::start(trans_timer);
       mpiGrid.wait_remote_neighbor_copy_update_sends();
@@ -122,8 +235,8 @@ void calculateSpatialTranslation(
 
       trans_timer=phiprof::initializeTimer("update_remote-z","MPI");
       phiprof::start("update_remote-z");
-      update_remote_mapping_contribution(mpiGrid, 2,+1,popID);
-      update_remote_mapping_contribution(mpiGrid, 2,-1,popID);
+      update_remote_mapping_contribution(mpiGrid, 2,+1,popID,fusedDimension==2);
+      update_remote_mapping_contribution(mpiGrid, 2,-1,popID,fusedDimension==2);
       phiprof::stop("update_remote-z");
 
       clearTargetGrid(mpiGrid,remoteTargetCellsz);
@@ -145,28 +258,31 @@ void calculateSpatialTranslation(
          localTargetGridGenerated=true;
       }
 
+      if (fusedDimension == 0) {
+         clearFusedMoments(mpiGrid,local_target_cells,popID);
+         clearFusedMoments(mpiGrid,remoteTargetCellsx,popID);
+      }
+
+      // Map cells whose stencil is local while the stencil data is in flight
+      phiprof::start("compute-mapping-inner-x");
+      #pragma omp parallel
+      {
+         no_subnormals();
+         translateCells(mpiGrid,innerCells[0],innerPencils[0],0,dt,popID,fusedDimension==0); // map along x//
+      }
+      phiprof::stop("compute-mapping-inner-x",innerCells[0].size(),"Spatial Cells");
+
       phiprof::start(trans_timer);
       mpiGrid.wait_remote_neighbor_copy_update_receives(VLASOV_SOLVER_X_NEIGHBORHOOD_ID);
       phiprof::stop(trans_timer);
 
-      phiprof::start("compute-mapping-x");
+      phiprof::start("compute-mapping-boundary-x");
       #pragma omp parallel
       {
-         const int tid = omp_get_thread_num();
          no_subnormals();
-         for (size_t c=0; c<local_propagated_cells.size(); ++c) {
-            Real t_start = 0;
-            if (tid == 0) if (Parameters::prepareForRebalance == true) t_start = MPI_Wtime();
-
-            trans_map_1d(mpiGrid,local_propagated_cells[c],0,dt,popID); // map along x//
-
-            if (tid == 0) if (Parameters::prepareForRebalance == true) {
-               mpiGrid[local_propagated_cells[c]]->get_cell_parameters()[CellParams::LBWEIGHTCOUNTER] 
-                       += (MPI_Wtime()-t_start);
-            }
-         }
+         translateCells(mpiGrid,boundaryCells[0],boundaryPencils[0],0,dt,popID,fusedDimension==0); // map along x//
       }
-      phiprof::stop("compute-mapping-x");
+      phiprof::stop("compute-mapping-boundary-x",boundaryCells[0].size(),"Spatial Cells");
 
       phiprof::start(trans_timer);
       mpiGrid.wait_remote_neighbor_copy_update_sends();
@@ -174,8 +290,8 @@ void calculateSpatialTranslation(
 
       trans_timer=phiprof::initializeTimer("update_remote-x","MPI");
       phiprof::start("update_remote-x");
-      update_remote_mapping_contribution(mpiGrid, 0,+1,popID);
-      update_remote_mapping_contribution(mpiGrid, 0,-1,popID);
+      update_remote_mapping_contribution(mpiGrid, 0,+1,popID,fusedDimension==0);
+      update_remote_mapping_contribution(mpiGrid, 0,-1,popID,fusedDimension==0);
       phiprof::stop("update_remote-x");
       clearTargetGrid(mpiGrid,remoteTargetCellsx);
       swapTargetSourceGrid(mpiGrid, local_target_cells,popID);
@@ -196,28 +312,31 @@ void calculateSpatialTranslation(
          localTargetGridGenerated=true;
       }
       
+      if (fusedDimension == 1) {
+         clearFusedMoments(mpiGrid,local_target_cells,popID);
+         clearFusedMoments(mpiGrid,remoteTargetCellsy,popID);
+      }
+
+      // Map cells whose stencil is local while the stencil data is in flight
+      phiprof::start("compute-mapping-inner-y");
+      #pragma omp parallel
+      {
+         no_subnormals();
+         translateCells(mpiGrid,innerCells[1],innerPencils[1],1,dt,popID,fusedDimension==1); // map along y//
+      }
+      phiprof::stop("compute-mapping-inner-y",innerCells[1].size(),"Spatial Cells");
+
       phiprof::start(trans_timer);
       mpiGrid.wait_remote_neighbor_copy_update_receives(VLASOV_SOLVER_Y_NEIGHBORHOOD_ID);
       phiprof::stop(trans_timer);
 
-      phiprof::start("compute-mapping-y");
+      phiprof::start("compute-mapping-boundary-y");
       #pragma omp parallel
       {
-         const int tid = omp_get_thread_num();
          no_subnormals();
-         for (size_t c=0; c<local_propagated_cells.size(); ++c) {
-            Real t_start = 0;
-            if (tid == 0) if (Parameters::prepareForRebalance == true) t_start = MPI_Wtime();
-            
-            trans_map_1d(mpiGrid,local_propagated_cells[c],1,dt,popID); // map along y//
-            
-            if (tid == 0) if (Parameters::prepareForRebalance == true) {
-               mpiGrid[local_propagated_cells[c]]->get_cell_parameters()[CellParams::LBWEIGHTCOUNTER] 
-                       += (MPI_Wtime()-t_start);
-            }
-         }
+         translateCells(mpiGrid,boundaryCells[1],boundaryPencils[1],1,dt,popID,fusedDimension==1); // map along y//
       }
-      phiprof::stop("compute-mapping-y");
+      phiprof::stop("compute-mapping-boundary-y",boundaryCells[1].size(),"Spatial Cells");
 
       phiprof::start(trans_timer);
       mpiGrid.wait_remote_neighbor_copy_update_sends();
@@ -225,13 +344,20 @@ void calculateSpatialTranslation(
       
       trans_timer=phiprof::initializeTimer("update_remote-y","MPI");
       phiprof::start("update_remote-y");
-      update_remote_mapping_contribution(mpiGrid, 1,+1,popID);
-      update_remote_mapping_contribution(mpiGrid, 1,-1,popID);
+      update_remote_mapping_contribution(mpiGrid, 1,+1,popID,fusedDimension==1);
+      update_remote_mapping_contribution(mpiGrid, 1,-1,popID,fusedDimension==1);
       phiprof::stop("update_remote-y");
       clearTargetGrid(mpiGrid,remoteTargetCellsy);
       swapTargetSourceGrid(mpiGrid, local_target_cells,popID);
    }
 
+   // Distribution function in target cells is now final, fused moments can be used
+   if (fusedDimension < 3) {
+      for (size_t c=0; c<local_target_cells.size(); ++c) {
+         mpiGrid[local_target_cells[c]]->set_fused_moments_valid(popID,true);
+      }
+   }
+
    clearTargetGrid(mpiGrid,local_target_cells);
 }
 
@@ -258,6 +384,11 @@ void calculateSpatialTranslation(
    vector<CellID> remoteTargetCellsz;
    vector<CellID> local_propagated_cells;
    vector<CellID> local_target_cells;
+   vector<CellID> innerCells[3];
+   vector<CellID> boundaryCells[3];
+   TranslationPencils innerPencils[3];
+   TranslationPencils boundaryPencils[3];
+   const int stencilNeighborhoods[3] = {VLASOV_SOLVER_X_NEIGHBORHOOD_ID,VLASOV_SOLVER_Y_NEIGHBORHOOD_ID,VLASOV_SOLVER_Z_NEIGHBORHOOD_ID};
    
    // If dt=0 we are either initializing or distribution functions are not translated. 
    // In both cases go to the end of this function and calculate the moments.
@@ -283,6 +414,17 @@ void calculateSpatialTranslation(
          local_target_cells.push_back(localCells[c]);
       }
    }
+
+   // Split translated cells into process inner and process boundary cells 
+   // separately for each dimension, and group them into pencils
+   for (uint dimension=0; dimension<3; ++dimension) {
+      splitProcessBoundaryCells(mpiGrid,local_propagated_cells,stencilNeighborhoods[dimension],
+                                innerCells[dimension],boundaryCells[dimension]);
+      if (P::vlasovSolverPencils == true) {
+         compute_translation_pencils(mpiGrid,innerCells[dimension],dimension,innerPencils[dimension]);
+         compute_translation_pencils(mpiGrid,boundaryCells[dimension],dimension,boundaryPencils[dimension]);
+      }
+   }
    phiprof::stop("compute_cell_lists");
 
    // Translate all particle species
@@ -290,9 +432,9 @@ void calculateSpatialTranslation(
       string profName = "translate "+getObjectWrapper().particleSpecies[popID].name;
       phiprof::start(profName);
       SpatialCell::setCommunicatedSpecies(popID);
-      calculateSpatialTranslation(mpiGrid,localCells,local_propagated_cells,
+      calculateSpatialTranslation(mpiGrid,localCells,innerCells,boundaryCells,
                                   local_target_cells,remoteTargetCellsx,remoteTargetCellsy,
-                                  remoteTargetCellsz,dt,popID);
+                                  remoteTargetCellsz,innerPencils,boundaryPencils,dt,popID);
       phiprof::stop(profName);
    }
 
@@ -407,6 +549,9 @@ void calculateAcceleration(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
       goto momentCalculation;
    }
    phiprof::start("semilag-acc");
+   // Count growths of the acceleration scratch buffers in this step, should be zero once they have 
+   // warmed up unless block columns are cached in the cells (see AccelerationWorkspace)
+   AccelerationWorkspace::resetAllocations();
     
    
    // Accelerate all particle species
@@ -460,7 +605,7 @@ void calculateAcceleration(dccrg::Dccrg<SpatialCell,dccrg::Cartesian_Geometry>&
        adjustVelocityBlocks(mpiGrid, cells, true, popID);
     } // for-loop over particle species
 
-    phiprof::stop("semilag-acc");
+    phiprof::stop("semilag-acc",AccelerationWorkspace::getAllocations(),"Workspace allocations");
 
    // Recalculate "_V" velocity moments
 momentCalculation: